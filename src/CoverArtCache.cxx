@@ -0,0 +1,169 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CoverArtCache.hxx"
+#include "TagFile.hxx"
+#include "tag/Handler.hxx"
+#include "tag/Generic.hxx"
+#include "protocol/Ack.hxx"
+#include "fs/FileInfo.hxx"
+#include "util/ConstBuffer.hxx"
+
+namespace {
+
+/**
+ * Copies the first picture to a #CoverArtCache::Picture.
+ */
+class CollectPictureHandler final : public NullTagHandler {
+	CoverArtCache::Picture &picture;
+
+public:
+	explicit CollectPictureHandler(CoverArtCache::Picture &_picture) noexcept
+		:NullTagHandler(WANT_PICTURE), picture(_picture) {}
+
+	void OnPicture(const char *mime_type,
+		       ConstBuffer<void> buffer) noexcept override {
+		if (picture.found)
+			/* only use the first picture */
+			return;
+
+		picture.found = true;
+
+		if (mime_type != nullptr)
+			picture.mime_type = mime_type;
+
+		const auto *data = (const std::byte *)buffer.data;
+		picture.data.assign(data, data + buffer.size);
+	}
+};
+
+}
+
+CoverArtCache::CoverArtCache() noexcept = default;
+CoverArtCache::~CoverArtCache() noexcept = default;
+
+std::shared_ptr<const CoverArtCache::Picture>
+CoverArtCache::GetPicture(Path path_fs)
+{
+	FileInfo info;
+	if (!GetFileInfo(path_fs, info) || !info.IsRegular())
+		/* this may be a song inside a container
+		   (e.g. a CUE sheet) */
+		return nullptr;
+
+	const FileStamp stamp{info.GetModificationTime(), info.GetSize()};
+	AllocatedPath key(path_fs);
+
+	for (auto i = pictures.begin(); i != pictures.end(); ++i) {
+		if (i->path != key)
+			continue;
+
+		if (i->stamp == stamp) {
+			pictures.splice(pictures.begin(), pictures, i);
+			return i->picture;
+		}
+
+		/* the file has been modified */
+		pictures_size -= i->picture->data.size();
+		pictures.erase(i);
+		break;
+	}
+
+	auto picture = std::make_shared<Picture>();
+	CollectPictureHandler handler(*picture);
+	if (!ScanFileTagsNoGeneric(path_fs, handler))
+		throw ProtocolError(ACK_ERROR_NO_EXIST, "Failed to load file");
+
+	ScanGenericTags(path_fs, handler);
+
+	const std::size_t size = picture->data.size();
+	if (size > MAX_PICTURE_SIZE)
+		return picture;
+
+	pictures.push_front({std::move(key), stamp, picture});
+	pictures_size += size;
+	EvictPictures();
+
+	return picture;
+}
+
+void
+CoverArtCache::EvictPictures() noexcept
+{
+	while (pictures_size > MAX_PICTURES_SIZE ||
+	       pictures.size() > MAX_PICTURES) {
+		pictures_size -= pictures.back().picture->data.size();
+		pictures.pop_back();
+	}
+}
+
+std::shared_ptr<const CoverArtCache::CoverFile>
+CoverArtCache::GetCoverFile(Path directory_fs)
+{
+	FileInfo info;
+	if (!GetFileInfo(directory_fs, info) || !info.IsDirectory())
+		throw ProtocolError(ACK_ERROR_NO_EXIST, "No file exists");
+
+	/* the directory's modification time changes when a cover
+	   file gets added, removed or renamed */
+	const FileStamp directory_stamp{info.GetModificationTime(),
+					info.GetSize()};
+	AllocatedPath key(directory_fs);
+
+	for (auto i = cover_files.begin(); i != cover_files.end(); ++i) {
+		if (i->directory != key)
+			continue;
+
+		if (i->directory_stamp == directory_stamp &&
+		    (i->path.IsNull() ||
+		     (GetFileInfo(i->path, info) &&
+		      i->stamp == FileStamp{info.GetModificationTime(),
+					    info.GetSize()}))) {
+			cover_files.splice(cover_files.begin(), cover_files, i);
+			return i->file;
+		}
+
+		/* the directory or the cover file has been modified */
+		cover_files.erase(i);
+		break;
+	}
+
+	CoverFileItem item{std::move(key), directory_stamp,
+			   nullptr, {}, nullptr};
+
+	auto file = std::make_shared<CoverFile>();
+	for (const char *name : cover_names) {
+		auto path = AllocatedPath::Build(directory_fs,
+						 AllocatedPath::FromUTF8(name));
+		if (GetFileInfo(path, info) && info.IsRegular() &&
+		    file->fd.OpenReadOnly(path.c_str())) {
+			file->size = info.GetSize();
+			item.path = std::move(path);
+			item.stamp = {info.GetModificationTime(), file->size};
+			break;
+		}
+	}
+
+	item.file = file;
+	cover_files.push_front(std::move(item));
+	if (cover_files.size() > MAX_COVER_FILES)
+		cover_files.pop_back();
+
+	return file;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_COVER_ART_CACHE_HXX
+#define MPD_COVER_ART_CACHE_HXX
+
+#include "fs/AllocatedPath.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A cache for the "albumart" and "readpicture" commands.  Clients
+ * download pictures in chunks of Response::MAX_BINARY_SIZE bytes,
+ * i.e. they send many requests for the same file, and a client
+ * showing a grid of album covers sends lots of them at once.
+ * Without this cache, each request would probe the directory for
+ * cover files again, or scan the song's tags (and decode its
+ * embedded picture) again.
+ *
+ * Only local files are cached.  Each entry remembers the
+ * modification time and size of the files it was obtained from, and
+ * is discarded when they change.
+ *
+ * This class is not thread-safe; it is only used by the main thread.
+ * Values are shared with the callers, so they remain valid even if
+ * the entry gets evicted meanwhile.
+ */
+class CoverArtCache {
+public:
+	/**
+	 * The file names which are tried by the "albumart" command,
+	 * in this order.
+	 */
+	static constexpr const char *cover_names[] = {
+		"cover.png",
+		"cover.jpg",
+		"cover.tiff",
+		"cover.bmp",
+	};
+
+	/**
+	 * The first picture embedded in a song file.
+	 */
+	struct Picture {
+		/**
+		 * Was a picture found at all?
+		 */
+		bool found = false;
+
+		std::string mime_type;
+
+		std::vector<std::byte> data;
+	};
+
+	/**
+	 * The cover file of a directory.
+	 */
+	struct CoverFile {
+		/**
+		 * An open file descriptor, or undefined if the
+		 * directory does not contain a cover file.
+		 */
+		UniqueFileDescriptor fd;
+
+		uint64_t size = 0;
+	};
+
+private:
+	/**
+	 * Identifies a version of a file (or a directory).
+	 */
+	struct FileStamp {
+		std::chrono::system_clock::time_point mtime;
+		uint64_t size;
+
+		bool operator==(const FileStamp &other) const noexcept {
+			return mtime == other.mtime && size == other.size;
+		}
+	};
+
+	struct PictureItem {
+		AllocatedPath path;
+		FileStamp stamp;
+		std::shared_ptr<const Picture> picture;
+	};
+
+	struct CoverFileItem {
+		AllocatedPath directory;
+		FileStamp directory_stamp;
+
+		/**
+		 * The path of the cover file; "nulled" if there is
+		 * none.
+		 */
+		AllocatedPath path;
+		FileStamp stamp;
+
+		std::shared_ptr<const CoverFile> file;
+	};
+
+	/**
+	 * The maximum total size of all pictures in #pictures.
+	 */
+	static constexpr std::size_t MAX_PICTURES_SIZE = 32 * 1024 * 1024;
+
+	/**
+	 * Larger pictures are not cached.
+	 */
+	static constexpr std::size_t MAX_PICTURE_SIZE = MAX_PICTURES_SIZE / 4;
+
+	static constexpr std::size_t MAX_PICTURES = 256;
+
+	/**
+	 * The maximum number of entries in #cover_files; this limits
+	 * the number of file descriptors kept open.
+	 */
+	static constexpr std::size_t MAX_COVER_FILES = 64;
+
+	/**
+	 * The most recently used entry is at the front.
+	 */
+	std::list<PictureItem> pictures;
+
+	/**
+	 * The total size of all pictures in #pictures.
+	 */
+	std::size_t pictures_size = 0;
+
+	/**
+	 * The most recently used entry is at the front.
+	 */
+	std::list<CoverFileItem> cover_files;
+
+public:
+	CoverArtCache() noexcept;
+	~CoverArtCache() noexcept;
+
+	CoverArtCache(const CoverArtCache &) = delete;
+	CoverArtCache &operator=(const CoverArtCache &) = delete;
+
+	/**
+	 * Obtain the first picture embedded in the given song file.
+	 * On a cache miss, the file's tags are scanned.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the picture or nullptr if the path does not refer
+	 * to a regular file (the caller should then fall back to
+	 * TagScanAny())
+	 */
+	std::shared_ptr<const Picture> GetPicture(Path path_fs);
+
+	/**
+	 * Find and open the cover file (see #cover_names) in the
+	 * given directory.
+	 *
+	 * Throws on error.
+	 */
+	std::shared_ptr<const CoverFile> GetCoverFile(Path directory_fs);
+
+private:
+	void EvictPictures() noexcept;
+};
+
+#endif
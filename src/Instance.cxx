@@ -23,7 +23,9 @@
 #include "IdleFlags.hxx"
 #include "StateFile.hxx"
 #include "Stats.hxx"
+#include "CoverArtCache.hxx"
 #include "client/List.hxx"
+#include "client/BackgroundCommandPool.hxx"
 #include "input/cache/Manager.hxx"
 
 #ifdef ENABLE_CURL
@@ -32,6 +34,7 @@
 #endif
 
 #ifdef ENABLE_DATABASE
+#include "db/AggregateCache.hxx"
 #include "db/DatabaseError.hxx"
 #include "db/Interface.hxx"
 #include "db/update/Service.hxx"
@@ -52,12 +55,18 @@ Instance::Instance()
 #ifdef ENABLE_SYSTEMD_DAEMON
 	 systemd_watchdog(event_loop),
 #endif
-	 idle_monitor(event_loop, BIND_THIS_METHOD(OnIdle))
+	 idle_monitor(event_loop, BIND_THIS_METHOD(OnIdle)),
+	 cover_art_cache(std::make_unique<CoverArtCache>())
 {
 }
 
 Instance::~Instance() noexcept
 {
+	/* wait for running background commands before the database
+	   gets closed */
+	if (command_pool)
+		command_pool->Stop();
+
 #ifdef ENABLE_DATABASE
 	delete update;
 
@@ -121,6 +130,7 @@ Instance::OnDatabaseModified() noexcept
 	/* propagate the change to all subsystems */
 
 	stats_invalidate();
+	InvalidateAggregateCaches();
 
 	for (auto &partition : partitions)
 		partition.DatabaseModified(*database);
@@ -50,11 +50,13 @@ class UpdateService;
 #include <list>
 
 class ClientList;
+class BackgroundCommandPool;
 struct Partition;
 class StateFile;
 class RemoteTagCache;
 class StickerDatabase;
 class InputCacheManager;
+class CoverArtCache;
 
 /**
  * A utility class which, when used as the first base class, ensures
@@ -127,8 +129,20 @@ struct Instance final
 	std::unique_ptr<RemoteTagCache> remote_tag_cache;
 #endif
 
+	/**
+	 * Worker threads for expensive read-only commands.  nullptr
+	 * if disabled.  This is declared before #client_list, because
+	 * clients may still refer to it when they get destroyed.
+	 */
+	std::unique_ptr<BackgroundCommandPool> command_pool;
+
 	std::unique_ptr<ClientList> client_list;
 
+	/**
+	 * Used by the "albumart" and "readpicture" commands.
+	 */
+	std::unique_ptr<CoverArtCache> cover_art_cache;
+
 	std::list<Partition> partitions;
 
 	std::unique_ptr<StateFile> state_file;
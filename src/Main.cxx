@@ -29,6 +29,7 @@
 #include "Listen.hxx"
 #include "client/Config.hxx"
 #include "client/List.hxx"
+#include "client/BackgroundCommandPool.hxx"
 #include "command/AllCommands.hxx"
 #include "Partition.hxx"
 #include "tag/Config.hxx"
@@ -120,9 +121,14 @@ static constexpr size_t MEGABYTE = 1024 * KILOBYTE;
 
 static constexpr size_t DEFAULT_BUFFER_SIZE = 4 * MEGABYTE;
 
-static constexpr
-size_t MIN_BUFFER_SIZE = std::max(CHUNK_SIZE * 32,
-				  64 * KILOBYTE);
+/**
+ * The minimum buffer size is 32 chunks (but at least 64 kB).
+ */
+static constexpr size_t
+GetMinBufferSize(size_t chunk_size) noexcept
+{
+	return std::max(chunk_size * 32, 64 * KILOBYTE);
+}
 
 #ifdef ANDROID
 Context *context;
@@ -276,28 +282,45 @@ initialize_decoder_and_player(Instance &instance,
 {
 	const ConfigParam *param;
 
+	size_t chunk_size = CHUNK_SIZE;
+	param = config.GetParam(ConfigOption::AUDIO_BUFFER_CHUNK_SIZE);
+	if (param != nullptr) {
+		chunk_size = param->With([](const char *s){
+			size_t result = ParseSize(s, KILOBYTE);
+			if (result < CHUNK_SIZE || result > MAX_CHUNK_SIZE)
+				throw FormatRuntimeError("chunk size \"%s\" is out of "
+							 "range (%lu..%lu)", s,
+							 (unsigned long)CHUNK_SIZE,
+							 (unsigned long)MAX_CHUNK_SIZE);
+
+			return result;
+		});
+	}
+
+	const size_t min_buffer_size = GetMinBufferSize(chunk_size);
+
 	size_t buffer_size;
 	param = config.GetParam(ConfigOption::AUDIO_BUFFER_SIZE);
 	if (param != nullptr) {
-		buffer_size = param->With([](const char *s){
+		buffer_size = param->With([min_buffer_size](const char *s){
 			size_t result = ParseSize(s, KILOBYTE);
 			if (result <= 0)
 				throw FormatRuntimeError("buffer size \"%s\" is not a "
 							 "positive integer", s);
 
-			if (result < MIN_BUFFER_SIZE) {
+			if (result < min_buffer_size) {
 				FormatWarning(config_domain, "buffer size %lu is too small, using %lu bytes instead",
 					      (unsigned long)result,
-					      (unsigned long)MIN_BUFFER_SIZE);
-				result = MIN_BUFFER_SIZE;
+					      (unsigned long)min_buffer_size);
+				result = min_buffer_size;
 			}
 
 			return result;
 		});
 	} else
-		buffer_size = DEFAULT_BUFFER_SIZE;
+		buffer_size = std::max(DEFAULT_BUFFER_SIZE, min_buffer_size);
 
-	const unsigned buffered_chunks = buffer_size / CHUNK_SIZE;
+	const unsigned buffered_chunks = buffer_size / chunk_size;
 
 	if (buffered_chunks >= 1 << 15)
 		throw FormatRuntimeError("buffer size \"%lu\" is too big",
@@ -318,6 +341,7 @@ initialize_decoder_and_player(Instance &instance,
 					 "default",
 					 max_length,
 					 buffered_chunks,
+					 chunk_size,
 					 configured_audio_format,
 					 replay_gain_config);
 	auto &partition = instance.partitions.back();
@@ -448,6 +472,14 @@ MainConfigured(const struct options &options, const ConfigData &raw_config)
 	}
 
 	client_manager_init(raw_config);
+
+#ifdef ENABLE_DATABASE
+	const unsigned command_threads =
+		raw_config.GetUnsigned(ConfigOption::COMMAND_THREADS, 2);
+	if (command_threads > 0)
+		instance.command_pool =
+			std::make_unique<BackgroundCommandPool>(command_threads);
+#endif
 	const ScopeInputPluginsInit input_plugins_init(raw_config,
 						       instance.io_thread.GetEventLoop());
 
@@ -22,15 +22,25 @@
 
 #include <cassert>
 
-MusicBuffer::MusicBuffer(unsigned num_chunks)
-	:buffer(num_chunks) {
+MusicBuffer::MusicBuffer(unsigned num_chunks, size_t _chunk_size)
+	:chunk_size(_chunk_size),
+	 buffer(num_chunks, chunk_size)
+{
+	assert(chunk_size >= CHUNK_SIZE);
+	assert(chunk_size <= MAX_CHUNK_SIZE);
+}
+
+size_t
+MusicBuffer::GetChunkCapacity() const noexcept
+{
+	return MusicChunk::GetCapacity(chunk_size);
 }
 
 MusicChunkPtr
 MusicBuffer::Allocate() noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-	return MusicChunkPtr(buffer.Allocate(), MusicChunkDeleter(*this));
+	return MusicChunkPtr(buffer.Allocate(chunk_size),
+			     MusicChunkDeleter(*this));
 }
 
 void
@@ -38,13 +48,8 @@ MusicBuffer::Return(MusicChunk *chunk) noexcept
 {
 	assert(chunk != nullptr);
 
-	/* these attributes need to be cleared before locking the
-	   mutex, because they might recursively call this method,
-	   causing a deadlock */
-	chunk->next.reset();
-	chunk->other.reset();
-
-	const std::lock_guard<Mutex> protect(mutex);
+	/* the chunk must have been removed from the MusicPipe */
+	assert(chunk->next.load(std::memory_order_relaxed) == nullptr);
 
 	assert(!chunk->other || !chunk->other->other);
 
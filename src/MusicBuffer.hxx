@@ -21,15 +21,18 @@
 #define MPD_MUSIC_BUFFER_HXX
 
 #include "MusicChunkPtr.hxx"
+#include "MusicChunk.hxx"
 #include "util/SliceBuffer.hxx"
-#include "thread/Mutex.hxx"
 
 /**
- * An allocator for #MusicChunk objects.
+ * An allocator for #MusicChunk objects.  All methods are thread-safe
+ * and lock-free.
  */
 class MusicBuffer {
-	/** a mutex which protects #buffer */
-	mutable Mutex mutex;
+	/**
+	 * The size of each #MusicChunk including its header.
+	 */
+	const size_t chunk_size;
 
 	SliceBuffer<MusicChunk> buffer;
 
@@ -39,14 +42,17 @@ public:
 	 *
 	 * @param num_chunks the number of #MusicChunk reserved in
 	 * this buffer
+	 * @param _chunk_size the size of each #MusicChunk including
+	 * its header; must be between #CHUNK_SIZE and
+	 * #MAX_CHUNK_SIZE
 	 */
-	explicit MusicBuffer(unsigned num_chunks);
+	explicit MusicBuffer(unsigned num_chunks,
+			     size_t _chunk_size=CHUNK_SIZE);
 
 #ifndef NDEBUG
 	/**
-	 * Check whether the buffer is empty.  This call is not
-	 * protected with the mutex, and may only be used while this
-	 * object is inaccessible to other threads.
+	 * Check whether the buffer is empty.  This may only be used
+	 * while this object is inaccessible to other threads.
 	 */
 	bool IsEmptyUnsafe() const {
 		return buffer.empty();
@@ -54,7 +60,6 @@ public:
 #endif
 
 	bool IsFull() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
 		return buffer.IsFull();
 	}
 
@@ -68,6 +73,13 @@ public:
 		return buffer.GetCapacity();
 	}
 
+	/**
+	 * Returns the number of data bytes each #MusicChunk can hold
+	 * (i.e. its MusicChunk::capacity).
+	 */
+	gcc_pure
+	size_t GetChunkCapacity() const noexcept;
+
 	/**
 	 * Allocates a chunk from the buffer.  When it is not used anymore,
 	 * call Return().
@@ -23,7 +23,9 @@
 
 #include <cassert>
 
-MusicChunkInfo::MusicChunkInfo() noexcept = default;
+MusicChunkInfo::MusicChunkInfo(uint16_t _capacity) noexcept
+	:capacity(_capacity) {}
+
 MusicChunkInfo::~MusicChunkInfo() noexcept = default;
 
 #ifndef NDEBUG
@@ -56,8 +58,8 @@ MusicChunk::Write(const AudioFormat af,
 	}
 
 	const size_t frame_size = af.GetFrameSize();
-	size_t num_frames = (sizeof(data) - length) / frame_size;
-	return { data + length, num_frames * frame_size };
+	size_t num_frames = (capacity - length) / frame_size;
+	return { GetData() + length, num_frames * frame_size };
 }
 
 bool
@@ -65,10 +67,10 @@ MusicChunk::Expand(const AudioFormat af, size_t _length) noexcept
 {
 	const size_t frame_size = af.GetFrameSize();
 
-	assert(length + _length <= sizeof(data));
+	assert(length + _length <= capacity);
 	assert(audio_format == af);
 
 	length += _length;
 
-	return length + frame_size > sizeof(data);
+	return length + frame_size > capacity;
 }
@@ -29,12 +29,26 @@
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 
+/**
+ * The default (and minimum) size of a #MusicChunk including its
+ * header.  It can be increased with the "audio_buffer_chunk_size"
+ * setting.
+ */
 static constexpr size_t CHUNK_SIZE = 4096;
 
+/**
+ * The maximum size of a #MusicChunk; limited by the 16 bit
+ * MusicChunkInfo::length field.
+ */
+static constexpr size_t MAX_CHUNK_SIZE = 65536;
+
 struct AudioFormat;
 struct Tag;
 struct MusicChunk;
@@ -43,8 +57,13 @@ struct MusicChunk;
  * Meta information for #MusicChunk.
  */
 struct MusicChunkInfo {
-	/** the next chunk in a linked list */
-	MusicChunkPtr next;
+	/**
+	 * The next chunk in the #MusicPipe.  The chunks in the pipe
+	 * are owned by the #MusicPipe, not by this pointer.  It is
+	 * atomic because it is written by MusicPipe::Push() and read
+	 * by other threads without a lock.
+	 */
+	std::atomic<MusicChunk *> next{nullptr};
 
 	/**
 	 * An optional chunk which should be mixed into this chunk.
@@ -67,6 +86,13 @@ struct MusicChunkInfo {
 	/** number of bytes stored in this chunk */
 	uint16_t length = 0;
 
+	/**
+	 * The number of bytes which can be stored at GetData().  It
+	 * depends on the chunk size of the #MusicBuffer this chunk
+	 * was allocated from.
+	 */
+	const uint16_t capacity;
+
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
 
@@ -90,7 +116,7 @@ struct MusicChunkInfo {
 	AudioFormat audio_format;
 #endif
 
-	MusicChunkInfo() noexcept;
+	explicit MusicChunkInfo(uint16_t _capacity) noexcept;
 	~MusicChunkInfo() noexcept;
 
 	MusicChunkInfo(const MusicChunkInfo &) = delete;
@@ -115,8 +141,38 @@ struct MusicChunkInfo {
  * MusicPipe::Push() caller.
  */
 struct MusicChunk : MusicChunkInfo {
-	/** the data (probably PCM) */
-	uint8_t data[CHUNK_SIZE - sizeof(MusicChunkInfo)];
+	/**
+	 * @param chunk_size the size of the memory allocated for
+	 * this object, including the data following it; between
+	 * #CHUNK_SIZE and #MAX_CHUNK_SIZE
+	 */
+	explicit MusicChunk(size_t chunk_size) noexcept
+		:MusicChunkInfo(GetCapacity(chunk_size)) {
+		assert(chunk_size >= CHUNK_SIZE);
+		assert(chunk_size <= MAX_CHUNK_SIZE);
+	}
+
+	/**
+	 * Returns the size of the data (see GetData()) for chunks of
+	 * the given total size.
+	 */
+	static constexpr size_t GetCapacity(size_t chunk_size) noexcept {
+		return chunk_size - sizeof(MusicChunkInfo);
+	}
+
+	/**
+	 * Returns the data (probably PCM).  It is stored right after
+	 * this object, in the same allocation, and its size is
+	 * MusicChunkInfo::capacity; it is not a fixed-size array,
+	 * because that size depends on the #MusicBuffer.
+	 */
+	uint8_t *GetData() noexcept {
+		return reinterpret_cast<uint8_t *>(this + 1);
+	}
+
+	const uint8_t *GetData() const noexcept {
+		return reinterpret_cast<const uint8_t *>(this + 1);
+	}
 
 	/**
 	 * Prepares appending to the music chunk.  Returns a buffer
@@ -145,6 +201,10 @@ struct MusicChunk : MusicChunkInfo {
 	bool Expand(AudioFormat af, size_t length) noexcept;
 };
 
-static_assert(sizeof(MusicChunk) == CHUNK_SIZE, "Wrong size");
+static_assert(sizeof(MusicChunk) == sizeof(MusicChunkInfo),
+	      "The data must follow MusicChunkInfo directly");
+static_assert(MusicChunk::GetCapacity(MAX_CHUNK_SIZE) <=
+	      std::numeric_limits<decltype(MusicChunkInfo::capacity)>::max(),
+	      "MusicChunkInfo::capacity is too small");
 
 #endif
@@ -17,19 +17,20 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #include "MusicPipe.hxx"
 #include "MusicChunk.hxx"
 
 #include <cassert>
+#include <thread>
 
 #ifndef NDEBUG
 
 bool
 MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-
-	for (const MusicChunk *i = head.get(); i != nullptr; i = i->next.get())
+	for (const MusicChunk *i = head.load(std::memory_order_acquire);
+	     i != nullptr; i = i->next.load(std::memory_order_acquire))
 		if (i == chunk)
 			return true;
 
@@ -41,32 +42,46 @@ MusicPipe::Contains(const MusicChunk *chunk) const noexcept
 MusicChunkPtr
 MusicPipe::Shift() noexcept
 {
-	const std::lock_guard<Mutex> protect(mutex);
-
-	auto chunk = std::move(head);
-	if (chunk != nullptr) {
-		assert(!chunk->IsEmpty());
-
-		head = std::move(chunk->next);
-		--size;
+	MusicChunk *const chunk = head.load(std::memory_order_acquire);
+	if (chunk == nullptr)
+		return nullptr;
 
-		if (head == nullptr) {
-			assert(size == 0);
-			assert(tail_r == &chunk->next);
+	assert(!chunk->IsEmpty());
 
-			tail_r = &head;
-		} else {
-			assert(size > 0);
-			assert(tail_r != &chunk->next);
+	/* copy the deleter now, before a Push() call may overwrite
+	   it (which can only happen after the pipe has become
+	   empty) */
+	const auto _deleter = deleter;
+
+	MusicChunk *next = chunk->next.load(std::memory_order_acquire);
+	if (next == nullptr) {
+		/* this appears to be the last chunk; reset #head
+		   before #tail, because Push() sets #head if it finds
+		   #tail to be nullptr */
+		head.store(nullptr, std::memory_order_relaxed);
+
+		MusicChunk *expected = chunk;
+		if (!tail.compare_exchange_strong(expected, nullptr,
+						  std::memory_order_acq_rel)) {
+			/* a concurrent Push() has already appended a
+			   chunk after this one, but hasn't linked it
+			   yet; wait for it */
+			while ((next = chunk->next.load(std::memory_order_acquire)) == nullptr)
+				std::this_thread::yield();
+
+			head.store(next, std::memory_order_release);
 		}
-
-#ifndef NDEBUG
-		if (size == 0)
-			audio_format.Clear();
-#endif
+	} else {
+		head.store(next, std::memory_order_release);
 	}
 
-	return chunk;
+	chunk->next.store(nullptr, std::memory_order_relaxed);
+
+	const unsigned old_size = size.fetch_sub(1, std::memory_order_release);
+	assert(old_size > 0);
+	(void)old_size;
+
+	return MusicChunkPtr(chunk, _deleter);
 }
 
 void
@@ -81,20 +96,33 @@ MusicPipe::Push(MusicChunkPtr chunk) noexcept
 	assert(!chunk->IsEmpty());
 	assert(chunk->length == 0 || chunk->audio_format.IsValid());
 
-	const std::lock_guard<Mutex> protect(mutex);
-
-	assert(size > 0 || !audio_format.IsDefined());
-	assert(!audio_format.IsDefined() ||
-	       chunk->CheckFormat(audio_format));
-
 #ifndef NDEBUG
-	if (!audio_format.IsDefined() && chunk->length > 0)
-		audio_format = chunk->audio_format;
+	/* the format may change only after the consumer has emptied
+	   the pipe; a producer which waits for that sees 0 here,
+	   because only Push() increments #size */
+	auto f = GetSize() > 0
+		? audio_format.load(std::memory_order_relaxed)
+		: AudioFormat::Undefined();
+	assert(!f.IsDefined() || chunk->CheckFormat(f));
+
+	if (!f.IsDefined() && chunk->length > 0)
+		f = chunk->audio_format;
+	audio_format.store(f, std::memory_order_relaxed);
 #endif
 
-	chunk->next.reset();
-	*tail_r = std::move(chunk);
-	tail_r = &(*tail_r)->next;
-
-	++size;
+	/* increment the size before publishing the chunk, so a
+	   concurrent Shift() cannot let it underflow */
+	size.fetch_add(1, std::memory_order_relaxed);
+
+	const auto _deleter = chunk.get_deleter();
+	MusicChunk *const c = chunk.release();
+	c->next.store(nullptr, std::memory_order_relaxed);
+
+	MusicChunk *const prev = tail.exchange(c, std::memory_order_acq_rel);
+	if (prev == nullptr) {
+		/* the pipe was empty */
+		deleter = _deleter;
+		head.store(c, std::memory_order_release);
+	} else
+		prev->next.store(c, std::memory_order_release);
 }
@@ -21,39 +21,71 @@
 #define MPD_PIPE_H
 
 #include "MusicChunkPtr.hxx"
-#include "thread/Mutex.hxx"
 #include "util/Compiler.h"
 
 #ifndef NDEBUG
 #include "pcm/AudioFormat.hxx"
 #endif
 
+#include <atomic>
+
 /**
- * A queue of #MusicChunk objects.  One party appends chunks at the
- * tail, and the other consumes them from the head.
+ * A queue of #MusicChunk objects.  One party (the producer) appends
+ * chunks at the tail, and the other (the consumer) removes them from
+ * the head.  Additional threads may read the chunks (see
+ * #SharedPipeConsumer) as long as the consumer does not remove them.
+ *
+ * This class is lock-free: there must be only one producer thread
+ * calling Push() and only one consumer thread calling Shift() and
+ * Clear(), but they may run concurrently.  The consumer role may be
+ * handed over: while seeking, the decoder thread clears the pipe
+ * while the player thread (the usual consumer) waits for the seek
+ * command to finish.
  */
 class MusicPipe {
-	/** the first chunk */
-	MusicChunkPtr head;
+	/**
+	 * The first chunk.  It is modified by the consumer, and by
+	 * the producer only if the pipe is empty.
+	 */
+	std::atomic<MusicChunk *> head{nullptr};
 
-	/** a pointer to the tail of the chunk */
-	MusicChunkPtr *tail_r = &head;
+	/**
+	 * The last chunk.  Push() exchanges it, and Shift() resets
+	 * it to nullptr after removing the last chunk.
+	 */
+	std::atomic<MusicChunk *> tail{nullptr};
 
 	/** the current number of chunks */
-	unsigned size = 0;
+	std::atomic_uint size{0};
 
-	/** a mutex which protects #head and #tail_r */
-	mutable Mutex mutex;
+	/**
+	 * The deleter of the chunks in this pipe (i.e. the
+	 * #MusicBuffer they were allocated from).  It is written by
+	 * Push() only while the pipe is empty, and published to
+	 * Shift() together with #head.
+	 */
+	MusicChunkDeleter deleter;
 
 #ifndef NDEBUG
-	AudioFormat audio_format = AudioFormat::Undefined();
+	/**
+	 * The audio format of the chunks in this pipe.  It is
+	 * checked and updated only by Push() (without a lock, so
+	 * debug builds exercise the same code paths as release
+	 * builds); it is atomic only for CheckFormat().
+	 */
+	std::atomic<AudioFormat> audio_format{AudioFormat::Undefined()};
 #endif
 
 public:
+	MusicPipe() noexcept = default;
+
 	~MusicPipe() noexcept {
 		Clear();
 	}
 
+	MusicPipe(const MusicPipe &) = delete;
+	MusicPipe &operator=(const MusicPipe &) = delete;
+
 #ifndef NDEBUG
 	/**
 	 * Checks if the audio format if the chunk is equal to the specified
@@ -61,12 +93,13 @@ public:
 	 */
 	gcc_pure
 	bool CheckFormat(AudioFormat other) const noexcept {
-		return !audio_format.IsDefined() ||
-			audio_format == other;
+		const auto f = audio_format.load(std::memory_order_relaxed);
+		return !f.IsDefined() || f == other;
 	}
 
 	/**
 	 * Checks if the specified chunk is enqueued in the music pipe.
+	 * May only be called by the consumer.
 	 */
 	gcc_pure
 	bool Contains(const MusicChunk *chunk) const noexcept;
@@ -78,22 +111,29 @@ public:
 	 */
 	gcc_pure
 	const MusicChunk *Peek() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
-		return head.get();
+		return head.load(std::memory_order_acquire);
 	}
 
 	/**
 	 * Removes the first chunk from the head, and returns it.
+	 *
+	 * May only be called by the consumer.
 	 */
 	MusicChunkPtr Shift() noexcept;
 
 	/**
 	 * Clears the whole pipe and returns the chunks to the buffer.
+	 *
+	 * May only be called by the consumer, or by the producer while
+	 * the consumer is known not to access the pipe (e.g. the
+	 * decoder while the player thread waits for a seek).
 	 */
 	void Clear() noexcept;
 
 	/**
 	 * Pushes a chunk to the tail of the pipe.
+	 *
+	 * May only be called by the producer.
 	 */
 	void Push(MusicChunkPtr chunk) noexcept;
 
@@ -102,8 +142,7 @@ public:
 	 */
 	gcc_pure
 	unsigned GetSize() const noexcept {
-		const std::lock_guard<Mutex> protect(mutex);
-		return size;
+		return size.load(std::memory_order_acquire);
 	}
 
 	gcc_pure
@@ -35,6 +35,7 @@ Partition::Partition(Instance &_instance,
 		     const char *_name,
 		     unsigned max_length,
 		     unsigned buffer_chunks,
+		     std::size_t buffer_chunk_size,
 		     AudioFormat configured_audio_format,
 		     const ReplayGainConfig &replay_gain_config) noexcept
 	:instance(_instance),
@@ -46,7 +47,7 @@ Partition::Partition(Instance &_instance,
 	 outputs(pc, *this),
 	 pc(*this, outputs,
 	    instance.input_cache.get(),
-	    buffer_chunks,
+	    buffer_chunks, buffer_chunk_size,
 	    configured_audio_format, replay_gain_config)
 {
 	UpdateEffectiveReplayGainMode();
@@ -27,7 +27,7 @@
 #include "time/ChronoUtil.hxx"
 #include "util/UriUtil.hxx"
 
-#define SONG_FILE "file: "
+#define SONG_FILE "file"
 
 static void
 song_print_uri(Response &r, const char *uri, bool base) noexcept
@@ -42,14 +42,14 @@ song_print_uri(Response &r, const char *uri, bool base) noexcept
 			uri = allocated.c_str();
 	}
 
-	r.Format(SONG_FILE "%s\n", uri);
+	r.Field(SONG_FILE, uri);
 }
 
 void
 song_print_uri(Response &r, const LightSong &song, bool base) noexcept
 {
 	if (!base && song.directory != nullptr)
-		r.Format(SONG_FILE "%s/%s\n", song.directory, song.uri);
+		r.FormatField(SONG_FILE, "%s/%s", song.directory, song.uri);
 	else
 		song_print_uri(r, song.uri, base);
 }
@@ -67,13 +67,13 @@ PrintRange(Response &r, SongTime start_time, SongTime end_time) noexcept
 	const unsigned end_ms = end_time.ToMS();
 
 	if (end_ms > 0)
-		r.Format("Range: %u.%03u-%u.%03u\n",
+		r.FormatField("Range", "%u.%03u-%u.%03u",
 			 start_ms / 1000,
 			 start_ms % 1000,
 			 end_ms / 1000,
 			 end_ms % 1000);
 	else if (start_ms > 0)
-		r.Format("Range: %u.%03u-\n",
+		r.FormatField("Range", "%u.%03u-",
 			 start_ms / 1000,
 			 start_ms % 1000);
 }
@@ -89,7 +89,7 @@ song_print_info(Response &r, const LightSong &song, bool base) noexcept
 		time_print(r, "Last-Modified", song.mtime);
 
 	if (song.audio_format.IsDefined())
-		r.Format("Format: %s\n", ToString(song.audio_format).c_str());
+		r.Field("Format", ToString(song.audio_format).c_str());
 
 	tag_print(r, song.tag);
 }
@@ -107,9 +107,8 @@ song_print_info(Response &r, const DetachedSong &song, bool base) noexcept
 	tag_print_values(r, song.GetTag());
 
 	const auto duration = song.GetDuration();
-	if (!duration.IsNegative())
-		r.Format("Time: %i\n"
-			 "duration: %1.3f\n",
-			 duration.RoundS(),
-			 duration.ToDoubleS());
+	if (!duration.IsNegative()) {
+		r.FormatField("Time", "%i", duration.RoundS());
+		r.FormatField("duration", "%1.3f", duration.ToDoubleS());
+	}
 }
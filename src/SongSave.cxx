@@ -37,7 +37,6 @@
 #include <stdlib.h>
 
 #define SONG_MTIME "mtime"
-#define SONG_END "song_end"
 
 static void
 range_save(BufferedOutputStream &os, unsigned start_ms, unsigned end_ms)
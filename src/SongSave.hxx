@@ -23,6 +23,7 @@
 #include <memory>
 
 #define SONG_BEGIN "song_begin: "
+#define SONG_END "song_end"
 
 struct Song;
 struct AudioFormat;
@@ -96,6 +96,8 @@ Song::UpdateFile(Storage &storage)
 		return false;
 	}
 
+	++song_generation;
+
 	mtime = info.mtime;
 	audio_format = new_audio_format;
 	tag_builder.Commit(tag);
@@ -137,6 +139,7 @@ Song::UpdateFileInArchive(ArchiveFile &archive) noexcept
 	if (!tag_archive_scan(archive, path_utf8.c_str(), tag_builder))
 		return false;
 
+	++song_generation;
 	tag_builder.Commit(tag);
 	return true;
 }
@@ -162,8 +165,9 @@ DetachedSong::LoadFile(Path path)
 		return false;
 	}
 
-	mtime = fi.GetModificationTime();
-	tag_builder.Commit(tag);
+	auto &d = Mutable();
+	d.mtime = fi.GetModificationTime();
+	tag_builder.Commit(d.tag);
 	return true;
 }
 
@@ -179,15 +183,16 @@ DetachedSong::Update()
 		TagBuilder tag_builder;
 
 		try {
-			if (!tag_stream_scan(uri.c_str(), tag_builder))
+			if (!tag_stream_scan(GetURI(), tag_builder))
 				return false;
 		} catch (...) {
 			// TODO: log or propagate I/O errors?
 			return false;
 		}
 
-		mtime = std::chrono::system_clock::time_point::min();
-		tag_builder.Commit(tag);
+		auto &d = Mutable();
+		d.mtime = std::chrono::system_clock::time_point::min();
+		tag_builder.Commit(d.tag);
 		return true;
 	} else
 		// TODO: implement
@@ -19,26 +19,35 @@
 
 #include "config.h"
 #include "StateFile.hxx"
+#include "StateFileJournal.hxx"
 #include "output/State.hxx"
 #include "queue/PlaylistState.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/FileOutputStream.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
+#include "fs/FileSystem.hxx"
 #include "storage/StorageState.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "mixer/Volume.hxx"
 #include "SongLoader.hxx"
 #include "util/Domain.hxx"
+#include "util/StringCompare.hxx"
 #include "Log.hxx"
 
+#include <cassert>
+#include <chrono>
 #include <exception>
+#include <utility>
+#include <vector>
 
 static constexpr Domain state_file_domain("state_file");
 
 StateFile::StateFile(StateFileConfig &&_config,
 		     Partition &_partition, EventLoop &_loop)
 	:config(std::move(_config)), path_utf8(config.path.ToUTF8()),
+	 journal_path(AllocatedPath::FromFS(PathTraitsFS::string(config.path.c_str()) +
+					    PATH_LITERAL(".journal"))),
 	 timer_event(_loop, BIND_THIS_METHOD(OnTimeout)),
 	 partition(_partition)
 {
@@ -69,9 +78,26 @@ StateFile::IsModified() const noexcept
 		;
 }
 
+/**
+ * Generate a new value for StateFile::journal_id.
+ */
+static uint64_t
+MakeJournalId(uint64_t old_id) noexcept
+{
+	uint64_t id = std::chrono::system_clock::now().time_since_epoch().count();
+	if (id == old_id)
+		++id;
+	return id;
+}
+
 inline void
 StateFile::Write(BufferedOutputStream &os)
 {
+	if (config.journal) {
+		journal_id = MakeJournalId(journal_id);
+		os.Format(JOURNAL_ID "%llu\n", (unsigned long long)journal_id);
+	}
+
 	save_sw_volume_state(os);
 	audio_output_state_save(os, partition.outputs);
 
@@ -96,10 +122,24 @@ StateFile::Write()
 	FormatDebug(state_file_domain,
 		    "Saving state file %s", path_utf8.c_str());
 
+	journal_valid = false;
+
 	try {
 		FileOutputStream fos(config.path);
 		Write(fos);
+		snapshot_size = fos.Tell();
 		fos.Commit();
+
+		if (journal_size > 0 || FileExists(journal_path)) {
+			/* the state file contains all changes now */
+			RemoveFile(journal_path);
+			journal_size = 0;
+		}
+
+		if (config.journal) {
+			queue_journal.Reset(partition.playlist.queue);
+			journal_valid = true;
+		}
 	} catch (...) {
 		LogError(std::current_exception());
 	}
@@ -107,11 +147,154 @@ StateFile::Write()
 	RememberVersions();
 }
 
+inline void
+StateFile::WriteJournalRecord(BufferedOutputStream &os)
+{
+	os.Write(JOURNAL_BEGIN "\n");
+
+	save_sw_volume_state(os);
+	audio_output_state_save(os, partition.outputs);
+
+#ifdef ENABLE_DATABASE
+	storage_state_save(os, partition.instance);
+#endif
+
+	playlist_state_save_changes(os, partition.playlist, partition.pc,
+				    queue_journal);
+
+	os.Write(JOURNAL_END "\n");
+}
+
+void
+StateFile::AppendJournal()
+{
+	assert(journal_valid);
+
+	FormatDebug(state_file_domain,
+		    "Appending to state file journal %s", path_utf8.c_str());
+
+	try {
+		/* the first record creates a new journal, which
+		   replaces a stale one atomically */
+		FileOutputStream fos(journal_path,
+				     journal_size > 0
+				     ? FileOutputStream::Mode::APPEND_EXISTING
+				     : FileOutputStream::Mode::CREATE);
+
+		BufferedOutputStream bos(fos);
+		if (journal_size == 0)
+			bos.Format(JOURNAL_ID "%llu\n",
+				   (unsigned long long)journal_id);
+
+		WriteJournalRecord(bos);
+		bos.Flush();
+
+		journal_size = fos.Tell();
+		fos.Commit();
+	} catch (...) {
+		LogError(std::current_exception());
+
+		/* the journal may be corrupt; write the whole state
+		   file next time */
+		journal_valid = false;
+	}
+
+	RememberVersions();
+}
+
+unsigned
+StateFile::ApplyJournal()
+{
+	/* load the state file, keeping the queue items as raw
+	   text */
+
+	std::string id;
+	std::vector<std::string> lines, entries;
+
+	{
+		TextFile file(config.path);
+
+		const char *line;
+		while ((line = file.ReadLine()) != nullptr) {
+			const char *p;
+			if ((p = StringAfterPrefix(line, JOURNAL_ID)))
+				id = p;
+			else if (!playlist_state_read_entries(line, file, entries))
+				lines.emplace_back(line);
+		}
+	}
+
+	TextFile file(journal_path);
+
+	const char *line = file.ReadLine();
+	const char *p;
+	if (line == nullptr ||
+	    (p = StringAfterPrefix(line, JOURNAL_ID)) == nullptr ||
+	    id != p) {
+		LogWarning(state_file_domain,
+			   "Ignoring stale state file journal");
+		return 0;
+	}
+
+	bool incomplete;
+	const unsigned n_records = state_journal_apply(file, lines, entries,
+						       incomplete);
+	if (incomplete)
+		LogWarning(state_file_domain,
+			   "Ignoring incomplete record in state file journal");
+
+	if (n_records == 0)
+		return 0;
+
+	FileOutputStream fos(config.path);
+	BufferedOutputStream bos(fos);
+
+	for (const auto &i : lines) {
+		bos.Write(i.data(), i.size());
+		bos.Write('\n');
+	}
+
+	playlist_state_write_entries(bos, entries);
+
+	bos.Flush();
+	fos.Commit();
+
+	return n_records;
+}
+
+void
+StateFile::ReplayJournal() noexcept
+{
+	if (!FileExists(journal_path))
+		return;
+
+	try {
+		const unsigned n = ApplyJournal();
+		if (n > 0)
+			FormatDebug(state_file_domain,
+				    "Applied %u records from state file journal",
+				    n);
+	} catch (...) {
+		/* keep the journal; it may be applied next time */
+		LogError(std::current_exception(),
+			 "Failed to apply the state file journal");
+		return;
+	}
+
+	try {
+		RemoveFile(journal_path);
+	} catch (...) {
+		LogError(std::current_exception());
+	}
+}
+
 void
 StateFile::Read()
 try {
 	bool success;
 
+	ReplayJournal();
+
 	FormatDebug(state_file_domain, "Loading state file %s", path_utf8.c_str());
 
 	TextFile file(config.path);
@@ -125,7 +308,8 @@ try {
 
 	const char *line;
 	while ((line = file.ReadLine()) != nullptr) {
-		success = read_sw_volume_state(line, partition.outputs) ||
+		success = StringStartsWith(line, JOURNAL_ID) ||
+			read_sw_volume_state(line, partition.outputs) ||
 			audio_output_state_read(line, partition.outputs) ||
 			playlist_state_restore(config, line, file, song_loader,
 					       partition.playlist,
@@ -155,5 +339,9 @@ StateFile::CheckModified() noexcept
 void
 StateFile::OnTimeout() noexcept
 {
-	Write();
+	if (journal_valid && journal_size < snapshot_size)
+		AppendJournal();
+	else
+		/* compact the journal */
+		Write();
 }
@@ -21,10 +21,13 @@
 #define MPD_STATE_FILE_HXX
 
 #include "StateFileConfig.hxx"
+#include "queue/QueueJournal.hxx"
 #include "event/TimerEvent.hxx"
+#include "fs/AllocatedPath.hxx"
 #include "util/Compiler.h"
 #include "config.h"
 
+#include <cstdint>
 #include <string>
 
 struct Partition;
@@ -36,6 +39,13 @@ class StateFile final {
 
 	const std::string path_utf8;
 
+	/**
+	 * The path of the journal, which is the state file path with
+	 * the suffix ".journal".  It contains records which are
+	 * applied to the state file by Read().
+	 */
+	const AllocatedPath journal_path;
+
 	TimerEvent timer_event;
 
 	Partition &partition;
@@ -51,6 +61,41 @@ class StateFile final {
 	unsigned prev_storage_version = 0;
 #endif
 
+	/**
+	 * Identifies the state file written by the last Write()
+	 * call.  The journal begins with this id, so a stale journal
+	 * does not get applied to a newer state file.
+	 */
+	uint64_t journal_id = 0;
+
+	/**
+	 * The queue as it was written by the last Write() or
+	 * AppendJournal() call; the next journal record contains
+	 * only the differences.
+	 */
+	QueueJournal queue_journal;
+
+	/**
+	 * The size of the state file written by the last Write()
+	 * call.  When the journal grows larger, it gets compacted,
+	 * i.e. the whole state file is written again.
+	 */
+	uint64_t snapshot_size = 0;
+
+	/**
+	 * The size of the journal file.  Zero means it does not
+	 * exist.
+	 */
+	uint64_t journal_size = 0;
+
+	/**
+	 * Can the next change be appended to the journal?  This
+	 * requires a state file which was written by this process;
+	 * after Read(), the queue may differ from the file (e.g. if
+	 * songs have disappeared meanwhile).
+	 */
+	bool journal_valid = false;
+
 public:
 	StateFile(StateFileConfig &&_config,
 		  Partition &partition, EventLoop &loop);
@@ -67,6 +112,26 @@ private:
 	void Write(OutputStream &os);
 	void Write(BufferedOutputStream &os);
 
+	/**
+	 * Append a record with all changes since the last Write() or
+	 * AppendJournal() call to the journal.
+	 */
+	void AppendJournal();
+	void WriteJournalRecord(BufferedOutputStream &os);
+
+	/**
+	 * If there is a journal, apply it to the state file and
+	 * delete it.  If that fails, the journal is kept.
+	 */
+	void ReplayJournal() noexcept;
+
+	/**
+	 * Throws on error.
+	 *
+	 * @return the number of records which were applied
+	 */
+	unsigned ApplyJournal();
+
 	/**
 	 * Save the current state versions for use with IsModified().
 	 */
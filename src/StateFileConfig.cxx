@@ -28,6 +28,7 @@ StateFileConfig::StateFileConfig(const ConfigData &config)
 	:path(config.GetPath(ConfigOption::STATE_FILE)),
 	 interval(config.GetUnsigned(ConfigOption::STATE_FILE_INTERVAL,
 				     DEFAULT_INTERVAL)),
+	 journal(config.GetBool(ConfigOption::STATE_FILE_JOURNAL, false)),
 	 restore_paused(config.GetBool(ConfigOption::RESTORE_PAUSED, false))
 {
 #ifdef ANDROID
@@ -32,6 +32,12 @@ struct StateFileConfig {
 
 	Event::Duration interval;
 
+	/**
+	 * Append changes to a journal instead of rewriting the whole
+	 * state file each time?
+	 */
+	bool journal;
+
 	bool restore_paused;
 
 	explicit StateFileConfig(const ConfigData &config);
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StateFileJournal.hxx"
+#include "queue/QueueJournal.hxx"
+#include "fs/io/TextFile.hxx"
+#include "util/StringAPI.hxx"
+
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+unsigned
+state_journal_apply(TextFile &file, std::vector<std::string> &lines,
+		    std::vector<std::string> &entries, bool &incomplete)
+{
+	/* each record contains all lines except for the queue, and
+	   the differences of the queue; it is applied only if it is
+	   complete */
+
+	unsigned n_records = 0;
+	bool in_record = false, have_entries = false;
+	std::vector<std::string> record_lines, record_entries;
+
+	const char *line;
+	while ((line = file.ReadLine()) != nullptr) {
+		if (StringIsEqual(line, JOURNAL_BEGIN)) {
+			in_record = true;
+			have_entries = false;
+			record_lines.clear();
+		} else if (!in_record) {
+			continue;
+		} else if (StringIsEqual(line, JOURNAL_END)) {
+			in_record = false;
+			++n_records;
+
+			std::swap(lines, record_lines);
+			if (have_entries)
+				std::swap(entries, record_entries);
+		} else {
+			bool is_queue;
+
+			try {
+				is_queue = queue_journal_replay(line, file,
+								entries,
+								record_entries);
+			} catch (const std::system_error &) {
+				/* I/O error */
+				throw;
+			} catch (const std::runtime_error &) {
+				/* the queue is cut off or malformed:
+				   nothing after it can be trusted */
+				break;
+			}
+
+			if (is_queue)
+				have_entries = true;
+			else
+				record_lines.emplace_back(line);
+		}
+	}
+
+	incomplete = in_record;
+	return n_records;
+}
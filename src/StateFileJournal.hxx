@@ -0,0 +1,54 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_STATE_FILE_JOURNAL_HXX
+#define MPD_STATE_FILE_JOURNAL_HXX
+
+#include <string>
+#include <vector>
+
+class TextFile;
+
+#define JOURNAL_ID "journal_id: "
+#define JOURNAL_BEGIN "journal_begin"
+#define JOURNAL_END "journal_end"
+
+/**
+ * Apply the records of a state file journal (after its
+ * #JOURNAL_ID line) to the state file contents.
+ *
+ * Appending a record may be interrupted by a crash, so the last
+ * record may be cut off.  Such a record (or a malformed one) ends the
+ * journal; the records before it are applied nonetheless.
+ *
+ * Throws on I/O error.
+ *
+ * @param lines the state file lines except for the queue; replaced
+ * by the lines of the last complete record
+ * @param entries the queue as raw entries obtained by
+ * queue_read_entry()
+ * @param incomplete set to true if the journal ends with an
+ * incomplete record
+ * @return the number of records which were applied
+ */
+unsigned
+state_journal_apply(TextFile &file, std::vector<std::string> &lines,
+		    std::vector<std::string> &entries, bool &incomplete);
+
+#endif
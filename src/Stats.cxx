@@ -26,6 +26,10 @@
 #include "db/Selection.hxx"
 #include "db/Interface.hxx"
 #include "db/Stats.hxx"
+#include "tag/Pool.hxx"
+#ifdef ENABLE_INOTIFY
+#include "db/update/InotifyUpdate.hxx"
+#endif
 #include "Log.hxx"
 #include "time/ChronoUtil.hxx"
 #include "util/Math.hxx"
@@ -110,6 +114,11 @@ db_stats_print(Response &r, const Database &db)
 	if (!IsNegative(update_stamp))
 		r.Format("db_update: %lu\n",
 			 (unsigned long)std::chrono::system_clock::to_time_t(update_stamp));
+
+	const auto load_duration = db.GetLoadDuration();
+	if (load_duration > load_duration.zero())
+		r.Format("db_load_time: %1.3f\n",
+			 std::chrono::duration_cast<FloatDuration>(load_duration).count());
 }
 
 #endif
@@ -128,6 +137,28 @@ stats_print(Response &r, const Partition &partition)
 		 (unsigned)std::chrono::duration_cast<std::chrono::seconds>(uptime).count(),
 		 lround(partition.pc.GetTotalPlayTime().count()));
 
+	r.Format("queue_memory: %zu\n",
+		 partition.playlist.queue.GetMemoryUsage());
+
+	const auto tag_pool = tag_pool_stats();
+	r.Format("tag_pool_items: %zu\n"
+		 "tag_pool_buckets: %zu\n"
+		 "tag_pool_collisions: %zu\n"
+		 "tag_pool_saved: %zu\n",
+		 tag_pool.items, tag_pool.buckets,
+		 tag_pool.collisions, tag_pool.saved_bytes);
+
+#ifdef ENABLE_INOTIFY
+	const auto inotify = mpd_inotify_stats();
+	if (inotify.enabled)
+		r.Format("inotify_watches: %zu\n"
+			 "inotify_pending: %zu\n"
+			 "inotify_events: %zu\n"
+			 "inotify_coalesced: %zu\n",
+			 inotify.watches, inotify.pending,
+			 inotify.events, inotify.coalesced);
+#endif
+
 #ifdef ENABLE_DATABASE
 	const Database *db = partition.instance.GetDatabase();
 	if (db != nullptr)
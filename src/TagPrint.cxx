@@ -35,14 +35,13 @@ tag_print_types(Response &r) noexcept
 void
 tag_print(Response &r, TagType type, StringView value) noexcept
 {
-	r.Format("%s: %.*s\n", tag_item_names[type],
-		 int(value.size), value.data);
+	r.Field(tag_item_names[type], value);
 }
 
 void
 tag_print(Response &r, TagType type, const char *value) noexcept
 {
-	r.Format("%s: %s\n", tag_item_names[type], value);
+	r.Field(tag_item_names[type], value);
 }
 
 void
@@ -57,11 +56,10 @@ tag_print_values(Response &r, const Tag &tag) noexcept
 void
 tag_print(Response &r, const Tag &tag) noexcept
 {
-	if (!tag.duration.IsNegative())
-		r.Format("Time: %i\n"
-			 "duration: %1.3f\n",
-			 tag.duration.RoundS(),
-			 tag.duration.ToDoubleS());
+	if (!tag.duration.IsNegative()) {
+		r.FormatField("Time", "%i", tag.duration.RoundS());
+		r.FormatField("duration", "%1.3f", tag.duration.ToDoubleS());
+	}
 
 	tag_print_values(r, tag);
 }
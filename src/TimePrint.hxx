@@ -26,6 +26,9 @@ class Response;
 
 /**
  * Write a line with a time stamp to the client.
+ *
+ * @param name the key; it must have static storage duration (see
+ * Response::Field())
  */
 void
 time_print(Response &r, const char *name,
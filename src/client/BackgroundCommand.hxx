@@ -30,7 +30,7 @@
  * (Note: "idle" is not a "background command" by this definition; it
  * is a special case.)
  *
- * @see ThreadBackgroundCommand
+ * @see ThreadBackgroundCommand, PoolBackgroundCommand
  */
 class BackgroundCommand {
 public:
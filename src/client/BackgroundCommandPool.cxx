@@ -0,0 +1,122 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BackgroundCommandPool.hxx"
+#include "thread/Name.hxx"
+
+#include <cassert>
+
+BackgroundCommandPool::BackgroundCommandPool(unsigned n_threads)
+{
+	try {
+		for (unsigned i = 0; i < n_threads; ++i)
+			threads.emplace_back(BIND_THIS_METHOD(RunThread)).Start();
+	} catch (...) {
+		Stop();
+		throw;
+	}
+}
+
+BackgroundCommandPool::~BackgroundCommandPool() noexcept
+{
+	Stop();
+
+	assert(queue.empty());
+}
+
+void
+BackgroundCommandPool::Stop() noexcept
+{
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		if (i.IsDefined())
+			i.Join();
+
+	threads.clear();
+}
+
+void
+BackgroundCommandPool::Push(PoolBackgroundCommand &cmd) noexcept
+{
+	const std::lock_guard<Mutex> lock(mutex);
+	queue.push_back(cmd);
+	wake_cond.notify_one();
+}
+
+bool
+BackgroundCommandPool::Remove(PoolBackgroundCommand &cmd) noexcept
+{
+	const std::lock_guard<Mutex> lock(mutex);
+	if (!cmd.is_linked())
+		return false;
+
+	queue.erase(queue.iterator_to(cmd));
+	return true;
+}
+
+BackgroundCommandPool::ScopePause::ScopePause(BackgroundCommandPool &_pool) noexcept
+	:pool(_pool)
+{
+	std::unique_lock<Mutex> lock(pool.mutex);
+	++pool.paused;
+	pool.idle_cond.wait(lock, [this]{ return pool.running == 0; });
+}
+
+BackgroundCommandPool::ScopePause::~ScopePause() noexcept
+{
+	const std::lock_guard<Mutex> lock(pool.mutex);
+	assert(pool.paused > 0);
+	if (--pool.paused == 0)
+		pool.wake_cond.notify_all();
+}
+
+void
+BackgroundCommandPool::RunThread() noexcept
+{
+	SetThreadName("command");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		wake_cond.wait(lock, [this]{
+			return quit || (paused == 0 && !queue.empty());
+		});
+
+		if (quit)
+			break;
+
+		auto &cmd = queue.front();
+		queue.pop_front();
+		++running;
+
+		lock.unlock();
+		/* after Execute() returns, the command may already
+		   have been deleted by the client's thread */
+		cmd.Execute();
+		lock.lock();
+
+		if (--running == 0)
+			idle_cond.notify_all();
+	}
+}
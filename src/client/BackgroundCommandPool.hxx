@@ -0,0 +1,131 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_BACKGROUND_COMMAND_POOL_HXX
+#define MPD_BACKGROUND_COMMAND_POOL_HXX
+
+#include "PoolBackgroundCommand.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <boost/intrusive/list.hpp>
+
+#include <list>
+
+/**
+ * A fixed number of worker threads which execute
+ * #PoolBackgroundCommand instances.  Since the MPD protocol allows
+ * only one command per client at a time, each client occupies at
+ * most one worker.
+ */
+class BackgroundCommandPool {
+	Mutex mutex;
+
+	/**
+	 * Wakes up the worker threads when a new command has been
+	 * queued, when a pause has ended or when they shall quit.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signals #ScopePause that no command is running.
+	 */
+	Cond idle_cond;
+
+	std::list<Thread> threads;
+
+	boost::intrusive::list<PoolBackgroundCommand,
+			       boost::intrusive::constant_time_size<false>> queue;
+
+	/**
+	 * The number of commands currently being executed.
+	 */
+	unsigned running = 0;
+
+	/**
+	 * The number of #ScopePause instances.  While this is
+	 * non-zero, no new command will be started.
+	 */
+	unsigned paused = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	explicit BackgroundCommandPool(unsigned n_threads);
+	~BackgroundCommandPool() noexcept;
+
+	BackgroundCommandPool(const BackgroundCommandPool &) = delete;
+	BackgroundCommandPool &operator=(const BackgroundCommandPool &) = delete;
+
+	/**
+	 * Let all worker threads finish the command they are
+	 * currently executing, and join them.  Queued commands will
+	 * not be executed anymore; they remain in the queue until
+	 * they are canceled.
+	 *
+	 * Running commands never wait for the main thread, so this
+	 * may be called from it.
+	 */
+	void Stop() noexcept;
+
+	/**
+	 * Add a command to the end of the queue.
+	 */
+	void Push(PoolBackgroundCommand &cmd) noexcept;
+
+	/**
+	 * Remove a command from the queue.
+	 *
+	 * @return true if the command has been removed, false if it
+	 * was not queued (i.e. it is being executed or has already
+	 * finished)
+	 */
+	bool Remove(PoolBackgroundCommand &cmd) noexcept;
+
+	/**
+	 * While an instance of this class exists, no command is
+	 * being executed.  The constructor waits for running
+	 * commands to finish.  This is used before modifications
+	 * which these commands are not protected against,
+	 * e.g. unmounting a database.
+	 *
+	 * This must not be used from inside a worker thread.  It is
+	 * safe to use in the main thread, because workers never wait
+	 * for the main thread (see #PoolBackgroundCommand).
+	 */
+	class ScopePause {
+		BackgroundCommandPool &pool;
+
+	public:
+		explicit ScopePause(BackgroundCommandPool &_pool) noexcept;
+		~ScopePause() noexcept;
+
+		ScopePause(const ScopePause &) = delete;
+		ScopePause &operator=(const ScopePause &) = delete;
+	};
+
+private:
+	void RunThread() noexcept;
+};
+
+#endif
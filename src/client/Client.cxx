@@ -22,6 +22,7 @@
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "BackgroundCommand.hxx"
+#include "CompactEncoder.hxx"
 #include "IdleFlags.hxx"
 #include "config.h"
 
@@ -62,6 +63,17 @@ Client::OnBackgroundCommandFinished() noexcept
 	timeout_event.Schedule(client_timeout);
 }
 
+void
+Client::SetCompact(bool enable) noexcept
+{
+	if (!enable)
+		compact_encoder.reset();
+	else if (!compact_encoder)
+		/* a new encoder starts with an empty key table; the
+		   client must forget all previous definitions */
+		compact_encoder = std::make_unique<CompactEncoder>();
+}
+
 void
 Client::SetPartition(Partition &new_partition) noexcept
 {
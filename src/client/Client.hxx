@@ -48,6 +48,7 @@ struct playlist;
 class Database;
 class Storage;
 class BackgroundCommand;
+class CompactEncoder;
 
 class Client final
 	: FullyBufferedSocket,
@@ -113,6 +114,12 @@ private:
 	 */
 	std::unique_ptr<BackgroundCommand> background_command;
 
+	/**
+	 * Only set if the client has enabled the "compact" protocol
+	 * feature.
+	 */
+	std::unique_ptr<CompactEncoder> compact_encoder;
+
 public:
 	Client(EventLoop &loop, Partition &partition,
 	       UniqueSocketDescriptor fd, int uid,
@@ -138,6 +145,14 @@ public:
 	 */
 	bool Write(const char *data) noexcept;
 
+#ifndef _WIN32
+	/**
+	 * Write a portion of a file (see
+	 * FullyBufferedSocket::WriteFile()).
+	 */
+	bool WriteFile(FileDescriptor fd, off_t offset, size_t length) noexcept;
+#endif
+
 	/**
 	 * returns the uid of the client process, or a negative value
 	 * if the uid is unknown
@@ -154,6 +169,19 @@ public:
 		return uid >= 0;
 	}
 
+	/**
+	 * Returns the #CompactEncoder if the client has enabled the
+	 * "compact" protocol feature, nullptr otherwise.
+	 */
+	CompactEncoder *GetCompactEncoder() const noexcept {
+		return compact_encoder.get();
+	}
+
+	/**
+	 * Enable or disable the "compact" protocol feature.
+	 */
+	void SetCompact(bool enable) noexcept;
+
 	unsigned GetPermission() const noexcept {
 		return permission;
 	}
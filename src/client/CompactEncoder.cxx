@@ -0,0 +1,108 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CompactEncoder.hxx"
+
+#include <string.h>
+
+static char *
+WriteLEB128(char *dest, std::size_t value) noexcept
+{
+	while (value >= 0x80) {
+		*dest++ = char((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+
+	*dest++ = char(value);
+	return dest;
+}
+
+void
+CompactEncoder::CachePointer(const char *key, uint8_t id) noexcept
+{
+	const std::size_t start = HashPointer(key);
+	for (std::size_t i = 0; i < N_SLOTS; ++i) {
+		auto &slot = by_pointer[(start + i) % N_SLOTS];
+		if (slot.key == nullptr) {
+			slot.key = key;
+			slot.id = id;
+			return;
+		}
+	}
+}
+
+inline int
+CompactEncoder::LookupKey(const char *key) noexcept
+{
+	definitions.clear();
+
+	const std::size_t start = HashPointer(key);
+	for (std::size_t i = 0; i < N_SLOTS; ++i) {
+		const auto &slot = by_pointer[(start + i) % N_SLOTS];
+		if (slot.key == key)
+			return slot.id;
+
+		if (slot.key == nullptr)
+			break;
+	}
+
+	auto n = by_name.find(key);
+	if (n != by_name.end()) {
+		/* same name at a different address: remember this
+		   address, too */
+		CachePointer(key, n->second);
+		return n->second;
+	}
+
+	const std::size_t length = strlen(key);
+	if (by_name.size() >= MAX_KEYS || length > MAX_KEY_LENGTH)
+		return -1;
+
+	const uint8_t id = by_name.size();
+	by_name.emplace(key, id);
+	CachePointer(key, id);
+
+	definitions.push_back(DEFINE_KEY);
+	definitions.push_back(char(id));
+	definitions.push_back(char(length));
+	definitions.append(key, length);
+
+	return id;
+}
+
+std::string_view
+CompactEncoder::EncodeHeader(const char *key, std::size_t value_length) noexcept
+{
+	const int id = LookupKey(key);
+	if (id < 0)
+		return {};
+
+	char *p = header;
+	*p++ = FIELD;
+	*p++ = char(id);
+	p = WriteLEB128(p, value_length);
+	const std::string_view result(header, p - header);
+
+	if (definitions.empty())
+		return result;
+
+	/* this is a new key: prepend its definition */
+	definitions.append(result);
+	return definitions;
+}
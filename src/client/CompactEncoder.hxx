@@ -0,0 +1,137 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_COMPACT_ENCODER_HXX
+#define MPD_COMPACT_ENCODER_HXX
+
+#include "util/Compiler.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Implementation of the "compact" protocol feature: it encodes
+ * "KEY: VALUE" response lines as binary records.  Each key is
+ * transmitted only once per connection; after that, it is referred
+ * to by a one-byte id.
+ *
+ * A key definition record is:
+ *
+ *   0x01 ID LENGTH(1 byte) NAME
+ *
+ * A field record is:
+ *
+ *   0x02 ID LENGTH(LEB128) VALUE
+ *
+ * Since text lines never start with a control character, clients can
+ * distinguish these records from text lines (e.g. "OK").
+ *
+ * One instance is owned by each #Client which has enabled the
+ * feature.  It is not thread-safe, but only one command per client
+ * is executed at a time.
+ */
+class CompactEncoder {
+	struct Slot {
+		const char *key = nullptr;
+		uint8_t id;
+	};
+
+	static constexpr std::size_t N_SLOTS = 512;
+
+	/**
+	 * An open-addressing hash table which maps the addresses of
+	 * key strings to ids.  This is a fast path for string
+	 * literals and #tag_item_names, whose addresses never
+	 * change.
+	 */
+	std::array<Slot, N_SLOTS> by_pointer;
+
+	/**
+	 * Maps key names to ids.
+	 */
+	std::unordered_map<std::string, uint8_t> by_name;
+
+	/**
+	 * Key definitions generated by the current EncodeHeader()
+	 * call.
+	 */
+	std::string definitions;
+
+	/**
+	 * The most recent field header: #FIELD, the id and up to 10
+	 * bytes of LEB128 length.
+	 */
+	char header[12];
+
+public:
+	static constexpr char DEFINE_KEY = 0x01;
+	static constexpr char FIELD = 0x02;
+
+	/**
+	 * The maximum number of keys per connection.  Fields with
+	 * other keys are sent as text lines.
+	 */
+	static constexpr std::size_t MAX_KEYS = 256;
+
+	static constexpr std::size_t MAX_KEY_LENGTH = 255;
+
+	/**
+	 * Encode the header of a field record, preceded by a key
+	 * definition if this key has not been used yet.  The caller
+	 * shall send the returned header, followed by the value.
+	 *
+	 * @param key a null-terminated key string with static
+	 * storage duration (e.g. a string literal or an element of
+	 * #tag_item_names), because its address is used as a cache
+	 * key
+	 * @param value_length the length of the value in bytes
+	 * @return the encoded header (valid until the next call), or
+	 * an empty string_view if the key cannot be encoded (table
+	 * full, key too long); the caller shall then send a text line
+	 */
+	std::string_view EncodeHeader(const char *key,
+				      std::size_t value_length) noexcept;
+
+private:
+	gcc_const
+	static std::size_t HashPointer(const char *key) noexcept {
+		const auto i = reinterpret_cast<std::uintptr_t>(key);
+		return (i ^ (i >> 9)) % N_SLOTS;
+	}
+
+	/**
+	 * Remember the id of a key address in #by_pointer (unless
+	 * the table is full).
+	 */
+	void CachePointer(const char *key, uint8_t id) noexcept;
+
+	/**
+	 * Look up the id of the given key, and add it (and its
+	 * definition record to #definitions) if it is new.
+	 *
+	 * @return the id or -1 if the key cannot be encoded
+	 */
+	int LookupKey(const char *key) noexcept;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "Domain.hxx"
 #include "List.hxx"
 #include "BackgroundCommand.hxx"
+#include "CompactEncoder.hxx"
 #include "Partition.hxx"
 #include "Instance.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
@@ -65,6 +66,15 @@ client_new(EventLoop &loop, Partition &partition,
 		return;
 	}
 
+#ifdef __linux__
+	/* responses are small and the client waits for each of
+	   them, so the Nagle algorithm would only add latency; this
+	   also lets FullyBufferedSocket::WriteFile() push all corked
+	   packets at once.  This fails harmlessly on local
+	   sockets. */
+	fd.SetNoDelay();
+#endif
+
 	(void)fd.Write(GREETING, sizeof(GREETING) - 1);
 
 	const unsigned num = next_client_num++;
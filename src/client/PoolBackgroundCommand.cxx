@@ -0,0 +1,182 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PoolBackgroundCommand.hxx"
+#include "BackgroundCommandPool.hxx"
+#include "Client.hxx"
+#include "Config.hxx"
+#include "Domain.hxx"
+#include "command/CommandError.hxx"
+#include "protocol/Result.hxx"
+#include "Log.hxx"
+
+
+/**
+ * Pass the response to the client thread in chunks of (at least)
+ * this size.
+ */
+static constexpr std::size_t FLUSH_SIZE = 32 * 1024;
+
+PoolBackgroundCommand::PoolBackgroundCommand(Client &_client,
+					     BackgroundCommandPool &_pool) noexcept
+	:pool(_pool),
+	 defer_flush(_client.GetEventLoop(), BIND_THIS_METHOD(OnDeferredFlush)),
+	 client(_client)
+{
+}
+
+void
+PoolBackgroundCommand::Start() noexcept
+{
+	pool.Push(*this);
+}
+
+inline void
+PoolBackgroundCommand::CommitBuffer() noexcept
+{
+	if (buffer.empty())
+		return;
+
+	if (canceled || stalled) {
+		buffer.clear();
+		return;
+	}
+
+	pending_size += buffer.size();
+	pending.emplace_back(std::move(buffer));
+	buffer = {};
+
+	if (pending_size > client_max_output_buffer_size) {
+		/* the client does not receive the response fast
+		   enough; the worker must not wait for it, because
+		   it may be holding the database lock, which may
+		   block the main thread */
+		stalled = true;
+		pending.clear();
+		pending_size = 0;
+	}
+
+	defer_flush.Schedule();
+}
+
+bool
+PoolBackgroundCommand::Write(const void *data, std::size_t length) noexcept
+{
+	buffer.append((const char *)data, length);
+
+	if (buffer.size() >= FLUSH_SIZE) {
+		const std::lock_guard<Mutex> lock(mutex);
+		CommitBuffer();
+		if (canceled || stalled)
+			return false;
+	}
+
+	return true;
+}
+
+void
+PoolBackgroundCommand::Execute() noexcept
+{
+	Response r(client, 0, *this);
+
+	CommandResult _result;
+	try {
+		_result = Run(r);
+	} catch (...) {
+		PrintError(r, std::current_exception());
+		_result = CommandResult::ERROR;
+	}
+
+	const std::lock_guard<Mutex> lock(mutex);
+	CommitBuffer();
+	result = _result;
+	finished = true;
+	cond.notify_one();
+
+	/* this is the last access to this object from the worker
+	   thread: while we're holding the mutex, the client thread
+	   cannot delete it */
+	defer_flush.Schedule();
+}
+
+void
+PoolBackgroundCommand::OnDeferredFlush() noexcept
+{
+	std::list<std::string> chunks;
+	bool _finished, _stalled;
+	CommandResult _result;
+
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+
+		chunks.swap(pending);
+		pending_size = 0;
+
+		_finished = finished;
+		_stalled = stalled;
+		_result = result;
+	}
+
+	/* from here on, use only local variables: if the output
+	   buffer runs full, Client::Write() expires the client,
+	   which cancels and deletes this object */
+	Client &c = client;
+
+	if (_stalled) {
+		if (_finished) {
+			LogError(client_domain,
+				 "Response is larger than the output buffer");
+			c.SetExpired();
+		}
+
+		return;
+	}
+
+	for (const auto &chunk : chunks)
+		if (!c.Write(chunk.data(), chunk.size()))
+			return;
+
+	if (!_finished)
+		return;
+
+	if (_result == CommandResult::OK) {
+		command_success(c);
+		if (c.IsExpired())
+			return;
+	}
+
+	/* delete this object */
+	c.OnBackgroundCommandFinished();
+}
+
+void
+PoolBackgroundCommand::Cancel() noexcept
+{
+	if (!pool.Remove(*this)) {
+		/* the command is running (or has already finished):
+		   wait for it, discarding its output */
+		std::unique_lock<Mutex> lock(mutex);
+		canceled = true;
+		pending.clear();
+		pending_size = 0;
+		cond.wait(lock, [this]{ return finished; });
+	}
+
+	defer_flush.Cancel();
+}
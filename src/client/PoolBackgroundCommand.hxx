@@ -0,0 +1,158 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_POOL_BACKGROUND_COMMAND_HXX
+#define MPD_POOL_BACKGROUND_COMMAND_HXX
+
+#include "BackgroundCommand.hxx"
+#include "Response.hxx"
+#include "command/CommandResult.hxx"
+#include "event/InjectEvent.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+
+#include <boost/intrusive/list_hook.hpp>
+
+#include <cstddef>
+#include <list>
+#include <string>
+
+class Client;
+class BackgroundCommandPool;
+
+/**
+ * A #BackgroundCommand which is executed by a thread of the
+ * #BackgroundCommandPool.  Its response is collected in chunks which
+ * are passed to the #Client (in the client's #EventLoop thread)
+ * while the command is still running.
+ *
+ * The worker thread never waits for the client, because it may be
+ * holding the database lock, and a main thread blocked on that lock
+ * could never send the chunks.  Therefore, the response is limited
+ * by #client_max_output_buffer_size just like responses generated in
+ * the main thread: if more than that is pending (or if the client's
+ * output buffer overflows), the response is discarded and the client
+ * is disconnected.
+ *
+ * Implementations must not access any state which is owned by the
+ * main thread; they may only read the #Client's settings (e.g. the
+ * tag mask) and use thread-safe objects such as the #Database.
+ */
+class PoolBackgroundCommand
+	: public BackgroundCommand, ResponseSink,
+	  public boost::intrusive::list_base_hook<>
+{
+	friend class BackgroundCommandPool;
+
+	BackgroundCommandPool &pool;
+
+	InjectEvent defer_flush;
+
+	Mutex mutex;
+
+	/**
+	 * Signals Cancel() that the command has finished.
+	 */
+	Cond cond;
+
+	/**
+	 * Response data which is being collected by the worker
+	 * thread.  Not protected by #mutex; only the worker thread
+	 * accesses it.
+	 */
+	std::string buffer;
+
+	/**
+	 * Response chunks which are ready to be passed to the
+	 * #Client.
+	 */
+	std::list<std::string> pending;
+
+	/**
+	 * The total size of #pending.
+	 */
+	std::size_t pending_size = 0;
+
+	/**
+	 * The return value of Run().
+	 */
+	CommandResult result = CommandResult::OK;
+
+	/**
+	 * Has Run() returned?
+	 */
+	bool finished = false;
+
+	/**
+	 * Has Cancel() been called?  All further output will be
+	 * discarded.
+	 */
+	bool canceled = false;
+
+	/**
+	 * Has #pending grown too large?  All further output will be
+	 * discarded, and the client will be disconnected after Run()
+	 * returns.
+	 */
+	bool stalled = false;
+
+protected:
+	Client &client;
+
+public:
+	PoolBackgroundCommand(Client &_client,
+			      BackgroundCommandPool &_pool) noexcept;
+
+	/**
+	 * Enqueue this command in the #BackgroundCommandPool.
+	 */
+	void Start() noexcept;
+
+	void Cancel() noexcept final;
+
+private:
+	/**
+	 * Called by the #BackgroundCommandPool in a worker thread.
+	 */
+	void Execute() noexcept;
+
+	/**
+	 * Move #buffer to #pending.  Caller must lock #mutex.
+	 */
+	void CommitBuffer() noexcept;
+
+	/**
+	 * Pass all chunks of #pending to the #Client.  Runs in the
+	 * client's #EventLoop thread.
+	 */
+	void OnDeferredFlush() noexcept;
+
+	/* virtual methods from class ResponseSink */
+	bool Write(const void *data, std::size_t length) noexcept override;
+
+protected:
+	/**
+	 * Execute the command.  This runs in a worker thread.  If
+	 * this method throws, the exception will be converted to a
+	 * MPD response.
+	 */
+	virtual CommandResult Run(Response &r) = 0;
+};
+
+#endif
@@ -40,7 +40,7 @@ Client::ProcessCommandList(bool list_ok,
 		char *cmd = &*i.begin();
 
 		FormatDebug(client_domain, "process command \"%s\"", cmd);
-		auto ret = command_process(*this, n++, cmd);
+		auto ret = command_process(*this, n++, cmd, false);
 		FormatDebug(client_domain, "command returned %i", int(ret));
 		if (IsExpired())
 			return CommandResult::CLOSE;
@@ -136,7 +136,7 @@ Client::ProcessLine(char *line) noexcept
 			FormatDebug(client_domain,
 				    "[%u] process command \"%s\"",
 				    id, line);
-			auto ret = command_process(*this, 0, line);
+			auto ret = command_process(*this, 0, line, true);
 			FormatDebug(client_domain,
 				    "[%u] command returned %i",
 				    id, int(ret));
@@ -19,9 +19,12 @@
 
 #include "Response.hxx"
 #include "Client.hxx"
+#include "CompactEncoder.hxx"
 #include "util/FormatString.hxx"
 #include "util/AllocatedString.hxx"
 
+#include <string.h>
+
 TagMask
 Response::GetTagMask() const noexcept
 {
@@ -31,13 +34,16 @@ Response::GetTagMask() const noexcept
 bool
 Response::Write(const void *data, size_t length) noexcept
 {
+	if (sink != nullptr)
+		return sink->Write(data, length);
+
 	return client.Write(data, length);
 }
 
 bool
 Response::Write(const char *data) noexcept
 {
-	return client.Write(data);
+	return Write(data, strlen(data));
 }
 
 bool
@@ -56,6 +62,32 @@ Response::Format(const char *fmt, ...) noexcept
 	return success;
 }
 
+bool
+Response::Field(const char *key, std::string_view value) noexcept
+{
+	CompactEncoder *encoder = client.GetCompactEncoder();
+	if (encoder != nullptr) {
+		const auto header = encoder->EncodeHeader(key, value.size());
+		if (!header.empty())
+			return Write(header.data(), header.size()) &&
+				Write(value.data(), value.size());
+	}
+
+	return Write(key) && Write(": ", 2) &&
+		Write(value.data(), value.size()) && Write("\n", 1);
+}
+
+bool
+Response::FormatField(const char *key, const char *fmt, ...) noexcept
+{
+	std::va_list args;
+	va_start(args, fmt);
+	const auto value = FormatStringV(fmt, args);
+	va_end(args);
+
+	return Field(key, value.c_str());
+}
+
 bool
 Response::WriteBinary(ConstBuffer<void> payload) noexcept
 {
@@ -66,6 +98,22 @@ Response::WriteBinary(ConstBuffer<void> payload) noexcept
 		Write("\n");
 }
 
+#ifndef _WIN32
+
+bool
+Response::WriteBinaryFile(FileDescriptor fd, uint64_t offset,
+			  size_t length) noexcept
+{
+	assert(sink == nullptr);
+	assert(length <= MAX_BINARY_SIZE);
+
+	return Format("binary: %zu\n", length) &&
+		client.WriteFile(fd, offset, length) &&
+		Write("\n");
+}
+
+#endif
+
 void
 Response::Error(enum ack code, const char *msg) noexcept
 {
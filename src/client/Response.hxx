@@ -25,14 +25,42 @@
 
 #include <cstdarg>
 #include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 template<typename T> struct ConstBuffer;
 class Client;
 class TagMask;
+class FileDescriptor;
+
+/**
+ * An alternative destination for a #Response.  This is used by
+ * commands which run outside of the client's #EventLoop thread, and
+ * therefore must not write to the #Client directly.
+ *
+ * @see PoolBackgroundCommand
+ */
+class ResponseSink {
+public:
+	/**
+	 * @return true on success, false if the response shall be
+	 * discarded (e.g. because the command was canceled)
+	 */
+	virtual bool Write(const void *data, size_t length) noexcept = 0;
+
+protected:
+	~ResponseSink() noexcept = default;
+};
 
 class Response {
 	Client &client;
 
+	/**
+	 * If not nullptr, then all output is written to this object
+	 * instead of to the #Client.
+	 */
+	ResponseSink *const sink = nullptr;
+
 	/**
 	 * This command's index in the command list.  Used to generate
 	 * error messages.
@@ -48,6 +76,10 @@ public:
 	Response(Client &_client, unsigned _list_index) noexcept
 		:client(_client), list_index(_list_index) {}
 
+	Response(Client &_client, unsigned _list_index,
+		 ResponseSink &_sink) noexcept
+		:client(_client), sink(&_sink), list_index(_list_index) {}
+
 	Response(const Response &) = delete;
 	Response &operator=(const Response &) = delete;
 
@@ -77,6 +109,19 @@ public:
 	bool FormatV(const char *fmt, std::va_list args) noexcept;
 	bool Format(const char *fmt, ...) noexcept;
 
+	/**
+	 * Write a "KEY: VALUE" line.  If the client has enabled the
+	 * "compact" protocol feature, it is encoded by the
+	 * #CompactEncoder instead.
+	 *
+	 * @param key the key; it must have static storage duration
+	 * (see CompactEncoder::EncodeHeader())
+	 */
+	bool Field(const char *key, std::string_view value) noexcept;
+
+	gcc_printf(3, 4)
+	bool FormatField(const char *key, const char *fmt, ...) noexcept;
+
 	static constexpr size_t MAX_BINARY_SIZE = 8192;
 
 	/**
@@ -87,6 +132,18 @@ public:
 	 */
 	bool WriteBinary(ConstBuffer<void> payload) noexcept;
 
+#ifndef _WIN32
+	/**
+	 * Like WriteBinary(), but the chunk is read from the given
+	 * file.  If possible, it is sent to the socket with
+	 * sendfile().  Must not be used with a #ResponseSink.
+	 *
+	 * @return true on success
+	 */
+	bool WriteBinaryFile(FileDescriptor fd, uint64_t offset,
+			     size_t length) noexcept;
+#endif
+
 	void Error(enum ack code, const char *msg) noexcept;
 	void FormatError(enum ack code, const char *fmt, ...) noexcept;
 };
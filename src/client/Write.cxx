@@ -33,3 +33,14 @@ Client::Write(const char *data) noexcept
 {
 	return Write(data, strlen(data));
 }
+
+#ifndef _WIN32
+
+bool
+Client::WriteFile(FileDescriptor fd, off_t offset, size_t length) noexcept
+{
+	return !IsExpired() &&
+		FullyBufferedSocket::WriteFile(fd, offset, length);
+}
+
+#endif
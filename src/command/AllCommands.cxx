@@ -41,6 +41,7 @@
 #include "Instance.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/BackgroundCommandPool.hxx"
 #include "util/Tokenizer.hxx"
 #include "util/StringAPI.hxx"
 
@@ -48,8 +49,16 @@
 #include "StickerCommands.hxx"
 #endif
 
+#ifdef ENABLE_DATABASE
+#include "db/DatabasePlugin.hxx"
+#include "db/Interface.hxx"
+#endif
+
 #include <cassert>
 #include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <string.h>
 
@@ -68,6 +77,14 @@ struct command {
 	int min;
 	int max;
 	CommandResult (*handler)(Client &client, Request request, Response &response);
+
+	/**
+	 * May this command be executed by the
+	 * #BackgroundCommandPool?  This requires that the handler
+	 * only reads from the #Database and does not access any
+	 * other state besides the client's settings.
+	 */
+	bool background = false;
 };
 
 /* don't be fooled, this is the command handler for "commands" command */
@@ -96,7 +113,7 @@ static constexpr struct command commands[] = {
 	{ "config", PERMISSION_ADMIN, 0, 0, handle_config },
 	{ "consume", PERMISSION_CONTROL, 1, 1, handle_consume },
 #ifdef ENABLE_DATABASE
-	{ "count", PERMISSION_READ, 1, -1, handle_count },
+	{ "count", PERMISSION_READ, 1, -1, handle_count, true },
 #endif
 	{ "crossfade", PERMISSION_CONTROL, 1, 1, handle_crossfade },
 	{ "currentsong", PERMISSION_READ, 0, 0, handle_currentsong },
@@ -107,7 +124,7 @@ static constexpr struct command commands[] = {
 	{ "disableoutput", PERMISSION_ADMIN, 1, 1, handle_disableoutput },
 	{ "enableoutput", PERMISSION_ADMIN, 1, 1, handle_enableoutput },
 #ifdef ENABLE_DATABASE
-	{ "find", PERMISSION_READ, 1, -1, handle_find },
+	{ "find", PERMISSION_READ, 1, -1, handle_find, true },
 	{ "findadd", PERMISSION_ADD, 1, -1, handle_findadd},
 #endif
 #ifdef ENABLE_CHROMAPRINT
@@ -117,9 +134,9 @@ static constexpr struct command commands[] = {
 	{ "idle", PERMISSION_READ, 0, -1, handle_idle },
 	{ "kill", PERMISSION_ADMIN, -1, -1, handle_kill },
 #ifdef ENABLE_DATABASE
-	{ "list", PERMISSION_READ, 1, -1, handle_list },
-	{ "listall", PERMISSION_READ, 0, 1, handle_listall },
-	{ "listallinfo", PERMISSION_READ, 0, 1, handle_listallinfo },
+	{ "list", PERMISSION_READ, 1, -1, handle_list, true },
+	{ "listall", PERMISSION_READ, 0, 1, handle_listall, true },
+	{ "listallinfo", PERMISSION_READ, 0, 1, handle_listallinfo, true },
 #endif
 	{ "listfiles", PERMISSION_READ, 0, 1, handle_listfiles },
 #ifdef ENABLE_DATABASE
@@ -167,6 +184,7 @@ static constexpr struct command commands[] = {
 	{ "previous", PERMISSION_CONTROL, 0, 0, handle_previous },
 	{ "prio", PERMISSION_CONTROL, 2, -1, handle_prio },
 	{ "prioid", PERMISSION_CONTROL, 2, -1, handle_prioid },
+	{ "protocol", PERMISSION_NONE, 0, -1, handle_protocol },
 	{ "random", PERMISSION_CONTROL, 1, 1, handle_random },
 	{ "rangeid", PERMISSION_ADD, 2, 2, handle_rangeid },
 	{ "readcomments", PERMISSION_READ, 1, 1, handle_read_comments },
@@ -182,7 +200,7 @@ static constexpr struct command commands[] = {
 	{ "rm", PERMISSION_CONTROL, 1, 1, handle_rm },
 	{ "save", PERMISSION_CONTROL, 1, 1, handle_save },
 #ifdef ENABLE_DATABASE
-	{ "search", PERMISSION_READ, 1, -1, handle_search },
+	{ "search", PERMISSION_READ, 1, -1, handle_search, true },
 	{ "searchadd", PERMISSION_ADD, 1, -1, handle_searchadd },
 	{ "searchaddpl", PERMISSION_CONTROL, 2, -1, handle_searchaddpl },
 #endif
@@ -370,8 +388,73 @@ command_checked_lookup(Response &r, unsigned permission,
 	return cmd;
 }
 
+#ifdef ENABLE_DATABASE
+
+/**
+ * Executes a command handler in a thread of the
+ * #BackgroundCommandPool.
+ */
+class HandlerBackgroundCommand final : public PoolBackgroundCommand {
+	const struct command &cmd;
+
+	/**
+	 * A copy of the arguments, because the input buffer they
+	 * point to gets reused while the command runs.
+	 */
+	const std::vector<std::string> args;
+	std::vector<const char *> argv;
+
+public:
+	HandlerBackgroundCommand(Client &_client, BackgroundCommandPool &_pool,
+				 const struct command &_cmd, Request _args)
+		:PoolBackgroundCommand(_client, _pool), cmd(_cmd),
+		 args(_args.begin(), _args.end())
+	{
+		argv.reserve(args.size());
+		for (const auto &i : args)
+			argv.push_back(i.c_str());
+	}
+
+protected:
+	CommandResult Run(Response &r) override {
+		r.SetCommand(cmd.cmd);
+		return cmd.handler(client, {argv.data(), argv.size()}, r);
+	}
+};
+
+/**
+ * Determine whether the command can be executed by the
+ * #BackgroundCommandPool.
+ *
+ * @return the pool or nullptr if the command must be executed in
+ * the main thread
+ */
+gcc_pure
+static BackgroundCommandPool *
+GetBackgroundCommandPool(const Client &client,
+			 const struct command &cmd) noexcept
+{
+	if (!cmd.background)
+		return nullptr;
+
+	auto *pool = client.GetInstance().command_pool.get();
+	if (pool == nullptr)
+		return nullptr;
+
+	const auto *db = client.GetDatabase();
+	if (db == nullptr || !db->GetPlugin().IsThreadSafe())
+		/* the error message or the (thread-unsafe)
+		   database gets handled in the main thread */
+		return nullptr;
+
+	return pool;
+}
+
+#endif
+
 CommandResult
-command_process(Client &client, unsigned num, char *line) noexcept
+command_process(Client &client, unsigned num, char *line,
+		[[maybe_unused]] bool allow_background) noexcept
 {
 	Response r(client, num);
 
@@ -424,6 +507,21 @@ command_process(Client &client, unsigned num, char *line) noexcept
 		if (cmd == nullptr)
 			return CommandResult::ERROR;
 
+#ifdef ENABLE_DATABASE
+		if (allow_background) {
+			auto *pool = GetBackgroundCommandPool(client, *cmd);
+			if (pool != nullptr) {
+				auto bc = std::make_unique<HandlerBackgroundCommand>(client,
+										     *pool,
+										     *cmd,
+										     args);
+				bc->Start();
+				client.SetBackgroundCommand(std::move(bc));
+				return CommandResult::BACKGROUND;
+			}
+		}
+#endif
+
 		return cmd->handler(client, args, r);
 	} catch (...) {
 		PrintError(r, std::current_exception());
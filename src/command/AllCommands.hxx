@@ -27,7 +27,16 @@ class Client;
 void
 command_init() noexcept;
 
+/**
+ * Parse and execute one command line.
+ *
+ * @param num the command's index in the command list
+ * @param allow_background may the command be deferred to the
+ * #BackgroundCommandPool?  This is not possible inside command
+ * lists, because the remaining commands would have to wait for it
+ */
 CommandResult
-command_process(Client &client, unsigned num, char *line) noexcept;
+command_process(Client &client, unsigned num, char *line,
+		bool allow_background) noexcept;
 
 #endif
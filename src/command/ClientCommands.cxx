@@ -26,6 +26,8 @@
 #include "tag/ParseName.hxx"
 #include "util/StringAPI.hxx"
 
+#include <iterator>
+
 CommandResult
 handle_close([[maybe_unused]] Client &client, [[maybe_unused]] Request args,
 	     [[maybe_unused]] Response &r)
@@ -109,3 +111,120 @@ handle_tagtypes(Client &client, Request request, Response &r)
 		return CommandResult::ERROR;
 	}
 }
+
+/**
+ * The features which can be enabled with the "protocol" command.
+ */
+enum class ProtocolFeature {
+	COMPACT,
+};
+
+static constexpr const char *protocol_feature_names[] = {
+	"compact",
+};
+
+static constexpr unsigned N_PROTOCOL_FEATURES =
+	std::size(protocol_feature_names);
+
+gcc_pure
+static bool
+IsProtocolFeatureEnabled(const Client &client, ProtocolFeature feature) noexcept
+{
+	switch (feature) {
+	case ProtocolFeature::COMPACT:
+		return client.GetCompactEncoder() != nullptr;
+	}
+
+	return false;
+}
+
+static void
+SetProtocolFeature(Client &client, ProtocolFeature feature,
+		   bool enable) noexcept
+{
+	switch (feature) {
+	case ProtocolFeature::COMPACT:
+		client.SetCompact(enable);
+		break;
+	}
+}
+
+static void
+SetAllProtocolFeatures(Client &client, bool enable) noexcept
+{
+	for (unsigned i = 0; i < N_PROTOCOL_FEATURES; ++i)
+		SetProtocolFeature(client, ProtocolFeature(i), enable);
+}
+
+static ProtocolFeature
+ParseProtocolFeature(const char *name)
+{
+	for (unsigned i = 0; i < N_PROTOCOL_FEATURES; ++i)
+		if (StringIsEqual(name, protocol_feature_names[i]))
+			return ProtocolFeature(i);
+
+	throw ProtocolError(ACK_ERROR_ARG, "Unknown protocol feature");
+}
+
+static void
+SetProtocolFeatures(Client &client, Request request, bool enable)
+{
+	if (request.empty())
+		throw ProtocolError(ACK_ERROR_ARG, "Not enough arguments");
+
+	/* parse all names before changing anything */
+	for (const char *name : request)
+		ParseProtocolFeature(name);
+
+	for (const char *name : request)
+		SetProtocolFeature(client, ParseProtocolFeature(name), enable);
+}
+
+CommandResult
+handle_protocol(Client &client, Request request, Response &r)
+{
+	if (request.empty()) {
+		for (unsigned i = 0; i < N_PROTOCOL_FEATURES; ++i)
+			if (IsProtocolFeatureEnabled(client, ProtocolFeature(i)))
+				r.Format("feature: %s\n",
+					 protocol_feature_names[i]);
+		return CommandResult::OK;
+	}
+
+	const char *cmd = request.shift();
+	if (StringIsEqual(cmd, "available")) {
+		if (!request.empty()) {
+			r.Error(ACK_ERROR_ARG, "Too many arguments");
+			return CommandResult::ERROR;
+		}
+
+		for (const char *name : protocol_feature_names)
+			r.Format("feature: %s\n", name);
+		return CommandResult::OK;
+	} else if (StringIsEqual(cmd, "all")) {
+		if (!request.empty()) {
+			r.Error(ACK_ERROR_ARG, "Too many arguments");
+			return CommandResult::ERROR;
+		}
+
+		SetAllProtocolFeatures(client, true);
+		return CommandResult::OK;
+	} else if (StringIsEqual(cmd, "clear")) {
+		if (!request.empty()) {
+			r.Error(ACK_ERROR_ARG, "Too many arguments");
+			return CommandResult::ERROR;
+		}
+
+		SetAllProtocolFeatures(client, false);
+		return CommandResult::OK;
+	} else if (StringIsEqual(cmd, "enable")) {
+		SetProtocolFeatures(client, request, true);
+		return CommandResult::OK;
+	} else if (StringIsEqual(cmd, "disable")) {
+		SetProtocolFeatures(client, request, false);
+		return CommandResult::OK;
+	} else {
+		r.Error(ACK_ERROR_ARG, "Unknown sub command");
+		return CommandResult::ERROR;
+	}
+}
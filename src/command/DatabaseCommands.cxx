@@ -19,6 +19,7 @@
 
 #include "DatabaseCommands.hxx"
 #include "Request.hxx"
+#include "BulkEdit.hxx"
 #include "db/DatabaseQueue.hxx"
 #include "db/DatabasePlaylist.hxx"
 #include "db/DatabasePrint.hxx"
@@ -144,6 +145,7 @@ handle_match_add(Client &client, Request args, bool fold_case)
 	const auto selection = ParseDatabaseSelection(args, fold_case, filter);
 
 	auto &partition = client.GetPartition();
+	const ScopeBulkEdit bulk_edit(partition);
 	AddFromDatabase(partition, selection);
 	return CommandResult::OK;
 }
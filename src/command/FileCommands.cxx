@@ -32,6 +32,8 @@
 #include "tag/Handler.hxx"
 #include "tag/Generic.hxx"
 #include "TagAny.hxx"
+#include "CoverArtCache.hxx"
+#include "Instance.hxx"
 #include "storage/StorageInterface.hxx"
 #include "fs/AllocatedPath.hxx"
 #include "fs/FileInfo.hxx"
@@ -43,6 +45,7 @@
 #include "thread/Mutex.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes> /* for PRIu64 */
 
@@ -161,14 +164,7 @@ handle_read_comments(Client &client, Request args, Response &r)
 static InputStreamPtr
 find_stream_art(std::string_view directory, Mutex &mutex)
 {
-	static constexpr char const * art_names[] = {
-		"cover.png",
-		"cover.jpg",
-		"cover.tiff",
-		"cover.bmp"
-	};
-
-	for(const auto name: art_names) {
+	for(const auto name: CoverArtCache::cover_names) {
 		std::string art_file = PathTraitsUTF8::Build(directory, name);
 
 		try {
@@ -217,6 +213,40 @@ read_stream_art(Response &r, const char *uri, size_t offset)
 	return CommandResult::OK;
 }
 
+#ifndef _WIN32
+
+/**
+ * Send a chunk of the cover file in the given local directory.  The
+ * open file is kept in the #CoverArtCache for the following chunks,
+ * and it is sent with sendfile() if possible.
+ */
+static CommandResult
+read_local_art(Client &client, Response &r, Path directory_fs,
+	       uint64_t offset)
+{
+	auto &cache = *client.GetInstance().cover_art_cache;
+	const auto file = cache.GetCoverFile(directory_fs);
+	if (!file->fd.IsDefined()) {
+		r.Error(ACK_ERROR_NO_EXIST, "No file exists");
+		return CommandResult::ERROR;
+	}
+
+	if (offset > file->size) {
+		r.Error(ACK_ERROR_ARG, "Bad file offset");
+		return CommandResult::ERROR;
+	}
+
+	const size_t length = std::min<uint64_t>(file->size - offset,
+						 Response::MAX_BINARY_SIZE);
+
+	r.Format("size: %" PRIu64 "\n", file->size);
+	r.WriteBinaryFile(file->fd, offset, length);
+
+	return CommandResult::OK;
+}
+
+#endif
+
 #ifdef ENABLE_DATABASE
 static CommandResult
 read_db_art(Client &client, Response &r, const char *uri, const uint64_t offset)
@@ -226,6 +256,14 @@ read_db_art(Client &client, Response &r, const char *uri, const uint64_t offset)
 		r.Error(ACK_ERROR_NO_EXIST, "No database");
 		return CommandResult::ERROR;
 	}
+
+#ifndef _WIN32
+	const auto path_fs = storage->MapFS(uri);
+	if (!path_fs.IsNull())
+		return read_local_art(client, r, path_fs.GetDirectoryName(),
+				      offset);
+#endif
+
 	std::string uri2 = storage->MapUTF8(uri);
 	return read_stream_art(r, uri2.c_str(), offset);
 }
@@ -247,8 +285,15 @@ handle_album_art(Client &client, Request args, Response &r)
 
 	switch (located_uri.type) {
 	case LocatedUri::Type::ABSOLUTE:
+		return read_stream_art(r, located_uri.canonical_uri, offset);
 	case LocatedUri::Type::PATH:
+#ifndef _WIN32
+		return read_local_art(client, r,
+				      located_uri.path.GetDirectoryName(),
+				      offset);
+#else
 		return read_stream_art(r, located_uri.canonical_uri, offset);
+#endif
 	case LocatedUri::Type::RELATIVE:
 #ifdef ENABLE_DATABASE
 		return read_db_art(client, r, located_uri.canonical_uri, offset);
@@ -261,6 +306,32 @@ handle_album_art(Client &client, Request args, Response &r)
 	return CommandResult::ERROR;
 }
 
+/**
+ * Print a chunk of a picture.
+ *
+ * @return false if the offset is out of range
+ */
+static bool
+PrintPicture(Response &r, size_t offset,
+	     const char *mime_type, ConstBuffer<void> buffer) noexcept
+{
+	if (offset > buffer.size)
+		return false;
+
+	r.Format("size: %" PRIoffset "\n", buffer.size);
+
+	if (mime_type != nullptr)
+		r.Format("type: %s\n", mime_type);
+
+	buffer.size -= offset;
+	if (buffer.size > Response::MAX_BINARY_SIZE)
+		buffer.size = Response::MAX_BINARY_SIZE;
+	buffer.data = OffsetPointer(buffer.data, offset);
+
+	r.WriteBinary(buffer);
+	return true;
+}
+
 class PrintPictureHandler final : public NullTagHandler {
 	Response &response;
 
@@ -288,24 +359,45 @@ public:
 
 		found = true;
 
-		if (offset > buffer.size) {
-			bad_offset = true;
-			return;
-		}
+		bad_offset = !PrintPicture(response, offset,
+					   mime_type, buffer);
+	}
+};
 
-		response.Format("size: %" PRIoffset "\n", buffer.size);
+/**
+ * Determine the local file name of the given song URI, the same way
+ * TagScanAny() does.
+ *
+ * Throws on error.
+ *
+ * @return the path or "nulled" if the song is not a local file
+ */
+static AllocatedPath
+LocateLocalSong(Client &client, const char *uri)
+{
+	auto located_uri = LocateUri(UriPluginKind::INPUT, uri, &client
+#ifdef ENABLE_DATABASE
+				     , nullptr
+#endif
+				     );
 
-		if (mime_type != nullptr)
-			response.Format("type: %s\n", mime_type);
+	switch (located_uri.type) {
+	case LocatedUri::Type::ABSOLUTE:
+		break;
 
-		buffer.size -= offset;
-		if (buffer.size > Response::MAX_BINARY_SIZE)
-			buffer.size = Response::MAX_BINARY_SIZE;
-		buffer.data = OffsetPointer(buffer.data, offset);
+	case LocatedUri::Type::RELATIVE:
+#ifdef ENABLE_DATABASE
+		if (const Storage *storage = client.GetStorage())
+			return storage->MapFS(located_uri.canonical_uri);
+#endif
+		break;
 
-		response.WriteBinary(buffer);
+	case LocatedUri::Type::PATH:
+		return std::move(located_uri.path);
 	}
-};
+
+	return nullptr;
+}
 
 CommandResult
 handle_read_picture(Client &client, Request args, Response &r)
@@ -315,6 +407,25 @@ handle_read_picture(Client &client, Request args, Response &r)
 	const char *const uri = args.front();
 	const size_t offset = args.ParseUnsigned(1);
 
+	const auto path_fs = LocateLocalSong(client, uri);
+	if (!path_fs.IsNull()) {
+		auto &cache = *client.GetInstance().cover_art_cache;
+		const auto picture = cache.GetPicture(path_fs);
+		if (picture != nullptr) {
+			if (picture->found &&
+			    !PrintPicture(r, offset,
+					  picture->mime_type.empty()
+					  ? nullptr
+					  : picture->mime_type.c_str(),
+					  {picture->data.data(),
+					   picture->data.size()}))
+				throw ProtocolError(ACK_ERROR_ARG,
+						    "Bad file offset");
+
+			return CommandResult::OK;
+		}
+	}
+
 	PrintPictureHandler handler(r, offset);
 	TagScanAny(client, uri, handler);
 	handler.RethrowError();
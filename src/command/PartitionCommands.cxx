@@ -25,6 +25,7 @@
 #include "output/Filtered.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "MusicChunk.hxx"
 #include "util/CharUtil.hxx"
 
 CommandResult
@@ -101,7 +102,7 @@ handle_newpartition(Client &client, Request request, Response &response)
 	instance.partitions.emplace_back(instance, name,
 					 // TODO: use real configuration
 					 16384,
-					 1024,
+					 1024, CHUNK_SIZE,
 					 AudioFormat::Undefined(),
 					 ReplayGainConfig());
 	auto &partition = instance.partitions.back();
@@ -57,6 +57,8 @@
 #define COMMAND_STATUS_MIXRAMPDELAY	"mixrampdelay"
 #define COMMAND_STATUS_AUDIO		"audio"
 #define COMMAND_STATUS_UPDATING_DB	"updating_db"
+#define COMMAND_STATUS_UPDATING_DB_FILES	"updating_db_files"
+#define COMMAND_STATUS_UPDATING_DB_RATE	"updating_db_rate"
 
 CommandResult
 handle_play(Client &client, Request args, [[maybe_unused]] Response &r)
@@ -195,6 +197,15 @@ handle_status(Client &client, [[maybe_unused]] Request args, Response &r)
 	if (updateJobId != 0) {
 		r.Format(COMMAND_STATUS_UPDATING_DB ": %i\n",
 			 updateJobId);
+
+		const unsigned n_loaded = update_service->GetLoadedCount();
+		r.Format(COMMAND_STATUS_UPDATING_DB_FILES ": %u\n", n_loaded);
+
+		const std::chrono::duration<double> elapsed =
+			update_service->GetElapsed();
+		if (elapsed.count() > 0)
+			r.Format(COMMAND_STATUS_UPDATING_DB_RATE ": %.1f\n",
+				 n_loaded / elapsed.count());
 	}
 #endif
 
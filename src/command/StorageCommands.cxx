@@ -28,17 +28,20 @@
 #include "fs/Traits.hxx"
 #include "client/Client.hxx"
 #include "client/Response.hxx"
+#include "client/BackgroundCommandPool.hxx"
 #include "Instance.hxx"
 #include "storage/Registry.hxx"
 #include "storage/CompositeStorage.hxx"
 #include "storage/FileInfo.hxx"
 #include "db/plugins/simple/SimpleDatabasePlugin.hxx"
 #include "db/update/Service.hxx"
+#include "db/AggregateCache.hxx"
 #include "TimePrint.hxx"
 #include "IdleFlags.hxx"
 
 #include <cinttypes> /* for PRIu64 */
 #include <memory>
+#include <optional>
 
 gcc_pure
 static bool
@@ -228,6 +231,7 @@ handle_mount(Client &client, Request args, Response &r)
 
 		// TODO: call Instance::OnDatabaseModified()?
 		// TODO: trigger database update?
+		InvalidateAggregateCaches();
 		instance.EmitIdle(IDLE_DATABASE);
 
 		if (need_update) {
@@ -269,9 +273,17 @@ handle_unmount(Client &client, Request args, Response &r)
 		instance.update->CancelMount(local_uri);
 
 	if (auto *db = dynamic_cast<SimpleDatabase *>(instance.GetDatabase())) {
-		if (db->Unmount(local_uri))
+		/* background commands may be visiting the mounted
+		   database without holding the database lock */
+		std::optional<BackgroundCommandPool::ScopePause> pause;
+		if (instance.command_pool)
+			pause.emplace(*instance.command_pool);
+
+		if (db->Unmount(local_uri)) {
 			// TODO: call Instance::OnDatabaseModified()?
+			InvalidateAggregateCaches();
 			instance.EmitIdle(IDLE_DATABASE);
+		}
 	}
 #endif
 
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "AggregateCache.hxx"
+#include "Interface.hxx"
+#include "song/Filter.hxx"
+#include "time/ChronoUtil.hxx"
+
+std::atomic_uint aggregate_cache_generation;
+
+void
+InvalidateAggregateCaches() noexcept
+{
+	++aggregate_cache_generation;
+}
+
+bool
+IsAggregateCacheable(const Database &db, const SongFilter *filter) noexcept
+{
+	if (filter != nullptr && !filter->IsEmpty())
+		return false;
+
+	/* databases without an update time stamp (e.g. "upnp") don't
+	   report modifications */
+	return !IsNegative(db.GetUpdateStamp());
+}
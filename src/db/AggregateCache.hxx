@@ -0,0 +1,165 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MPD_DB_AGGREGATE_CACHE_HXX
+#define MPD_DB_AGGREGATE_CACHE_HXX
+
+#include "thread/Mutex.hxx"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+class Database;
+class SongFilter;
+
+/**
+ * Incremented by InvalidateAggregateCaches().  Do not use directly.
+ */
+extern std::atomic_uint aggregate_cache_generation;
+
+/**
+ * Invalidate all #AggregateCache instances.  This must be called
+ * whenever the database contents change.
+ */
+void
+InvalidateAggregateCaches() noexcept;
+
+/**
+ * Returns the current cache generation.  It must be obtained before
+ * querying the database, and passed to AggregateCache::Put().
+ */
+inline unsigned
+GetAggregateCacheGeneration() noexcept
+{
+	return aggregate_cache_generation.load(std::memory_order_acquire);
+}
+
+/**
+ * May the result of the given query be cached?  This is only
+ * possible if the #Database notifies us about modifications and if
+ * there is no filter (filters cannot be converted to a unique cache
+ * key).
+ */
+bool
+IsAggregateCacheable(const Database &db, const SongFilter *filter) noexcept;
+
+/**
+ * A small cache for the results of expensive database aggregation
+ * queries such as "list" and "count group", which are sent by many
+ * clients right after connecting.  All entries are discarded by
+ * InvalidateAggregateCaches().
+ *
+ * This class is thread-safe.  Values are shared with the callers, so
+ * they remain valid even if the entry gets evicted meanwhile.
+ */
+template<typename T>
+class AggregateCache {
+	static constexpr std::size_t MAX_ENTRIES = 32;
+
+	using Value = std::shared_ptr<const T>;
+
+	Mutex mutex;
+
+	/**
+	 * The most recently used entry is at the front.
+	 */
+	std::list<std::pair<std::string, Value>> entries;
+
+	unsigned generation = 0;
+
+public:
+	/**
+	 * Look up a cached value.
+	 *
+	 * @return the cached value or nullptr if there is none
+	 */
+	Value Get(const std::string &key) noexcept {
+		const std::lock_guard<Mutex> lock(mutex);
+
+		if (!Validate())
+			return nullptr;
+
+		for (auto i = entries.begin(); i != entries.end(); ++i) {
+			if (i->first == key) {
+				entries.splice(entries.begin(), entries, i);
+				return i->second;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Add a new value to the cache, evicting the least recently
+	 * used one if the cache is full.  If the cache has been
+	 * invalidated since the given generation, the value is not
+	 * added, because it may be outdated.
+	 *
+	 * @param _generation the return value of
+	 * GetAggregateCacheGeneration() before the value was
+	 * calculated
+	 * @return the value
+	 */
+	Value Put(std::string &&key, T &&value, unsigned _generation) {
+		auto v = std::make_shared<const T>(std::move(value));
+
+		const std::lock_guard<Mutex> lock(mutex);
+
+		Validate();
+		if (_generation != generation)
+			return v;
+
+		for (auto i = entries.begin(); i != entries.end(); ++i) {
+			if (i->first == key) {
+				/* another thread has been faster */
+				entries.erase(i);
+				break;
+			}
+		}
+
+		entries.emplace_front(std::move(key), v);
+		if (entries.size() > MAX_ENTRIES)
+			entries.pop_back();
+
+		return v;
+	}
+
+private:
+	/**
+	 * Discard all entries if the cache has been invalidated.
+	 * Caller must lock the #mutex.
+	 *
+	 * @return false if the cache was invalidated
+	 */
+	bool Validate() noexcept {
+		const unsigned current = GetAggregateCacheGeneration();
+		if (generation == current)
+			return true;
+
+		entries.clear();
+		generation = current;
+		return false;
+	}
+};
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "Count.hxx"
+#include "AggregateCache.hxx"
 #include "Selection.hxx"
 #include "Interface.hxx"
 #include "Partition.hxx"
@@ -41,6 +42,9 @@ struct SearchStats {
 class TagCountMap : public std::map<std::string, SearchStats> {
 };
 
+static AggregateCache<SearchStats> count_cache;
+static AggregateCache<TagCountMap> group_count_cache;
+
 static void
 PrintSearchStats(Response &r, const SearchStats &stats) noexcept
 {
@@ -102,9 +106,26 @@ PrintSongCount(Response &r, const Partition &partition, const char *name,
 
 	const DatabaseSelection selection(name, true, filter);
 
+	const bool cacheable = IsAggregateCacheable(db, filter);
+	std::string key;
+	if (cacheable) {
+		key = name;
+		key.push_back('\0');
+		key.push_back(char(group));
+	}
+
 	if (group == TAG_NUM_OF_ITEM_TYPES) {
 		/* no grouping */
 
+		if (cacheable) {
+			const auto cached = count_cache.Get(key);
+			if (cached != nullptr) {
+				PrintSearchStats(r, *cached);
+				return;
+			}
+		}
+
+		const unsigned generation = GetAggregateCacheGeneration();
 		SearchStats stats;
 
 		const auto f = [&](const auto &song)
@@ -113,10 +134,23 @@ PrintSongCount(Response &r, const Partition &partition, const char *name,
 		db.Visit(selection, f);
 
 		PrintSearchStats(r, stats);
+
+		if (cacheable)
+			count_cache.Put(std::move(key), std::move(stats),
+					generation);
 	} else {
 		/* group by the specified tag: store counts in a
 		   std::map */
 
+		if (cacheable) {
+			const auto cached = group_count_cache.Get(key);
+			if (cached != nullptr) {
+				Print(r, group, *cached);
+				return;
+			}
+		}
+
+		const unsigned generation = GetAggregateCacheGeneration();
 		TagCountMap map;
 
 		const auto f = [&map,group](const auto &song)
@@ -125,5 +159,9 @@ PrintSongCount(Response &r, const Partition &partition, const char *name,
 		db.Visit(selection, f);
 
 		Print(r, group, map);
+
+		if (cacheable)
+			group_count_cache.Put(std::move(key), std::move(map),
+					      generation);
 	}
 }
@@ -19,8 +19,9 @@
 
 #include "DatabaseLock.hxx"
 
-Mutex db_mutex;
+SharedMutex db_mutex;
 
 #ifndef NDEBUG
 ThreadId db_mutex_holder;
+thread_local unsigned db_shared_lock_count;
 #endif
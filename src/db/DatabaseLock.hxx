@@ -26,25 +26,51 @@
 #ifndef MPD_DB_LOCK_HXX
 #define MPD_DB_LOCK_HXX
 
-#include "thread/Mutex.hxx"
+#include "thread/SharedMutex.hxx"
 #include "util/Compiler.h"
 
 #include <cassert>
 
-extern Mutex db_mutex;
+/**
+ * The global database lock.  Code which only reads the #Directory
+ * tree (e.g. SimpleDatabase::Visit()) obtains it in shared mode, so
+ * several readers may proceed in parallel; modifications require
+ * exclusive ownership.
+ */
+extern SharedMutex db_mutex;
 
 #ifndef NDEBUG
 
 #include "thread/Id.hxx"
 
+/**
+ * The thread which holds the exclusive database lock.
+ */
 extern ThreadId db_mutex_holder;
 
 /**
- * Does the current thread hold the database lock?
+ * The number of shared database locks held by the current thread.
+ */
+extern thread_local unsigned db_shared_lock_count;
+
+/**
+ * Does the current thread hold the database lock (exclusive or
+ * shared)?  This is sufficient for reading the #Directory tree.
  */
 gcc_pure
 static inline bool
 holding_db_lock() noexcept
+{
+	return db_mutex_holder.IsInside() || db_shared_lock_count > 0;
+}
+
+/**
+ * Does the current thread hold the exclusive database lock?  This is
+ * required for modifying the #Directory tree.
+ */
+gcc_pure
+static inline bool
+holding_db_write_lock() noexcept
 {
 	return db_mutex_holder.IsInside();
 }
@@ -52,8 +78,8 @@ holding_db_lock() noexcept
 #endif
 
 /**
- * Obtain the global database lock.  This is needed before
- * dereferencing a #song or #directory.  It is not recursive.
+ * Obtain the global database lock in exclusive mode.  This is needed
+ * before modifying a #song or #directory.  It is not recursive.
  */
 static inline void
 db_lock(void)
@@ -69,12 +95,12 @@ db_lock(void)
 }
 
 /**
- * Release the global database lock.
+ * Release the exclusive global database lock.
  */
 static inline void
 db_unlock(void)
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 #ifndef NDEBUG
 	db_mutex_holder = ThreadId::Null();
 #endif
@@ -82,6 +108,38 @@ db_unlock(void)
 	db_mutex.unlock();
 }
 
+/**
+ * Obtain the global database lock in shared mode.  This is needed
+ * before dereferencing a #song or #directory.  It is not recursive
+ * (a recursive shared lock may deadlock if another thread is waiting
+ * for the exclusive lock).
+ */
+static inline void
+db_lock_shared(void)
+{
+	assert(!holding_db_lock());
+
+	db_mutex.lock_shared();
+
+#ifndef NDEBUG
+	++db_shared_lock_count;
+#endif
+}
+
+/**
+ * Release the shared global database lock.
+ */
+static inline void
+db_unlock_shared(void)
+{
+#ifndef NDEBUG
+	assert(db_shared_lock_count > 0);
+	--db_shared_lock_count;
+#endif
+
+	db_mutex.unlock_shared();
+}
+
 class ScopeDatabaseLock {
 	bool locked = true;
 
@@ -106,8 +164,32 @@ public:
 	}
 };
 
+class ScopeDatabaseSharedLock {
+	bool locked = true;
+
+public:
+	ScopeDatabaseSharedLock() {
+		db_lock_shared();
+	}
+
+	~ScopeDatabaseSharedLock() {
+		if (locked)
+			db_unlock_shared();
+	}
+
+	/**
+	 * Unlock the mutex now, making the destructor a no-op.
+	 */
+	void unlock() {
+		assert(locked);
+
+		db_unlock_shared();
+		locked = false;
+	}
+};
+
 /**
- * Unlock the database while in the current scope.
+ * Unlock the exclusive database lock while in the current scope.
  */
 class ScopeDatabaseUnlock {
 public:
@@ -120,4 +202,18 @@ public:
 	}
 };
 
+/**
+ * Unlock the shared database lock while in the current scope.
+ */
+class ScopeDatabaseSharedUnlock {
+public:
+	ScopeDatabaseSharedUnlock() {
+		db_unlock_shared();
+	}
+
+	~ScopeDatabaseSharedUnlock() {
+		db_lock_shared();
+	}
+};
+
 #endif
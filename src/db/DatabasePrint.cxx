@@ -18,6 +18,7 @@
  */
 
 #include "DatabasePrint.hxx"
+#include "AggregateCache.hxx"
 #include "Selection.hxx"
 #include "SongPrint.hxx"
 #include "TimePrint.hxx"
@@ -47,8 +48,7 @@ static void
 PrintDirectoryURI(Response &r, bool base,
 		  const LightDirectory &directory) noexcept
 {
-	r.Format("directory: %s\n",
-		 ApplyBaseFlag(directory.GetPath(), base));
+	r.Field("directory", ApplyBaseFlag(directory.GetPath(), base));
 }
 
 static void
@@ -77,11 +77,9 @@ print_playlist_in_directory(Response &r, bool base,
 			    const char *name_utf8) noexcept
 {
 	if (base || directory == nullptr)
-		r.Format("playlist: %s\n",
-			 ApplyBaseFlag(name_utf8, base));
+		r.Field("playlist", ApplyBaseFlag(name_utf8, base));
 	else
-		r.Format("playlist: %s/%s\n",
-			 directory, name_utf8);
+		r.FormatField("playlist", "%s/%s", directory, name_utf8);
 }
 
 static void
@@ -90,10 +88,10 @@ print_playlist_in_directory(Response &r, bool base,
 			    const char *name_utf8) noexcept
 {
 	if (base || directory == nullptr || directory->IsRoot())
-		r.Format("playlist: %s\n", name_utf8);
+		r.Field("playlist", name_utf8);
 	else
-		r.Format("playlist: %s/%s\n",
-			 directory->GetPath(), name_utf8);
+		r.FormatField("playlist", "%s/%s",
+			      directory->GetPath(), name_utf8);
 }
 
 static void
@@ -188,6 +186,12 @@ PrintSongUris(Response &r, Partition &partition,
 	db.Visit(selection, f);
 }
 
+/**
+ * Caches the results of unfiltered "list" commands, keyed by the
+ * list of tag types.
+ */
+static AggregateCache<RecursiveMap<std::string>> unique_tags_cache;
+
 static void
 PrintUniqueTags(Response &r, ConstBuffer<TagType> tag_types,
 		const RecursiveMap<std::string> &map) noexcept
@@ -196,7 +200,7 @@ PrintUniqueTags(Response &r, ConstBuffer<TagType> tag_types,
 	tag_types.pop_front();
 
 	for (const auto &i : map) {
-		r.Format("%s: %s\n", name, i.first.c_str());
+		r.Field(name, i.first);
 
 		if (!tag_types.empty())
 			PrintUniqueTags(r, tag_types, i.second);
@@ -212,6 +216,22 @@ PrintUniqueTags(Response &r, Partition &partition,
 
 	const DatabaseSelection selection("", true, filter);
 
-	PrintUniqueTags(r, tag_types,
-			db.CollectUniqueTags(selection, tag_types));
+	if (!IsAggregateCacheable(db, filter)) {
+		PrintUniqueTags(r, tag_types,
+				db.CollectUniqueTags(selection, tag_types));
+		return;
+	}
+
+	std::string key(tag_types.begin(), tag_types.end());
+
+	auto map = unique_tags_cache.Get(key);
+	if (map == nullptr) {
+		const unsigned generation = GetAggregateCacheGeneration();
+		map = unique_tags_cache.Put(std::move(key),
+					    db.CollectUniqueTags(selection,
+								 tag_types),
+					    generation);
+	}
+
+	PrintUniqueTags(r, tag_types, *map);
 }
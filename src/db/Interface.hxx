@@ -138,6 +138,15 @@ public:
 	 */
 	gcc_pure
 	virtual std::chrono::system_clock::time_point GetUpdateStamp() const noexcept = 0;
+
+	/**
+	 * Returns the time it took to load this database from disk,
+	 * or zero if that is unknown or not applicable.
+	 */
+	gcc_pure
+	virtual std::chrono::steady_clock::duration GetLoadDuration() const noexcept {
+		return {};
+	}
 };
 
 #endif
@@ -24,11 +24,21 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <utility>
 
 #include <stdlib.h>
 #include <string.h>
 
+struct DatabaseVisitorHelper::TopItem {
+	DetachedSong song;
+
+	/**
+	 * The position of this song in the unsorted result.
+	 */
+	unsigned serial;
+};
+
 DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 					     VisitSong &visit_song) noexcept
 	:selection(std::move(_selection))
@@ -37,7 +47,16 @@ DatabaseVisitorHelper::DatabaseVisitorHelper(DatabaseSelection _selection,
 	assert(selection.uri.empty());
 	assert(selection.filter == nullptr);
 
-	if (selection.sort != TAG_NUM_OF_ITEM_TYPES) {
+	if (selection.sort != TAG_NUM_OF_ITEM_TYPES && UseTop()) {
+		/* the client has asked us to sort the result, but
+		   only needs the first "window.end" songs; keep only
+		   those in a bounded heap */
+
+		original_visit_song = std::move(visit_song);
+		visit_song = [this](const auto &song){
+			VisitTop(song);
+		};
+	} else if (selection.sort != TAG_NUM_OF_ITEM_TYPES) {
 		/* the client has asked us to sort the result; this is
 		   pretty expensive, because instead of streaming the
 		   result to the client, we need to copy it all into
@@ -90,6 +109,90 @@ CompareTags(TagType type, bool descending, const Tag &a, const Tag &b) noexcept
 	}
 }
 
+/**
+ * The attributes of a song which are used for sorting.
+ */
+struct SortKey {
+	const Tag &tag;
+	std::chrono::system_clock::time_point mtime;
+
+	SortKey(const LightSong &song) noexcept
+		:tag(song.tag), mtime(song.mtime) {}
+
+	SortKey(const DetachedSong &song) noexcept
+		:tag(song.GetTag()), mtime(song.GetLastModified()) {}
+};
+
+gcc_pure
+static bool
+CompareSongs(TagType sort, bool descending, SortKey a, SortKey b) noexcept
+{
+	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
+		return descending
+			? a.mtime > b.mtime
+			: a.mtime < b.mtime;
+
+	return CompareTags(sort, descending, a.tag, b.tag);
+}
+
+bool
+DatabaseVisitorHelper::TopBefore(const TopItem &a,
+				 const TopItem &b) const noexcept
+{
+	const auto sort = selection.sort;
+	const auto descending = selection.descending;
+
+	if (CompareSongs(sort, descending, a.song, b.song))
+		return true;
+
+	if (CompareSongs(sort, descending, b.song, a.song))
+		return false;
+
+	return a.serial < b.serial;
+}
+
+void
+DatabaseVisitorHelper::VisitTop(const LightSong &song)
+{
+	const unsigned serial = counter++;
+
+	const auto before = [this](const TopItem &a, const TopItem &b){
+		return TopBefore(a, b);
+	};
+
+	if (top.size() < selection.window.end) {
+		top.push_back({DetachedSong(song), serial});
+		std::push_heap(top.begin(), top.end(), before);
+		return;
+	}
+
+	/* the heap is full: the new song replaces the top only if it
+	   sorts before it; if both are equal, the top wins because it
+	   was visited first */
+	if (top.empty() ||
+	    !CompareSongs(selection.sort, selection.descending,
+			  song, top.front().song))
+		return;
+
+	std::pop_heap(top.begin(), top.end(), before);
+	top.back() = {DetachedSong(song), serial};
+	std::push_heap(top.begin(), top.end(), before);
+}
+
+void
+DatabaseVisitorHelper::CommitTop()
+{
+	std::sort_heap(top.begin(), top.end(),
+		       [this](const TopItem &a, const TopItem &b){
+			       return TopBefore(a, b);
+		       });
+
+	/* apply the "window" and pass the remaining songs to the
+	   original visitor callback */
+	for (std::size_t i = selection.window.start; i < top.size(); ++i)
+		original_visit_song((LightSong)top[i].song);
+}
+
 void
 DatabaseVisitorHelper::Commit()
 {
@@ -99,25 +202,20 @@ DatabaseVisitorHelper::Commit()
 
 	assert(original_visit_song);
 
+	if (UseTop()) {
+		CommitTop();
+		return;
+	}
+
 	/* sort the song collection */
 	const auto sort = selection.sort;
 	const auto descending = selection.descending;
 
-	if (sort == TagType(SORT_TAG_LAST_MODIFIED))
-		std::stable_sort(songs.begin(), songs.end(),
-				 [descending](const DetachedSong &a, const DetachedSong &b){
-					 return descending
-						 ? a.GetLastModified() > b.GetLastModified()
-						 : a.GetLastModified() < b.GetLastModified();
-				 });
-	else
-		std::stable_sort(songs.begin(), songs.end(),
-				 [sort, descending](const DetachedSong &a,
-						    const DetachedSong &b){
-					 return CompareTags(sort, descending,
-							    a.GetTag(),
-							    b.GetTag());
-				 });
+	std::stable_sort(songs.begin(), songs.end(),
+			 [sort, descending](const DetachedSong &a,
+					    const DetachedSong &b){
+				 return CompareSongs(sort, descending, a, b);
+			 });
 
 	/* apply the "window" */
 	if (selection.window.end < songs.size())
@@ -22,10 +22,12 @@
 
 #include "Visitor.hxx"
 #include "Selection.hxx"
+#include "util/Compiler.h"
 
 #include <vector>
 
 class DetachedSong;
+struct LightSong;
 
 /**
  * This class helps implementing Database::Visit() by emulating
@@ -46,10 +48,21 @@ class DatabaseVisitorHelper {
 	 */
 	std::vector<DetachedSong> songs;
 
+	/**
+	 * If the client has asked us to sort the result and the
+	 * "window" has an upper bound, then only the first
+	 * "window.end" songs (in sort order) are needed.  Instead of
+	 * collecting all songs in #songs, this binary heap collects
+	 * just those; its top is the one which sorts last.
+	 */
+	struct TopItem;
+	std::vector<TopItem> top;
+
 	VisitSong original_visit_song;
 
 	/**
-	 * Used to emulate the "window".
+	 * Used to emulate the "window", and to keep the sort stable
+	 * for #top.
 	 */
 	unsigned counter = 0;
 
@@ -65,6 +78,21 @@ public:
 	~DatabaseVisitorHelper() noexcept;
 
 	void Commit();
+
+private:
+	bool UseTop() const noexcept {
+		return selection.window.end != RangeArg::All().end;
+	}
+
+	/**
+	 * Does #a sort before #b?  Songs which compare equal are
+	 * ordered by TopItem::serial.
+	 */
+	gcc_pure
+	bool TopBefore(const TopItem &a, const TopItem &b) const noexcept;
+
+	void VisitTop(const LightSong &song);
+	void CommitTop();
 };
 
 #endif
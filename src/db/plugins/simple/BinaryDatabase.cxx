@@ -0,0 +1,710 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BinaryDatabase.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/PlaylistVector.hxx"
+#include "fs/io/FileReader.hxx"
+#include "fs/io/OutputStream.hxx"
+#include "fs/Charset.hxx"
+#include "fs/Path.hxx"
+#include "tag/Builder.hxx"
+#include "tag/ParseName.hxx"
+#include "tag/Settings.hxx"
+#include "time/ChronoUtil.hxx"
+#include "util/RuntimeError.hxx"
+#include "Version.h"
+
+#ifndef _WIN32
+#include "system/Error.hxx"
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/*
+ * File layout: a #BinaryHeader, followed by the arrays of
+ * #BinaryTagName, #BinaryDirectory, #BinarySong, #BinaryTagItem and
+ * #BinaryPlaylist records (in this order, sizes specified in the
+ * header), followed by the string table.  All strings are referred
+ * to by their offset in the string table; they are null-terminated
+ * and de-duplicated.  Offset 0 is always the empty string.
+ *
+ * All integers are in host byte order; a database file copied to a
+ * host with a different byte order will be discarded.
+ */
+
+static constexpr char BINARY_DB_MAGIC[8] = {
+	'\x89', 'M', 'P', 'D', 'B', 'D', 'B', '\n',
+};
+
+static constexpr uint32_t BINARY_DB_VERSION = 1;
+
+static constexpr uint32_t BINARY_DB_BYTE_ORDER = 0x01020304;
+
+/**
+ * Special value for "mtime" attributes which means "unknown".
+ */
+static constexpr int64_t BINARY_DB_NO_TIME =
+	std::numeric_limits<int64_t>::min();
+
+struct BinaryHeader {
+	char magic[sizeof(BINARY_DB_MAGIC)];
+	uint32_t version;
+	uint32_t byte_order;
+
+	uint32_t mpd_version, fs_charset;
+
+	uint32_t n_tag_names, n_directories, n_songs, n_tag_items;
+	uint32_t n_playlists;
+
+	uint32_t reserved;
+
+	uint64_t strings_size;
+};
+
+struct BinaryTagName {
+	uint32_t name;
+
+	/**
+	 * Was this tag enabled (#IsTagEnabled()) when the database
+	 * was generated?
+	 */
+	uint32_t enabled;
+};
+
+struct BinaryDirectory {
+	/**
+	 * The index of the parent directory plus one; zero refers to
+	 * the root directory.  Parents always come before their
+	 * children.
+	 */
+	uint32_t parent;
+
+	uint32_t name;
+
+	int64_t mtime;
+
+	/**
+	 * One of the special #Directory::device values (e.g.
+	 * #DEVICE_CONTAINER) or 0.
+	 */
+	uint32_t device;
+
+	uint32_t reserved;
+};
+
+struct BinarySong {
+	/**
+	 * The directory index plus one (see BinaryDirectory::parent).
+	 */
+	uint32_t directory;
+
+	uint32_t filename, target;
+
+	/**
+	 * The range of #BinaryTagItem records belonging to this song.
+	 */
+	uint32_t first_tag_item, n_tag_items;
+
+	uint32_t start_ms, end_ms;
+
+	/**
+	 * The tag duration in milliseconds; negative if unknown.
+	 */
+	int32_t duration_ms;
+
+	int64_t mtime;
+
+	uint32_t sample_rate;
+	uint8_t format, channels;
+
+	uint8_t has_playlist;
+
+	uint8_t reserved;
+};
+
+struct BinaryTagItem {
+	/**
+	 * An index into the #BinaryTagName array.
+	 */
+	uint32_t type;
+
+	uint32_t value;
+};
+
+struct BinaryPlaylist {
+	/**
+	 * The directory index plus one (see BinaryDirectory::parent).
+	 */
+	uint32_t directory;
+
+	uint32_t name;
+
+	int64_t mtime;
+};
+
+/* all records are multiples of 8 bytes, which keeps each array
+   aligned without padding */
+static_assert(sizeof(BinaryHeader) % 8 == 0);
+static_assert(sizeof(BinaryTagName) % 8 == 0);
+static_assert(sizeof(BinaryDirectory) % 8 == 0);
+static_assert(sizeof(BinarySong) % 8 == 0);
+static_assert(sizeof(BinaryTagItem) % 8 == 0);
+static_assert(sizeof(BinaryPlaylist) % 8 == 0);
+
+static constexpr int64_t
+ExportTime(std::chrono::system_clock::time_point t) noexcept
+{
+	return IsNegative(t)
+		? BINARY_DB_NO_TIME
+		: int64_t(std::chrono::system_clock::to_time_t(t));
+}
+
+static constexpr std::chrono::system_clock::time_point
+ImportTime(int64_t t) noexcept
+{
+	return t == BINARY_DB_NO_TIME
+		? std::chrono::system_clock::time_point::min()
+		: std::chrono::system_clock::from_time_t(t);
+}
+
+static constexpr uint32_t
+ExportDevice(uint64_t device) noexcept
+{
+	return device == DEVICE_INARCHIVE || device == DEVICE_CONTAINER ||
+		device == DEVICE_PLAYLIST
+		? uint32_t(device)
+		: 0;
+}
+
+namespace {
+
+class BinaryDatabaseWriter {
+	std::vector<BinaryTagName> tag_names;
+	std::vector<BinaryDirectory> directories;
+	std::vector<BinarySong> songs;
+	std::vector<BinaryTagItem> tag_items;
+	std::vector<BinaryPlaylist> playlists;
+
+	std::string strings;
+
+	/**
+	 * Maps strings to their offset in #strings.  The keys point
+	 * to strings owned by the #Directory tree, which does not
+	 * change while we're saving it.
+	 */
+	std::unordered_map<std::string_view, uint32_t> string_map;
+
+public:
+	BinaryDatabaseWriter() {
+		/* offset 0 is the empty string */
+		strings.push_back('\0');
+
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+			tag_names.push_back({AddString(tag_item_names[i]),
+					     IsTagEnabled(i)});
+	}
+
+	void AddDirectory(const Directory &directory, uint32_t index);
+
+	void Write(OutputStream &os) const;
+
+private:
+	uint32_t AddString(std::string_view s);
+
+	static uint32_t CheckCount(std::size_t n) {
+		if (n > std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("Database too large");
+
+		return uint32_t(n);
+	}
+
+	void AddSong(const Song &song, uint32_t directory_index);
+};
+
+}
+
+uint32_t
+BinaryDatabaseWriter::AddString(std::string_view s)
+{
+	if (s.empty())
+		return 0;
+
+	auto i = string_map.emplace(s, uint32_t(strings.size()));
+	if (i.second) {
+		strings.append(s);
+		strings.push_back('\0');
+		CheckCount(strings.size());
+	}
+
+	return i.first->second;
+}
+
+inline void
+BinaryDatabaseWriter::AddSong(const Song &song, uint32_t directory_index)
+{
+	BinarySong s{};
+	s.directory = directory_index;
+	s.filename = AddString(song.filename);
+	s.target = AddString(song.target);
+	s.first_tag_item = CheckCount(tag_items.size());
+	s.start_ms = song.start_time.ToMS();
+	s.end_ms = song.end_time.ToMS();
+	s.duration_ms = song.tag.duration.count();
+	s.mtime = ExportTime(song.mtime);
+	s.sample_rate = song.audio_format.sample_rate;
+	s.format = uint8_t(song.audio_format.format);
+	s.channels = song.audio_format.channels;
+	s.has_playlist = song.tag.has_playlist;
+
+	for (const auto &i : song.tag)
+		tag_items.push_back({uint32_t(i.type), AddString(i.value)});
+
+	s.n_tag_items = CheckCount(tag_items.size()) - s.first_tag_item;
+	songs.push_back(s);
+}
+
+void
+BinaryDatabaseWriter::AddDirectory(const Directory &directory,
+				   uint32_t index)
+{
+	for (const auto &child : directory.children) {
+		if (child.IsMount())
+			continue;
+
+		directories.push_back({index, AddString(child.GetName()),
+				       ExportTime(child.mtime),
+				       ExportDevice(child.device), 0});
+		AddDirectory(child, CheckCount(directories.size()));
+	}
+
+	for (const auto &song : directory.songs)
+		AddSong(song, index);
+
+	for (const auto &pi : directory.playlists)
+		playlists.push_back({index, AddString(pi.name),
+				     ExportTime(pi.mtime)});
+}
+
+template<typename T>
+static void
+WriteArray(OutputStream &os, const std::vector<T> &v)
+{
+	os.Write(v.data(), v.size() * sizeof(T));
+}
+
+inline void
+BinaryDatabaseWriter::Write(OutputStream &os) const
+{
+	BinaryHeader header{};
+	memcpy(header.magic, BINARY_DB_MAGIC, sizeof(header.magic));
+	header.version = BINARY_DB_VERSION;
+	header.byte_order = BINARY_DB_BYTE_ORDER;
+
+	/* these two strings are not in the tree, so they are appended
+	   without de-duplication */
+	std::string s = strings;
+	header.mpd_version = CheckCount(s.size());
+	s.append(VERSION);
+	s.push_back('\0');
+	header.fs_charset = CheckCount(s.size());
+	s.append(GetFSCharset());
+	s.push_back('\0');
+
+	header.n_tag_names = CheckCount(tag_names.size());
+	header.n_directories = CheckCount(directories.size());
+	header.n_songs = CheckCount(songs.size());
+	header.n_tag_items = CheckCount(tag_items.size());
+	header.n_playlists = CheckCount(playlists.size());
+	header.strings_size = CheckCount(s.size());
+
+	os.Write(&header, sizeof(header));
+	WriteArray(os, tag_names);
+	WriteArray(os, directories);
+	WriteArray(os, songs);
+	WriteArray(os, tag_items);
+	WriteArray(os, playlists);
+	os.Write(s.data(), s.size());
+}
+
+void
+db_save_binary(OutputStream &os, const Directory &root)
+{
+	BinaryDatabaseWriter writer;
+
+	{
+		const ScopeDatabaseSharedLock protect;
+		writer.AddDirectory(root, 0);
+	}
+
+	writer.Write(os);
+}
+
+bool
+db_is_binary(Path path)
+{
+	FileReader reader(path);
+
+	char magic[sizeof(BINARY_DB_MAGIC)];
+	size_t nbytes = 0;
+	while (nbytes < sizeof(magic)) {
+		size_t n = reader.Read(magic + nbytes, sizeof(magic) - nbytes);
+		if (n == 0)
+			return false;
+
+		nbytes += n;
+	}
+
+	return memcmp(magic, BINARY_DB_MAGIC, sizeof(magic)) == 0;
+}
+
+namespace {
+
+/**
+ * A read-only view of a whole file.  On POSIX, the file is mapped
+ * into memory; elsewhere, it is read into a buffer.
+ */
+class MappedDatabaseFile {
+	const std::byte *data;
+	std::size_t size;
+
+#ifdef _WIN32
+	std::unique_ptr<std::byte[]> buffer;
+#endif
+
+public:
+	explicit MappedDatabaseFile(Path path);
+
+#ifndef _WIN32
+	~MappedDatabaseFile() noexcept {
+		munmap(const_cast<std::byte *>(data), size);
+	}
+#endif
+
+	MappedDatabaseFile(const MappedDatabaseFile &) = delete;
+	MappedDatabaseFile &operator=(const MappedDatabaseFile &) = delete;
+
+	const std::byte *begin() const noexcept {
+		return data;
+	}
+
+	const std::byte *end() const noexcept {
+		return data + size;
+	}
+};
+
+MappedDatabaseFile::MappedDatabaseFile(Path path)
+{
+	FileReader reader(path);
+
+	const uint64_t file_size = reader.GetSize();
+	if (file_size < sizeof(BinaryHeader) ||
+	    file_size > std::numeric_limits<std::size_t>::max())
+		throw std::runtime_error("Database corrupted");
+
+	size = std::size_t(file_size);
+
+#ifdef _WIN32
+	buffer = std::make_unique<std::byte[]>(size);
+	for (std::size_t position = 0; position < size;) {
+		std::size_t nbytes = reader.Read(buffer.get() + position,
+						 size - position);
+		if (nbytes == 0)
+			throw std::runtime_error("Unexpected end of file");
+
+		position += nbytes;
+	}
+
+	data = buffer.get();
+#else
+	void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+		       reader.GetFD().Get(), 0);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map database file");
+
+	/* the whole file will be read sequentially */
+	madvise(p, size, MADV_WILLNEED);
+
+	data = (const std::byte *)p;
+#endif
+}
+
+/**
+ * Parses the sections of a #MappedDatabaseFile and verifies that all
+ * references point inside the file.
+ */
+class BinaryDatabaseReader {
+	const std::byte *position;
+	const std::byte *const end;
+
+	const char *strings;
+	std::size_t strings_size;
+
+public:
+	const BinaryHeader &header;
+	const BinaryTagName *const tag_names;
+	const BinaryDirectory *const directories;
+	const BinarySong *const songs;
+	const BinaryTagItem *const tag_items;
+	const BinaryPlaylist *const playlists;
+
+	explicit BinaryDatabaseReader(const MappedDatabaseFile &file)
+		:position(file.begin()), end(file.end()),
+		 header(CheckHeader(*Next<BinaryHeader>(1))),
+		 tag_names(Next<BinaryTagName>(header.n_tag_names)),
+		 directories(Next<BinaryDirectory>(header.n_directories)),
+		 songs(Next<BinarySong>(header.n_songs)),
+		 tag_items(Next<BinaryTagItem>(header.n_tag_items)),
+		 playlists(Next<BinaryPlaylist>(header.n_playlists))
+	{
+		if (header.strings_size == 0 ||
+		    header.strings_size != std::size_t(end - position))
+			throw std::runtime_error("Database corrupted");
+
+		strings = (const char *)position;
+		strings_size = header.strings_size;
+
+		if (strings[0] != 0 || strings[strings_size - 1] != 0)
+			throw std::runtime_error("Database corrupted");
+	}
+
+	const char *GetString(uint32_t offset) const {
+		if (offset >= strings_size)
+			throw std::runtime_error("Database corrupted");
+
+		return strings + offset;
+	}
+
+private:
+	template<typename T>
+	const T *Next(std::size_t n) {
+		if (n > std::size_t(end - position) / sizeof(T))
+			throw std::runtime_error("Database corrupted");
+
+		const T *result = (const T *)(const void *)position;
+		position += n * sizeof(T);
+		return result;
+	}
+
+	static const BinaryHeader &CheckHeader(const BinaryHeader &header) {
+		if (memcmp(header.magic, BINARY_DB_MAGIC,
+			   sizeof(header.magic)) != 0)
+			throw std::runtime_error("Database corrupted");
+
+		if (header.version != BINARY_DB_VERSION ||
+		    header.byte_order != BINARY_DB_BYTE_ORDER)
+			throw std::runtime_error("Database format mismatch, "
+						 "discarding database file");
+
+		return header;
+	}
+};
+
+}
+
+/**
+ * Convert the #BinaryTagName array to a lookup table for the
+ * #BinaryTagItem::type attribute, and verify that all currently
+ * enabled tags were enabled when the database was generated.
+ */
+static std::vector<TagType>
+LoadTagNames(const BinaryDatabaseReader &r)
+{
+	std::vector<TagType> result;
+	result.reserve(r.header.n_tag_names);
+
+	bool enabled[TAG_NUM_OF_ITEM_TYPES]{};
+
+	for (uint32_t i = 0; i < r.header.n_tag_names; ++i) {
+		const auto &t = r.tag_names[i];
+		const auto name = r.GetString(t.name);
+
+		/* unknown tag names are tolerated as long as no
+		   song refers to them */
+		const TagType type = tag_name_parse(name);
+		result.push_back(type);
+
+		if (t.enabled) {
+			if (type == TAG_NUM_OF_ITEM_TYPES)
+				throw FormatRuntimeError("Unrecognized tag '%s', "
+							 "discarding database file",
+							 name);
+
+			enabled[type] = true;
+		}
+	}
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (IsTagEnabled(i) && !enabled[i])
+			throw std::runtime_error("Tag list mismatch, "
+						 "discarding database file");
+
+	return result;
+}
+
+static void
+CheckCharset(const BinaryDatabaseReader &r)
+{
+	const char *const new_charset = r.GetString(r.header.fs_charset);
+	const char *const old_charset = GetFSCharset();
+	if (*old_charset != 0 && strcmp(new_charset, old_charset) != 0)
+		throw FormatRuntimeError("Existing database has charset "
+					 "\"%s\" instead of \"%s\"; "
+					 "discarding database file",
+					 new_charset, old_charset);
+}
+
+static constexpr uint64_t
+ImportDevice(uint32_t device) noexcept
+{
+	return device == DEVICE_INARCHIVE || device == DEVICE_CONTAINER ||
+		device == DEVICE_PLAYLIST
+		? device
+		: 0;
+}
+
+static Directory &
+GetDirectory(const std::vector<Directory *> &directories, uint32_t index)
+{
+	if (index >= directories.size())
+		throw std::runtime_error("Database corrupted");
+
+	return *directories[index];
+}
+
+static void
+LoadDirectories(const BinaryDatabaseReader &r,
+		std::vector<Directory *> &directories)
+{
+	for (uint32_t i = 0; i < r.header.n_directories; ++i) {
+		const auto &d = r.directories[i];
+
+		/* the parent must have been loaded already */
+		Directory &parent = GetDirectory(directories, d.parent);
+
+		const char *name = r.GetString(d.name);
+		if (*name == 0)
+			throw std::runtime_error("Database corrupted");
+
+		if (parent.FindChild(name) != nullptr)
+			throw FormatRuntimeError("Duplicate subdirectory '%s'",
+						 name);
+
+		Directory *directory = parent.CreateChild(name);
+		directory->mtime = ImportTime(d.mtime);
+		directory->device = ImportDevice(d.device);
+		directories.push_back(directory);
+	}
+}
+
+static void
+LoadSongs(const BinaryDatabaseReader &r,
+	  const std::vector<Directory *> &directories,
+	  const std::vector<TagType> &tag_types)
+{
+	for (uint32_t i = 0; i < r.header.n_songs; ++i) {
+		const auto &s = r.songs[i];
+		Directory &directory = GetDirectory(directories, s.directory);
+
+		const char *name = r.GetString(s.filename);
+		if (*name == 0)
+			throw std::runtime_error("Database corrupted");
+
+		if (directory.FindSong(name) != nullptr)
+			throw FormatRuntimeError("Duplicate song '%s'", name);
+
+		if (s.first_tag_item > r.header.n_tag_items ||
+		    s.n_tag_items > r.header.n_tag_items - s.first_tag_item)
+			throw std::runtime_error("Database corrupted");
+
+		TagBuilder tag;
+		tag.SetDuration(SignedSongTime(SignedSongTime::rep(s.duration_ms)));
+		tag.SetHasPlaylist(s.has_playlist);
+
+		for (uint32_t j = 0; j < s.n_tag_items; ++j) {
+			const auto &item = r.tag_items[s.first_tag_item + j];
+			if (item.type >= tag_types.size() ||
+			    tag_types[item.type] == TAG_NUM_OF_ITEM_TYPES)
+				throw std::runtime_error("Database corrupted");
+
+			tag.AddItem(tag_types[item.type],
+				    r.GetString(item.value));
+		}
+
+		auto song = std::make_unique<Song>(name, directory);
+		song->target = r.GetString(s.target);
+		song->tag = tag.Commit();
+		song->mtime = ImportTime(s.mtime);
+		song->start_time = SongTime::FromMS(s.start_ms);
+		song->end_time = SongTime::FromMS(s.end_ms);
+
+		song->audio_format = AudioFormat(s.sample_rate,
+						 SampleFormat(s.format),
+						 s.channels);
+		if (!song->audio_format.IsValid())
+			song->audio_format.Clear();
+
+		directory.AddSong(std::move(song));
+	}
+}
+
+static void
+LoadPlaylists(const BinaryDatabaseReader &r,
+	      const std::vector<Directory *> &directories)
+{
+	for (uint32_t i = 0; i < r.header.n_playlists; ++i) {
+		const auto &p = r.playlists[i];
+		Directory &directory = GetDirectory(directories, p.directory);
+
+		directory.playlists.UpdateOrInsert(PlaylistInfo(r.GetString(p.name),
+								ImportTime(p.mtime)));
+	}
+}
+
+void
+db_load_binary(Path path, Directory &root)
+{
+	const MappedDatabaseFile file(path);
+	const BinaryDatabaseReader r(file);
+
+	CheckCharset(r);
+	const auto tag_types = LoadTagNames(r);
+
+	std::vector<Directory *> directories;
+	directories.reserve(r.header.n_directories + std::size_t(1));
+	directories.push_back(&root);
+
+	const ScopeDatabaseLock protect;
+	LoadDirectories(r, directories);
+	LoadSongs(r, directories, tag_types);
+	LoadPlaylists(r, directories);
+}
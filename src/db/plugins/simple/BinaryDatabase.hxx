@@ -0,0 +1,56 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_BINARY_DATABASE_HXX
+#define MPD_BINARY_DATABASE_HXX
+
+struct Directory;
+class Path;
+class OutputStream;
+
+/**
+ * Does the given file begin with the magic header of the binary
+ * database format?
+ *
+ * Throws on I/O error.
+ */
+bool
+db_is_binary(Path path);
+
+/**
+ * Write the database in the binary format: a header, a few arrays
+ * of fixed-size records and one string table which is shared by all
+ * records.
+ *
+ * Throws on I/O error.
+ */
+void
+db_save_binary(OutputStream &os, const Directory &root);
+
+/**
+ * Load a database file written by db_save_binary().  The file is
+ * mapped into memory, and the records are converted directly into
+ * #Directory and #Song objects without any parsing.
+ *
+ * Throws #std::runtime_error on error.
+ */
+void
+db_load_binary(Path path, Directory &root);
+
+#endif
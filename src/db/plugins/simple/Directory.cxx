@@ -39,6 +39,23 @@
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * Does the given list have more than the given number of items?
+ * Unlike size(), this is O(n) bounded by the given number, and does
+ * not require constant_time_size.
+ */
+template<typename L>
+gcc_pure
+static bool
+IsLongerThan(const L &list, std::size_t n) noexcept
+{
+	for (auto i = list.begin(), end = list.end(); i != end; ++i)
+		if (n-- == 0)
+			return true;
+
+	return false;
+}
+
 Directory::Directory(std::string &&_path_utf8, Directory *_parent) noexcept
 	:parent(_parent),
 	 path(std::move(_path_utf8))
@@ -59,9 +76,12 @@ Directory::~Directory() noexcept
 void
 Directory::Delete() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(parent != nullptr);
 
+	++song_generation;
+
+	parent->UnindexChild(*this);
 	parent->children.erase_and_dispose(parent->children.iterator_to(*this),
 					   DeleteDisposer());
 }
@@ -85,7 +105,7 @@ Directory::GetName() const noexcept
 Directory *
 Directory::CreateChild(std::string_view name_utf8) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(!name_utf8.empty());
 
 	std::string path_utf8 = IsRoot()
@@ -94,14 +114,47 @@ Directory::CreateChild(std::string_view name_utf8) noexcept
 
 	auto *child = new Directory(std::move(path_utf8), this);
 	children.push_back(*child);
+	IndexChild(*child);
 	return child;
 }
 
+void
+Directory::IndexChild(Directory &child) noexcept
+{
+	if (child_index != nullptr) {
+		child_index->emplace(child.GetName(), &child);
+		return;
+	}
+
+	if (!IsLongerThan(children, INDEX_THRESHOLD))
+		return;
+
+	child_index = std::make_unique<NameIndex<Directory>>();
+	for (auto &i : children)
+		child_index->emplace(i.GetName(), &i);
+}
+
+void
+Directory::UnindexChild(const Directory &child) noexcept
+{
+	if (child_index == nullptr)
+		return;
+
+	auto i = child_index->find(child.GetName());
+	if (i != child_index->end() && i->second == &child)
+		child_index->erase(i);
+}
+
 const Directory *
 Directory::FindChild(std::string_view name) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (child_index != nullptr) {
+		auto i = child_index->find(name);
+		return i != child_index->end() ? i->second : nullptr;
+	}
+
 	for (const auto &child : children)
 		if (name.compare(child.GetName()) == 0)
 			return &child;
@@ -112,16 +165,17 @@ Directory::FindChild(std::string_view name) const noexcept
 void
 Directory::PruneEmpty() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 
 	for (auto child = children.begin(), end = children.end();
 	     child != end;) {
 		child->PruneEmpty();
 
-		if (child->IsEmpty() && !child->IsMount())
+		if (child->IsEmpty() && !child->IsMount()) {
+			UnindexChild(*child);
 			child = children.erase_and_dispose(child,
 							   DeleteDisposer());
-		else
+		} else
 			++child;
 	}
 }
@@ -161,21 +215,47 @@ Directory::LookupDirectory(std::string_view _uri) noexcept
 void
 Directory::AddSong(SongPtr song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
-	songs.push_back(*song.release());
+	Song &s = *song.release();
+	songs.push_back(s);
+	IndexSong(s);
+	++song_generation;
+}
+
+void
+Directory::IndexSong(Song &song) noexcept
+{
+	if (song_index != nullptr) {
+		song_index->emplace(song.filename, &song);
+		return;
+	}
+
+	if (!IsLongerThan(songs, INDEX_THRESHOLD))
+		return;
+
+	song_index = std::make_unique<NameIndex<Song>>();
+	for (auto &i : songs)
+		song_index->emplace(i.filename, &i);
 }
 
 SongPtr
 Directory::RemoveSong(Song *song) noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
 	assert(song != nullptr);
 	assert(&song->parent == this);
 
+	if (song_index != nullptr) {
+		auto i = song_index->find(song->filename);
+		if (i != song_index->end() && i->second == song)
+			song_index->erase(i);
+	}
+
 	songs.erase(songs.iterator_to(*song));
+	++song_generation;
 	return SongPtr(song);
 }
 
@@ -184,6 +264,11 @@ Directory::FindSong(std::string_view name_utf8) const noexcept
 {
 	assert(holding_db_lock());
 
+	if (song_index != nullptr) {
+		auto i = song_index->find(name_utf8);
+		return i != song_index->end() ? i->second : nullptr;
+	}
+
 	for (auto &song : songs) {
 		assert(&song.parent == this);
 
@@ -204,7 +289,9 @@ directory_cmp(const Directory &a, const Directory &b) noexcept
 void
 Directory::Sort() noexcept
 {
-	assert(holding_db_lock());
+	assert(holding_db_write_lock());
+
+	++song_generation;
 
 	children.sort(directory_cmp);
 	song_list_sort(songs);
@@ -224,7 +311,7 @@ Directory::Walk(bool recursive, const SongFilter *filter,
 		/* TODO: eliminate this unlock/lock; it is necessary
 		   because the child's SimpleDatabasePlugin::Visit()
 		   call will lock it again */
-		const ScopeDatabaseUnlock unlock;
+		const ScopeDatabaseSharedUnlock unlock;
 		WalkMount(GetPath(), *mounted_database,
 			  "", DatabaseSelection("", recursive, filter),
 			  visit_directory, visit_song,
@@ -29,8 +29,10 @@
 
 #include <boost/intrusive/list.hpp>
 
+#include <memory>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 /**
  * Virtual directory that is really an archive file or a folder inside
@@ -89,6 +91,34 @@ struct Directory {
 	 */
 	SongList songs;
 
+	/**
+	 * Directories with more than this number of children (or
+	 * songs) get a hash index for FindChild() and FindSong();
+	 * below that, a linear scan is cheaper.
+	 */
+	static constexpr std::size_t INDEX_THRESHOLD = 32;
+
+	template<typename T>
+	using NameIndex = std::unordered_map<std::string_view, T *>;
+
+	/**
+	 * An optional index of #children by their base name.  It is
+	 * allocated as soon as the list grows beyond
+	 * #INDEX_THRESHOLD, and from then on, it is maintained by all
+	 * methods which add or remove children.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 */
+	std::unique_ptr<NameIndex<Directory>> child_index;
+
+	/**
+	 * An optional index of #songs by their file name; see
+	 * #child_index.
+	 *
+	 * This attribute is protected with the global #db_mutex.
+	 */
+	std::unique_ptr<NameIndex<Song>> song_index;
+
 	PlaylistVector playlists;
 
 	Directory *const parent;
@@ -144,14 +174,14 @@ public:
 	 * Remove this #Directory object from its parent and free it.  This
 	 * must not be called with the root Directory.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Delete() noexcept;
 
 	/**
 	 * Create a new #Directory object as a child of the given one.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 *
 	 * @param name_utf8 the UTF-8 encoded name of the new sub directory
 	 */
@@ -173,7 +203,7 @@ public:
 	 * Look up a sub directory, and create the object if it does not
 	 * exist.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	Directory *MakeChild(std::string_view name_utf8) noexcept {
 		Directory *child = FindChild(name_utf8);
@@ -283,19 +313,19 @@ public:
 	SongPtr RemoveSong(Song *song) noexcept;
 
 	/**
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void PruneEmpty() noexcept;
 
 	/**
 	 * Sort all directory entries recursively.
 	 *
-	 * Caller must lock the #db_mutex.
+	 * Caller must lock the #db_mutex exclusively.
 	 */
 	void Sort() noexcept;
 
 	/**
-	 * Caller must lock #db_mutex.
+	 * Caller must hold a shared lock on #db_mutex.
 	 */
 	void Walk(bool recursive, const SongFilter *match,
 		  const VisitDirectory& visit_directory, const VisitSong& visit_song,
@@ -303,6 +333,25 @@ public:
 
 	gcc_pure
 	LightDirectory Export() const noexcept;
+
+private:
+	/**
+	 * Add a new child to #child_index, creating the index if the
+	 * list has become large enough.
+	 */
+	void IndexChild(Directory &child) noexcept;
+
+	/**
+	 * Remove a child from #child_index (if there is one).  Must
+	 * be called before the child gets disposed.
+	 */
+	void UnindexChild(const Directory &child) noexcept;
+
+	/**
+	 * Add a new song to #song_index, creating the index if the
+	 * list has become large enough.
+	 */
+	void IndexSong(Song &song) noexcept;
 };
 
 #endif
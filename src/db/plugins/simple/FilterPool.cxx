@@ -0,0 +1,136 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FilterPool.hxx"
+#include "Song.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "thread/Name.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+/**
+ * The number of songs a worker claims at a time.  Large enough to
+ * keep the contention on #FilterPool::next low, small enough to
+ * distribute the work evenly.
+ */
+static constexpr std::size_t CHUNK_SIZE = 256;
+
+FilterPool::FilterPool(unsigned n_threads)
+{
+	try {
+		for (unsigned i = 0; i < n_threads; ++i)
+			threads.emplace_back(BIND_THIS_METHOD(RunThread)).Start();
+	} catch (...) {
+		Stop();
+		throw;
+	}
+}
+
+FilterPool::~FilterPool() noexcept
+{
+	Stop();
+}
+
+void
+FilterPool::Stop() noexcept
+{
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		if (i.IsDefined())
+			i.Join();
+
+	threads.clear();
+}
+
+inline void
+FilterPool::Work() noexcept
+{
+	while (true) {
+		const std::size_t start =
+			next.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+		if (start >= n_songs)
+			break;
+
+		const std::size_t end = std::min(start + CHUNK_SIZE, n_songs);
+		for (std::size_t i = start; i < end; ++i)
+			result[i] = filter->Match(songs[i]->Export());
+	}
+}
+
+void
+FilterPool::Match(const SongFilter &_filter,
+		  const Song *const*_songs, std::size_t _n_songs,
+		  uint8_t *_result) noexcept
+{
+	std::unique_lock<Mutex> lock(mutex);
+	assert(busy == 0);
+
+	filter = &_filter;
+	songs = _songs;
+	n_songs = _n_songs;
+	result = _result;
+	next.store(0, std::memory_order_relaxed);
+	busy = threads.size();
+	++job;
+	wake_cond.notify_all();
+
+	/* let the calling thread participate */
+	lock.unlock();
+	Work();
+	lock.lock();
+
+	done_cond.wait(lock, [this]{ return busy == 0; });
+}
+
+void
+FilterPool::RunThread() noexcept
+{
+	SetThreadName("db_filter");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	/* start with 0, not with the current #job value, just in
+	   case Match() was called before this thread got here */
+	unsigned last_job = 0;
+
+	while (true) {
+		wake_cond.wait(lock, [this, last_job]{
+			return quit || job != last_job;
+		});
+
+		if (quit)
+			break;
+
+		last_job = job;
+
+		lock.unlock();
+		Work();
+		lock.lock();
+
+		if (--busy == 0)
+			done_cond.notify_one();
+	}
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SIMPLE_FILTER_POOL_HXX
+#define MPD_SIMPLE_FILTER_POOL_HXX
+
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+
+struct Song;
+class SongFilter;
+
+/**
+ * A pool of worker threads which evaluate a #SongFilter on a large
+ * number of songs concurrently.  This speeds up CPU-bound searches
+ * (e.g. regular expressions or case-folded substring matches) on
+ * multi-core machines.
+ *
+ * The caller is responsible for keeping the songs alive (i.e. for
+ * holding a shared lock on the #db_mutex) during Match().
+ */
+class FilterPool {
+	Mutex mutex;
+
+	/**
+	 * Wakes up the worker threads when a new job has been
+	 * submitted or when they shall quit.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signals the caller of Match() that all workers have
+	 * finished the current job.
+	 */
+	Cond done_cond;
+
+	std::list<Thread> threads;
+
+	/* the current job; protected by #mutex, except for the
+	   atomic #next */
+
+	const SongFilter *filter;
+	const Song *const*songs;
+	std::size_t n_songs;
+	uint8_t *result;
+
+	/**
+	 * The index of the next chunk to be processed.
+	 */
+	std::atomic_size_t next;
+
+	/**
+	 * Incremented for each job; workers compare it with the
+	 * last job they have worked on.
+	 */
+	unsigned job = 0;
+
+	/**
+	 * The number of workers which are still working on the
+	 * current job.
+	 */
+	unsigned busy = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param n_threads the number of worker threads; the thread
+	 * calling Match() participates as well
+	 */
+	explicit FilterPool(unsigned n_threads);
+	~FilterPool() noexcept;
+
+	FilterPool(const FilterPool &) = delete;
+	FilterPool &operator=(const FilterPool &) = delete;
+
+	/**
+	 * Evaluate the filter on all songs and store the result (0
+	 * or 1) in the corresponding element of the #result array.
+	 * Returns after all songs have been evaluated.
+	 *
+	 * Only one thread may call this method at a time.
+	 */
+	void Match(const SongFilter &filter,
+		   const Song *const*songs, std::size_t n_songs,
+		   uint8_t *result) noexcept;
+
+private:
+	/**
+	 * Process chunks of the current job until there are no
+	 * more.
+	 */
+	void Work() noexcept;
+
+	/**
+	 * Stop and join all worker threads.
+	 */
+	void Stop() noexcept;
+
+	void RunThread() noexcept;
+};
+
+#endif
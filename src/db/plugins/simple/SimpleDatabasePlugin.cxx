@@ -31,6 +31,8 @@
 #include "Directory.hxx"
 #include "Song.hxx"
 #include "DatabaseSave.hxx"
+#include "BinaryDatabase.hxx"
+#include "FilterPool.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/DatabaseError.hxx"
 #include "fs/io/TextFile.hxx"
@@ -43,24 +45,56 @@
 #include "util/Domain.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/RecursiveMap.hxx"
+#include "util/RuntimeError.hxx"
+#include "util/StringAPI.hxx"
 #include "Log.hxx"
 
 #ifdef ENABLE_ZLIB
 #include "fs/io/GzipOutputStream.hxx"
 #endif
 
+#include <algorithm>
 #include <cerrno>
 #include <memory>
+#include <thread>
+#include <vector>
 
 static constexpr Domain simple_db_domain("simple_db");
 
+/**
+ * Visit() uses the #FilterPool only if the selection contains at
+ * least this number of songs; for smaller selections, the overhead
+ * is not worth it.
+ */
+static constexpr std::size_t PARALLEL_THRESHOLD = 4096;
+
+static unsigned
+GetDefaultThreads() noexcept
+{
+	return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+static SimpleDatabase::FileFormat
+ParseFileFormat(const char *s)
+{
+	if (StringIsEqual(s, "text"))
+		return SimpleDatabase::FileFormat::TEXT;
+	else if (StringIsEqual(s, "binary"))
+		return SimpleDatabase::FileFormat::BINARY;
+	else
+		throw FormatRuntimeError("Unrecognized database format: \"%s\"",
+					 s);
+}
+
 inline SimpleDatabase::SimpleDatabase(const ConfigBlock &block)
 	:Database(simple_db_plugin),
 	 path(block.GetPath("path")),
 #ifdef ENABLE_ZLIB
 	 compress(block.GetBlockValue("compress", true)),
 #endif
-	 cache_path(block.GetPath("cache_directory"))
+	 format(ParseFileFormat(block.GetBlockValue("format", "text"))),
+	 cache_path(block.GetPath("cache_directory")),
+	 n_threads(block.GetPositiveValue("threads", GetDefaultThreads()))
 {
 	if (path.IsNull())
 		throw std::runtime_error("No \"path\" parameter specified");
@@ -72,17 +106,21 @@ inline SimpleDatabase::SimpleDatabase(AllocatedPath &&_path,
 #ifndef ENABLE_ZLIB
 				      [[maybe_unused]]
 #endif
-				      bool _compress) noexcept
+				      bool _compress,
+				      FileFormat _format) noexcept
 	:Database(simple_db_plugin),
 	 path(std::move(_path)),
 	 path_utf8(path.ToUTF8()),
 #ifdef ENABLE_ZLIB
 	 compress(_compress),
 #endif
+	 format(_format),
 	 cache_path(nullptr)
 {
 }
 
+SimpleDatabase::~SimpleDatabase() noexcept = default;
+
 DatabasePtr
 SimpleDatabase::Create(EventLoop &, EventLoop &,
 		       [[maybe_unused]] DatabaseListener &listener,
@@ -150,11 +188,24 @@ SimpleDatabase::Load()
 	assert(!path.IsNull());
 	assert(root != nullptr);
 
-	TextFile file(path);
+	const auto start_time = std::chrono::steady_clock::now();
+
+	if (db_is_binary(path)) {
+		LogDebug(simple_db_domain, "reading binary DB");
 
-	LogDebug(simple_db_domain, "reading DB");
+		db_load_binary(path, *root);
+	} else {
+		TextFile file(path);
+
+		LogDebug(simple_db_domain, "reading DB");
+
+		db_load_internal(file, *root);
+	}
+
+	load_duration = std::chrono::steady_clock::now() - start_time;
 
-	db_load_internal(file, *root);
+	FormatDebug(simple_db_domain, "DB loaded in %.3f s",
+		    std::chrono::duration_cast<FloatDuration>(load_duration).count());
 
 	FileInfo fi;
 	if (GetFileInfo(path, fi))
@@ -184,6 +235,18 @@ SimpleDatabase::Open()
 
 		root = Directory::NewRoot();
 	}
+
+	if (n_threads > 1) {
+		try {
+			filter_pool = std::make_unique<FilterPool>(n_threads - 1);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start database filter threads");
+		}
+	}
+
+	const ScopeDatabaseLock protect;
+	tag_index.Build(*root);
 }
 
 void
@@ -193,6 +256,13 @@ SimpleDatabase::Close() noexcept
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
+	{
+		const ScopeDatabaseLock protect;
+		tag_index.Clear();
+	}
+
+	filter_pool.reset();
+
 	delete root;
 }
 
@@ -203,7 +273,7 @@ SimpleDatabase::GetSong(std::string_view uri) const
 	assert(prefixed_light_song == nullptr);
 	assert(borrowed_song_count == 0);
 
-	ScopeDatabaseLock protect;
+	ScopeDatabaseSharedLock protect;
 
 	auto r = root->LookupDirectory(uri);
 
@@ -275,13 +345,71 @@ CheckSelection(DatabaseSelection selection) noexcept
 	return selection;
 }
 
+/**
+ * Collect all songs of the given directory (recursively) in the
+ * order in which Directory::Walk() visits them.
+ *
+ * @return false if a mount point was found (songs of mounted
+ * databases cannot be collected)
+ */
+static bool
+CollectSongs(const Directory &directory, std::vector<const Song *> &songs)
+{
+	if (directory.IsMount())
+		return false;
+
+	for (const auto &song : directory.songs)
+		songs.push_back(&song);
+
+	for (const auto &child : directory.children)
+		if (!CollectSongs(child, songs))
+			return false;
+
+	return true;
+}
+
+bool
+SimpleDatabase::VisitParallel(const Directory &directory,
+			      const SongFilter &filter,
+			      const VisitSong &visit_song) const
+{
+	if (filter_pool == nullptr)
+		return false;
+
+	/* the FilterPool evaluates only one filter at a time; if
+	   another reader is using it, walk the tree in this thread
+	   instead of waiting */
+	const std::unique_lock<Mutex> pool_lock(filter_pool_mutex,
+						std::try_to_lock);
+	if (!pool_lock.owns_lock())
+		return false;
+
+	std::vector<const Song *> songs;
+	if (!CollectSongs(directory, songs) ||
+	    songs.size() < PARALLEL_THRESHOLD)
+		return false;
+
+	std::vector<uint8_t> matches(songs.size());
+	filter_pool->Match(filter, songs.data(), songs.size(),
+			   matches.data());
+
+	/* invoke the visitor in this thread, in the original order,
+	   so DatabaseVisitorHelper can sort and window the result
+	   just like with Directory::Walk() */
+	for (std::size_t i = 0; i < songs.size(); ++i)
+		if (matches[i])
+			visit_song(songs[i]->Export());
+
+	return true;
+}
+
 void
 SimpleDatabase::Visit(const DatabaseSelection &selection,
 		      VisitDirectory visit_directory,
 		      VisitSong visit_song,
 		      VisitPlaylist visit_playlist) const
 {
-	ScopeDatabaseLock protect;
+	ScopeDatabaseSharedLock protect;
 
 	auto r = root->LookupDirectory(selection.uri);
 
@@ -305,6 +433,16 @@ SimpleDatabase::Visit(const DatabaseSelection &selection,
 		if (selection.recursive && visit_directory)
 			visit_directory(r.directory->Export());
 
+		if (selection.recursive && selection.filter != nullptr &&
+		    visit_song && !visit_directory && !visit_playlist &&
+		    (tag_index.Visit(*r.directory, *selection.filter,
+				     visit_song) ||
+		     VisitParallel(*r.directory, *selection.filter,
+				   visit_song))) {
+			helper.Commit();
+			return;
+		}
+
 		r.directory->Walk(selection.recursive, selection.filter,
 				  visit_directory, visit_song,
 				  visit_playlist);
@@ -356,11 +494,48 @@ SimpleDatabase::Save()
 		root->Sort();
 	}
 
+	{
+		/* build the new index with only a shared lock, so
+		   readers are not blocked meanwhile; the old index is
+		   stale and will not be used by them */
+		LogDebug(simple_db_domain, "indexing DB");
+
+		TagIndex new_index;
+
+		{
+			const ScopeDatabaseSharedLock protect;
+			new_index.Build(*root);
+		}
+
+		{
+			const ScopeDatabaseLock protect;
+			std::swap(tag_index, new_index);
+		}
+
+		/* the old index is freed here, after the lock has
+		   been released */
+	}
+
 	LogDebug(simple_db_domain, "writing DB");
 
 	FileOutputStream fos(path);
 
-	OutputStream *os = &fos;
+	if (format == FileFormat::BINARY)
+		db_save_binary(fos, *root);
+	else
+		SaveText(fos);
+
+	fos.Commit();
+
+	FileInfo fi;
+	if (GetFileInfo(path, fi))
+		mtime = fi.GetModificationTime();
+}
+
+void
+SimpleDatabase::SaveText(OutputStream &_os)
+{
+	OutputStream *os = &_os;
 
 #ifdef ENABLE_ZLIB
 	std::unique_ptr<GzipOutputStream> gzip;
@@ -382,12 +557,6 @@ SimpleDatabase::Save()
 		gzip.reset();
 	}
 #endif
-
-	fos.Commit();
-
-	FileInfo fi;
-	if (GetFileInfo(path, fi))
-		mtime = fi.GetModificationTime();
 }
 
 void
@@ -413,6 +582,12 @@ SimpleDatabase::Mount(const char *uri, DatabasePtr db)
 
 	Directory *mnt = r.directory->CreateChild(r.rest);
 	mnt->mounted_database = std::move(db);
+
+	/* songs in mounted databases cannot be indexed; bumping the
+	   generation also invalidates an index which is being built
+	   concurrently by Save() */
+	++song_generation;
+	tag_index.Clear();
 }
 
 static constexpr bool
@@ -443,7 +618,7 @@ SimpleDatabase::Mount(const char *local_uri, const char *storage_uri)
 	constexpr bool compress = false;
 #endif
 	auto db = std::make_unique<SimpleDatabase>(cache_path / name_fs,
-						   compress);
+						   compress, format);
 	db->Open();
 
 	bool exists = db->FileExists();
@@ -481,6 +656,6 @@ SimpleDatabase::Unmount(const char *uri) noexcept
 
 const DatabasePlugin simple_db_plugin = {
 	"simple",
-	DatabasePlugin::FLAG_REQUIRE_STORAGE,
+	DatabasePlugin::FLAG_REQUIRE_STORAGE|DatabasePlugin::FLAG_THREAD_SAFE,
 	SimpleDatabase::Create,
 };
@@ -20,15 +20,19 @@
 #ifndef MPD_SIMPLE_DATABASE_PLUGIN_HXX
 #define MPD_SIMPLE_DATABASE_PLUGIN_HXX
 
+#include "TagIndex.hxx"
 #include "db/Interface.hxx"
 #include "db/Ptr.hxx"
 #include "fs/AllocatedPath.hxx"
+#include "thread/Mutex.hxx"
 #include "song/LightSong.hxx"
 #include "util/Manual.hxx"
 #include "util/Compiler.h"
 #include "config.h"
 
 #include <cassert>
+#include <cstdint>
+#include <memory>
 
 struct ConfigBlock;
 struct Directory;
@@ -36,8 +40,27 @@ struct DatabasePlugin;
 class EventLoop;
 class DatabaseListener;
 class PrefixedLightSong;
+class OutputStream;
+class FilterPool;
+class SongFilter;
 
 class SimpleDatabase : public Database {
+public:
+	enum class FileFormat : uint8_t {
+		/**
+		 * The line-based text format (optionally compressed
+		 * with gzip).
+		 */
+		TEXT,
+
+		/**
+		 * The binary format implemented by
+		 * db_save_binary().
+		 */
+		BINARY,
+	};
+
+private:
 	AllocatedPath path;
 	std::string path_utf8;
 
@@ -45,15 +68,56 @@ class SimpleDatabase : public Database {
 	bool compress;
 #endif
 
+	/**
+	 * The format used by Save().  Load() detects the format of
+	 * the existing file automatically.
+	 */
+	FileFormat format;
+
 	/**
 	 * The path where cache files for Mount() are located.
 	 */
 	AllocatedPath cache_path;
 
+	/**
+	 * The number of threads used to evaluate filters in Visit().
+	 * A value of 1 disables the #filter_pool.
+	 */
+	unsigned n_threads = 1;
+
 	Directory *root;
 
+	/**
+	 * An index for Visit() calls with tag filters.  It is rebuilt
+	 * after loading and after saving the database (i.e. after
+	 * each update).
+	 *
+	 * Protected with the global #db_mutex: readers need a shared
+	 * lock, replacing or clearing it requires an exclusive lock.
+	 */
+	TagIndex tag_index;
+
+	/**
+	 * Worker threads for Visit() calls with filters which cannot
+	 * be answered by the #tag_index.  Created by Open() if
+	 * #n_threads is larger than 1.
+	 */
+	std::unique_ptr<FilterPool> filter_pool;
+
+	/**
+	 * Serializes access to the #filter_pool, which can evaluate
+	 * only one filter at a time.  Readers which find it locked
+	 * fall back to Directory::Walk().
+	 */
+	mutable Mutex filter_pool_mutex;
+
 	std::chrono::system_clock::time_point mtime;
 
+	/**
+	 * How long did the last Load() call take?
+	 */
+	std::chrono::steady_clock::duration load_duration{};
+
 	/**
 	 * A buffer for GetSong() when prefixing the #LightSong
 	 * instance from a mounted #Database.
@@ -71,7 +135,9 @@ class SimpleDatabase : public Database {
 
 public:
 	SimpleDatabase(const ConfigBlock &block);
-	SimpleDatabase(AllocatedPath &&_path, bool _compress) noexcept;
+	SimpleDatabase(AllocatedPath &&_path, bool _compress,
+		       FileFormat _format) noexcept;
+	~SimpleDatabase() noexcept override;
 
 	static DatabasePtr Create(EventLoop &main_event_loop,
 				  EventLoop &io_event_loop,
@@ -133,6 +199,10 @@ public:
 		return mtime;
 	}
 
+	std::chrono::steady_clock::duration GetLoadDuration() const noexcept override {
+		return load_duration;
+	}
+
 private:
 	void Configure(const ConfigBlock &block);
 
@@ -143,6 +213,22 @@ private:
 	 */
 	void Load();
 
+	void SaveText(OutputStream &os);
+
+	/**
+	 * Evaluate the filter with the #filter_pool and pass all
+	 * matching songs to the visitor.
+	 *
+	 * Caller must hold a shared lock on the #db_mutex.
+	 *
+	 * @return false if the #filter_pool cannot be used (or is
+	 * not worth it); the caller must then fall back to
+	 * Directory::Walk()
+	 */
+	bool VisitParallel(const Directory &directory,
+			   const SongFilter &filter,
+			   const VisitSong &visit_song) const;
+
 	DatabasePtr LockUmountSteal(const char *uri) noexcept;
 };
 
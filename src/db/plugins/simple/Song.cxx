@@ -24,6 +24,8 @@
 #include "song/LightSong.hxx"
 #include "fs/Traits.hxx"
 
+std::atomic_uint song_generation;
+
 Song::Song(DetachedSong &&other, Directory &_parent) noexcept
 	:tag(std::move(other.WritableTag())),
 	 parent(_parent),
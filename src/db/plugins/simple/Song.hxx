@@ -29,6 +29,7 @@
 
 #include <boost/intrusive/list.hpp>
 
+#include <atomic>
 #include <string>
 
 struct StringView;
@@ -156,6 +157,15 @@ struct Song {
 	LightSong Export() const noexcept;
 };
 
+/**
+ * This counter is incremented whenever a #Song is added to or removed
+ * from a #Directory, whenever its tags are modified and whenever the
+ * order of songs changes.  Caches which are derived from the songs of
+ * a #Directory tree (e.g. #TagIndex) compare it to detect whether
+ * they are stale.
+ */
+extern std::atomic_uint song_generation;
+
 typedef boost::intrusive::list<Song,
 			       boost::intrusive::member_hook<Song, Song::Hook,
 							     &Song::siblings>,
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TagIndex.hxx"
+#include "Directory.hxx"
+#include "Song.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "song/TagSongFilter.hxx"
+#include "tag/Fallback.hxx"
+#include "tag/Mask.hxx"
+#include "tag/Tag.hxx"
+
+#include <algorithm>
+
+/**
+ * These tags are not indexed because their values are (almost)
+ * unique for each song; indexing them would cost a lot of memory
+ * with little benefit.
+ */
+static constexpr TagMask unindexed_tags =
+	TagMask(TAG_TITLE) | TagMask(TAG_NAME) | TagMask(TAG_COMMENT) |
+	TagMask(TAG_MUSICBRAINZ_TRACKID) |
+	TagMask(TAG_MUSICBRAINZ_RELEASETRACKID);
+
+static constexpr bool
+IsIndexedTag(TagType type) noexcept
+{
+	return type < TAG_NUM_OF_ITEM_TYPES && !unindexed_tags.Test(type);
+}
+
+void
+TagIndex::Clear() noexcept
+{
+	valid = false;
+	postings.clear();
+	songs.clear();
+	songs.shrink_to_fit();
+}
+
+bool
+TagIndex::IsValid() const noexcept
+{
+	return valid && generation == song_generation;
+}
+
+inline void
+TagIndex::AddPosting(TagType type, const char *value) noexcept
+{
+	auto &list = postings[Key{type, value}];
+
+	/* a song may have the same value twice */
+	const uint32_t i = songs.size() - 1;
+	if (list.empty() || list.back() != i)
+		list.push_back(i);
+}
+
+inline void
+TagIndex::AddSong(const Song &song) noexcept
+{
+	songs.push_back(&song);
+
+	const Tag &tag = song.tag;
+
+	bool present[TAG_NUM_OF_ITEM_TYPES]{};
+	for (const auto &i : tag) {
+		present[i.type] = true;
+
+		if (IsIndexedTag(i.type))
+			AddPosting(i.type, i.value);
+	}
+
+	/* index the fallback values of missing tags, just like
+	   TagSongFilter::Match() would look them up */
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		const auto type = TagType(i);
+		if (present[type] || !IsIndexedTag(type))
+			continue;
+
+		ApplyTagFallback(type, [&](TagType fallback){
+			if (!present[fallback])
+				return false;
+
+			for (const auto &item : tag)
+				if (item.type == fallback)
+					AddPosting(type, item.value);
+
+			return true;
+		});
+	}
+}
+
+void
+TagIndex::AddDirectory(const Directory &directory) noexcept
+{
+	if (directory.IsMount()) {
+		valid = false;
+		return;
+	}
+
+	/* same order as Directory::Walk() */
+
+	for (const auto &song : directory.songs)
+		AddSong(song);
+
+	for (const auto &child : directory.children)
+		AddDirectory(child);
+}
+
+void
+TagIndex::Build(const Directory &root) noexcept
+{
+	Clear();
+
+	generation = song_generation;
+	valid = true;
+
+	AddDirectory(root);
+
+	if (!valid)
+		Clear();
+}
+
+gcc_pure
+static bool
+IsInside(const Directory &directory, const Directory &base) noexcept
+{
+	for (const Directory *i = &directory; i != nullptr; i = i->parent)
+		if (i == &base)
+			return true;
+
+	return false;
+}
+
+bool
+TagIndex::Visit(const Directory &base, const SongFilter &filter,
+		const VisitSong &visit_song) const
+{
+	if (!IsValid())
+		return false;
+
+	std::vector<const std::vector<uint32_t> *> lists;
+
+	for (const auto &i : filter.GetItems()) {
+		const auto *t = dynamic_cast<const TagSongFilter *>(i.get());
+		if (t == nullptr || !t->IsExact() || t->GetValue().empty() ||
+		    !IsIndexedTag(t->GetTagType()))
+			continue;
+
+		auto p = postings.find(Key{t->GetTagType(), t->GetValue()});
+		if (p == postings.end())
+			/* no song has this value */
+			return true;
+
+		lists.push_back(&p->second);
+	}
+
+	if (lists.empty())
+		return false;
+
+	/* iterate over the shortest list, and look up its items in
+	   all other lists */
+	std::sort(lists.begin(), lists.end(), [](auto a, auto b){
+		return a->size() < b->size();
+	});
+
+	for (const uint32_t i : *lists.front()) {
+		if (!std::all_of(std::next(lists.begin()), lists.end(),
+				 [i](auto list){
+					 return std::binary_search(list->begin(),
+								   list->end(),
+								   i);
+				 }))
+			continue;
+
+		const Song &song = *songs[i];
+		if (!IsInside(song.parent, base))
+			continue;
+
+		const LightSong song2 = song.Export();
+		if (filter.Match(song2))
+			visit_song(song2);
+	}
+
+	return true;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_SIMPLE_TAG_INDEX_HXX
+#define MPD_SIMPLE_TAG_INDEX_HXX
+
+#include "db/Visitor.hxx"
+#include "tag/Type.h"
+#include "util/Compiler.h"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Directory;
+struct Song;
+class SongFilter;
+
+/**
+ * An inverted index which maps tag values to the songs which have
+ * them.  It is used by SimpleDatabase::Visit() to avoid walking the
+ * whole tree for filters which contain exact tag matches (e.g. "find
+ * album X").
+ *
+ * The index is built from scratch by Build() and becomes stale as
+ * soon as the #Directory tree is modified (see #song_generation);
+ * a stale index is never used.
+ *
+ * All methods must be called while holding (at least) a shared lock
+ * on the #db_mutex; the index itself is not protected by it, so an
+ * instance which is shared with other threads may only be modified
+ * with an exclusive lock.
+ */
+class TagIndex {
+	struct Key {
+		TagType type;
+
+		/**
+		 * Points to the pooled tag value of one of the
+		 * songs.  This is only valid as long as the index is
+		 * not stale; therefore, keys must not be compared
+		 * after the tree has been modified.
+		 */
+		std::string_view value;
+
+		bool operator==(const Key &other) const noexcept {
+			return type == other.type && value == other.value;
+		}
+
+		struct Hash {
+			gcc_pure
+			std::size_t operator()(const Key &key) const noexcept {
+				return std::hash<std::string_view>()(key.value) ^
+					(std::size_t(key.type) * 0x9e3779b9);
+			}
+		};
+	};
+
+	/**
+	 * All songs in the order in which Directory::Walk() visits
+	 * them.
+	 */
+	std::vector<const Song *> songs;
+
+	/**
+	 * Maps each tag value to a sorted list of indices into
+	 * #songs.
+	 */
+	std::unordered_map<Key, std::vector<uint32_t>, Key::Hash> postings;
+
+	/**
+	 * The #song_generation value which was current when this
+	 * index was built.
+	 */
+	unsigned generation;
+
+	bool valid = false;
+
+public:
+	/**
+	 * Discard the old index and build a new one from the given
+	 * tree.  If the tree contains mount points, the index remains
+	 * invalid, because songs from mounted databases cannot be
+	 * indexed.
+	 */
+	void Build(const Directory &root) noexcept;
+
+	/**
+	 * Free all memory and invalidate the index.
+	 */
+	void Clear() noexcept;
+
+	gcc_pure
+	bool IsValid() const noexcept;
+
+	/**
+	 * Visit all songs inside the given directory (recursively)
+	 * which match the given filter, in the same order as
+	 * Directory::Walk().
+	 *
+	 * @return false if the index cannot be used (stale, or the
+	 * filter does not contain an indexable item); the caller
+	 * must then fall back to Directory::Walk()
+	 */
+	bool Visit(const Directory &base, const SongFilter &filter,
+		   const VisitSong &visit_song) const;
+
+private:
+	void AddDirectory(const Directory &directory) noexcept;
+	void AddSong(const Song &song) noexcept;
+	void AddPosting(TagType type, const char *value) noexcept;
+};
+
+#endif
@@ -22,6 +22,8 @@
 #include "config/Option.hxx"
 
 UpdateConfig::UpdateConfig(const ConfigData &config)
+	:threads(config.GetUnsigned(ConfigOption::UPDATE_THREADS,
+				    DEFAULT_THREADS))
 {
 #ifndef _WIN32
 	follow_inside_symlinks =
@@ -31,7 +33,5 @@ UpdateConfig::UpdateConfig(const ConfigData &config)
 	follow_outside_symlinks =
 		config.GetBool(ConfigOption::FOLLOW_OUTSIDE_SYMLINKS,
 			       DEFAULT_FOLLOW_OUTSIDE_SYMLINKS);
-#else
-	(void)config;
 #endif
 }
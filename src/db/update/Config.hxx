@@ -31,6 +31,14 @@ struct UpdateConfig {
 	bool follow_outside_symlinks = DEFAULT_FOLLOW_OUTSIDE_SYMLINKS;
 #endif
 
+	static constexpr unsigned DEFAULT_THREADS = 4;
+
+	/**
+	 * The number of threads which scan song files during the
+	 * update; 0 means they are scanned by the update thread.
+	 */
+	unsigned threads = DEFAULT_THREADS;
+
 	explicit UpdateConfig(const ConfigData &config);
 };
 
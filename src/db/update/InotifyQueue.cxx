@@ -83,19 +83,24 @@ InotifyQueue::Enqueue(const char *uri_utf8) noexcept
 {
 	delay_event.Schedule(INOTIFY_UPDATE_DELAY);
 
+	++n_events;
+
 	for (auto i = queue.begin(), end = queue.end(); i != end;) {
 		const char *current_uri = i->c_str();
 
-		if (path_in(uri_utf8, current_uri))
+		if (path_in(uri_utf8, current_uri)) {
 			/* already enqueued */
+			++n_coalesced;
 			return;
+		}
 
-		if (path_in(current_uri, uri_utf8))
+		if (path_in(current_uri, uri_utf8)) {
 			/* existing path is a sub-path of the new
 			   path; we can dequeue the existing path and
 			   update the new path instead */
 			i = queue.erase(i);
-		else
+			++n_coalesced;
+		} else
 			++i;
 	}
 
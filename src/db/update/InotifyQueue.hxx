@@ -22,6 +22,7 @@
 
 #include "event/TimerEvent.hxx"
 
+#include <cstddef>
 #include <list>
 #include <string>
 
@@ -34,11 +35,25 @@ class InotifyQueue final {
 
 	TimerEvent delay_event;
 
+	/**
+	 * Statistics: the number of Enqueue() calls and how many of
+	 * them were merged into an existing queue item.
+	 */
+	std::size_t n_events = 0, n_coalesced = 0;
+
 public:
 	InotifyQueue(EventLoop &_loop, UpdateService &_update) noexcept
 		:update(_update),
 		 delay_event(_loop, BIND_THIS_METHOD(OnDelay)) {}
 
+	std::size_t GetEventCount() const noexcept {
+		return n_events;
+	}
+
+	std::size_t GetCoalescedCount() const noexcept {
+		return n_coalesced;
+	}
+
 	void Enqueue(const char *uri_utf8) noexcept;
 
 private:
@@ -29,15 +29,21 @@
 #include "fs/DirectoryReader.hxx"
 #include "fs/FileInfo.hxx"
 #include "fs/Traits.hxx"
+#include "event/DeferEvent.hxx"
+#include "system/Error.hxx"
 #include "thread/Mutex.hxx"
 #include "util/Compiler.h"
 #include "Log.hxx"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <deque>
 #include <forward_list>
-#include <map>
 #include <string>
+#include <unordered_map>
 
 #include <sys/inotify.h>
 #include <dirent.h>
@@ -60,6 +66,12 @@ struct WatchDirectory {
 
 	std::forward_list<WatchDirectory> children;
 
+	/**
+	 * Is this directory in #inotify_scan_queue, i.e. have its
+	 * sub directories not been watched yet?
+	 */
+	bool scan_pending = false;
+
 	template<typename N>
 	WatchDirectory(N &&_name,
 		       int _descriptor)
@@ -102,7 +114,35 @@ static InotifyQueue *inotify_queue;
 
 static unsigned inotify_max_depth;
 static WatchDirectory *inotify_root;
-static std::map<int, WatchDirectory *> inotify_directories;
+static std::unordered_map<int, WatchDirectory *> inotify_directories;
+
+/**
+ * Directories whose sub directories shall be watched.  They are
+ * processed by #inotify_scan_event in small portions whenever the
+ * #EventLoop is idle, so installing the watches for a huge music
+ * directory does not block MPD.
+ */
+static std::deque<WatchDirectory *> inotify_scan_queue;
+static DeferEvent *inotify_scan_event;
+
+/**
+ * The number of directories processed by one #inotify_scan_event
+ * invocation.
+ */
+static constexpr unsigned INOTIFY_SCAN_BATCH = 32;
+
+/**
+ * When was the initial scan started?  Used to log how long it took.
+ */
+static std::chrono::steady_clock::time_point inotify_scan_start;
+
+static bool inotify_initial_scan;
+
+/**
+ * Has inotify_add_watch() failed with ENOSPC?  No more watches will
+ * be added until one has been removed.
+ */
+static bool inotify_watches_exhausted;
 
 static void
 tree_add_watch_directory(WatchDirectory *directory)
@@ -134,10 +174,21 @@ disable_watch_directory(WatchDirectory &directory)
 {
 	tree_remove_watch_directory(&directory);
 
+	if (directory.scan_pending) {
+		auto i = std::find(inotify_scan_queue.begin(),
+				   inotify_scan_queue.end(), &directory);
+		assert(i != inotify_scan_queue.end());
+		inotify_scan_queue.erase(i);
+	}
+
 	for (WatchDirectory &child : directory.children)
 		disable_watch_directory(child);
 
 	inotify_source->Remove(directory.descriptor);
+
+	/* a watch has been freed; the directories which were
+	   skipped get watched when their parent reports a change */
+	inotify_watches_exhausted = false;
 }
 
 static void
@@ -183,9 +234,24 @@ SkipFilename(Path name) noexcept
 }
 
 static void
-recursive_watch_subdirectories(WatchDirectory &parent,
-			       const Path path_fs,
-			       unsigned depth)
+schedule_scan(WatchDirectory &directory) noexcept
+{
+	if (directory.scan_pending)
+		return;
+
+	directory.scan_pending = true;
+	inotify_scan_queue.push_back(&directory);
+	inotify_scan_event->ScheduleIdle();
+}
+
+/**
+ * Watch all sub directories of the given directory.  Their own sub
+ * directories will be watched later by inotify_scan_step().
+ */
+static void
+watch_subdirectories(WatchDirectory &parent,
+		     const Path path_fs,
+		     unsigned depth)
 try {
 	assert(depth <= inotify_max_depth);
 	assert(!path_fs.IsNull());
@@ -196,7 +262,7 @@ try {
 		return;
 
 	DirectoryReader dir(path_fs);
-	while (dir.ReadEntry()) {
+	while (!inotify_watches_exhausted && dir.ReadEntry()) {
 		int ret;
 
 		const Path name_fs = dir.GetEntry();
@@ -222,9 +288,19 @@ try {
 		try {
 			ret = inotify_source->Add(child_path_fs.c_str(),
 						  IN_MASK);
-		} catch (...) {
-			FormatError(std::current_exception(),
-				    "Failed to register %s",
+		} catch (const std::system_error &e) {
+			if (IsErrno(e, ENOSPC)) {
+				/* don't log an error for each of the
+				   remaining directories */
+				inotify_watches_exhausted = true;
+				FormatError(inotify_domain,
+					    "Too many directories (%zu); "
+					    "increase fs.inotify.max_user_watches",
+					    inotify_directories.size());
+				break;
+			}
+
+			FormatError(e, "Failed to register %s",
 				    child_path_fs.c_str());
 			continue;
 		}
@@ -242,7 +318,8 @@ try {
 
 		tree_add_watch_directory(child);
 
-		recursive_watch_subdirectories(*child, child_path_fs, depth);
+		if (depth < inotify_max_depth)
+			schedule_scan(*child);
 	}
 } catch (...) {
 	LogError(std::current_exception());
@@ -260,6 +337,48 @@ WatchDirectory::GetDepth() const noexcept
 	return depth;
 }
 
+gcc_pure
+static AllocatedPath
+GetPathFS(const WatchDirectory &directory) noexcept
+{
+	const auto uri_fs = directory.GetUriFS();
+	const auto &root = inotify_root->name;
+	return uri_fs.IsNull()
+		? root
+		: (root / uri_fs);
+}
+
+static void
+inotify_scan_step() noexcept
+{
+	for (unsigned n = 0; n < INOTIFY_SCAN_BATCH &&
+		     !inotify_scan_queue.empty(); ++n) {
+		WatchDirectory &directory = *inotify_scan_queue.front();
+		inotify_scan_queue.pop_front();
+
+		assert(directory.scan_pending);
+		directory.scan_pending = false;
+
+		watch_subdirectories(directory, GetPathFS(directory),
+				     directory.GetDepth());
+	}
+
+	if (!inotify_scan_queue.empty()) {
+		inotify_scan_event->ScheduleIdle();
+		return;
+	}
+
+	if (inotify_initial_scan) {
+		inotify_initial_scan = false;
+
+		const std::chrono::duration<double> duration =
+			std::chrono::steady_clock::now() - inotify_scan_start;
+		FormatDebug(inotify_domain,
+			    "watching %zu directories (%.1f s)",
+			    inotify_directories.size(), duration.count());
+	}
+}
+
 static void
 mpd_inotify_callback(int wd, unsigned mask,
 		     [[maybe_unused]] const char *name, [[maybe_unused]] void *ctx)
@@ -287,8 +406,8 @@ mpd_inotify_callback(int wd, unsigned mask,
 			? root
 			: (root / uri_fs);
 
-		recursive_watch_subdirectories(*directory, path_fs,
-					       directory->GetDepth());
+		watch_subdirectories(*directory, path_fs,
+				     directory->GetDepth());
 	}
 
 	if ((mask & (IN_CLOSE_WRITE|IN_MOVE|IN_DELETE)) != 0 ||
@@ -347,21 +466,46 @@ mpd_inotify_init(EventLoop &loop, Storage &storage, UpdateService &update,
 
 	tree_add_watch_directory(inotify_root);
 
-	recursive_watch_subdirectories(*inotify_root, path, 0);
-
 	inotify_queue = new InotifyQueue(loop, update);
 
+	/* the sub directories are watched in the background */
+	inotify_scan_event = new DeferEvent(loop,
+					    BIND_FUNCTION(inotify_scan_step));
+	inotify_scan_start = std::chrono::steady_clock::now();
+	inotify_initial_scan = true;
+	inotify_watches_exhausted = false;
+	if (inotify_max_depth > 0)
+		schedule_scan(*inotify_root);
+
 	LogDebug(inotify_domain, "watching music directory");
 }
 
+InotifyStats
+mpd_inotify_stats() noexcept
+{
+	InotifyStats stats{};
+
+	if (inotify_source == nullptr)
+		return stats;
+
+	stats.enabled = true;
+	stats.watches = inotify_directories.size();
+	stats.pending = inotify_scan_queue.size();
+	stats.events = inotify_queue->GetEventCount();
+	stats.coalesced = inotify_queue->GetCoalescedCount();
+	return stats;
+}
+
 void
 mpd_inotify_finish() noexcept
 {
 	if (inotify_source == nullptr)
 		return;
 
+	delete inotify_scan_event;
 	delete inotify_queue;
 	delete inotify_source;
 	delete inotify_root;
 	inotify_directories.clear();
+	inotify_scan_queue.clear();
 }
@@ -20,6 +20,10 @@
 #ifndef MPD_INOTIFY_UPDATE_HXX
 #define MPD_INOTIFY_UPDATE_HXX
 
+#include "util/Compiler.h"
+
+#include <cstddef>
+
 class EventLoop;
 class Storage;
 class UpdateService;
@@ -31,4 +35,38 @@ mpd_inotify_init(EventLoop &loop, Storage &storage, UpdateService &update,
 void
 mpd_inotify_finish() noexcept;
 
+struct InotifyStats {
+	/**
+	 * Is the inotify watcher running?  If not, all other
+	 * attributes are zero.
+	 */
+	bool enabled;
+
+	/**
+	 * The number of directories being watched.
+	 */
+	std::size_t watches;
+
+	/**
+	 * The number of directories whose sub directories have not
+	 * yet been watched.
+	 */
+	std::size_t pending;
+
+	/**
+	 * The number of modifications reported by inotify.
+	 */
+	std::size_t events;
+
+	/**
+	 * The number of modifications which were merged into an
+	 * update which was already queued.
+	 */
+	std::size_t coalesced;
+};
+
+gcc_pure
+InotifyStats
+mpd_inotify_stats() noexcept;
+
 #endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ScanPool.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "thread/Name.hxx"
+#include "thread/Util.hxx"
+
+#include <cassert>
+
+UpdateScanPool::UpdateScanPool(Storage &_storage, unsigned n_threads)
+	:storage(_storage), max_pending(4 * n_threads)
+{
+	assert(n_threads > 0);
+
+	try {
+		for (unsigned i = 0; i < n_threads; ++i)
+			threads.emplace_back(BIND_THIS_METHOD(RunThread)).Start();
+	} catch (...) {
+		Stop();
+		throw;
+	}
+}
+
+UpdateScanPool::~UpdateScanPool() noexcept
+{
+	Stop();
+}
+
+void
+UpdateScanPool::Stop() noexcept
+{
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &i : threads)
+		if (i.IsDefined())
+			i.Join();
+
+	threads.clear();
+}
+
+void
+UpdateScanPool::Push(Directory &directory, Song *old_song,
+		     std::string_view name) noexcept
+{
+	++n_pending;
+
+	const std::lock_guard<Mutex> lock(mutex);
+	queue.emplace_back(directory, old_song, name);
+	wake_cond.notify_one();
+}
+
+std::list<UpdateScanJob>
+UpdateScanPool::Take(bool wait) noexcept
+{
+	std::list<UpdateScanJob> result;
+
+	{
+		std::unique_lock<Mutex> lock(mutex);
+		if (wait && n_pending > 0)
+			done_cond.wait(lock, [this]{ return !done.empty(); });
+
+		result.swap(done);
+	}
+
+	assert(result.size() <= n_pending);
+	n_pending -= result.size();
+
+	return result;
+}
+
+inline void
+UpdateScanPool::Run(UpdateScanJob &job) noexcept
+try {
+	job.new_song = Song::LoadFile(storage, job.name.c_str(),
+				      job.directory);
+} catch (...) {
+	job.error = std::current_exception();
+}
+
+void
+UpdateScanPool::RunThread() noexcept
+{
+	SetThreadName("update_scan");
+	SetThreadIdlePriority();
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		wake_cond.wait(lock, [this]{
+			return quit || !queue.empty();
+		});
+
+		if (quit)
+			break;
+
+		const auto i = queue.begin();
+		running.splice(running.end(), queue, i);
+
+		lock.unlock();
+		Run(*i);
+		lock.lock();
+
+		done.splice(done.end(), running, i);
+		done_cond.notify_one();
+	}
+}
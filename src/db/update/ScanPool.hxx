@@ -0,0 +1,165 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_UPDATE_SCAN_POOL_HXX
+#define MPD_UPDATE_SCAN_POOL_HXX
+
+#include "db/plugins/simple/Ptr.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <cstddef>
+#include <exception>
+#include <list>
+#include <string>
+#include <string_view>
+
+struct Directory;
+struct Song;
+class Storage;
+
+/**
+ * A job for the #UpdateScanPool: load a new or modified song file.
+ */
+struct UpdateScanJob {
+	Directory &directory;
+
+	/**
+	 * The existing song which shall be updated; nullptr if this
+	 * is a new file.
+	 */
+	Song *const old_song;
+
+	const std::string name;
+
+	/**
+	 * The result; nullptr if the file was not recognized.
+	 */
+	SongPtr new_song;
+
+	/**
+	 * The error which occurred while loading the file.
+	 */
+	std::exception_ptr error;
+
+	UpdateScanJob(Directory &_directory, Song *_old_song,
+		      std::string_view _name) noexcept
+		:directory(_directory), old_song(_old_song), name(_name) {}
+};
+
+/**
+ * Worker threads which load song files (i.e. scan their tags) on
+ * behalf of the #UpdateWalk.  The update thread keeps enumerating
+ * directories while the workers wait for the storage, so the
+ * latency of each file (e.g. on a NFS or SMB share) overlaps with
+ * the others.  The workers do not modify the #Directory tree; the
+ * update thread obtains the finished jobs with Take() and commits
+ * them.
+ *
+ * All methods except for the constructor and the destructor must be
+ * called only by the update thread.
+ */
+class UpdateScanPool {
+	Storage &storage;
+
+	const std::size_t max_pending;
+
+	Mutex mutex;
+
+	/**
+	 * Wakes up the worker threads when a new job has been queued
+	 * or when they shall quit.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signals Take() that a job has finished.
+	 */
+	Cond done_cond;
+
+	std::list<Thread> threads;
+
+	/**
+	 * Jobs which are waiting for a worker thread.
+	 */
+	std::list<UpdateScanJob> queue;
+
+	/**
+	 * Jobs which are being executed by a worker thread.
+	 */
+	std::list<UpdateScanJob> running;
+
+	/**
+	 * Jobs which have finished, but have not yet been returned by
+	 * Take().
+	 */
+	std::list<UpdateScanJob> done;
+
+	/**
+	 * The number of jobs which have been submitted but not yet
+	 * returned by Take().  Only accessed by the update thread.
+	 */
+	std::size_t n_pending = 0;
+
+	bool quit = false;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	UpdateScanPool(Storage &_storage, unsigned n_threads);
+	~UpdateScanPool() noexcept;
+
+	UpdateScanPool(const UpdateScanPool &) = delete;
+	UpdateScanPool &operator=(const UpdateScanPool &) = delete;
+
+	bool IsEmpty() const noexcept {
+		return n_pending == 0;
+	}
+
+	/**
+	 * Are there so many pending jobs that the caller should
+	 * Take() some before submitting more?  This limits the
+	 * memory used by finished jobs.
+	 */
+	bool IsFull() const noexcept {
+		return n_pending >= max_pending;
+	}
+
+	void Push(Directory &directory, Song *old_song,
+		  std::string_view name) noexcept;
+
+	/**
+	 * Return all finished jobs.
+	 *
+	 * @param wait if there are no finished jobs, wait for one
+	 * (unless there are no pending jobs at all)
+	 */
+	std::list<UpdateScanJob> Take(bool wait) noexcept;
+
+private:
+	void Stop() noexcept;
+
+	void Run(UpdateScanJob &job) noexcept;
+
+	void RunThread() noexcept;
+};
+
+#endif
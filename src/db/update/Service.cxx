@@ -58,6 +58,14 @@ UpdateService::~UpdateService() noexcept
 		update_thread.Join();
 }
 
+unsigned
+UpdateService::GetLoadedCount() const noexcept
+{
+	assert(GetEventLoop().IsInside());
+
+	return walk != nullptr ? walk->GetLoadedCount() : 0;
+}
+
 void
 UpdateService::CancelAllAsync() noexcept
 {
@@ -77,7 +85,7 @@ UpdateService::CancelMount(const char *uri) noexcept
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		lr = db.GetRoot().LookupDirectory(uri);
 	}
 
@@ -152,6 +160,7 @@ UpdateService::StartThread(UpdateQueueItem &&i)
 	next = std::move(i);
 	walk = std::make_unique<UpdateWalk>(config, GetEventLoop(), listener,
 					    *next.storage);
+	start_time = std::chrono::steady_clock::now();
 
 	update_thread.Start();
 
@@ -180,7 +189,7 @@ UpdateService::Enqueue(std::string_view path, bool discard)
 
 	Directory::LookupResult lr;
 	{
-		const ScopeDatabaseLock protect;
+		const ScopeDatabaseSharedLock protect;
 		lr = db.GetRoot().LookupDirectory(path);
 	}
 
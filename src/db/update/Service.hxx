@@ -26,6 +26,7 @@
 #include "thread/Thread.hxx"
 #include "util/Compiler.h"
 
+#include <chrono>
 #include <memory>
 #include <string_view>
 
@@ -61,6 +62,11 @@ class UpdateService final {
 
 	std::unique_ptr<UpdateWalk> walk;
 
+	/**
+	 * When was the current update job started?
+	 */
+	std::chrono::steady_clock::time_point start_time;
+
 public:
 	UpdateService(const ConfigData &_config,
 		      EventLoop &_loop, SimpleDatabase &_db,
@@ -81,6 +87,19 @@ public:
 		return next.id;
 	}
 
+	/**
+	 * Returns the number of song files which have been loaded by
+	 * the current update job.
+	 */
+	unsigned GetLoadedCount() const noexcept;
+
+	/**
+	 * Returns how long the current update job has been running.
+	 */
+	std::chrono::steady_clock::duration GetElapsed() const noexcept {
+		return std::chrono::steady_clock::now() - start_time;
+	}
+
 	/**
 	 * Add this path to the database update queue.
 	 *
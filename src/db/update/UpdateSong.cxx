@@ -20,6 +20,7 @@
 #include "Walk.hxx"
 #include "UpdateIO.hxx"
 #include "UpdateDomain.hxx"
+#include "ScanPool.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/plugins/simple/Directory.hxx"
 #include "db/plugins/simple/Song.hxx"
@@ -29,6 +30,96 @@
 
 #include <unistd.h>
 
+void
+UpdateWalk::CommitScan(UpdateScanJob &job) noexcept
+{
+	Directory &directory = job.directory;
+	const char *name = job.name.c_str();
+
+	if (job.error) {
+		FormatError(job.error, "error reading file %s/%s",
+			    directory.GetPath(), name);
+		return;
+	}
+
+	++n_loaded;
+
+	if (!job.new_song) {
+		if (job.old_song == nullptr) {
+			FormatDebug(update_domain,
+				    "ignoring unrecognized file %s/%s",
+				    directory.GetPath(), name);
+			return;
+		}
+
+		FormatDebug(update_domain,
+			    "deleting unrecognized file %s/%s",
+			    directory.GetPath(), name);
+		editor.DeleteSong(directory, job.old_song);
+	} else if (job.old_song == nullptr) {
+		directory.AddSong(std::move(job.new_song));
+		FormatNotice(update_domain, "added %s/%s",
+			     directory.GetPath(), name);
+	} else {
+		/* copy the new metadata into the existing object,
+		   while readers are locked out */
+		Song &song = *job.old_song;
+		song.tag = std::move(job.new_song->tag);
+		song.mtime = job.new_song->mtime;
+		song.audio_format = job.new_song->audio_format;
+		++song_generation;
+	}
+
+	modified = true;
+}
+
+void
+UpdateWalk::CommitScans(bool wait) noexcept
+{
+	/* the jobs are freed after the lock has been released */
+	auto jobs = scan_pool->Take(wait);
+	if (jobs.empty())
+		return;
+
+	const ScopeDatabaseLock protect;
+	for (auto &job : jobs)
+		CommitScan(job);
+}
+
+void
+UpdateWalk::FlushScans() noexcept
+{
+	if (scan_pool == nullptr)
+		return;
+
+	while (!scan_pool->IsEmpty())
+		CommitScans(true);
+}
+
+inline void
+UpdateWalk::LoadSongFile(Directory &directory, Song *song,
+			 const char *name) noexcept
+{
+	if (scan_pool != nullptr) {
+		if (scan_pool->IsFull())
+			CommitScans(true);
+
+		scan_pool->Push(directory, song, name);
+		return;
+	}
+
+	UpdateScanJob job(directory, song, name);
+
+	try {
+		job.new_song = Song::LoadFile(storage, name, directory);
+	} catch (...) {
+		job.error = std::current_exception();
+	}
+
+	const ScopeDatabaseLock protect;
+	CommitScan(job);
+}
+
 inline void
 UpdateWalk::UpdateSongFile2(Directory &directory,
 			    const char *name, std::string_view suffix,
@@ -61,34 +152,11 @@ try {
 	if (song == nullptr) {
 		FormatDebug(update_domain, "reading %s/%s",
 			    directory.GetPath(), name);
-
-		auto new_song = Song::LoadFile(storage, name, directory);
-		if (!new_song) {
-			FormatDebug(update_domain,
-				    "ignoring unrecognized file %s/%s",
-				    directory.GetPath(), name);
-			return;
-		}
-
-		{
-			const ScopeDatabaseLock protect;
-			directory.AddSong(std::move(new_song));
-		}
-
-		modified = true;
-		FormatNotice(update_domain, "added %s/%s",
-			     directory.GetPath(), name);
+		LoadSongFile(directory, nullptr, name);
 	} else if (info.mtime != song->mtime || walk_discard) {
 		FormatNotice(update_domain, "updating %s/%s",
 			     directory.GetPath(), name);
-		if (!song->UpdateFile(storage)) {
-			FormatDebug(update_domain,
-				    "deleting unrecognized file %s/%s",
-				    directory.GetPath(), name);
-			editor.LockDeleteSong(directory, song);
-		}
-
-		modified = true;
+		LoadSongFile(directory, song, name);
 	}
 } catch (...) {
 	FormatError(std::current_exception(),
@@ -21,6 +21,7 @@
 #include "UpdateIO.hxx"
 #include "Editor.hxx"
 #include "UpdateDomain.hxx"
+#include "ScanPool.hxx"
 #include "db/DatabaseLock.hxx"
 #include "db/Uri.hxx"
 #include "db/plugins/simple/Directory.hxx"
@@ -55,6 +56,8 @@ UpdateWalk::UpdateWalk(const UpdateConfig &_config,
 {
 }
 
+UpdateWalk::~UpdateWalk() noexcept = default;
+
 static void
 directory_set_stat(Directory &dir, const StorageFileInfo &info)
 {
@@ -220,8 +223,10 @@ try {
 
 		assert(&directory == subdir->parent);
 
-		if (!UpdateDirectory(*subdir, exclude_list, info))
+		if (!UpdateDirectory(*subdir, exclude_list, info)) {
+			FlushScans();
 			editor.LockDeleteDirectory(subdir);
+		}
 	} else {
 		FormatDebug(update_domain,
 			    "%s is not a directory, archive or music", name);
@@ -480,6 +485,16 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 	walk_discard = discard;
 	modified = false;
 
+	if (config.threads > 0) {
+		try {
+			scan_pool = std::make_unique<UpdateScanPool>(storage,
+								     config.threads);
+		} catch (...) {
+			LogError(std::current_exception(),
+				 "Failed to start update threads");
+		}
+	}
+
 	if (path != nullptr && !isRootDirectory(path)) {
 		UpdateUri(root, path);
 	} else {
@@ -498,5 +513,10 @@ UpdateWalk::Walk(Directory &root, const char *path, bool discard) noexcept
 		UpdateDirectory(root, exclude_list, info);
 	}
 
+	if (!cancel)
+		FlushScans();
+
+	scan_pool.reset();
+
 	return modified;
 }
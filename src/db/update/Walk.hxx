@@ -26,6 +26,8 @@
 #include "config.h"
 
 #include <atomic>
+#include <list>
+#include <memory>
 #include <string_view>
 
 struct StorageFileInfo;
@@ -35,6 +37,8 @@ struct PlaylistPlugin;
 class ArchiveFile;
 class Storage;
 class ExcludeList;
+class UpdateScanPool;
+struct UpdateScanJob;
 
 class UpdateWalk final {
 #ifdef ENABLE_ARCHIVE
@@ -53,14 +57,35 @@ class UpdateWalk final {
 	 */
 	std::atomic_bool cancel;
 
+	/**
+	 * The number of song files which have been loaded so far.
+	 * It is read by the main thread for the "status" command.
+	 */
+	std::atomic_uint n_loaded{0};
+
 	Storage &storage;
 
 	DatabaseEditor editor;
 
+	/**
+	 * Loads song files in worker threads.  nullptr if disabled
+	 * (see UpdateConfig::threads).
+	 */
+	std::unique_ptr<UpdateScanPool> scan_pool;
+
 public:
 	UpdateWalk(const UpdateConfig &_config,
 		   EventLoop &_loop, DatabaseListener &_listener,
 		   Storage &_storage) noexcept;
+	~UpdateWalk() noexcept;
+
+	/**
+	 * Returns the number of song files which have been loaded
+	 * (i.e. whose tags have been scanned) so far.
+	 */
+	unsigned GetLoadedCount() const noexcept {
+		return n_loaded.load(std::memory_order_relaxed);
+	}
 
 	/**
 	 * Cancel the current update and quit the Walk() method as
@@ -85,6 +110,30 @@ private:
 
 	void PurgeDeletedFromDirectory(Directory &directory) noexcept;
 
+	/**
+	 * Commit the finished jobs of the #scan_pool to the
+	 * #Directory tree.
+	 *
+	 * @param wait wait for at least one job to finish
+	 */
+	void CommitScans(bool wait) noexcept;
+
+	/**
+	 * Wait for all jobs of the #scan_pool and commit them.  This
+	 * must be called before deleting a #Directory, because the
+	 * jobs refer to it.
+	 */
+	void FlushScans() noexcept;
+
+	void CommitScan(UpdateScanJob &job) noexcept;
+
+	/**
+	 * Load a new or modified song file, either right now or in
+	 * the #scan_pool.
+	 */
+	void LoadSongFile(Directory &directory, Song *song,
+			  const char *name) noexcept;
+
 	void UpdateSongFile2(Directory &directory,
 			     const char *name, std::string_view suffix,
 			     const StorageFileInfo &info) noexcept;
@@ -20,6 +20,7 @@
 #include "Configured.hxx"
 #include "EncoderList.hxx"
 #include "EncoderPlugin.hxx"
+#include "SharedEncoder.hxx"
 #include "config/Block.hxx"
 #include "util/StringAPI.hxx"
 #include "util/RuntimeError.hxx"
@@ -51,6 +52,10 @@ GetConfiguredEncoderPlugin(const ConfigBlock &block, bool shout_legacy)
 PreparedEncoder *
 CreateConfiguredEncoder(const ConfigBlock &block, bool shout_legacy)
 {
-	return encoder_init(GetConfiguredEncoderPlugin(block, shout_legacy),
-			    block);
+	const auto &plugin = GetConfiguredEncoderPlugin(block, shout_legacy);
+
+	if (block.GetBlockValue("shared_encoder", false))
+		return CreateSharedEncoder(plugin, block);
+
+	return encoder_init(plugin, block);
 }
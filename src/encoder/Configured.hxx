@@ -26,7 +26,8 @@ class PreparedEncoder;
 /**
  * Create a #PreparedEncoder instance from the settings in the
  * #ConfigBlock.  Its "encoder" setting is used to choose the encoder
- * plugin.
+ * plugin.  If "shared_encoder" is enabled, the encoder is shared with
+ * other outputs using the same settings (see CreateSharedEncoder()).
  *
  * Throws an exception on error.
  *
@@ -0,0 +1,942 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SharedEncoder.hxx"
+#include "EncoderInterface.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Tag.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Name.hxx"
+#include "thread/Thread.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <forward_list>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A subscriber which lags behind the most advanced one by more than
+ * this (in PCM time) blocks the most advanced one.
+ */
+static constexpr std::chrono::seconds MAX_LAG(2);
+
+/**
+ * How long does the most advanced subscriber wait for lagging ones?
+ * After that, they are detached, i.e. they lose their unread data
+ * and resume at the current position on their next Write() call;
+ * while others are still submitting, they only read the encoder
+ * output from then on.  This happens to "httpd" outputs without
+ * clients, which stop writing.
+ */
+static constexpr std::chrono::milliseconds MAX_LAG_WAIT(500);
+
+/**
+ * Writers block while this many PCM bytes are waiting for the
+ * encoder thread.
+ */
+static constexpr std::size_t MAX_QUEUED_SIZE = 256 * 1024;
+
+/**
+ * The maximum number of tag positions remembered for lagging
+ * subscribers.
+ */
+static constexpr std::size_t MAX_TAG_MARKS = 64;
+
+using Buffer = std::vector<std::byte>;
+
+class SharedEncoder {
+public:
+	/**
+	 * The state of one #SharedEncoderSubscriber.  Positions are
+	 * the number of PCM bytes submitted since the encoder was
+	 * opened; tags are counted.
+	 */
+	struct Subscriber {
+		uint64_t position;
+
+		unsigned tags;
+
+		/**
+		 * The absolute index of the next page to be read.
+		 */
+		uint64_t page_index;
+
+		std::size_t page_offset;
+
+		/**
+		 * The stream header which shall be delivered before
+		 * the next page; nullptr if none.
+		 */
+		std::shared_ptr<const Buffer> header;
+
+		std::size_t header_offset;
+
+		/**
+		 * The absolute index of the page after the last one
+		 * this subscriber may read after End().  Only valid if
+		 * #ending is set.
+		 */
+		uint64_t end_page_index;
+
+		/**
+		 * Was this subscriber detached because it was lagging
+		 * too much?
+		 */
+		bool detached;
+
+		/**
+		 * Has this subscriber been re-attached after it was
+		 * detached, while others were still submitting?  Its
+		 * input is older than theirs, so it must not be
+		 * submitted: it would make the stream jump back and
+		 * forth in time.  Instead, the subscriber only reads
+		 * the encoded data at the live head, until it is the
+		 * only one left.
+		 */
+		bool follower;
+
+		/**
+		 * Has End() been called?  After that, the subscriber
+		 * reads all pages before #end_page_index, regardless
+		 * of its position.
+		 */
+		bool ending;
+	};
+
+	using SubscriberIterator = std::list<Subscriber>::iterator;
+
+private:
+	struct Command {
+		enum class Type {
+			WRITE, PRE_TAG, TAG, FLUSH, END,
+		} type;
+
+		Buffer data;
+
+		std::unique_ptr<Tag> tag;
+
+		/**
+		 * The stream position after this command, copied to
+		 * the resulting #Page.
+		 */
+		uint64_t position;
+		unsigned tags;
+	};
+
+	/**
+	 * Encoded data produced by one #Command.  Subscribers read it
+	 * only after they have submitted the PCM (and tags) it was
+	 * produced from.
+	 */
+	struct Page {
+		uint64_t position;
+		unsigned tags;
+		Buffer data;
+	};
+
+	/**
+	 * Remembers where a tag was applied, for subscribers which
+	 * send the same tag later.
+	 */
+	struct TagMark {
+		uint64_t position;
+		uint64_t page_index;
+	};
+
+	const std::string key;
+
+	const AudioFormat audio_format;
+
+	const std::size_t max_lag;
+
+	const std::unique_ptr<Encoder> encoder;
+
+	const bool implements_tag;
+
+	Thread thread;
+
+	mutable Mutex mutex;
+
+	/**
+	 * Wakes up the encoder thread.
+	 */
+	Cond wake_cond;
+
+	/**
+	 * Signalled by the encoder thread after each command.
+	 */
+	Cond done_cond;
+
+	/**
+	 * Signalled when a subscriber advances or goes away.
+	 */
+	Cond progress_cond;
+
+	/**
+	 * Commands waiting for the encoder thread; the front one is
+	 * removed only after it has finished.
+	 */
+	std::deque<Command> commands;
+
+	/**
+	 * The total number of PCM bytes in #commands.
+	 */
+	std::size_t queued_size = 0;
+
+	std::deque<Page> pages;
+
+	/**
+	 * The absolute index of pages.front().
+	 */
+	uint64_t pages_base = 0;
+
+	std::deque<TagMark> tag_marks;
+
+	/**
+	 * The tag number of tag_marks.front().
+	 */
+	unsigned tag_marks_base = 0;
+
+	/**
+	 * The most recent stream header, i.e. the output after
+	 * opening the encoder or after the last tag.  It is delivered
+	 * to new subscribers.
+	 */
+	std::shared_ptr<const Buffer> header;
+
+	std::list<Subscriber> subscribers;
+
+	uint64_t submitted_position = 0;
+	unsigned submitted_tags = 0;
+
+	bool pre_tag_submitted = false;
+
+	bool ended = false;
+
+	bool quit = false;
+
+	std::exception_ptr error;
+
+public:
+	SharedEncoder(std::string &&_key, std::unique_ptr<Encoder> &&_encoder,
+		      const AudioFormat &_audio_format);
+	~SharedEncoder() noexcept;
+
+	SharedEncoder(const SharedEncoder &) = delete;
+	SharedEncoder &operator=(const SharedEncoder &) = delete;
+
+	const AudioFormat &GetAudioFormat() const noexcept {
+		return audio_format;
+	}
+
+	bool ImplementsTag() const noexcept {
+		return implements_tag;
+	}
+
+	/**
+	 * May a new subscriber with the given key use this instance?
+	 */
+	bool IsCompatible(const std::string &other_key) const noexcept {
+		const std::lock_guard<Mutex> lock(mutex);
+		return key == other_key && !ended && !error;
+	}
+
+	SubscriberIterator Subscribe() noexcept;
+	void Unsubscribe(SubscriberIterator s) noexcept;
+
+	void Write(Subscriber &s, const void *data, std::size_t length);
+	void PreTag(Subscriber &s);
+	void SendTag(Subscriber &s, const Tag &tag);
+	void Flush(Subscriber &s);
+	void End(Subscriber &s);
+	std::size_t Read(Subscriber &s, void *dest, std::size_t length) noexcept;
+
+private:
+	void CheckError() const {
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void Submit(Command::Type type, Buffer &&data={},
+		    std::unique_ptr<Tag> &&tag={}) noexcept;
+
+	void WaitDone(std::unique_lock<Mutex> &lock) noexcept {
+		done_cond.wait(lock, [this]{ return commands.empty(); });
+	}
+
+	void Resync(Subscriber &s, bool with_header) noexcept;
+
+	/**
+	 * Is there a subscriber other than the given one whose input
+	 * gets submitted to the encoder?
+	 */
+	bool HasOtherSubmitters(const Subscriber &s) const noexcept;
+
+	/**
+	 * Resume a detached subscriber at the current position.
+	 */
+	void Reattach(Subscriber &s, bool with_header) noexcept;
+
+	/**
+	 * Let a follower submit its input again if all others have
+	 * gone.
+	 */
+	void UpdateFollower(Subscriber &s) noexcept;
+
+	/**
+	 * Block the calling (most advanced) subscriber while others
+	 * lag too much behind the given position, and detach those
+	 * which don't catch up in time.
+	 */
+	void WaitLaggards(std::unique_lock<Mutex> &lock, const Subscriber &s,
+			  uint64_t position) noexcept;
+
+	/**
+	 * Let a subscriber which sends a tag that was already applied
+	 * skip to that tag.
+	 */
+	void CatchUpTag(Subscriber &s) noexcept;
+
+	void TrimPages() noexcept;
+
+	void ReadAll(Buffer &dest);
+	void Run(Command &command, Buffer &dest);
+	void RunThread() noexcept;
+};
+
+SharedEncoder::SharedEncoder(std::string &&_key,
+			     std::unique_ptr<Encoder> &&_encoder,
+			     const AudioFormat &_audio_format)
+	:key(std::move(_key)), audio_format(_audio_format),
+	 max_lag(audio_format.TimeToSize(MAX_LAG)),
+	 encoder(std::move(_encoder)),
+	 implements_tag(encoder->ImplementsTag()),
+	 thread(BIND_THIS_METHOD(RunThread))
+{
+	/* the first bytes after opening the encoder are the stream
+	   header, which is delivered to every subscriber */
+	Buffer data;
+	ReadAll(data);
+	header = std::make_shared<const Buffer>(std::move(data));
+
+	thread.Start();
+}
+
+SharedEncoder::~SharedEncoder() noexcept
+{
+	assert(subscribers.empty());
+
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+		quit = true;
+		wake_cond.notify_one();
+	}
+
+	thread.Join();
+}
+
+SharedEncoder::SubscriberIterator
+SharedEncoder::Subscribe() noexcept
+{
+	const std::lock_guard<Mutex> lock(mutex);
+	subscribers.emplace_back();
+	Resync(subscribers.back(), true);
+	return std::prev(subscribers.end());
+}
+
+void
+SharedEncoder::Unsubscribe(SubscriberIterator s) noexcept
+{
+	const std::lock_guard<Mutex> lock(mutex);
+	subscribers.erase(s);
+	TrimPages();
+	progress_cond.notify_all();
+}
+
+inline void
+SharedEncoder::Submit(Command::Type type, Buffer &&data,
+		      std::unique_ptr<Tag> &&tag) noexcept
+{
+	queued_size += data.size();
+	commands.push_back({type, std::move(data), std::move(tag),
+			    submitted_position, submitted_tags});
+	wake_cond.notify_one();
+}
+
+void
+SharedEncoder::Resync(Subscriber &s, bool with_header) noexcept
+{
+	s.position = submitted_position;
+	s.tags = submitted_tags;
+	s.page_index = pages_base + pages.size();
+	s.page_offset = 0;
+	s.header = with_header ? header : nullptr;
+	s.header_offset = 0;
+	s.detached = false;
+	s.follower = false;
+	s.ending = false;
+}
+
+bool
+SharedEncoder::HasOtherSubmitters(const Subscriber &s) const noexcept
+{
+	return std::any_of(subscribers.begin(), subscribers.end(),
+			   [&s](const Subscriber &i){
+				   return &i != &s && !i.detached &&
+					   !i.follower;
+			   });
+}
+
+void
+SharedEncoder::Reattach(Subscriber &s, bool with_header) noexcept
+{
+	Resync(s, with_header);
+	s.follower = HasOtherSubmitters(s);
+}
+
+void
+SharedEncoder::UpdateFollower(Subscriber &s) noexcept
+{
+	if (s.follower && !HasOtherSubmitters(s)) {
+		s.follower = false;
+		s.position = submitted_position;
+		s.tags = submitted_tags;
+	}
+}
+
+inline void
+SharedEncoder::WaitLaggards(std::unique_lock<Mutex> &lock,
+			    const Subscriber &s, uint64_t position) noexcept
+{
+	const auto is_lagging = [&s, position, this](const Subscriber &i){
+		return &i != &s && !i.detached && !i.follower &&
+			i.position + max_lag < position;
+	};
+
+	/* followers don't hold up the others; if one doesn't keep
+	   up, detach it again, so it doesn't pin old pages */
+	for (auto &i : subscribers)
+		if (i.follower && i.position + max_lag < position)
+			i.detached = true;
+
+	if (progress_cond.wait_for(lock, MAX_LAG_WAIT, [&]{
+		return std::none_of(subscribers.begin(), subscribers.end(),
+				    is_lagging);
+	}))
+		return;
+
+	for (auto &i : subscribers)
+		if (is_lagging(i))
+			i.detached = true;
+
+	TrimPages();
+}
+
+void
+SharedEncoder::CatchUpTag(Subscriber &s) noexcept
+{
+	assert(s.tags < submitted_tags);
+
+	if (s.tags >= tag_marks_base &&
+	    s.tags - tag_marks_base < tag_marks.size()) {
+		const auto &mark = tag_marks[s.tags - tag_marks_base];
+		if (s.position < mark.position) {
+			/* the subscriber has not submitted the PCM
+			   before the tag (e.g. an "httpd" output
+			   without clients): skip to the tag, so its
+			   next Read() returns the new stream header */
+			s.position = mark.position;
+			if (s.page_index < mark.page_index) {
+				s.page_index = mark.page_index;
+				s.page_offset = 0;
+			}
+
+			s.header = nullptr;
+		}
+	}
+
+	++s.tags;
+}
+
+void
+SharedEncoder::TrimPages() noexcept
+{
+	uint64_t min_index = pages_base + pages.size();
+	for (const auto &i : subscribers)
+		if (!i.detached)
+			min_index = std::min(min_index, i.page_index);
+
+	while (pages_base < min_index) {
+		pages.pop_front();
+		++pages_base;
+	}
+}
+
+void
+SharedEncoder::Write(Subscriber &s, const void *data, std::size_t length)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	if (s.detached) {
+		/* resume at the current position; the stream header
+		   is needed only if a new stream has begun since the
+		   subscriber has been detached */
+		WaitDone(lock);
+		Reattach(s, s.tags != submitted_tags);
+	}
+
+	UpdateFollower(s);
+
+	if (s.follower) {
+		/* discard the input; just advance to read what the
+		   others have submitted meanwhile */
+		s.position = std::min(s.position + length, submitted_position);
+		s.tags = submitted_tags;
+		return;
+	}
+
+	const uint64_t end = s.position + length;
+	if (end > submitted_position)
+		/* this is the most advanced subscriber */
+		WaitLaggards(lock, s, end);
+
+	if (end > submitted_position) {
+		/* submit only the part which no other subscriber
+		   has submitted yet */
+		assert(s.position <= submitted_position);
+		const std::size_t skip = submitted_position - s.position;
+
+		done_cond.wait(lock, [this]{
+			return error || queued_size < MAX_QUEUED_SIZE;
+		});
+		CheckError();
+
+		const auto *p = (const std::byte *)data;
+		submitted_position = end;
+		Submit(Command::Type::WRITE, Buffer(p + skip, p + length));
+	}
+
+	s.position = end;
+	progress_cond.notify_all();
+}
+
+void
+SharedEncoder::PreTag(Subscriber &s)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	if (s.detached) {
+		WaitDone(lock);
+		Reattach(s, false);
+	}
+
+	UpdateFollower(s);
+
+	if (s.follower)
+		/* the others submit the tags */
+		return;
+
+	if (s.tags == submitted_tags && !pre_tag_submitted) {
+		pre_tag_submitted = true;
+		Submit(Command::Type::PRE_TAG);
+	}
+
+	WaitDone(lock);
+	CheckError();
+}
+
+void
+SharedEncoder::SendTag(Subscriber &s, const Tag &tag)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+	WaitDone(lock);
+
+	if (s.detached) {
+		Reattach(s, false);
+
+		if (!tag_marks.empty() &&
+		    tag_marks.back().position == submitted_position)
+			/* there was no PCM since the last tag, which
+			   is probably this one */
+			--s.tags;
+	}
+
+	UpdateFollower(s);
+
+	if (s.follower)
+		/* the others submit the tags */
+		return;
+
+	if (s.tags < submitted_tags) {
+		/* another subscriber has already applied this tag */
+		CatchUpTag(s);
+		return;
+	}
+
+	++submitted_tags;
+	pre_tag_submitted = false;
+	Submit(Command::Type::TAG, {}, std::make_unique<Tag>(tag));
+	++s.tags;
+
+	WaitDone(lock);
+	CheckError();
+}
+
+void
+SharedEncoder::Flush(Subscriber &s)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	/* only the most advanced subscriber really flushes; for the
+	   others, the data up to their position is already
+	   available (or will be after WaitDone()) */
+	if (!s.detached && !s.follower && !ended &&
+	    s.position == submitted_position && s.tags == submitted_tags)
+		Submit(Command::Type::FLUSH);
+
+	WaitDone(lock);
+	CheckError();
+}
+
+void
+SharedEncoder::End(Subscriber &s)
+{
+	std::unique_lock<Mutex> lock(mutex);
+	CheckError();
+
+	if (subscribers.size() == 1 && !ended) {
+		/* this is the last subscriber: really end the
+		   stream */
+		ended = true;
+		s.position = submitted_position;
+		s.tags = submitted_tags;
+		Submit(Command::Type::END);
+	} else if (!ended)
+		/* the other subscribers still need the encoder, so it
+		   cannot be ended; instead, flush it, which emits
+		   whatever it still buffers from this subscriber's
+		   input */
+		Submit(Command::Type::FLUSH);
+
+	WaitDone(lock);
+	CheckError();
+
+	/* let this subscriber read everything which has been encoded
+	   so far; this includes the tail of its own input, but if it
+	   was lagging behind, also some input it has never
+	   submitted */
+	s.ending = true;
+	s.end_page_index = pages_base + pages.size();
+}
+
+std::size_t
+SharedEncoder::Read(Subscriber &s, void *_dest, std::size_t length) noexcept
+{
+	auto *dest = (std::byte *)_dest;
+	std::size_t nbytes = 0;
+
+	const std::lock_guard<Mutex> lock(mutex);
+
+	if (s.header != nullptr) {
+		const Buffer &src = *s.header;
+		const std::size_t n = std::min(src.size() - s.header_offset,
+					       length);
+		std::copy_n(src.data() + s.header_offset, n, dest);
+		nbytes += n;
+		s.header_offset += n;
+		if (s.header_offset == src.size())
+			s.header = nullptr;
+	}
+
+	if (s.detached)
+		return nbytes;
+
+	while (nbytes < length &&
+	       s.page_index < pages_base + pages.size()) {
+		const Page &page = pages[s.page_index - pages_base];
+		if (s.ending
+		    ? s.page_index >= s.end_page_index
+		    : page.position > s.position || page.tags > s.tags)
+			/* the subscriber hasn't submitted the input of
+			   this page yet, or the page was encoded after
+			   its End() call */
+			break;
+
+		const std::size_t n = std::min(page.data.size() - s.page_offset,
+					       length - nbytes);
+		std::copy_n(page.data.data() + s.page_offset, n,
+			    dest + nbytes);
+		nbytes += n;
+		s.page_offset += n;
+
+		if (s.page_offset == page.data.size()) {
+			++s.page_index;
+			s.page_offset = 0;
+		}
+	}
+
+	TrimPages();
+	return nbytes;
+}
+
+void
+SharedEncoder::ReadAll(Buffer &dest)
+{
+	std::byte buffer[32768];
+	std::size_t nbytes;
+	while ((nbytes = encoder->Read(buffer, sizeof(buffer))) > 0)
+		dest.insert(dest.end(), buffer, buffer + nbytes);
+}
+
+inline void
+SharedEncoder::Run(Command &command, Buffer &dest)
+{
+	switch (command.type) {
+	case Command::Type::WRITE:
+		encoder->Write(command.data.data(), command.data.size());
+		break;
+
+	case Command::Type::PRE_TAG:
+		encoder->PreTag();
+		break;
+
+	case Command::Type::TAG:
+		encoder->SendTag(*command.tag);
+
+		/* make the new stream header available now, for
+		   subscribers joining later */
+		encoder->Flush();
+		break;
+
+	case Command::Type::FLUSH:
+		encoder->Flush();
+		break;
+
+	case Command::Type::END:
+		encoder->End();
+		break;
+	}
+
+	ReadAll(dest);
+}
+
+void
+SharedEncoder::RunThread() noexcept
+{
+	SetThreadName("encoder");
+
+	std::unique_lock<Mutex> lock(mutex);
+
+	while (true) {
+		wake_cond.wait(lock, [this]{
+			return quit || !commands.empty();
+		});
+
+		if (quit)
+			break;
+
+		Command &command = commands.front();
+		Buffer data;
+
+		if (!error) {
+			lock.unlock();
+
+			std::exception_ptr e;
+			try {
+				Run(command, data);
+			} catch (...) {
+				e = std::current_exception();
+			}
+
+			lock.lock();
+
+			if (e)
+				error = std::move(e);
+		}
+
+		if (command.type == Command::Type::TAG) {
+			tag_marks.push_back({command.position,
+					     pages_base + pages.size()});
+			if (tag_marks.size() > MAX_TAG_MARKS) {
+				tag_marks.pop_front();
+				++tag_marks_base;
+			}
+
+			if (!data.empty())
+				header = std::make_shared<const Buffer>(data);
+		}
+
+		if (!data.empty())
+			pages.push_back({command.position, command.tags,
+					 std::move(data)});
+
+		queued_size -= command.data.size();
+		commands.pop_front();
+		done_cond.notify_all();
+	}
+}
+
+/**
+ * The #Encoder implementation returned by
+ * #SharedPreparedEncoder::Open().
+ */
+class SharedEncoderSubscriber final : public Encoder {
+	const std::shared_ptr<SharedEncoder> shared;
+
+	const SharedEncoder::SubscriberIterator subscriber;
+
+public:
+	explicit SharedEncoderSubscriber(std::shared_ptr<SharedEncoder> &&_shared) noexcept
+		:Encoder(_shared->ImplementsTag()),
+		 shared(std::move(_shared)),
+		 subscriber(shared->Subscribe()) {}
+
+	~SharedEncoderSubscriber() noexcept override {
+		shared->Unsubscribe(subscriber);
+	}
+
+	/* virtual methods from class Encoder */
+	void End() override {
+		shared->End(*subscriber);
+	}
+
+	void Flush() override {
+		shared->Flush(*subscriber);
+	}
+
+	void PreTag() override {
+		shared->PreTag(*subscriber);
+	}
+
+	void SendTag(const Tag &tag) override {
+		shared->SendTag(*subscriber, tag);
+	}
+
+	void Write(const void *data, size_t length) override {
+		shared->Write(*subscriber, data, length);
+	}
+
+	size_t Read(void *dest, size_t length) override {
+		return shared->Read(*subscriber, dest, length);
+	}
+};
+
+/**
+ * All #SharedEncoder instances; protected by #shared_encoders_mutex.
+ */
+static Mutex shared_encoders_mutex;
+static std::forward_list<std::weak_ptr<SharedEncoder>> shared_encoders;
+
+class SharedPreparedEncoder final : public PreparedEncoder {
+	/**
+	 * Identifies the encoder plugin and its settings.
+	 */
+	const std::string key;
+
+	const std::unique_ptr<PreparedEncoder> prepared;
+
+public:
+	SharedPreparedEncoder(std::string &&_key,
+			      std::unique_ptr<PreparedEncoder> &&_prepared) noexcept
+		:key(std::move(_key)), prepared(std::move(_prepared)) {}
+
+	/* virtual methods from class PreparedEncoder */
+	Encoder *Open(AudioFormat &audio_format) override;
+
+	const char *GetMimeType() const noexcept override {
+		return prepared->GetMimeType();
+	}
+};
+
+Encoder *
+SharedPreparedEncoder::Open(AudioFormat &audio_format)
+{
+	std::string full_key = key;
+	full_key += '\n';
+	full_key += ToString(audio_format).c_str();
+
+	const std::lock_guard<Mutex> lock(shared_encoders_mutex);
+
+	shared_encoders.remove_if([](const auto &i){
+		return i.expired();
+	});
+
+	for (const auto &i : shared_encoders) {
+		auto shared = i.lock();
+		if (shared && shared->IsCompatible(full_key)) {
+			audio_format = shared->GetAudioFormat();
+			return new SharedEncoderSubscriber(std::move(shared));
+		}
+	}
+
+	std::unique_ptr<Encoder> encoder(prepared->Open(audio_format));
+	auto shared = std::make_shared<SharedEncoder>(std::move(full_key),
+						      std::move(encoder),
+						      audio_format);
+	shared_encoders.emplace_front(shared);
+	return new SharedEncoderSubscriber(std::move(shared));
+}
+
+PreparedEncoder *
+CreateSharedEncoder(const EncoderPlugin &plugin, const ConfigBlock &block)
+{
+	/* initialize the plugin with a copy of the block to find out
+	   which settings it uses; only those decide which outputs
+	   may share an encoder */
+	ConfigBlock copy(block.line);
+	for (const auto &i : block.block_params)
+		copy.AddBlockParam(i.name, i.value, i.line);
+
+	std::unique_ptr<PreparedEncoder> prepared(encoder_init(plugin, copy));
+
+	std::vector<std::string> settings;
+	for (const auto &i : copy.block_params) {
+		if (!i.used)
+			continue;
+
+		settings.emplace_back(i.name + '=' + i.value);
+
+		/* mark the original setting as used */
+		block.GetBlockParam(i.name.c_str());
+	}
+
+	std::sort(settings.begin(), settings.end());
+
+	std::string key = plugin.name;
+	for (const auto &i : settings) {
+		key += '\n';
+		key += i;
+	}
+
+	return new SharedPreparedEncoder(std::move(key), std::move(prepared));
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_ENCODER_SHARED_HXX
+#define MPD_ENCODER_SHARED_HXX
+
+struct ConfigBlock;
+struct EncoderPlugin;
+class PreparedEncoder;
+
+/**
+ * Create a #PreparedEncoder whose #Encoder instances are shared
+ * between all outputs which use the same encoder plugin with the same
+ * settings and the same input audio format.  The first output which
+ * opens it creates the real encoder, which then runs on its own
+ * thread; all others subscribe to it and receive a copy of the
+ * encoded data.
+ *
+ * This assumes that all subscribers feed the same PCM data (i.e. no
+ * per-output software volume or filters); each subscriber's position
+ * in the PCM stream is tracked, and data which has already been
+ * submitted by another subscriber is not encoded again.
+ *
+ * Throws on error.
+ */
+PreparedEncoder *
+CreateSharedEncoder(const EncoderPlugin &plugin, const ConfigBlock &block);
+
+#endif
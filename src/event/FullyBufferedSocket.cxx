@@ -21,10 +21,17 @@
 #include "net/SocketError.hxx"
 #include "util/Compiler.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <stdexcept>
 
 #include <string.h>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 FullyBufferedSocket::ssize_t
 FullyBufferedSocket::DirectWrite(const void *data, size_t length) noexcept
 {
@@ -46,6 +53,20 @@ FullyBufferedSocket::DirectWrite(const void *data, size_t length) noexcept
 	return nbytes;
 }
 
+inline void
+FullyBufferedSocket::OnOutputEmpty() noexcept
+{
+	idle_event.Cancel();
+	event.CancelWrite();
+
+#ifdef __linux__
+	if (corked) {
+		corked = false;
+		GetSocket().SetCork(false);
+	}
+#endif
+}
+
 bool
 FullyBufferedSocket::Flush() noexcept
 {
@@ -53,8 +74,7 @@ FullyBufferedSocket::Flush() noexcept
 
 	const auto data = output.Read();
 	if (data.empty()) {
-		idle_event.Cancel();
-		event.CancelWrite();
+		OnOutputEmpty();
 		return true;
 	}
 
@@ -64,10 +84,8 @@ FullyBufferedSocket::Flush() noexcept
 
 	output.Consume(nbytes);
 
-	if (output.empty()) {
-		idle_event.Cancel();
-		event.CancelWrite();
-	}
+	if (output.empty())
+		OnOutputEmpty();
 
 	return true;
 }
@@ -92,6 +110,63 @@ FullyBufferedSocket::Write(const void *data, size_t length) noexcept
 	return true;
 }
 
+#ifndef _WIN32
+
+bool
+FullyBufferedSocket::WriteFile(FileDescriptor fd, off_t offset,
+			       size_t length) noexcept
+{
+	assert(IsDefined());
+
+#ifdef __linux__
+	/* hold back partial packets until the rest of the response
+	   has been flushed (see OnOutputEmpty()).  This fails
+	   harmlessly on non-TCP sockets. */
+	if (!corked)
+		corked = GetSocket().SetCork();
+
+	/* the file contents must not overtake data which is still
+	   in the output buffer */
+	if (!output.empty() && !Flush())
+		return false;
+
+	while (length > 0 && output.empty()) {
+		const auto nbytes = sendfile(GetSocket().Get(), fd.Get(),
+					     &offset, length);
+		if (nbytes <= 0)
+			/* the socket is not ready for writing
+			   (EAGAIN), or sendfile() is not supported
+			   for this file; let Write() deal with it */
+			break;
+
+		length -= nbytes;
+	}
+#endif
+
+	while (length > 0) {
+		std::byte buffer[8192];
+		const auto nbytes = fd.ReadAt(offset, buffer,
+					      std::min(length, sizeof(buffer)));
+		if (nbytes <= 0) {
+			/* the file has been truncated; the peer
+			   expects the announced number of bytes, so
+			   there is no way to recover */
+			OnSocketError(std::make_exception_ptr(std::runtime_error("Failed to read file")));
+			return false;
+		}
+
+		if (!Write(buffer, nbytes))
+			return false;
+
+		offset += nbytes;
+		length -= nbytes;
+	}
+
+	return true;
+}
+
+#endif
+
 void
 FullyBufferedSocket::OnSocketReady(unsigned flags) noexcept
 {
@@ -24,6 +24,10 @@
 #include "IdleEvent.hxx"
 #include "util/PeakBuffer.hxx"
 
+#ifndef _WIN32
+#include "io/FileDescriptor.hxx"
+#endif
+
 /**
  * A #BufferedSocket specialization that adds an output buffer.
  */
@@ -32,6 +36,16 @@ class FullyBufferedSocket : protected BufferedSocket {
 
 	PeakBuffer output;
 
+#ifdef __linux__
+	/**
+	 * Has WriteFile() enabled TCP_CORK?  It is disabled as soon
+	 * as the output buffer has been flushed completely, so the
+	 * response header, the file contents and the rest of the
+	 * response get combined into as few packets as possible.
+	 */
+	bool corked = false;
+#endif
+
 public:
 	FullyBufferedSocket(SocketDescriptor _fd, EventLoop &_loop,
 			    size_t normal_size, size_t peak_size=0) noexcept
@@ -56,6 +70,11 @@ private:
 	 */
 	ssize_t DirectWrite(const void *data, size_t length) noexcept;
 
+	/**
+	 * Called after the output buffer has become empty.
+	 */
+	void OnOutputEmpty() noexcept;
+
 protected:
 	/**
 	 * Send data from the output buffer to the socket.
@@ -69,6 +88,19 @@ protected:
 	 */
 	bool Write(const void *data, size_t length) noexcept;
 
+#ifndef _WIN32
+	/**
+	 * Send a portion of a file.  If the output buffer is empty
+	 * (or can be flushed right away), the data is passed from the
+	 * file to the socket by the kernel with sendfile(), without
+	 * copying it to userspace; whatever the socket does not
+	 * accept is read into the output buffer.
+	 *
+	 * @return false if the socket has been closed
+	 */
+	bool WriteFile(FileDescriptor fd, off_t offset, size_t length) noexcept;
+#endif
+
 	void OnIdle() noexcept;
 
 	/* virtual methods from class BufferedSocket */
@@ -234,6 +234,17 @@ public:
 		return ::read(fd, buffer, length);
 	}
 
+#ifndef _WIN32
+	/**
+	 * Read from the given file position without modifying the
+	 * file pointer.
+	 */
+	ssize_t ReadAt(off_t offset,
+		       void *buffer, std::size_t length) const noexcept {
+		return ::pread(fd, buffer, length, offset);
+	}
+#endif
+
 	/**
 	 * Read until all of the given buffer has been filled.  Throws
 	 * on error.
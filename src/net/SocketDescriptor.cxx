@@ -452,6 +452,25 @@ SocketDescriptor::Write(const void *buffer, size_t length) noexcept
 	return ::send(Get(), (const char *)buffer, length, flags);
 }
 
+#ifndef _WIN32
+
+ssize_t
+SocketDescriptor::Write(const struct iovec *iov, size_t n_iov) noexcept
+{
+	int flags = 0;
+#ifdef __linux__
+	flags |= MSG_NOSIGNAL;
+#endif
+
+	struct msghdr msg{};
+	msg.msg_iov = const_cast<struct iovec *>(iov);
+	msg.msg_iovlen = n_iov;
+
+	return ::sendmsg(Get(), &msg, flags);
+}
+
+#endif
+
 #ifdef _WIN32
 
 int
@@ -141,7 +141,7 @@ AudioOutputSource::GetChunkData(const MusicChunk &chunk,
 	assert(!chunk.IsEmpty());
 	assert(chunk.CheckFormat(in_audio_format));
 
-	ConstBuffer<void> data(chunk.data, chunk.length);
+	ConstBuffer<void> data(chunk.GetData(), chunk.length);
 
 	assert(data.size % in_audio_format.GetFrameSize() == 0);
 
@@ -19,6 +19,7 @@
 
 #include "HttpdClient.hxx"
 #include "HttpdInternal.hxx"
+#include "PageRing.hxx"
 #include "util/ASCII.hxx"
 #include "util/AllocatedString.hxx"
 #include "Page.hxx"
@@ -27,11 +28,37 @@
 #include "net/UniqueSocketDescriptor.hxx"
 #include "Log.hxx"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
+#ifdef _WIN32
+/* there is no sendmsg() on Windows; send one segment at a time */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+#else
+#include <sys/uio.h>
+#endif
+
 #include <stdio.h>
 
+/**
+ * The maximum number of #iovec items passed to one sendmsg() call.
+ */
+#ifdef _WIN32
+static constexpr size_t MAX_SEGMENTS = 1;
+#else
+static constexpr size_t MAX_SEGMENTS = 64;
+#endif
+
+/**
+ * A client which lags behind by more than this number of bytes gets
+ * its queue flushed.
+ */
+static constexpr uint64_t MAX_QUEUE_SIZE = 256 * 1024;
+
 HttpdClient::~HttpdClient() noexcept
 {
 	if (IsDefined())
@@ -58,6 +85,7 @@ HttpdClient::BeginResponse() noexcept
 
 	state = State::RESPONSE;
 	current_page = nullptr;
+	next_page = httpd.GetPageRing().GetEnd();
 
 	if (!head_method)
 		httpd.SendHeader(*this);
@@ -189,194 +217,231 @@ HttpdClient::HttpdClient(HttpdOutput &_httpd, UniqueSocketDescriptor _fd,
 {
 }
 
-void
-HttpdClient::ClearQueue() noexcept
-{
-	assert(state == State::RESPONSE);
-
-	while (!pages.empty()) {
-#ifndef NDEBUG
-		auto &page = pages.front();
-		assert(queue_size >= page->GetSize());
-		queue_size -= page->GetSize();
-#endif
-
-		pages.pop();
-	}
-
-	assert(queue_size == 0);
-}
-
 void
 HttpdClient::CancelQueue() noexcept
 {
 	if (state != State::RESPONSE)
 		return;
 
-	ClearQueue();
+	next_page = httpd.GetPageRing().GetEnd();
 
 	if (current_page == nullptr)
 		event.CancelWrite();
 }
 
-ssize_t
-HttpdClient::TryWritePage(const Page &page, size_t position) noexcept
+size_t
+HttpdClient::PrepareSegments(const PageRing &ring, struct iovec *iov,
+			     Segment *segments,
+			     size_t max_segments) const noexcept
 {
-	assert(position < page.GetSize());
+	static constexpr uint8_t empty_metadata = 0;
+
+	size_t n = 0;
+
+	/* simulate the ICY metadata state while walking through the
+	   data */
+	unsigned fill = metadata_fill;
+	bool sent = metadata_sent;
+	size_t metadata_position = metadata_current_position;
+
+	/* add segments for the given page data, splitting it at
+	   metadata boundaries; returns false if there is no room for
+	   all of it */
+	const auto add_data = [&](const uint8_t *data, size_t size,
+				  Segment::Type type, uint64_t page){
+		size_t position = 0;
+		while (position < size) {
+			if (n >= max_segments)
+				return false;
 
-	return GetSocket().Write(page.GetData() + position,
-				 page.GetSize() - position);
-}
+			if (metadata_requested && fill >= metaint) {
+				/* insert a metadata block before the
+				   next data byte */
+				if (!sent) {
+					iov[n].iov_base = const_cast<uint8_t *>(metadata->GetData() + metadata_position);
+					iov[n].iov_len = metadata->GetSize() - metadata_position;
+					segments[n] = {Segment::Type::METADATA, iov[n].iov_len, 0};
+					sent = true;
+					metadata_position = 0;
+				} else {
+					iov[n].iov_base = const_cast<uint8_t *>(&empty_metadata);
+					iov[n].iov_len = 1;
+					segments[n] = {Segment::Type::EMPTY_METADATA, 1, 0};
+				}
 
-ssize_t
-HttpdClient::TryWritePageN(const Page &page,
-			   size_t position, ssize_t n) noexcept
-{
-	return n >= 0
-		? GetSocket().Write(page.GetData() + position, n)
-		: TryWritePage(page, position);
-}
+				fill = 0;
+				++n;
+				continue;
+			}
 
-ssize_t
-HttpdClient::GetBytesTillMetaData() const noexcept
-{
-	if (metadata_requested &&
-	    current_page->GetSize() - current_position > metaint - metadata_fill)
-		return metaint - metadata_fill;
+			size_t length = size - position;
+			if (metadata_requested) {
+				length = std::min<size_t>(length, metaint - fill);
+				fill += length;
+			}
+
+			iov[n].iov_base = const_cast<uint8_t *>(data + position);
+			iov[n].iov_len = length;
+			segments[n] = {type, length, page};
+			++n;
+
+			/* the following segments of this page are
+			   sent from #current_page */
+			type = Segment::Type::CURRENT;
+			position += length;
+		}
+
+		return true;
+	};
+
+	if (current_page != nullptr &&
+	    !add_data(current_page->GetData() + current_position,
+		      current_page->GetSize() - current_position,
+		      Segment::Type::CURRENT, 0))
+		return n;
+
+	for (uint64_t i = next_page; i < ring.GetEnd(); ++i) {
+		const Page &page = *ring.Get(i);
+		if (!add_data(page.GetData(), page.GetSize(),
+			      Segment::Type::RING, i))
+			break;
+	}
 
-	return -1;
+	return n;
 }
 
-inline bool
-HttpdClient::TryWrite() noexcept
+void
+HttpdClient::ConsumeSegments(const PageRing &ring, const Segment *segments,
+			     size_t n_segments, size_t nbytes) noexcept
 {
-	const std::lock_guard<Mutex> protect(httpd.mutex);
+	for (size_t i = 0; i < n_segments && nbytes > 0; ++i) {
+		const auto &segment = segments[i];
+		const size_t length = std::min(segment.length, nbytes);
+		nbytes -= length;
 
-	assert(state == State::RESPONSE);
+		switch (segment.type) {
+		case Segment::Type::RING:
+			assert(current_page == nullptr);
+			assert(segment.page == next_page);
 
-	if (current_page == nullptr) {
-		if (pages.empty()) {
-			/* another thread has removed the event source
-			   while this thread was waiting for
-			   httpd.mutex */
-			event.CancelWrite();
-			return true;
-		}
+			current_page = ring.Get(segment.page);
+			current_position = 0;
+			++next_page;
 
-		current_page = pages.front();
-		pages.pop();
-		current_position = 0;
+			[[fallthrough]];
 
-		assert(queue_size >= current_page->GetSize());
-		queue_size -= current_page->GetSize();
-	}
+		case Segment::Type::CURRENT:
+			current_position += length;
+			assert(current_position <= current_page->GetSize());
 
-	const ssize_t bytes_to_write = GetBytesTillMetaData();
-	if (bytes_to_write == 0) {
-		if (!metadata_sent) {
-			ssize_t nbytes = TryWritePage(*metadata,
-						      metadata_current_position);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorAgain(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FormatWarning(httpd_output_domain,
-						      "failed to write to client: %s",
-						      (const char *)msg);
-				}
+			if (metadata_requested)
+				metadata_fill += length;
 
-				Close();
-				return false;
-			}
+			if (current_position >= current_page->GetSize())
+				current_page.reset();
+			break;
 
-			metadata_current_position += nbytes;
+		case Segment::Type::METADATA:
+			metadata_current_position += length;
 
-			if (metadata->GetSize() - metadata_current_position == 0) {
+			if (metadata_current_position >= metadata->GetSize()) {
 				metadata_fill = 0;
 				metadata_current_position = 0;
 				metadata_sent = true;
 			}
-		} else {
-			char empty_data = 0;
-
-			ssize_t nbytes = GetSocket().Write(&empty_data, 1);
-			if (nbytes < 0) {
-				auto e = GetSocketError();
-				if (IsSocketErrorAgain(e))
-					return true;
-
-				if (!IsSocketErrorClosed(e)) {
-					SocketErrorMessage msg(e);
-					FormatWarning(httpd_output_domain,
-						      "failed to write to client: %s",
-						      (const char *)msg);
-				}
-
-				Close();
-				return false;
-			}
+			break;
 
+		case Segment::Type::EMPTY_METADATA:
 			metadata_fill = 0;
 			metadata_current_position = 0;
+			break;
 		}
-	} else {
-		ssize_t nbytes =
-			TryWritePageN(*current_page, current_position,
-				      bytes_to_write);
-		if (nbytes < 0) {
-			auto e = GetSocketError();
-			if (IsSocketErrorAgain(e))
-				return true;
-
-			if (!IsSocketErrorClosed(e)) {
-				SocketErrorMessage msg(e);
-				FormatWarning(httpd_output_domain,
-					      "failed to write to client: %s",
-					      (const char *)msg);
-			}
+	}
+}
 
-			Close();
-			return false;
-		}
+bool
+HttpdClient::HasPendingData(const PageRing &ring) const noexcept
+{
+	return current_page != nullptr || next_page < ring.GetEnd();
+}
+
+inline bool
+HttpdClient::TryWrite() noexcept
+{
+	const std::lock_guard<Mutex> protect(httpd.mutex);
+
+	assert(state == State::RESPONSE);
 
-		current_position += nbytes;
-		assert(current_position <= current_page->GetSize());
+	const PageRing &ring = httpd.GetPageRing();
 
-		if (metadata_requested)
-			metadata_fill += nbytes;
+	struct iovec iov[MAX_SEGMENTS];
+	Segment segments[MAX_SEGMENTS];
+	const size_t n = PrepareSegments(ring, iov, segments, MAX_SEGMENTS);
+	if (n == 0) {
+		/* another thread has removed the event source while
+		   this thread was waiting for httpd.mutex */
+		event.CancelWrite();
+		return true;
+	}
 
-		if (current_position >= current_page->GetSize()) {
-			current_page.reset();
+#ifdef _WIN32
+	const ssize_t nbytes = GetSocket().Write(iov[0].iov_base,
+						 iov[0].iov_len);
+#else
+	const ssize_t nbytes = GetSocket().Write(iov, n);
+#endif
+	if (nbytes < 0) {
+		auto e = GetSocketError();
+		if (IsSocketErrorAgain(e))
+			return true;
 
-			if (pages.empty())
-				/* all pages are sent: remove the
-				   event source */
-				event.CancelWrite();
+		if (!IsSocketErrorClosed(e)) {
+			SocketErrorMessage msg(e);
+			FormatWarning(httpd_output_domain,
+				      "failed to write to client: %s",
+				      (const char *)msg);
 		}
+
+		Close();
+		return false;
 	}
 
+	ConsumeSegments(ring, segments, n, nbytes);
+
+	if (!HasPendingData(ring))
+		/* all pages are sent: remove the event source */
+		event.CancelWrite();
+
 	return true;
 }
 
 void
-HttpdClient::PushPage(PagePtr page) noexcept
+HttpdClient::PushHeader(PagePtr page) noexcept
+{
+	assert(state == State::RESPONSE);
+	assert(current_page == nullptr);
+
+	current_page = std::move(page);
+	current_position = 0;
+
+	event.ScheduleWrite();
+}
+
+void
+HttpdClient::OnNewPages(const PageRing &ring) noexcept
 {
 	if (state != State::RESPONSE)
 		/* the client is still writing the HTTP request */
 		return;
 
-	if (queue_size > 256 * 1024) {
+	assert(ring.GetEnd() > ring.GetBegin());
+
+	if (ring.GetSizeFrom(next_page) > MAX_QUEUE_SIZE) {
 		FormatDebug(httpd_output_domain,
 			    "client is too slow, flushing its queue");
-		ClearQueue();
+		next_page = ring.GetEnd() - 1;
 	}
 
-	queue_size += page->GetSize();
-	pages.emplace(std::move(page));
-
 	event.ScheduleWrite();
 }
 
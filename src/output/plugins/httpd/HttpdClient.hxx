@@ -28,11 +28,12 @@
 #include <boost/intrusive/list_hook.hpp>
 
 #include <cstddef>
-#include <list>
-#include <queue>
+#include <cstdint>
 
 class UniqueSocketDescriptor;
 class HttpdOutput;
+class PageRing;
+struct iovec;
 
 class HttpdClient final
 	: BufferedSocket,
@@ -57,17 +58,15 @@ class HttpdClient final
 	} state = State::REQUEST;
 
 	/**
-	 * A queue of #Page objects to be sent to the client.
+	 * The absolute index of the next page in the output's
+	 * #PageRing to be sent to the client.
 	 */
-	std::queue<PagePtr, std::list<PagePtr>> pages;
+	uint64_t next_page = 0;
 
 	/**
-	 * The sum of all page sizes in #pages.
-	 */
-	size_t queue_size = 0;
-
-	/**
-	 * The #page which is currently being sent to the client.
+	 * The #page which is currently being sent to the client.  It
+	 * is either the header (see PushHeader()) or a page from the
+	 * #PageRing which has been sent partially.
 	 */
 	PagePtr current_page;
 
@@ -173,19 +172,33 @@ public:
 	 */
 	bool SendResponse() noexcept;
 
-	gcc_pure
-	ssize_t GetBytesTillMetaData() const noexcept;
+	bool TryWrite() noexcept;
 
-	ssize_t TryWritePage(const Page &page, size_t position) noexcept;
-	ssize_t TryWritePageN(const Page &page,
-			      size_t position, ssize_t n) noexcept;
+	/**
+	 * Is this client sending pages from the #PageRing?
+	 */
+	bool IsStreaming() const noexcept {
+		return state == State::RESPONSE;
+	}
 
-	bool TryWrite() noexcept;
+	/**
+	 * The absolute index of the oldest page from the #PageRing
+	 * which this client still needs.
+	 */
+	uint64_t GetNextPage() const noexcept {
+		return next_page;
+	}
 
 	/**
-	 * Appends a page to the client's queue.
+	 * Sends this page before the pages from the #PageRing.  This
+	 * is used for the encoder header.
 	 */
-	void PushPage(PagePtr page) noexcept;
+	void PushHeader(PagePtr page) noexcept;
+
+	/**
+	 * New pages have been added to the #PageRing.
+	 */
+	void OnNewPages(const PageRing &ring) noexcept;
 
 	/**
 	 * Sends the passed metadata.
@@ -193,7 +206,54 @@ public:
 	void PushMetaData(PagePtr page) noexcept;
 
 private:
-	void ClearQueue() noexcept;
+	/**
+	 * Describes what one #iovec prepared by PrepareSegments()
+	 * contains, for ConsumeSegments().
+	 */
+	struct Segment {
+		enum class Type {
+			/** more data from #current_page */
+			CURRENT,
+
+			/** the beginning of a page from the #PageRing */
+			RING,
+
+			/** the (rest of the) ICY metadata block */
+			METADATA,
+
+			/** an empty ICY metadata block */
+			EMPTY_METADATA,
+		} type;
+
+		size_t length;
+
+		/**
+		 * The absolute page index for #Type::RING.
+		 */
+		uint64_t page;
+	};
+
+	/**
+	 * Fill the #iovec array with the data to be sent next: the
+	 * rest of #current_page and the following pages from the
+	 * #PageRing, with ICY metadata blocks inserted every #metaint
+	 * bytes.
+	 *
+	 * @return the number of #iovec items
+	 */
+	size_t PrepareSegments(const PageRing &ring, struct iovec *iov,
+			       Segment *segments,
+			       size_t max_segments) const noexcept;
+
+	/**
+	 * Update the state after PrepareSegments() data has been
+	 * sent.
+	 */
+	void ConsumeSegments(const PageRing &ring, const Segment *segments,
+			     size_t n_segments, size_t nbytes) noexcept;
+
+	gcc_pure
+	bool HasPendingData(const PageRing &ring) const noexcept;
 
 protected:
 	/* virtual methods from class BufferedSocket */
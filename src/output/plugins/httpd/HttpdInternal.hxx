@@ -26,6 +26,7 @@
 #define MPD_OUTPUT_HTTPD_INTERNAL_H
 
 #include "HttpdClient.hxx"
+#include "PageRing.hxx"
 #include "output/Interface.hxx"
 #include "output/Timer.hxx"
 #include "thread/Mutex.hxx"
@@ -115,6 +116,12 @@ private:
 	 */
 	std::queue<PagePtr, std::list<PagePtr>> pages;
 
+	/**
+	 * The pages being sent to the clients.  Only the IOThread
+	 * accesses it, while holding #mutex.
+	 */
+	PageRing page_ring;
+
 	InjectEvent defer_broadcast;
 
  public:
@@ -220,6 +227,10 @@ public:
 	 */
 	void RemoveClient(HttpdClient &client) noexcept;
 
+	const PageRing &GetPageRing() const noexcept {
+		return page_ring;
+	}
+
 	/**
 	 * Sends the encoder header to the client.  This is called
 	 * right after the response headers have been sent.
@@ -269,6 +280,14 @@ public:
 	bool Pause() override;
 
 private:
+	/**
+	 * Remove pages which have been sent to all clients from the
+	 * #PageRing.
+	 *
+	 * Caller must lock the mutex.
+	 */
+	void TrimPageRing() noexcept;
+
 	/* InjectEvent callback */
 	void OnDeferredBroadcast() noexcept;
 
@@ -32,6 +32,7 @@
 #include "util/DeleteDisposer.hxx"
 #include "config/Net.hxx"
 
+#include <algorithm>
 #include <cassert>
 
 #include <string.h>
@@ -106,12 +107,16 @@ HttpdOutput::OnDeferredBroadcast() noexcept
 
 	const std::lock_guard<Mutex> protect(mutex);
 
-	while (!pages.empty()) {
-		PagePtr page = std::move(pages.front());
-		pages.pop();
+	if (!pages.empty()) {
+		do {
+			page_ring.Push(std::move(pages.front()));
+			pages.pop();
+		} while (!pages.empty());
 
 		for (auto &client : clients)
-			client.PushPage(page);
+			client.OnNewPages(page_ring);
+
+		TrimPageRing();
 	}
 
 	/* wake up the client that may be waiting for the queue to be
@@ -119,6 +124,17 @@ HttpdOutput::OnDeferredBroadcast() noexcept
 	cond.notify_all();
 }
 
+void
+HttpdOutput::TrimPageRing() noexcept
+{
+	uint64_t begin = page_ring.GetEnd();
+	for (const auto &client : clients)
+		if (client.IsStreaming())
+			begin = std::min(begin, client.GetNextPage());
+
+	page_ring.Trim(begin);
+}
+
 void
 HttpdOutput::OnAccept(UniqueSocketDescriptor fd,
 		      SocketAddress, [[maybe_unused]] int uid) noexcept
@@ -211,6 +227,7 @@ HttpdOutput::Close() noexcept
 			const std::lock_guard<Mutex> protect(mutex);
 			open = false;
 			clients.clear_and_dispose(DeleteDisposer());
+			page_ring.Clear();
 		});
 
 	header.reset();
@@ -231,7 +248,7 @@ void
 HttpdOutput::SendHeader(HttpdClient &client) const noexcept
 {
 	if (header != nullptr)
-		client.PushPage(header);
+		client.PushHeader(header);
 }
 
 std::chrono::steady_clock::duration
@@ -393,6 +410,8 @@ HttpdOutput::CancelAllClients() noexcept
 	for (auto &client : clients)
 		client.CancelQueue();
 
+	page_ring.Clear();
+
 	cond.notify_all();
 }
 
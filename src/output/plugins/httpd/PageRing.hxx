@@ -0,0 +1,132 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_OUTPUT_HTTPD_PAGE_RING_HXX
+#define MPD_OUTPUT_HTTPD_PAGE_RING_HXX
+
+#include "Page.hxx"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * The encoded pages which are being sent to the clients of the
+ * "httpd" output.  All clients share this ring; each one has its
+ * own cursor (an absolute page index), so broadcasting a page costs
+ * no allocation per client.  Pages are removed by Trim() after all
+ * clients have sent them.
+ *
+ * This class is not thread-safe; it is protected by
+ * HttpdOutput::mutex.
+ */
+class PageRing {
+	struct Item {
+		PagePtr page;
+
+		/**
+		 * The total number of bytes pushed up to and
+		 * including this page.
+		 */
+		uint64_t end_offset;
+	};
+
+	/**
+	 * The slots; the size is always a power of two.
+	 */
+	std::vector<Item> items;
+
+	/**
+	 * The absolute index of the oldest and the next page.
+	 */
+	uint64_t begin = 0, end = 0;
+
+	/**
+	 * The total number of bytes pushed.
+	 */
+	uint64_t end_offset = 0;
+
+public:
+	PageRing() noexcept:items(16) {}
+
+	uint64_t GetBegin() const noexcept {
+		return begin;
+	}
+
+	uint64_t GetEnd() const noexcept {
+		return end;
+	}
+
+	const PagePtr &Get(uint64_t i) const noexcept {
+		assert(i >= begin);
+		assert(i < end);
+
+		return items[i & (items.size() - 1)].page;
+	}
+
+	/**
+	 * Returns the number of bytes from the start of the given page
+	 * to the end of the ring.
+	 */
+	uint64_t GetSizeFrom(uint64_t i) const noexcept {
+		assert(i >= begin);
+		assert(i <= end);
+
+		if (i == end)
+			return 0;
+
+		const auto &item = items[i & (items.size() - 1)];
+		return end_offset - item.end_offset + item.page->GetSize();
+	}
+
+	void Push(PagePtr page) noexcept {
+		if (end - begin == items.size())
+			Grow();
+
+		end_offset += page->GetSize();
+		items[end & (items.size() - 1)] = {std::move(page), end_offset};
+		++end;
+	}
+
+	/**
+	 * Remove all pages before the given absolute index.
+	 */
+	void Trim(uint64_t new_begin) noexcept {
+		assert(new_begin <= end);
+
+		for (; begin < new_begin; ++begin)
+			items[begin & (items.size() - 1)].page.reset();
+	}
+
+	void Clear() noexcept {
+		Trim(end);
+	}
+
+private:
+	void Grow() noexcept {
+		std::vector<Item> new_items(items.size() * 2);
+		for (uint64_t i = begin; i < end; ++i)
+			new_items[i & (new_items.size() - 1)] =
+				std::move(items[i & (items.size() - 1)]);
+		items.swap(new_items);
+	}
+};
+
+#endif
@@ -19,6 +19,8 @@
 
 #include "ConfiguredResampler.hxx"
 #include "FallbackResampler.hxx"
+#include "SincResampler.hxx"
+#include "ParallelResampler.hxx"
 #include "config/Data.hxx"
 #include "config/Option.hxx"
 #include "config/Block.hxx"
@@ -34,13 +36,17 @@
 #include "SoxrResampler.hxx"
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 #include <string.h>
 
 enum class SelectedResampler {
 	FALLBACK,
 
+	SINC,
+
 #ifdef ENABLE_LIBSAMPLERATE
 	LIBSAMPLERATE,
 #endif
@@ -52,6 +58,12 @@ enum class SelectedResampler {
 
 static SelectedResampler selected_resampler = SelectedResampler::FALLBACK;
 
+/**
+ * If this is more than 1, the channels are split into groups which
+ * are resampled in separate threads (see #ParallelPcmResampler).
+ */
+static unsigned resampler_threads = 1;
+
 static const ConfigBlock *
 MakeResamplerDefaultConfig(ConfigBlock &block) noexcept
 {
@@ -62,7 +74,7 @@ MakeResamplerDefaultConfig(ConfigBlock &block) noexcept
 #elif defined(ENABLE_SOXR)
 	block.AddBlockParam("plugin", "soxr");
 #else
-	block.AddBlockParam("plugin", "internal");
+	block.AddBlockParam("plugin", "sinc");
 #endif
 	return &block;
 }
@@ -142,6 +154,9 @@ pcm_resampler_global_init(const ConfigData &config)
 
 	if (strcmp(plugin_name, "internal") == 0) {
 		selected_resampler = SelectedResampler::FALLBACK;
+	} else if (strcmp(plugin_name, "sinc") == 0) {
+		selected_resampler = SelectedResampler::SINC;
+		pcm_resample_sinc_global_init(*block);
 #ifdef ENABLE_SOXR
 	} else if (strcmp(plugin_name, "soxr") == 0) {
 		selected_resampler = SelectedResampler::SOXR;
@@ -156,15 +171,29 @@ pcm_resampler_global_init(const ConfigData &config)
 		throw FormatRuntimeError("No such resampler plugin: %s",
 					 plugin_name);
 	}
+
+#ifdef ENABLE_SOXR
+	if (selected_resampler == SelectedResampler::SOXR)
+		/* libsoxr implements the "threads" setting itself */
+		return;
+#endif
+
+	resampler_threads = block->GetBlockValue("threads", 1U);
+	if (resampler_threads == 0)
+		resampler_threads = std::max(std::thread::hardware_concurrency(),
+					     1U);
 }
 
-PcmResampler *
-pcm_resampler_create()
+static PcmResampler *
+CreateResampler()
 {
 	switch (selected_resampler) {
 	case SelectedResampler::FALLBACK:
 		return new FallbackPcmResampler();
 
+	case SelectedResampler::SINC:
+		return new SincPcmResampler();
+
 #ifdef ENABLE_LIBSAMPLERATE
 	case SelectedResampler::LIBSAMPLERATE:
 		return new LibsampleratePcmResampler();
@@ -178,3 +207,13 @@ pcm_resampler_create()
 
 	gcc_unreachable();
 }
+
+PcmResampler *
+pcm_resampler_create()
+{
+	if (resampler_threads > 1)
+		return new ParallelPcmResampler(resampler_threads,
+						CreateResampler);
+
+	return CreateResampler();
+}
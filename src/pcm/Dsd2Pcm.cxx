@@ -35,6 +35,7 @@ or implied, of Sebastian Gesemann.
 #include "util/BitReverse.hxx"
 #include "util/GenerateArray.hxx"
 
+#include <algorithm>
 #include <cassert>
 
 #include <stdlib.h>
@@ -46,7 +47,7 @@ static constexpr size_t HTAPS = 48;
 /** number of "8 MACs" lookup tables */
 static constexpr size_t CTABLES = (HTAPS + 7) / 8;
 
-static_assert(Dsd2Pcm::FIFOSIZE * 8 >= HTAPS * 2, "FIFOSIZE too small");
+static_assert(Dsd2Pcm::CTABLES == CTABLES, "Wrong CTABLES");
 
 /*
  * Properties of this 96-tap lowpass filter when applied on a signal
@@ -172,76 +173,96 @@ void
 Dsd2Pcm::Reset() noexcept
 {
 	/* my favorite silence pattern */
-	std::fill_n(fifo, std::size(fifo), 0x69);
-
-	fifopos = 0;
+	constexpr uint8_t SILENCE = 0x69;
 	/* 0x69 = 01101001
 	 * This pattern "on repeat" makes a low energy 352.8 kHz tone
 	 * and a high energy 1.0584 MHz tone which should be filtered
 	 * out completely by any playback system --> silence
 	 */
+
+	std::fill_n(raw_history, RAW_HISTORY, SILENCE);
+
+	/* the original ring buffer implementation reversed each byte
+	   when it became CTABLES bytes old; the older bytes of the
+	   initial silence pattern were never reversed */
+	std::fill_n(reversed_history, REVERSED_HISTORY - CTABLES, SILENCE);
+	std::fill_n(reversed_history + REVERSED_HISTORY - CTABLES, CTABLES,
+		    bit_reverse(SILENCE));
 }
 
 inline void
-Dsd2Pcm::ApplySample(size_t ffp, uint8_t src) noexcept
+Dsd2Pcm::LoadBlock(size_t n, const uint8_t *gcc_restrict src,
+		   ptrdiff_t src_stride,
+		   uint8_t *gcc_restrict raw,
+		   uint8_t *gcc_restrict reversed) noexcept
 {
-	fifo[ffp] = src;
-	uint8_t *p = fifo + ((ffp-CTABLES) & FIFOMASK);
-	*p = bit_reverse(*p);
+	assert(n <= BLOCK_SIZE);
+
+	std::copy_n(raw_history, RAW_HISTORY, raw);
+	std::copy_n(reversed_history, REVERSED_HISTORY, reversed);
+
+	for (size_t i = 0; i < n; ++i) {
+		const uint8_t b = src[i * src_stride];
+		raw[RAW_HISTORY + i] = b;
+		reversed[REVERSED_HISTORY + i] = bit_reverse(b);
+	}
+
+	std::copy_n(raw + n, RAW_HISTORY, raw_history);
+	std::copy_n(reversed + n, REVERSED_HISTORY, reversed_history);
 }
 
-inline float
-Dsd2Pcm::CalcOutputSample(size_t ffp) const noexcept
+/**
+ * Calculate one output sample.
+ *
+ * @param raw the input bytes in original bit order; the newest one
+ * is raw[RAW_HISTORY]
+ * @param reversed the input bytes in reversed bit order, starting
+ * with the oldest one used for this sample
+ */
+static inline float
+CalcOutputSample(const uint8_t *raw, const uint8_t *reversed) noexcept
 {
 	double acc = 0;
 	for (size_t i = 0; i < CTABLES; ++i) {
-		uint8_t bite1 = fifo[(ffp              -i) & FIFOMASK];
-		uint8_t bite2 = fifo[(ffp-(CTABLES*2-1)+i) & FIFOMASK];
+		uint8_t bite1 = raw[Dsd2Pcm::RAW_HISTORY - i];
+		uint8_t bite2 = reversed[i];
 		acc += double(ctables[i][bite1] + ctables[i][bite2]);
 	}
 	return float(acc);
 }
 
-inline float
-Dsd2Pcm::TranslateSample(size_t ffp, uint8_t src) noexcept
-{
-	ApplySample(ffp, src);
-	return CalcOutputSample(ffp);
-}
-
-inline int32_t
-Dsd2Pcm::CalcOutputSampleS24(size_t ffp) const noexcept
+static inline int32_t
+CalcOutputSampleS24(const uint8_t *raw, const uint8_t *reversed) noexcept
 {
 	int32_t acc = 0;
 	for (size_t i = 0; i < CTABLES; ++i) {
-		uint8_t bite1 = fifo[(ffp              -i) & FIFOMASK];
-		uint8_t bite2 = fifo[(ffp-(CTABLES*2-1)+i) & FIFOMASK];
+		uint8_t bite1 = raw[Dsd2Pcm::RAW_HISTORY - i];
+		uint8_t bite2 = reversed[i];
 		acc += ctables_s24[i][bite1] + ctables_s24[i][bite2];
 	}
 	return acc;
 }
 
-inline int32_t
-Dsd2Pcm::TranslateSampleS24(size_t ffp, uint8_t src) noexcept
-{
-	ApplySample(ffp, src);
-	return CalcOutputSampleS24(ffp);
-}
-
 void
 Dsd2Pcm::Translate(size_t samples,
 		   const uint8_t *gcc_restrict src, ptrdiff_t src_stride,
 		   float *dst, ptrdiff_t dst_stride) noexcept
 {
-	size_t ffp = fifopos;
-	while (samples-- > 0) {
-		uint8_t bite1 = *src;
-		src += src_stride;
-		*dst = TranslateSample(ffp, bite1);
-		dst += dst_stride;
-		ffp = (ffp + 1) & FIFOMASK;
+	uint8_t raw[RAW_HISTORY + BLOCK_SIZE];
+	uint8_t reversed[REVERSED_HISTORY + BLOCK_SIZE];
+
+	while (samples > 0) {
+		const size_t n = std::min(samples, BLOCK_SIZE);
+		LoadBlock(n, src, src_stride, raw, reversed);
+
+		for (size_t i = 0; i < n; ++i)
+			dst[i * dst_stride] =
+				CalcOutputSample(raw + i, reversed + i);
+
+		samples -= n;
+		src += n * src_stride;
+		dst += n * dst_stride;
 	}
-	fifopos = ffp;
 }
 
 void
@@ -249,15 +270,21 @@ Dsd2Pcm::TranslateS24(size_t samples,
 		      const uint8_t *gcc_restrict src, ptrdiff_t src_stride,
 		      int32_t *dst, ptrdiff_t dst_stride) noexcept
 {
-	size_t ffp = fifopos;
-	while (samples-- > 0) {
-		uint8_t bite1 = *src;
-		src += src_stride;
-		*dst = TranslateSampleS24(ffp, bite1);
-		dst += dst_stride;
-		ffp = (ffp + 1) & FIFOMASK;
+	uint8_t raw[RAW_HISTORY + BLOCK_SIZE];
+	uint8_t reversed[REVERSED_HISTORY + BLOCK_SIZE];
+
+	while (samples > 0) {
+		const size_t n = std::min(samples, BLOCK_SIZE);
+		LoadBlock(n, src, src_stride, raw, reversed);
+
+		for (size_t i = 0; i < n; ++i)
+			dst[i * dst_stride] =
+				CalcOutputSampleS24(raw + i, reversed + i);
+
+		samples -= n;
+		src += n * src_stride;
+		dst += n * dst_stride;
 	}
-	fifopos = ffp;
 }
 
 void
@@ -266,29 +293,18 @@ MultiDsd2Pcm::Translate(unsigned channels, size_t n_frames,
 {
 	assert(channels <= per_channel.max_size());
 
-	if (channels == 2) {
-		TranslateStereo(n_frames, src, dest);
-		return;
-	}
+	while (n_frames > 0) {
+		const size_t n = std::min(n_frames, Dsd2Pcm::BLOCK_SIZE);
 
-	for (unsigned i = 0; i < channels; ++i) {
-		per_channel[i].Translate(n_frames,
-					 src++, channels,
-					 dest++, channels);
-	}
-}
+		for (unsigned c = 0; c < channels; ++c)
+			per_channel[c].Translate(n,
+						 src + c, channels,
+						 dest + c, channels);
 
-inline void
-MultiDsd2Pcm::TranslateStereo(size_t n_frames,
-			      const uint8_t *src, float *dest) noexcept
-{
-	size_t ffp = fifopos;
-	while (n_frames-- > 0) {
-		*dest++ = per_channel[0].TranslateSample(ffp, *src++);
-		*dest++ = per_channel[1].TranslateSample(ffp, *src++);
-		ffp = (ffp + 1) & Dsd2Pcm::FIFOMASK;
+		n_frames -= n;
+		src += n * channels;
+		dest += n * channels;
 	}
-	fifopos = ffp;
 }
 
 void
@@ -297,27 +313,16 @@ MultiDsd2Pcm::TranslateS24(unsigned channels, size_t n_frames,
 {
 	assert(channels <= per_channel.max_size());
 
-	if (channels == 2) {
-		TranslateStereoS24(n_frames, src, dest);
-		return;
-	}
+	while (n_frames > 0) {
+		const size_t n = std::min(n_frames, Dsd2Pcm::BLOCK_SIZE);
 
-	for (unsigned i = 0; i < channels; ++i) {
-		per_channel[i].TranslateS24(n_frames,
-					    src++, channels,
-					    dest++, channels);
-	}
-}
+		for (unsigned c = 0; c < channels; ++c)
+			per_channel[c].TranslateS24(n,
+						    src + c, channels,
+						    dest + c, channels);
 
-inline void
-MultiDsd2Pcm::TranslateStereoS24(size_t n_frames,
-				 const uint8_t *src, int32_t *dest) noexcept
-{
-	size_t ffp = fifopos;
-	while (n_frames-- > 0) {
-		*dest++ = per_channel[0].TranslateSampleS24(ffp, *src++);
-		*dest++ = per_channel[1].TranslateSampleS24(ffp, *src++);
-		ffp = (ffp + 1) & Dsd2Pcm::FIFOMASK;
+		n_frames -= n;
+		src += n * channels;
+		dest += n * channels;
 	}
-	fifopos = ffp;
 }
@@ -39,20 +39,42 @@ or implied, of Sebastian Gesemann.
 
 /**
  * A "dsd2pcm engine" for one channel.
+ *
+ * Instead of a ring buffer which is updated for each input byte,
+ * this class keeps only the history needed by the FIR filter and
+ * converts blocks of input bytes: they are copied to linear buffers
+ * (once in original and once in bit-reversed order), and each
+ * output sample is computed with plain table lookups at fixed
+ * offsets.
  */
 class Dsd2Pcm {
-	friend class MultiDsd2Pcm;
-
 public:
-	/* must be a power of two */
-	static constexpr size_t FIFOSIZE = 16;
+	/**
+	 * The number of "8 MACs" lookup tables; each table covers 8
+	 * taps of one half of the symmetric FIR filter.
+	 */
+	static constexpr size_t CTABLES = 6;
 
-private:
-	/** bit mask for FIFO offsets */
-	static constexpr size_t FIFOMASK = FIFOSIZE - 1;
+	/**
+	 * The number of previous input bytes needed for the first
+	 * half of the filter (in original bit order).
+	 */
+	static constexpr size_t RAW_HISTORY = CTABLES - 1;
+
+	/**
+	 * The number of previous input bytes needed for the second
+	 * half of the filter (in reversed bit order).
+	 */
+	static constexpr size_t REVERSED_HISTORY = CTABLES * 2 - 1;
+
+	/**
+	 * The number of bytes converted in one block.
+	 */
+	static constexpr size_t BLOCK_SIZE = 256;
 
-	uint8_t fifo[FIFOSIZE];
-	size_t fifopos;
+private:
+	uint8_t raw_history[RAW_HISTORY];
+	uint8_t reversed_history[REVERSED_HISTORY];
 
 public:
 	Dsd2Pcm() noexcept {
@@ -67,7 +89,6 @@ public:
 	/**
 	 * "translates" a stream of octets to a stream of floats
 	 * (8:1 decimation)
-	 * @param ctx -- pointer to abstract context (buffers)
 	 * @param samples -- number of octets/samples to "translate"
 	 * @param src -- pointer to first octet (input)
 	 * @param src_stride -- src pointer increment
@@ -83,41 +104,35 @@ public:
 			  int32_t *dst, ptrdiff_t dst_stride) noexcept;
 
 private:
-	void ApplySample(size_t ffp, uint8_t src) noexcept;
-	float CalcOutputSample(size_t ffp) const noexcept;
-	float TranslateSample(size_t ffp, uint8_t src) noexcept;
-
-	int32_t CalcOutputSampleS24(size_t ffp) const noexcept;
-	int32_t TranslateSampleS24(size_t ffp, uint8_t src) noexcept;
+	/**
+	 * Copy the history and the given input bytes to the linear
+	 * buffers, and update the history.
+	 *
+	 * @param n the number of input bytes (at most #BLOCK_SIZE)
+	 */
+	void LoadBlock(size_t n, const uint8_t *src, ptrdiff_t src_stride,
+		       uint8_t *raw, uint8_t *reversed) noexcept;
 };
 
 class MultiDsd2Pcm {
 	std::array<Dsd2Pcm, MAX_CHANNELS> per_channel;
 
-	size_t fifopos = 0;
-
 public:
 	void Reset() noexcept {
 		for (auto &i : per_channel)
 			i.Reset();
-		fifopos = 0;
 	}
 
+	/**
+	 * Convert interleaved DSD data.  The channels are converted
+	 * in blocks of Dsd2Pcm::BLOCK_SIZE frames, so the input and
+	 * output of all channels stays in the CPU cache.
+	 */
 	void Translate(unsigned channels, size_t n_frames,
 		       const uint8_t *src, float *dest) noexcept;
 
 	void TranslateS24(unsigned channels, size_t n_frames,
 			  const uint8_t *src, int32_t *dest) noexcept;
-
-private:
-	/**
-	 * Optimized implementation for the common case.
-	 */
-	void TranslateStereo(size_t n_frames,
-			     const uint8_t *src, float *dest) noexcept;
-
-	void TranslateStereoS24(size_t n_frames,
-				const uint8_t *src, int32_t *dest) noexcept;
 };
 
 #endif /* include guard DSD2PCM_H_INCLUDED */
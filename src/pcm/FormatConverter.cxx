@@ -19,6 +19,7 @@
 
 #include "FormatConverter.hxx"
 #include "PcmFormat.hxx"
+#include "Simd.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/RuntimeError.hxx"
 
@@ -50,6 +51,7 @@ PcmFormatConverter::Open(SampleFormat _src_format, SampleFormat _dest_format)
 
 	src_format = _src_format;
 	dest_format = _dest_format;
+	simd = &SelectPcmSimd();
 }
 
 void
@@ -74,22 +76,22 @@ PcmFormatConverter::Convert(ConstBuffer<void> src) noexcept
 	case SampleFormat::S16:
 		return pcm_convert_to_16(buffer, dither,
 					 src_format,
-					 src).ToVoid();
+					 src, *simd).ToVoid();
 
 	case SampleFormat::S24_P32:
 		return pcm_convert_to_24(buffer,
 					 src_format,
-					 src).ToVoid();
+					 src, *simd).ToVoid();
 
 	case SampleFormat::S32:
 		return pcm_convert_to_32(buffer,
 					 src_format,
-					 src).ToVoid();
+					 src, *simd).ToVoid();
 
 	case SampleFormat::FLOAT:
 		return pcm_convert_to_float(buffer,
 					    src_format,
-					    src).ToVoid();
+					    src, *simd).ToVoid();
 	}
 
 	assert(false);
@@ -29,6 +29,7 @@
 #endif
 
 template<typename T> struct ConstBuffer;
+struct PcmSimd;
 
 /**
  * A class that converts samples from one format to another.
@@ -36,6 +37,11 @@ template<typename T> struct ConstBuffer;
 class PcmFormatConverter {
 	SampleFormat src_format, dest_format;
 
+	/**
+	 * The SIMD kernels selected by Open().
+	 */
+	const PcmSimd *simd;
+
 	PcmBuffer buffer;
 	PcmDither dither;
 
@@ -19,6 +19,7 @@
 
 #include "Mix.hxx"
 #include "Volume.hxx"
+#include "Simd.hxx"
 #include "Clamp.hxx"
 #include "Traits.hxx"
 #include "util/Clamp.hxx"
@@ -71,20 +72,6 @@ PcmAddVolumeVoid(PcmDither &dither,
 				volume1, volume2);
 }
 
-static void
-pcm_add_vol_float(float *buffer1, const float *buffer2,
-		  unsigned num_samples, float volume1, float volume2) noexcept
-{
-	while (num_samples > 0) {
-		float sample1 = *buffer1;
-		float sample2 = *buffer2++;
-
-		sample1 = (sample1 * volume1 + sample2 * volume2);
-		*buffer1++ = sample1;
-		--num_samples;
-	}
-}
-
 static bool
 pcm_add_vol(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 	    int vol1, int vol2,
@@ -121,10 +108,11 @@ pcm_add_vol(PcmDither &dither, void *buffer1, const void *buffer2, size_t size,
 		return true;
 
 	case SampleFormat::FLOAT:
-		pcm_add_vol_float((float *)buffer1, (const float *)buffer2,
-				  size / 4,
-				  pcm_volume_to_float(vol1),
-				  pcm_volume_to_float(vol2));
+		SelectPcmSimd().mix_float((float *)buffer1,
+					  (const float *)buffer2,
+					  size / sizeof(float),
+					  pcm_volume_to_float(vol1),
+					  pcm_volume_to_float(vol2));
 		return true;
 	}
 
@@ -163,18 +151,6 @@ PcmAddVoid(void *a, const void *b, size_t size) noexcept
 			  size / sample_size);
 }
 
-static void
-pcm_add_float(float *buffer1, const float *buffer2,
-	      unsigned num_samples) noexcept
-{
-	while (num_samples > 0) {
-		float sample1 = *buffer1;
-		float sample2 = *buffer2++;
-		*buffer1++ = sample1 + sample2;
-		--num_samples;
-	}
-}
-
 static bool
 pcm_add(void *buffer1, const void *buffer2, size_t size,
 	SampleFormat format) noexcept
@@ -202,8 +178,9 @@ pcm_add(void *buffer1, const void *buffer2, size_t size,
 		return true;
 
 	case SampleFormat::FLOAT:
-		pcm_add_float((float *)buffer1, (const float *)buffer2,
-			      size / 4);
+		SelectPcmSimd().add_float((float *)buffer1,
+					  (const float *)buffer2,
+					  size / sizeof(float));
 		return true;
 	}
 
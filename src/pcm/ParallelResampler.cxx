@@ -0,0 +1,288 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ParallelResampler.hxx"
+#include "AudioFormat.hxx"
+#include "thread/Name.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include <string.h>
+
+/**
+ * Buffers with fewer samples (frames times channels) than this are
+ * resampled in the calling thread, because waking up the worker
+ * threads would take longer than resampling them.
+ */
+static constexpr std::size_t PARALLEL_MIN_SAMPLES = 2048;
+
+ParallelPcmResampler::Group::Group(ParallelPcmResampler &_parent,
+				   std::unique_ptr<PcmResampler> &&_resampler,
+				   unsigned _first_channel,
+				   unsigned _channels) noexcept
+	:parent(_parent), resampler(std::move(_resampler)),
+	 first_channel(_first_channel), channels(_channels),
+	 thread(BIND_THIS_METHOD(RunThread)),
+	 generation(parent.generation)
+{
+}
+
+inline void
+ParallelPcmResampler::Group::Resample() noexcept
+try {
+	const auto output = resampler->Resample(input);
+	const auto *data = (const std::byte *)output.data;
+	pending.insert(pending.end(), data, data + output.size);
+} catch (...) {
+	error = std::current_exception();
+}
+
+inline void
+ParallelPcmResampler::Group::Flush()
+{
+	while (true) {
+		const auto output = resampler->Flush();
+		if (output.IsNull())
+			break;
+
+		const auto *data = (const std::byte *)output.data;
+		pending.insert(pending.end(), data, data + output.size);
+	}
+}
+
+void
+ParallelPcmResampler::Group::RunThread() noexcept
+{
+	SetThreadName("resampler");
+
+	std::unique_lock<Mutex> lock(parent.mutex);
+
+	while (true) {
+		parent.wake_cond.wait(lock, [this]{
+			return parent.quit || parent.generation != generation;
+		});
+
+		if (parent.quit)
+			break;
+
+		generation = parent.generation;
+
+		lock.unlock();
+		Resample();
+		lock.lock();
+
+		assert(parent.n_running > 0);
+		if (--parent.n_running == 0)
+			parent.done_cond.notify_one();
+	}
+}
+
+AudioFormat
+ParallelPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate)
+{
+	assert(groups.empty());
+
+	channels = af.channels;
+	quit = false;
+
+	const unsigned n_groups = std::min(max_groups, channels);
+	AudioFormat result;
+
+	try {
+		unsigned first_channel = 0;
+		for (unsigned i = 0; i < n_groups; ++i) {
+			/* distribute the channels evenly */
+			const unsigned n = (channels - first_channel) /
+				(n_groups - i);
+
+			std::unique_ptr<PcmResampler> resampler(factory());
+			AudioFormat group_af(af.sample_rate, af.format, n);
+			auto group_result = resampler->Open(group_af,
+							    new_sample_rate);
+
+			if (i == 0) {
+				/* the plugin may have chosen another
+				   input format */
+				af.format = group_af.format;
+				result = group_result;
+				result.channels = channels;
+			}
+
+			assert(group_af.format == af.format);
+			assert(group_result.format == result.format);
+
+			auto &group = groups.emplace_back(*this,
+							  std::move(resampler),
+							  first_channel, n);
+			if (i > 0)
+				group.thread.Start();
+
+			first_channel += n;
+		}
+	} catch (...) {
+		Close();
+		throw;
+	}
+
+	in_sample_size = af.GetSampleSize();
+	out_sample_size = result.GetSampleSize();
+
+	return result;
+}
+
+void
+ParallelPcmResampler::StopThreads() noexcept
+{
+	{
+		const std::lock_guard<Mutex> lock(mutex);
+		quit = true;
+		wake_cond.notify_all();
+	}
+
+	for (auto &group : groups)
+		if (group.thread.IsDefined())
+			group.thread.Join();
+}
+
+void
+ParallelPcmResampler::Close() noexcept
+{
+	StopThreads();
+
+	for (auto &group : groups)
+		group.resampler->Close();
+
+	groups.clear();
+}
+
+void
+ParallelPcmResampler::Reset() noexcept
+{
+	for (auto &group : groups) {
+		group.resampler->Reset();
+		group.pending.clear();
+	}
+}
+
+ConstBuffer<void>
+ParallelPcmResampler::CollectOutput() noexcept
+{
+	const std::size_t frame_size = out_sample_size * channels;
+
+	std::size_t n_frames = SIZE_MAX;
+	for (const auto &group : groups)
+		n_frames = std::min(n_frames, group.pending.size() /
+				    (out_sample_size * group.channels));
+
+	auto *const dest = (std::byte *)output_buffer.Get(n_frames * frame_size);
+
+	for (auto &group : groups) {
+		const std::size_t group_frame_size =
+			out_sample_size * group.channels;
+		const std::byte *src = group.pending.data();
+		std::byte *p = dest + group.first_channel * out_sample_size;
+
+		for (std::size_t i = 0; i < n_frames; ++i) {
+			memcpy(p, src, group_frame_size);
+			p += frame_size;
+			src += group_frame_size;
+		}
+
+		group.pending.erase(group.pending.begin(),
+				    std::next(group.pending.begin(),
+					      n_frames * group_frame_size));
+	}
+
+	return {dest, n_frames * frame_size};
+}
+
+ConstBuffer<void>
+ParallelPcmResampler::Resample(ConstBuffer<void> src)
+{
+	const std::size_t frame_size = in_sample_size * channels;
+	assert(src.size % frame_size == 0);
+	const std::size_t n_frames = src.size / frame_size;
+
+	/* split the channels */
+
+	for (auto &group : groups) {
+		const std::size_t group_frame_size =
+			in_sample_size * group.channels;
+		const std::size_t group_size = n_frames * group_frame_size;
+		auto *const dest = (std::byte *)group.input_buffer.Get(group_size);
+
+		const std::byte *s = (const std::byte *)src.data +
+			group.first_channel * in_sample_size;
+		std::byte *p = dest;
+		for (std::size_t i = 0; i < n_frames; ++i) {
+			memcpy(p, s, group_frame_size);
+			p += group_frame_size;
+			s += frame_size;
+		}
+
+		group.input = {dest, group_size};
+	}
+
+	if (groups.size() > 1 &&
+	    n_frames * channels >= PARALLEL_MIN_SAMPLES) {
+		{
+			const std::lock_guard<Mutex> lock(mutex);
+			n_running = groups.size() - 1;
+			++generation;
+			wake_cond.notify_all();
+		}
+
+		/* the first group is resampled by this thread */
+		groups.front().Resample();
+
+		std::unique_lock<Mutex> lock(mutex);
+		done_cond.wait(lock, [this]{ return n_running == 0; });
+	} else {
+		for (auto &group : groups)
+			group.Resample();
+	}
+
+	for (auto &group : groups)
+		if (group.error)
+			std::rethrow_exception(std::exchange(group.error,
+							     nullptr));
+
+	return CollectOutput();
+}
+
+ConstBuffer<void>
+ParallelPcmResampler::Flush()
+{
+	for (auto &group : groups)
+		group.Flush();
+
+	const auto result = CollectOutput();
+	if (result.empty()) {
+		/* discard the remaining output if the groups did not
+		   return the same number of frames */
+		for (auto &group : groups)
+			group.pending.clear();
+		return nullptr;
+	}
+
+	return result;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_PARALLEL_RESAMPLER_HXX
+#define MPD_PCM_PARALLEL_RESAMPLER_HXX
+
+#include "Resampler.hxx"
+#include "Buffer.hxx"
+#include "thread/Mutex.hxx"
+#include "thread/Cond.hxx"
+#include "thread/Thread.hxx"
+
+#include <cstddef>
+#include <exception>
+#include <list>
+#include <memory>
+#include <vector>
+
+/**
+ * A #PcmResampler which splits the channels into groups and resamples
+ * each group with its own #PcmResampler instance in a separate
+ * thread.  This is useful for resamplers which are single-threaded,
+ * with many channels or high sample rates.
+ *
+ * Each Resample() call hands the groups to the worker threads and
+ * waits for them, i.e. it adds the thread wake-up latency to each
+ * call.  Therefore, small buffers are resampled in the calling
+ * thread.
+ */
+class ParallelPcmResampler final : public PcmResampler {
+public:
+	typedef PcmResampler *(*Factory)();
+
+private:
+	struct Group {
+		ParallelPcmResampler &parent;
+
+		const std::unique_ptr<PcmResampler> resampler;
+
+		const unsigned first_channel, channels;
+
+		/**
+		 * The worker thread; not used for the first group,
+		 * which is resampled by the caller.
+		 */
+		Thread thread;
+
+		PcmBuffer input_buffer;
+
+		/**
+		 * The input for the current Resample() call.
+		 */
+		ConstBuffer<void> input;
+
+		/**
+		 * Resampled data which has not yet been returned,
+		 * because other groups have returned less.
+		 */
+		std::vector<std::byte> pending;
+
+		std::exception_ptr error;
+
+		/**
+		 * The last ParallelPcmResampler::generation seen by
+		 * the worker thread.
+		 */
+		unsigned generation;
+
+		Group(ParallelPcmResampler &_parent,
+		      std::unique_ptr<PcmResampler> &&_resampler,
+		      unsigned _first_channel, unsigned _channels) noexcept;
+
+		void Resample() noexcept;
+		void Flush();
+
+		void RunThread() noexcept;
+	};
+
+	const Factory factory;
+
+	const unsigned max_groups;
+
+	std::list<Group> groups;
+
+	std::size_t in_sample_size, out_sample_size;
+
+	unsigned channels;
+
+	Mutex mutex;
+	Cond wake_cond, done_cond;
+
+	/**
+	 * Incremented by each Resample() call which wakes up the
+	 * worker threads.
+	 */
+	unsigned generation = 0;
+
+	/**
+	 * The number of worker threads which are still working on
+	 * the current #generation.
+	 */
+	unsigned n_running = 0;
+
+	bool quit = false;
+
+	PcmBuffer output_buffer;
+
+public:
+	/**
+	 * @param _max_threads the maximum number of threads (and
+	 * channel groups)
+	 * @param _factory creates the #PcmResampler instance for each
+	 * group
+	 */
+	ParallelPcmResampler(unsigned _max_threads, Factory _factory) noexcept
+		:factory(_factory), max_groups(_max_threads) {}
+
+	AudioFormat Open(AudioFormat &af, unsigned new_sample_rate) override;
+	void Close() noexcept override;
+	void Reset() noexcept override;
+	ConstBuffer<void> Resample(ConstBuffer<void> src) override;
+	ConstBuffer<void> Flush() override;
+
+private:
+	void StopThreads() noexcept;
+
+	/**
+	 * Interleave the pending output of all groups.
+	 */
+	ConstBuffer<void> CollectOutput() noexcept;
+};
+
+#endif
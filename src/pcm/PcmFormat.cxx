@@ -73,47 +73,6 @@ struct Convert32To16 {
 	}
 };
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-struct PortableFloatToInteger
-	: PerSampleConvert<FloatToIntegerSampleConvert<F, Traits>> {};
-
-template<SampleFormat F, class Traits=SampleTraits<F>>
-struct FloatToInteger : PortableFloatToInteger<F, Traits> {};
-
-/**
- * A template class that attempts to use the "optimized" algorithm for
- * large portions of the buffer, and calls the "portable" algorithm"
- * for the rest when the last block is not full.
- */
-template<typename Optimized, typename Portable>
-class GlueOptimizedConvert : Optimized, Portable {
-public:
-	using SrcTraits = typename Portable::SrcTraits;
-	using DstTraits = typename Portable::DstTraits;
-
-	void Convert(typename DstTraits::pointer out,
-		     typename SrcTraits::const_pointer in,
-		     size_t n) const {
-		Optimized::Convert(out, in, n);
-
-		/* use the "portable" algorithm for the trailing
-		   samples */
-		size_t remaining = n % Optimized::BLOCK_SIZE;
-		size_t done = n - remaining;
-		Portable::Convert(out + done, in + done, remaining);
-	}
-};
-
-#ifdef __ARM_NEON__
-#include "Neon.hxx"
-
-template<>
-struct FloatToInteger<SampleFormat::S16, SampleTraits<SampleFormat::S16>>
-	: GlueOptimizedConvert<NeonFloatTo16,
-			       PortableFloatToInteger<SampleFormat::S16>> {};
-
-#endif
-
 template<class C>
 static ConstBuffer<typename C::DstTraits::value_type>
 AllocateConvert(PcmBuffer &buffer, C convert,
@@ -124,11 +83,18 @@ AllocateConvert(PcmBuffer &buffer, C convert,
 	return { dest, src.size };
 }
 
-template<SampleFormat F, class Traits=SampleTraits<F>>
-static ConstBuffer<typename Traits::value_type>
-AllocateFromFloat(PcmBuffer &buffer, ConstBuffer<float> src)
+/**
+ * Convert with one of the #PcmSimd kernels.
+ */
+template<typename D, typename S>
+static ConstBuffer<D>
+AllocateSimdConvert(PcmBuffer &buffer,
+		    void (*convert)(D *dest, const S *src, size_t n) noexcept,
+		    ConstBuffer<S> src)
 {
-	return AllocateConvert(buffer, FloatToInteger<F, Traits>(), src);
+	auto dest = buffer.GetT<D>(src.size);
+	convert(dest, src.data, src.size);
+	return { dest, src.size };
 }
 
 static ConstBuffer<int16_t>
@@ -152,14 +118,16 @@ pcm_allocate_32_to_16(PcmBuffer &buffer, PcmDither &dither,
 }
 
 static ConstBuffer<int16_t>
-pcm_allocate_float_to_16(PcmBuffer &buffer, ConstBuffer<float> src)
+pcm_allocate_float_to_16(PcmBuffer &buffer, const PcmSimd &simd,
+			 ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S16>(buffer, src);
+	return AllocateSimdConvert(buffer, simd.float_to_16, src);
 }
 
 ConstBuffer<int16_t>
 pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
-		  SampleFormat src_format, ConstBuffer<void> src) noexcept
+		  SampleFormat src_format, ConstBuffer<void> src,
+		  const PcmSimd &simd) noexcept
 {
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
@@ -182,7 +150,7 @@ pcm_convert_to_16(PcmBuffer &buffer, PcmDither &dither,
 					     ConstBuffer<int32_t>::FromVoid(src));
 
 	case SampleFormat::FLOAT:
-		return pcm_allocate_float_to_16(buffer,
+		return pcm_allocate_float_to_16(buffer, simd,
 						ConstBuffer<float>::FromVoid(src));
 	}
 
@@ -220,14 +188,16 @@ pcm_allocate_32_to_24(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 }
 
 static ConstBuffer<int32_t>
-pcm_allocate_float_to_24(PcmBuffer &buffer, ConstBuffer<float> src)
+pcm_allocate_float_to_24(PcmBuffer &buffer, const PcmSimd &simd,
+			 ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S24_P32>(buffer, src);
+	return AllocateSimdConvert(buffer, simd.float_to_24, src);
 }
 
 ConstBuffer<int32_t>
 pcm_convert_to_24(PcmBuffer &buffer,
-		  SampleFormat src_format, ConstBuffer<void> src) noexcept
+		  SampleFormat src_format, ConstBuffer<void> src,
+		  const PcmSimd &simd) noexcept
 {
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
@@ -250,7 +220,7 @@ pcm_convert_to_24(PcmBuffer &buffer,
 					     ConstBuffer<int32_t>::FromVoid(src));
 
 	case SampleFormat::FLOAT:
-		return pcm_allocate_float_to_24(buffer,
+		return pcm_allocate_float_to_24(buffer, simd,
 						ConstBuffer<float>::FromVoid(src));
 	}
 
@@ -288,14 +258,16 @@ pcm_allocate_24p32_to_32(PcmBuffer &buffer, ConstBuffer<int32_t> src)
 }
 
 static ConstBuffer<int32_t>
-pcm_allocate_float_to_32(PcmBuffer &buffer, ConstBuffer<float> src)
+pcm_allocate_float_to_32(PcmBuffer &buffer, const PcmSimd &simd,
+			 ConstBuffer<float> src)
 {
-	return AllocateFromFloat<SampleFormat::S32>(buffer, src);
+	return AllocateSimdConvert(buffer, simd.float_to_32, src);
 }
 
 ConstBuffer<int32_t>
 pcm_convert_to_32(PcmBuffer &buffer,
-		  SampleFormat src_format, ConstBuffer<void> src) noexcept
+		  SampleFormat src_format, ConstBuffer<void> src,
+		  const PcmSimd &simd) noexcept
 {
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
@@ -318,7 +290,7 @@ pcm_convert_to_32(PcmBuffer &buffer,
 		return ConstBuffer<int32_t>::FromVoid(src);
 
 	case SampleFormat::FLOAT:
-		return pcm_allocate_float_to_32(buffer,
+		return pcm_allocate_float_to_32(buffer, simd,
 						ConstBuffer<float>::FromVoid(src));
 	}
 
@@ -328,14 +300,6 @@ pcm_convert_to_32(PcmBuffer &buffer,
 struct Convert8ToFloat
 	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S8>> {};
 
-struct Convert16ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S16>> {};
-
-struct Convert24ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S24_P32>> {};
-
-struct Convert32ToFloat
-	: PerSampleConvert<IntegerToFloatSampleConvert<SampleFormat::S32>> {};
 
 static ConstBuffer<float>
 pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
@@ -344,26 +308,30 @@ pcm_allocate_8_to_float(PcmBuffer &buffer, ConstBuffer<int8_t> src)
 }
 
 static ConstBuffer<float>
-pcm_allocate_16_to_float(PcmBuffer &buffer, ConstBuffer<int16_t> src)
+pcm_allocate_16_to_float(PcmBuffer &buffer, const PcmSimd &simd,
+			 ConstBuffer<int16_t> src)
 {
-	return AllocateConvert(buffer, Convert16ToFloat(), src);
+	return AllocateSimdConvert(buffer, simd.s16_to_float, src);
 }
 
 static ConstBuffer<float>
-pcm_allocate_24p32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
+pcm_allocate_24p32_to_float(PcmBuffer &buffer, const PcmSimd &simd,
+			    ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert24ToFloat(), src);
+	return AllocateSimdConvert(buffer, simd.s24_to_float, src);
 }
 
 static ConstBuffer<float>
-pcm_allocate_32_to_float(PcmBuffer &buffer, ConstBuffer<int32_t> src)
+pcm_allocate_32_to_float(PcmBuffer &buffer, const PcmSimd &simd,
+			 ConstBuffer<int32_t> src)
 {
-	return AllocateConvert(buffer, Convert32ToFloat(), src);
+	return AllocateSimdConvert(buffer, simd.s32_to_float, src);
 }
 
 ConstBuffer<float>
 pcm_convert_to_float(PcmBuffer &buffer,
-		     SampleFormat src_format, ConstBuffer<void> src) noexcept
+		     SampleFormat src_format, ConstBuffer<void> src,
+		     const PcmSimd &simd) noexcept
 {
 	switch (src_format) {
 	case SampleFormat::UNDEFINED:
@@ -375,15 +343,15 @@ pcm_convert_to_float(PcmBuffer &buffer,
 					       ConstBuffer<int8_t>::FromVoid(src));
 
 	case SampleFormat::S16:
-		return pcm_allocate_16_to_float(buffer,
+		return pcm_allocate_16_to_float(buffer, simd,
 					       ConstBuffer<int16_t>::FromVoid(src));
 
 	case SampleFormat::S32:
-		return pcm_allocate_32_to_float(buffer,
+		return pcm_allocate_32_to_float(buffer, simd,
 					       ConstBuffer<int32_t>::FromVoid(src));
 
 	case SampleFormat::S24_P32:
-		return pcm_allocate_24p32_to_float(buffer,
+		return pcm_allocate_24p32_to_float(buffer, simd,
 						   ConstBuffer<int32_t>::FromVoid(src));
 
 	case SampleFormat::FLOAT:
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Simd.hxx"
+#include "Volume.hxx"
+#include "Traits.hxx"
+#include "FloatConvert.hxx"
+#include "util/TransformN.hxx"
+
+#include <atomic>
+
+#ifdef __ARM_NEON__
+#include "Neon.hxx"
+#endif
+
+#if GCC_OLDER_THAN(8,0)
+/* GCC 6.3 emits this bogus warning in PcmVolumeConvert() because it
+   checks an unreachable branch */
+#pragma GCC diagnostic ignored "-Wshift-count-overflow"
+#endif
+
+/**
+ * Apply software volume, converting to a different sample type.
+ */
+template<SampleFormat SF, SampleFormat DF,
+	 class STraits=SampleTraits<SF>,
+	 class DTraits=SampleTraits<DF>>
+#if !GCC_OLDER_THAN(8,0)
+constexpr
+#endif
+static typename DTraits::value_type
+PcmVolumeConvert(typename STraits::value_type _sample, int volume) noexcept
+{
+	typename STraits::long_type sample(_sample);
+	sample *= volume;
+
+	static_assert(DTraits::BITS > STraits::BITS,
+		      "Destination sample must be larger than source sample");
+
+	/* after multiplying with the volume value, the "sample"
+	   variable contains this number of precision bits: source
+	   bits plus the volume bits */
+	constexpr unsigned BITS = STraits::BITS + PCM_VOLUME_BITS;
+
+	/* .. and now we need to scale to the requested destination
+	   bits */
+
+	typename DTraits::value_type result;
+	if (BITS > DTraits::BITS)
+		result = sample >> (BITS - DTraits::BITS);
+	else if (BITS < DTraits::BITS)
+		result = sample << (DTraits::BITS - BITS);
+	else
+		result = sample;
+
+	return result;
+}
+
+static void
+PortableVolumeFloat(float *dest, const float *src, size_t n,
+		    float volume) noexcept
+{
+	transform_n(src, n, dest,
+		    [volume](float x){ return x * volume; });
+}
+
+static void
+PortableVolume16To24(int32_t *dest, const int16_t *src, size_t n,
+		     int volume) noexcept
+{
+	transform_n(src, n, dest,
+		    [volume](auto x){
+			    return PcmVolumeConvert<SampleFormat::S16,
+						    SampleFormat::S24_P32>(x,
+									   volume);
+		    });
+}
+
+static void
+PortableMixFloat(float *a, const float *b, size_t n,
+		 float volume1, float volume2) noexcept
+{
+	for (size_t i = 0; i != n; ++i)
+		a[i] = a[i] * volume1 + b[i] * volume2;
+}
+
+static void
+PortableAddFloat(float *a, const float *b, size_t n) noexcept
+{
+	for (size_t i = 0; i != n; ++i)
+		a[i] = a[i] + b[i];
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+PortableFromFloat(typename Traits::pointer dest, const float *src,
+		  size_t n) noexcept
+{
+	transform_n(src, n, dest,
+		    FloatToIntegerSampleConvert<F, Traits>::Convert);
+}
+
+static void
+PortableFloatTo16(int16_t *dest, const float *src, size_t n) noexcept
+{
+#ifdef __ARM_NEON__
+	NeonFloatTo16().Convert(dest, src, n);
+
+	/* use the portable algorithm for the trailing samples */
+	const size_t done = n - n % NeonFloatTo16::BLOCK_SIZE;
+	dest += done;
+	src += done;
+	n -= done;
+#endif
+
+	PortableFromFloat<SampleFormat::S16>(dest, src, n);
+}
+
+template<SampleFormat F, class Traits=SampleTraits<F>>
+static void
+PortableToFloat(float *dest, typename Traits::const_pointer src,
+		size_t n) noexcept
+{
+	transform_n(src, n, dest,
+		    IntegerToFloatSampleConvert<F, Traits>::Convert);
+}
+
+static float
+PortableDotFloat(const float *a, const float *b, size_t n) noexcept
+{
+	float sum = 0;
+	for (size_t i = 0; i != n; ++i)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+const PcmSimd pcm_simd_portable = {
+	PcmSimdLevel::PORTABLE,
+	"portable",
+	PortableVolumeFloat,
+	PortableVolume16To24,
+	PortableMixFloat,
+	PortableAddFloat,
+	PortableFloatTo16,
+	PortableFromFloat<SampleFormat::S24_P32>,
+	PortableFromFloat<SampleFormat::S32>,
+	PortableToFloat<SampleFormat::S16>,
+	PortableToFloat<SampleFormat::S24_P32>,
+	PortableToFloat<SampleFormat::S32>,
+	PortableDotFloat,
+};
+
+#ifdef __x86_64__
+
+gcc_const
+static bool
+HaveAvx2() noexcept
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+const PcmSimd *
+GetPcmSimd(PcmSimdLevel level) noexcept
+{
+	switch (level) {
+	case PcmSimdLevel::PORTABLE:
+		return &pcm_simd_portable;
+
+	case PcmSimdLevel::SSE2:
+#ifdef __x86_64__
+		return &pcm_simd_sse2;
+#else
+		break;
+#endif
+
+	case PcmSimdLevel::AVX2:
+#ifdef __x86_64__
+		if (HaveAvx2())
+			return &pcm_simd_avx2;
+#endif
+		break;
+	}
+
+	return nullptr;
+}
+
+static const PcmSimd &
+DetectPcmSimd() noexcept
+{
+	for (auto level : {PcmSimdLevel::AVX2, PcmSimdLevel::SSE2}) {
+		const auto *simd = GetPcmSimd(level);
+		if (simd != nullptr)
+			return *simd;
+	}
+
+	return pcm_simd_portable;
+}
+
+const PcmSimd &
+SelectPcmSimd() noexcept
+{
+	/* this is called from several threads, and MPD is built
+	   with -fno-threadsafe-statics, so a static initialized by
+	   DetectPcmSimd() would be racy; this atomic is
+	   constant-initialized, and if two threads race here, both
+	   store the same pointer */
+	static std::atomic<const PcmSimd *> selected{nullptr};
+
+	const PcmSimd *simd = selected.load(std::memory_order_relaxed);
+	if (simd == nullptr) {
+		simd = &DetectPcmSimd();
+		selected.store(simd, std::memory_order_relaxed);
+	}
+
+	return *simd;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SIMD_HXX
+#define MPD_PCM_SIMD_HXX
+
+#include "util/Compiler.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * An instruction set for which a #PcmSimd implementation exists.
+ */
+enum class PcmSimdLevel : uint8_t {
+	/**
+	 * Plain C++ code (which may still use compile-time SIMD
+	 * extensions such as ARM NEON).
+	 */
+	PORTABLE,
+
+	/**
+	 * x86-64 SSE2 (always available on x86-64).
+	 */
+	SSE2,
+
+	/**
+	 * x86-64 AVX2 (detected at runtime).
+	 */
+	AVX2,
+};
+
+/**
+ * A table of PCM kernels for one instruction set.  All
+ * implementations produce exactly the same results as the portable
+ * implementation.
+ *
+ * Dithering (see #PcmDither) is not part of this table: its error
+ * feedback makes each sample depend on the previous one, so it
+ * cannot be vectorized.
+ */
+struct PcmSimd {
+	PcmSimdLevel level;
+
+	const char *name;
+
+	/**
+	 * dest[i] = src[i] * volume
+	 */
+	void (*volume_float)(float *dest, const float *src, size_t n,
+			     float volume) noexcept;
+
+	/**
+	 * Apply an integer volume (see #PCM_VOLUME_1) to 16 bit
+	 * samples, converting them to 24 bit (see PcmVolume::Open()).
+	 */
+	void (*volume_16_to_24)(int32_t *dest, const int16_t *src, size_t n,
+				int volume) noexcept;
+
+	/**
+	 * a[i] = a[i] * volume1 + b[i] * volume2
+	 */
+	void (*mix_float)(float *a, const float *b, size_t n,
+			  float volume1, float volume2) noexcept;
+
+	/**
+	 * a[i] = a[i] + b[i]
+	 */
+	void (*add_float)(float *a, const float *b, size_t n) noexcept;
+
+	void (*float_to_16)(int16_t *dest, const float *src,
+			    size_t n) noexcept;
+	void (*float_to_24)(int32_t *dest, const float *src,
+			    size_t n) noexcept;
+	void (*float_to_32)(int32_t *dest, const float *src,
+			    size_t n) noexcept;
+
+	void (*s16_to_float)(float *dest, const int16_t *src,
+			     size_t n) noexcept;
+	void (*s24_to_float)(float *dest, const int32_t *src,
+			     size_t n) noexcept;
+	void (*s32_to_float)(float *dest, const int32_t *src,
+			     size_t n) noexcept;
+
+	/**
+	 * Returns the sum of a[i] * b[i].
+	 *
+	 * Unlike the other kernels, the result is not exactly the
+	 * same in all implementations, because they add the products
+	 * in a different order.
+	 */
+	float (*dot_float)(const float *a, const float *b,
+			   size_t n) noexcept;
+};
+
+/**
+ * Returns the #PcmSimd implementation for the given level, or nullptr
+ * if it was not compiled or is not supported by this CPU.
+ */
+const PcmSimd *
+GetPcmSimd(PcmSimdLevel level) noexcept;
+
+/**
+ * Returns the fastest #PcmSimd implementation supported by this CPU.
+ * The CPU features are detected only once.
+ */
+const PcmSimd &
+SelectPcmSimd() noexcept;
+
+extern const PcmSimd pcm_simd_portable;
+
+#ifdef __x86_64__
+extern const PcmSimd pcm_simd_sse2;
+extern const PcmSimd pcm_simd_avx2;
+#endif
+
+#endif
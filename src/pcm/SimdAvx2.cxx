@@ -0,0 +1,240 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * AVX2 implementation of #PcmSimd.  The functions are compiled with
+ * the "avx2" target attribute and must only be called after
+ * GetPcmSimd() has verified that the CPU supports AVX2.
+ */
+
+#include "Simd.hxx"
+#include "Volume.hxx"
+
+#include <immintrin.h>
+
+#include <cstdint>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET
+static void
+Avx2VolumeFloat(float *dest, const float *src, size_t n,
+		float volume) noexcept
+{
+	const __m256 v = _mm256_set1_ps(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(src + i), v));
+
+	pcm_simd_sse2.volume_float(dest + i, src + i, n - i, volume);
+}
+
+AVX2_TARGET
+static void
+Avx2Volume16To24(int32_t *dest, const int16_t *src, size_t n,
+		 int volume) noexcept
+{
+	/* see PcmVolumeConvert() */
+	constexpr int shift = 16 + PCM_VOLUME_BITS - 24;
+
+	const __m256i v = _mm256_set1_epi32(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		x = _mm256_srai_epi32(_mm256_mullo_epi32(x, v), shift);
+		_mm256_storeu_si256((__m256i *)(dest + i), x);
+	}
+
+	pcm_simd_portable.volume_16_to_24(dest + i, src + i, n - i, volume);
+}
+
+AVX2_TARGET
+static void
+Avx2MixFloat(float *a, const float *b, size_t n,
+	     float volume1, float volume2) noexcept
+{
+	const __m256 v1 = _mm256_set1_ps(volume1);
+	const __m256 v2 = _mm256_set1_ps(volume2);
+
+	/* no FMA here: it would round differently than the
+	   portable implementation */
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(a + i), v1);
+		const __m256 y = _mm256_mul_ps(_mm256_loadu_ps(b + i), v2);
+		_mm256_storeu_ps(a + i, _mm256_add_ps(x, y));
+	}
+
+	pcm_simd_sse2.mix_float(a + i, b + i, n - i, volume1, volume2);
+}
+
+AVX2_TARGET
+static void
+Avx2AddFloat(float *a, const float *b, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(a + i,
+				 _mm256_add_ps(_mm256_loadu_ps(a + i),
+					       _mm256_loadu_ps(b + i)));
+
+	pcm_simd_sse2.add_float(a + i, b + i, n - i);
+}
+
+/**
+ * Scale and clamp like FloatToIntegerSampleConvert, and truncate
+ * to 32 bit integers.
+ */
+template<unsigned BITS>
+AVX2_TARGET
+static inline __m256i
+Avx2FromFloat(__m256 x) noexcept
+{
+	constexpr float factor = uint32_t(1) << (BITS - 1);
+	const __m256 min = _mm256_set1_ps(-factor);
+	const __m256 max = _mm256_set1_ps(float(int32_t((uint32_t(1) << (BITS - 1)) - 1)));
+
+	x = _mm256_mul_ps(x, _mm256_set1_ps(factor));
+
+	if (BITS < 32) {
+		x = _mm256_max_ps(_mm256_min_ps(x, max), min);
+		return _mm256_cvttps_epi32(x);
+	}
+
+	/* see Sse2FromFloat() */
+	const __m256i overflow =
+		_mm256_castps_si256(_mm256_cmp_ps(x, max, _CMP_GE_OQ));
+	x = _mm256_max_ps(x, min);
+	return _mm256_xor_si256(_mm256_cvttps_epi32(x), overflow);
+}
+
+AVX2_TARGET
+static void
+Avx2FloatTo16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m256i lo = Avx2FromFloat<16>(_mm256_loadu_ps(src + i));
+		const __m256i hi = Avx2FromFloat<16>(_mm256_loadu_ps(src + i + 8));
+
+		/* _mm256_packs_epi32() works on each 128 bit lane;
+		   restore the sample order afterwards */
+		__m256i packed = _mm256_packs_epi32(lo, hi);
+		packed = _mm256_permute4x64_epi64(packed, 0xd8);
+		_mm256_storeu_si256((__m256i *)(dest + i), packed);
+	}
+
+	pcm_simd_sse2.float_to_16(dest + i, src + i, n - i);
+}
+
+template<unsigned BITS>
+AVX2_TARGET
+static void
+Avx2FloatTo32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    Avx2FromFloat<BITS>(_mm256_loadu_ps(src + i)));
+
+	if (BITS == 24)
+		pcm_simd_sse2.float_to_24(dest + i, src + i, n - i);
+	else
+		pcm_simd_sse2.float_to_32(dest + i, src + i, n - i);
+}
+
+AVX2_TARGET
+static void
+Avx2S16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(1.0f / (1 << 15));
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), factor));
+	}
+
+	pcm_simd_sse2.s16_to_float(dest + i, src + i, n - i);
+}
+
+template<unsigned BITS>
+AVX2_TARGET
+static void
+Avx2S32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	const __m256 factor = _mm256_set1_ps(1.0f / float(uint32_t(1) << (BITS - 1)));
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(x), factor));
+	}
+
+	if (BITS == 24)
+		pcm_simd_sse2.s24_to_float(dest + i, src + i, n - i);
+	else
+		pcm_simd_sse2.s32_to_float(dest + i, src + i, n - i);
+}
+
+AVX2_TARGET
+static float
+Avx2DotFloat(const float *a, const float *b, size_t n) noexcept
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+
+	/* two accumulators to hide the latency of the additions */
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+							 _mm256_loadu_ps(b + i)));
+		sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+							 _mm256_loadu_ps(b + i + 8)));
+	}
+
+	const __m256 sum = _mm256_add_ps(sum0, sum1);
+	const __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum),
+				       _mm256_extractf128_ps(sum, 1));
+
+	float sums[4];
+	_mm_storeu_ps(sums, sum4);
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]) +
+		pcm_simd_sse2.dot_float(a + i, b + i, n - i);
+}
+
+const PcmSimd pcm_simd_avx2 = {
+	PcmSimdLevel::AVX2,
+	"avx2",
+	Avx2VolumeFloat,
+	Avx2Volume16To24,
+	Avx2MixFloat,
+	Avx2AddFloat,
+	Avx2FloatTo16,
+	Avx2FloatTo32<24>,
+	Avx2FloatTo32<32>,
+	Avx2S16ToFloat,
+	Avx2S32ToFloat<24>,
+	Avx2S32ToFloat<32>,
+	Avx2DotFloat,
+};
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * SSE2 implementation of #PcmSimd.  SSE2 is part of the x86-64
+ * baseline, so this file is compiled without special flags.
+ */
+
+#include "Simd.hxx"
+#include "Volume.hxx"
+
+#include <emmintrin.h>
+
+#include <cstdint>
+
+static void
+Sse2VolumeFloat(float *dest, const float *src, size_t n,
+		float volume) noexcept
+{
+	const __m128 v = _mm_set1_ps(volume);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(src + i), v));
+
+	pcm_simd_portable.volume_float(dest + i, src + i, n - i, volume);
+}
+
+static void
+Sse2Volume16To24(int32_t *dest, const int16_t *src, size_t n,
+		 int volume) noexcept
+{
+	/* see PcmVolumeConvert() */
+	constexpr int shift = 16 + PCM_VOLUME_BITS - 24;
+
+	size_t i = 0;
+
+	/* _mm_madd_epi16() needs a 16 bit volume */
+	if (volume >= 0 && volume <= INT16_MAX) {
+		/* each 32 bit lane contains the 16 bit pair
+		   (volume, 0); multiplied with (sample, 0), this
+		   yields a sign-correct 32 bit product */
+		const __m128i v = _mm_set1_epi32(volume);
+		const __m128i zero = _mm_setzero_si128();
+
+		for (; i + 8 <= n; i += 8) {
+			const __m128i x =
+				_mm_loadu_si128((const __m128i *)(src + i));
+
+			__m128i lo = _mm_unpacklo_epi16(x, zero);
+			__m128i hi = _mm_unpackhi_epi16(x, zero);
+			lo = _mm_srai_epi32(_mm_madd_epi16(lo, v), shift);
+			hi = _mm_srai_epi32(_mm_madd_epi16(hi, v), shift);
+
+			_mm_storeu_si128((__m128i *)(dest + i), lo);
+			_mm_storeu_si128((__m128i *)(dest + i + 4), hi);
+		}
+	}
+
+	pcm_simd_portable.volume_16_to_24(dest + i, src + i, n - i, volume);
+}
+
+static void
+Sse2MixFloat(float *a, const float *b, size_t n,
+	     float volume1, float volume2) noexcept
+{
+	const __m128 v1 = _mm_set1_ps(volume1), v2 = _mm_set1_ps(volume2);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128 x = _mm_mul_ps(_mm_loadu_ps(a + i), v1);
+		const __m128 y = _mm_mul_ps(_mm_loadu_ps(b + i), v2);
+		_mm_storeu_ps(a + i, _mm_add_ps(x, y));
+	}
+
+	pcm_simd_portable.mix_float(a + i, b + i, n - i, volume1, volume2);
+}
+
+static void
+Sse2AddFloat(float *a, const float *b, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i),
+						_mm_loadu_ps(b + i)));
+
+	pcm_simd_portable.add_float(a + i, b + i, n - i);
+}
+
+/**
+ * Scale and clamp like FloatToIntegerSampleConvert, and truncate
+ * to 32 bit integers.
+ */
+template<unsigned BITS>
+static inline __m128i
+Sse2FromFloat(__m128 x) noexcept
+{
+	constexpr float factor = uint32_t(1) << (BITS - 1);
+	const __m128 min = _mm_set1_ps(-factor);
+	const __m128 max = _mm_set1_ps(float(int32_t((uint32_t(1) << (BITS - 1)) - 1)));
+
+	x = _mm_mul_ps(x, _mm_set1_ps(factor));
+
+	if (BITS < 32) {
+		x = _mm_max_ps(_mm_min_ps(x, max), min);
+		return _mm_cvttps_epi32(x);
+	}
+
+	/* the maximum (2^31-1) cannot be represented as float;
+	   _mm_cvttps_epi32() returns 0x80000000 for all values which
+	   are too large, and XOR with the comparison mask turns that
+	   into 0x7fffffff */
+	const __m128i overflow = _mm_castps_si128(_mm_cmpge_ps(x, max));
+	x = _mm_max_ps(x, min);
+	return _mm_xor_si128(_mm_cvttps_epi32(x), overflow);
+}
+
+static void
+Sse2FloatTo16(int16_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i lo = Sse2FromFloat<16>(_mm_loadu_ps(src + i));
+		const __m128i hi = Sse2FromFloat<16>(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 _mm_packs_epi32(lo, hi));
+	}
+
+	pcm_simd_portable.float_to_16(dest + i, src + i, n - i);
+}
+
+template<unsigned BITS>
+static void
+Sse2FloatTo32(int32_t *dest, const float *src, size_t n) noexcept
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 Sse2FromFloat<BITS>(_mm_loadu_ps(src + i)));
+
+	if (BITS == 24)
+		pcm_simd_portable.float_to_24(dest + i, src + i, n - i);
+	else
+		pcm_simd_portable.float_to_32(dest + i, src + i, n - i);
+}
+
+static void
+Sse2S16ToFloat(float *dest, const int16_t *src, size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(1.0f / (1 << 15));
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* sign-extend to 32 bit */
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_cvtepi32_ps(lo), factor));
+		_mm_storeu_ps(dest + i + 4,
+			      _mm_mul_ps(_mm_cvtepi32_ps(hi), factor));
+	}
+
+	pcm_simd_portable.s16_to_float(dest + i, src + i, n - i);
+}
+
+template<unsigned BITS>
+static void
+Sse2S32ToFloat(float *dest, const int32_t *src, size_t n) noexcept
+{
+	const __m128 factor = _mm_set1_ps(1.0f / float(uint32_t(1) << (BITS - 1)));
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_cvtepi32_ps(x), factor));
+	}
+
+	if (BITS == 24)
+		pcm_simd_portable.s24_to_float(dest + i, src + i, n - i);
+	else
+		pcm_simd_portable.s32_to_float(dest + i, src + i, n - i);
+}
+
+static float
+Sse2DotFloat(const float *a, const float *b, size_t n) noexcept
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i),
+						   _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+						   _mm_loadu_ps(b + i + 4)));
+	}
+
+	float sum[4];
+	_mm_storeu_ps(sum, _mm_add_ps(sum0, sum1));
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]) +
+		pcm_simd_portable.dot_float(a + i, b + i, n - i);
+}
+
+const PcmSimd pcm_simd_sse2 = {
+	PcmSimdLevel::SSE2,
+	"sse2",
+	Sse2VolumeFloat,
+	Sse2Volume16To24,
+	Sse2MixFloat,
+	Sse2AddFloat,
+	Sse2FloatTo16,
+	Sse2FloatTo32<24>,
+	Sse2FloatTo32<32>,
+	Sse2S16ToFloat,
+	Sse2S32ToFloat<24>,
+	Sse2S32ToFloat<32>,
+	Sse2DotFloat,
+};
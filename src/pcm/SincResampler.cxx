@@ -0,0 +1,389 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SincResampler.hxx"
+#include "Simd.hxx"
+#include "AudioFormat.hxx"
+#include "config/Block.hxx"
+#include "thread/Mutex.hxx"
+#include "util/RuntimeError.hxx"
+#include "util/Domain.hxx"
+#include "Log.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <numeric>
+
+#include <string.h>
+
+static constexpr Domain sinc_domain("sinc");
+
+struct SincQuality {
+	const char *name;
+
+	/**
+	 * The length of the filter in input frames (when
+	 * upsampling).
+	 */
+	unsigned taps;
+
+	/**
+	 * The cutoff frequency relative to the Nyquist frequency of
+	 * the lower sample rate.  It is chosen so the transition band
+	 * ends at the Nyquist frequency.
+	 */
+	double cutoff;
+
+	/**
+	 * The Kaiser window parameter; it determines the stopband
+	 * attenuation (roughly 8.7 + beta / 0.1102 dB).
+	 */
+	double beta;
+};
+
+static constexpr SincQuality sinc_quality_table[] = {
+	{ "very high", 128, 0.94, 12.0 },
+	{ "high", 64, 0.90, 9.5 },
+	{ "medium", 32, 0.85, 7.0 },
+	{ "low", 16, 0.78, 5.0 },
+};
+
+static const SincQuality *sinc_quality = &sinc_quality_table[1];
+
+/**
+ * If the reduced output rate (see SincFilter::l) is larger than
+ * this, then the filter table has only #SINC_INTERPOLATED_PHASES
+ * phases, and coefficients between them are interpolated linearly.
+ */
+static constexpr unsigned SINC_MAX_EXACT_PHASES = 2048;
+
+static constexpr unsigned SINC_INTERPOLATED_PHASES = 1024;
+
+/**
+ * The number of filter tables kept by SincFilter::Get().
+ */
+static constexpr std::size_t SINC_CACHE_SIZE = 4;
+
+struct SincFilter {
+	const unsigned in_rate, out_rate;
+
+	const SincQuality &quality;
+
+	/**
+	 * The conversion ratio reduced to lowest terms: #l output
+	 * frames for #m input frames.
+	 */
+	unsigned l, m;
+
+	/**
+	 * The number of coefficients per phase; a multiple of 8 for
+	 * PcmSimd::dot_float().
+	 */
+	unsigned taps;
+
+	/**
+	 * The number of phases.  If this is less than #l, then the
+	 * table contains one more row (the first phase shifted by
+	 * one input frame) for interpolating the last phase.
+	 */
+	unsigned phases;
+
+	std::vector<float> coefficients;
+
+	SincFilter(unsigned _in_rate, unsigned _out_rate,
+		   const SincQuality &_quality) noexcept;
+
+	bool IsInterpolated() const noexcept {
+		return phases < l;
+	}
+
+	const float *GetRow(unsigned i) const noexcept {
+		return coefficients.data() + std::size_t(i) * taps;
+	}
+
+	/**
+	 * Obtain the (cached) filter for the given sample rates with
+	 * the configured quality.
+	 */
+	static std::shared_ptr<const SincFilter> Get(unsigned in_rate,
+						     unsigned out_rate) noexcept;
+};
+
+/**
+ * The modified Bessel function of the first kind, order 0.
+ */
+gcc_const
+static double
+BesselI0(double x) noexcept
+{
+	const double y = x * x / 4;
+	double sum = 1, term = 1;
+
+	for (unsigned k = 1; term > sum * 1e-17; ++k) {
+		term *= y / (double(k) * double(k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+SincFilter::SincFilter(unsigned _in_rate, unsigned _out_rate,
+		       const SincQuality &_quality) noexcept
+	:in_rate(_in_rate), out_rate(_out_rate), quality(_quality)
+{
+	const unsigned g = std::gcd(in_rate, out_rate);
+	l = out_rate / g;
+	m = in_rate / g;
+
+	/* when downsampling, the cutoff frequency is lowered to the
+	   output's Nyquist frequency, and the filter gets wider */
+	const double scale = std::min(1.0, double(out_rate) / in_rate);
+	const double cutoff = quality.cutoff * scale;
+
+	taps = unsigned(std::ceil(quality.taps / scale));
+	taps = (taps + 7) & ~7u;
+
+	phases = l <= SINC_MAX_EXACT_PHASES ? l : SINC_INTERPOLATED_PHASES;
+	const unsigned rows = IsInterpolated() ? phases + 1 : phases;
+
+	coefficients.resize(std::size_t(rows) * taps);
+
+	const double half = taps / 2;
+	const double i0_beta = BesselI0(quality.beta);
+	std::vector<double> row(taps);
+
+	for (unsigned p = 0; p < rows; ++p) {
+		/* the position of the output frame after the first
+		   input frame of the window is half-1+offset */
+		const double offset = double(p) / phases;
+
+		double sum = 0;
+		for (unsigned k = 0; k < taps; ++k) {
+			const double u = offset + half - 1 - k;
+			const double r = u / half;
+			const double window = r * r < 1
+				? BesselI0(quality.beta * std::sqrt(1 - r * r)) / i0_beta
+				: 0;
+
+			const double x = M_PI * cutoff * u;
+			const double sinc = x == 0 ? 1 : std::sin(x) / x;
+
+			row[k] = cutoff * sinc * window;
+			sum += row[k];
+		}
+
+		/* normalize to unity DC gain, so all phases have the
+		   same gain */
+		float *dest = coefficients.data() + std::size_t(p) * taps;
+		for (unsigned k = 0; k < taps; ++k)
+			dest[k] = float(row[k] / sum);
+	}
+}
+
+static Mutex sinc_cache_mutex;
+
+/**
+ * The most recently used filter is at the front.
+ */
+static std::list<std::shared_ptr<const SincFilter>> sinc_cache;
+
+std::shared_ptr<const SincFilter>
+SincFilter::Get(unsigned in_rate, unsigned out_rate) noexcept
+{
+	const std::lock_guard<Mutex> lock(sinc_cache_mutex);
+
+	for (auto i = sinc_cache.begin(); i != sinc_cache.end(); ++i) {
+		const auto &f = **i;
+		if (f.in_rate == in_rate && f.out_rate == out_rate &&
+		    &f.quality == sinc_quality) {
+			sinc_cache.splice(sinc_cache.begin(), sinc_cache, i);
+			return sinc_cache.front();
+		}
+	}
+
+	sinc_cache.push_front(std::make_shared<const SincFilter>(in_rate,
+								 out_rate,
+								 *sinc_quality));
+	if (sinc_cache.size() > SINC_CACHE_SIZE)
+		sinc_cache.pop_back();
+
+	return sinc_cache.front();
+}
+
+void
+pcm_resample_sinc_global_init(const ConfigBlock &block)
+{
+	const char *quality = block.GetBlockValue("quality");
+	if (quality != nullptr) {
+		auto i = std::find_if(std::begin(sinc_quality_table),
+				      std::end(sinc_quality_table),
+				      [quality](const SincQuality &q){
+					      return strcmp(q.name, quality) == 0;
+				      });
+		if (i == std::end(sinc_quality_table))
+			throw FormatRuntimeError("unknown quality setting '%s' in line %d",
+						 quality, block.line);
+
+		sinc_quality = &*i;
+	}
+
+	FormatDebug(sinc_domain, "sinc converter '%s'", sinc_quality->name);
+}
+
+AudioFormat
+SincPcmResampler::Open(AudioFormat &af, unsigned new_sample_rate)
+{
+	assert(af.IsValid());
+	assert(audio_valid_sample_rate(new_sample_rate));
+
+	filter = SincFilter::Get(af.sample_rate, new_sample_rate);
+	simd = &SelectPcmSimd();
+	channels = af.channels;
+
+	FormatDebug(sinc_domain, "%u:%u taps=%u phases=%u%s",
+		    filter->m, filter->l, filter->taps, filter->phases,
+		    filter->IsInterpolated() ? " (interpolated)" : "");
+
+	/* the filter works with floating point samples */
+	af.format = SampleFormat::FLOAT;
+
+	history.resize(channels);
+	Reset();
+
+	AudioFormat result = af;
+	result.sample_rate = new_sample_rate;
+	return result;
+}
+
+void
+SincPcmResampler::Close() noexcept
+{
+	filter.reset();
+	history.clear();
+}
+
+void
+SincPcmResampler::Reset() noexcept
+{
+	/* start with silence, so the first output frame is centered
+	   on the first input frame */
+	for (auto &h : history)
+		h.assign(filter->taps / 2 - 1, 0.0f);
+
+	position = 0;
+	phase = 0;
+	flushed = false;
+}
+
+inline ConstBuffer<float>
+SincPcmResampler::Process() noexcept
+{
+	const SincFilter &f = *filter;
+	const std::size_t available = history.front().size();
+
+	const std::size_t max_frames = available >= position
+		? std::size_t(uint64_t(available - position) * f.l / f.m + 1)
+		: 0;
+	float *const dest = buffer.GetT<float>(max_frames * channels);
+	float *p = dest;
+
+	const unsigned step = f.m / f.l, phase_step = f.m % f.l;
+
+	while (position + f.taps <= available) {
+		if (f.IsInterpolated()) {
+			const uint64_t x = uint64_t(phase) * f.phases;
+			const unsigned i = x / f.l;
+			const float t = float(x % f.l) / float(f.l);
+			const float *row0 = f.GetRow(i), *row1 = f.GetRow(i + 1);
+
+			for (const auto &h : history) {
+				const float *src = h.data() + position;
+				const float a = simd->dot_float(src, row0, f.taps);
+				const float b = simd->dot_float(src, row1, f.taps);
+				*p++ = a + (b - a) * t;
+			}
+		} else {
+			const float *row = f.GetRow(phase);
+
+			for (const auto &h : history)
+				*p++ = simd->dot_float(h.data() + position,
+						       row, f.taps);
+		}
+
+		position += step;
+		phase += phase_step;
+		if (phase >= f.l) {
+			phase -= f.l;
+			++position;
+		}
+	}
+
+	assert(std::size_t(p - dest) <= max_frames * channels);
+
+	/* discard the input frames which are not needed anymore */
+	const std::size_t consumed = std::min(position, available);
+	for (auto &h : history)
+		h.erase(h.begin(), std::next(h.begin(), consumed));
+	position -= consumed;
+
+	return {dest, std::size_t(p - dest)};
+}
+
+ConstBuffer<void>
+SincPcmResampler::Resample(ConstBuffer<void> _src)
+{
+	const auto src = ConstBuffer<float>::FromVoid(_src);
+	assert(src.size % channels == 0);
+
+	const std::size_t n_frames = src.size / channels;
+
+	for (unsigned c = 0; c < channels; ++c) {
+		auto &h = history[c];
+		const std::size_t old_size = h.size();
+		h.resize(old_size + n_frames);
+
+		for (std::size_t i = 0; i < n_frames; ++i)
+			h[old_size + i] = src[i * channels + c];
+	}
+
+	return Process().ToVoid();
+}
+
+ConstBuffer<void>
+SincPcmResampler::Flush()
+{
+	if (flushed)
+		return nullptr;
+
+	flushed = true;
+
+	/* append silence, so the last input frames reach the center
+	   of the filter window */
+	for (auto &h : history)
+		h.resize(h.size() + filter->taps / 2, 0.0f);
+
+	const auto result = Process();
+	if (result.empty())
+		return nullptr;
+
+	return result.ToVoid();
+}
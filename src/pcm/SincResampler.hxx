@@ -0,0 +1,91 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_PCM_SINC_RESAMPLER_HXX
+#define MPD_PCM_SINC_RESAMPLER_HXX
+
+#include "Resampler.hxx"
+#include "Buffer.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct ConfigBlock;
+struct PcmSimd;
+struct SincFilter;
+
+/**
+ * A resampler which applies a Kaiser-windowed sinc filter.  It does
+ * not need an external library.
+ *
+ * The filter is split into polyphase tables: one row of coefficients
+ * for each fractional position of an output frame between two input
+ * frames.  The tables depend only on the two sample rates and the
+ * configured quality, so they are shared by all instances (see
+ * SincFilter::Get()).
+ */
+class SincPcmResampler final : public PcmResampler {
+	std::shared_ptr<const SincFilter> filter;
+
+	const PcmSimd *simd;
+
+	unsigned channels;
+
+	/**
+	 * The recent input samples of each channel (not
+	 * interleaved), starting with the oldest one which is still
+	 * needed by the filter.
+	 */
+	std::vector<std::vector<float>> history;
+
+	/**
+	 * The input frame (index into #history) where the filter
+	 * window of the next output frame starts.
+	 */
+	std::size_t position;
+
+	/**
+	 * The fractional part of the next output frame's position,
+	 * in units of 1/SincFilter::l.
+	 */
+	unsigned phase;
+
+	/**
+	 * Has Flush() already appended silence to #history?
+	 */
+	bool flushed;
+
+	PcmBuffer buffer;
+
+public:
+	AudioFormat Open(AudioFormat &af, unsigned new_sample_rate) override;
+	void Close() noexcept override;
+	void Reset() noexcept override;
+	ConstBuffer<void> Resample(ConstBuffer<void> src) override;
+	ConstBuffer<void> Flush() override;
+
+private:
+	ConstBuffer<float> Process() noexcept;
+};
+
+void
+pcm_resample_sinc_global_init(const ConfigBlock &block);
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "Volume.hxx"
 #include "Silence.hxx"
+#include "Simd.hxx"
 #include "Traits.hxx"
 #include "util/ConstBuffer.hxx"
 #include "util/WritableBuffer.hxx"
@@ -32,49 +33,6 @@
 
 #include <string.h>
 
-#if GCC_OLDER_THAN(8,0)
-/* GCC 6.3 emits this bogus warning in PcmVolumeConvert() because it
-   checks an unreachable branch */
-#pragma GCC diagnostic ignored "-Wshift-count-overflow"
-#endif
-
-/**
- * Apply software volume, converting to a different sample type.
- */
-template<SampleFormat SF, SampleFormat DF,
-	 class STraits=SampleTraits<SF>,
-	 class DTraits=SampleTraits<DF>>
-#if !GCC_OLDER_THAN(8,0)
-constexpr
-#endif
-static typename DTraits::value_type
-PcmVolumeConvert(typename STraits::value_type _sample, int volume) noexcept
-{
-	typename STraits::long_type sample(_sample);
-	sample *= volume;
-
-	static_assert(DTraits::BITS > STraits::BITS,
-		      "Destination sample must be larger than source sample");
-
-	/* after multiplying with the volume value, the "sample"
-	   variable contains this number of precision bits: source
-	   bits plus the volume bits */
-	constexpr unsigned BITS = STraits::BITS + PCM_VOLUME_BITS;
-
-	/* .. and now we need to scale to the requested destination
-	   bits */
-
-	typename DTraits::value_type result;
-	if (BITS > DTraits::BITS)
-		result = sample >> (BITS - DTraits::BITS);
-	else if (BITS < DTraits::BITS)
-		result = sample << (DTraits::BITS - BITS);
-	else
-		result = sample;
-
-	return result;
-}
-
 template<SampleFormat F, class Traits=SampleTraits<F>>
 static inline typename Traits::value_type
 pcm_volume_sample(PcmDither &dither,
@@ -119,18 +77,6 @@ pcm_volume_change_16(PcmDither &dither,
 	pcm_volume_change<SampleFormat::S16>(dither, dest, src, n, volume);
 }
 
-static void
-PcmVolumeChange16to32(int32_t *dest, const int16_t *src, size_t n,
-		      int volume) noexcept
-{
-	transform_n(src, n, dest,
-		    [volume](auto x){
-			    return PcmVolumeConvert<SampleFormat::S16,
-						    SampleFormat::S24_P32>(x,
-									   volume);
-		    });
-}
-
 static void
 pcm_volume_change_24(PcmDither &dither,
 		     int32_t *dest, const int32_t *src, size_t n,
@@ -148,20 +94,13 @@ pcm_volume_change_32(PcmDither &dither,
 	pcm_volume_change<SampleFormat::S32>(dither, dest, src, n, volume);
 }
 
-static void
-pcm_volume_change_float(float *dest, const float *src, size_t n,
-			float volume) noexcept
-{
-	transform_n(src, n, dest,
-		    [volume](float x){ return x * volume; });
-}
-
 SampleFormat
 PcmVolume::Open(SampleFormat _format, bool allow_convert)
 {
 	assert(format == SampleFormat::UNDEFINED);
 
 	convert = false;
+	simd = &SelectPcmSimd();
 
 	switch (_format) {
 	case SampleFormat::UNDEFINED:
@@ -231,7 +170,7 @@ PcmVolume::Apply(ConstBuffer<void> src) noexcept
 
 	case SampleFormat::S16:
 		if (convert)
-			PcmVolumeChange16to32((int32_t *)data,
+			simd->volume_16_to_24((int32_t *)data,
 					      (const int16_t *)src.data,
 					      src.size / sizeof(int16_t),
 					      volume);
@@ -257,10 +196,10 @@ PcmVolume::Apply(ConstBuffer<void> src) noexcept
 		break;
 
 	case SampleFormat::FLOAT:
-		pcm_volume_change_float((float *)data,
-					(const float *)src.data,
-					src.size / sizeof(float),
-					pcm_volume_to_float(volume));
+		simd->volume_float((float *)data,
+				   (const float *)src.data,
+				   src.size / sizeof(float),
+				   pcm_volume_to_float(volume));
 		break;
 
 	case SampleFormat::DSD:
@@ -29,6 +29,7 @@
 #endif
 
 template<typename T> struct ConstBuffer;
+struct PcmSimd;
 
 /**
  * Number of fractional bits for a fixed-point volume value.
@@ -71,6 +72,11 @@ class PcmVolume {
 
 	unsigned volume;
 
+	/**
+	 * The SIMD kernels selected by Open().
+	 */
+	const PcmSimd *simd;
+
 	PcmBuffer buffer;
 	PcmDither dither;
 
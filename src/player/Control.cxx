@@ -29,11 +29,13 @@ PlayerControl::PlayerControl(PlayerListener &_listener,
 			     PlayerOutputs &_outputs,
 			     InputCacheManager *_input_cache,
 			     unsigned _buffer_chunks,
+			     std::size_t _buffer_chunk_size,
 			     AudioFormat _configured_audio_format,
 			     const ReplayGainConfig &_replay_gain_config) noexcept
 	:listener(_listener), outputs(_outputs),
 	 input_cache(_input_cache),
 	 buffer_chunks(_buffer_chunks),
+	 buffer_chunk_size(_buffer_chunk_size),
 	 configured_audio_format(_configured_audio_format),
 	 thread(BIND_THIS_METHOD(RunThread)),
 	 replay_gain_config(_replay_gain_config)
@@ -120,6 +120,12 @@ class PlayerControl final : public AudioOutputClient {
 
 	const unsigned buffer_chunks;
 
+	/**
+	 * The size of each #MusicChunk (the "audio_buffer_chunk_size"
+	 * setting).
+	 */
+	const std::size_t buffer_chunk_size;
+
 	/**
 	 * The "audio_output_format" setting.
 	 */
@@ -238,6 +244,7 @@ public:
 		      PlayerOutputs &_outputs,
 		      InputCacheManager *_input_cache,
 		      unsigned buffer_chunks,
+		      std::size_t buffer_chunk_size,
 		      AudioFormat _configured_audio_format,
 		      const ReplayGainConfig &_replay_gain_config) noexcept;
 	~PlayerControl() noexcept;
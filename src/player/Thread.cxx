@@ -532,9 +532,10 @@ Player::CheckDecoderStartup(std::unique_lock<Mutex> &lock) noexcept
 
 		const size_t buffer_before_play_size =
 			play_audio_format.TimeToSize(buffer_before_play_duration);
+		const size_t chunk_capacity = buffer.GetChunkCapacity();
 		buffer_before_play =
-			(buffer_before_play_size + sizeof(MusicChunk::data) - 1)
-			/ sizeof(MusicChunk::data);
+			(buffer_before_play_size + chunk_capacity - 1)
+			/ chunk_capacity;
 
 		idle_add(IDLE_PLAYER);
 
@@ -1057,7 +1058,8 @@ Player::Run() noexcept
 							dc.out_audio_format,
 							play_audio_format,
 							buffer.GetSize() -
-							buffer_before_play);
+							buffer_before_play,
+							buffer.GetChunkCapacity());
 			if (cross_fade_chunks > 0)
 				xfade_state = CrossFadeState::ENABLED;
 			else
@@ -1168,7 +1170,7 @@ try {
 			  replay_gain_config);
 	dc.StartThread();
 
-	MusicBuffer buffer(buffer_chunks);
+	MusicBuffer buffer(buffer_chunks, buffer_chunk_size);
 
 	std::unique_lock<Mutex> lock(mutex);
 
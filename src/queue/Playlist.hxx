@@ -57,8 +57,9 @@ struct playlist {
 
 	/**
 	 * If true, then a bulk edit has been initiated by
-	 * BeginBulk(), and UpdateQueuedSong() and OnModified() will
-	 * be postponed until CommitBulk()
+	 * BeginBulk(), and UpdateQueuedSong(), OnModified() and
+	 * shuffling new songs (in random mode) will be postponed
+	 * until CommitBulk()
 	 */
 	bool bulk_edit = false;
 
@@ -67,6 +68,13 @@ struct playlist {
 	 */
 	bool bulk_modified;
 
+	/**
+	 * The length of the queue when the bulk edit was started.
+	 * All songs after this position have been appended by
+	 * AppendSong(), and they will be shuffled by CommitBulk().
+	 */
+	unsigned bulk_length;
+
 	/**
 	 * Number of errors since playback was started.  If this
 	 * number exceeds the length of the playlist, MPD gives up,
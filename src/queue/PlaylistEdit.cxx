@@ -30,6 +30,8 @@
 #include "song/DetachedSong.hxx"
 #include "SongLoader.hxx"
 
+#include <algorithm>
+
 #include <stdlib.h>
 
 void
@@ -64,6 +66,7 @@ playlist::BeginBulk() noexcept
 
 	bulk_edit = true;
 	bulk_modified = false;
+	bulk_length = queue.GetLength();
 }
 
 void
@@ -75,13 +78,23 @@ playlist::CommitBulk(PlayerControl &pc) noexcept
 	if (!bulk_modified)
 		return;
 
-	if (queued < 0)
-		/* if no song was queued, UpdateQueuedSong() is being
-		   ignored in "bulk" edit mode; now that we have
-		   shuffled all new songs, we can pick a random one
-		   (instead of always picking the first one that was
-		   added) */
-		UpdateQueuedSong(pc, nullptr);
+	const unsigned length = queue.GetLength();
+	if (queue.random && length > bulk_length) {
+		/* shuffle all new songs into the list of remaining
+		   songs to play at once */
+		const unsigned start = queued >= 0
+			? unsigned(queued + 1)
+			: unsigned(current + 1);
+		queue.ShuffleOrderAppendedWithPriority(std::min(start,
+								bulk_length),
+						       bulk_length, length);
+	}
+
+	/* if no song was queued, UpdateQueuedSong() has been ignored
+	   in "bulk" edit mode; now that we have shuffled all new
+	   songs, we can pick a random one (instead of always picking
+	   the first one that was added) */
+	UpdateQueuedSong(pc, GetQueuedSong());
 
 	OnModified();
 }
@@ -95,6 +108,14 @@ playlist::AppendSong(PlayerControl &pc, DetachedSong &&song)
 		throw PlaylistError(PlaylistResult::TOO_LARGE,
 				    "Playlist is too large");
 
+	if (bulk_edit) {
+		/* shuffling and UpdateQueuedSong() are postponed to
+		   CommitBulk() */
+		id = queue.Append(std::move(song), 0);
+		OnModified();
+		return id;
+	}
+
 	const DetachedSong *const queued_song = GetQueuedSong();
 
 	id = queue.Append(std::move(song), 0);
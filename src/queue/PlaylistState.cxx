@@ -28,6 +28,7 @@
 #include "SingleMode.hxx"
 #include "StateFileConfig.hxx"
 #include "queue/QueueSave.hxx"
+#include "queue/QueueJournal.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
 #include "player/Control.hxx"
@@ -57,9 +58,10 @@
 #define PLAYLIST_STATE_FILE_STATE_PAUSE		"pause"
 #define PLAYLIST_STATE_FILE_STATE_STOP		"stop"
 
-void
-playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
-		    PlayerControl &pc)
+static void
+playlist_state_save_options(BufferedOutputStream &os,
+			    const struct playlist &playlist,
+			    PlayerControl &pc)
 {
 	const auto player_status = pc.LockGetStatus();
 
@@ -96,11 +98,51 @@ playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
 		  (double)pc.GetMixRampDb());
 	os.Format(PLAYLIST_STATE_FILE_MIXRAMPDELAY "%f\n",
 		  pc.GetMixRampDelay().count());
+}
+
+void
+playlist_state_save(BufferedOutputStream &os, const struct playlist &playlist,
+		    PlayerControl &pc)
+{
+	playlist_state_save_options(os, playlist, pc);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN "\n");
 	queue_save(os, playlist.queue);
 	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
 }
 
+void
+playlist_state_save_changes(BufferedOutputStream &os,
+			    const struct playlist &playlist,
+			    PlayerControl &pc, QueueJournal &journal)
+{
+	playlist_state_save_options(os, playlist, pc);
+	journal.SaveChanges(os, playlist.queue);
+}
+
+bool
+playlist_state_read_entries(const char *line, TextFile &file,
+			    std::vector<std::string> &entries)
+{
+	if (!StringStartsWith(line, PLAYLIST_STATE_FILE_PLAYLIST_BEGIN))
+		return false;
+
+	while ((line = file.ReadLine()) != nullptr &&
+	       !StringStartsWith(line, PLAYLIST_STATE_FILE_PLAYLIST_END))
+		entries.emplace_back(queue_read_entry(file, line));
+
+	return true;
+}
+
+void
+playlist_state_write_entries(BufferedOutputStream &os,
+			     const std::vector<std::string> &entries)
+{
+	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_BEGIN "\n");
+	for (const auto &i : entries)
+		os.Write(i.data(), i.size());
+	os.Write(PLAYLIST_STATE_FILE_PLAYLIST_END "\n");
+}
+
 static void
 playlist_state_load(TextFile &file, const SongLoader &song_loader,
 		    struct playlist &playlist)
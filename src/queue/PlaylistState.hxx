@@ -25,7 +25,11 @@
 #ifndef MPD_PLAYLIST_STATE_HXX
 #define MPD_PLAYLIST_STATE_HXX
 
+#include <string>
+#include <vector>
+
 struct StateFileConfig;
+class QueueJournal;
 struct playlist;
 class PlayerControl;
 class TextFile;
@@ -36,6 +40,36 @@ void
 playlist_state_save(BufferedOutputStream &os, const playlist &playlist,
 		    PlayerControl &pc);
 
+/**
+ * Like playlist_state_save(), but save only the differences of the
+ * queue (see QueueJournal::SaveChanges()).  This is used by the
+ * state file journal.
+ */
+void
+playlist_state_save_changes(BufferedOutputStream &os,
+			    const playlist &playlist, PlayerControl &pc,
+			    QueueJournal &journal);
+
+/**
+ * Read the raw queue items from the state file without loading them
+ * (see queue_read_entry()), for replaying the state file journal.
+ *
+ * Throws on error.
+ *
+ * @param line the current line, which must be "playlist_begin"
+ * @return false if the line was not recognized
+ */
+bool
+playlist_state_read_entries(const char *line, TextFile &file,
+			    std::vector<std::string> &entries);
+
+/**
+ * Write raw queue items obtained by playlist_state_read_entries().
+ */
+void
+playlist_state_write_entries(BufferedOutputStream &os,
+			     const std::vector<std::string> &entries);
+
 bool
 playlist_state_restore(const StateFileConfig &config,
 		       const char *line, TextFile &file,
@@ -68,6 +68,20 @@ Queue::IncrementVersion() noexcept
 	}
 }
 
+void
+Queue::ModifyAtPosition(unsigned position) noexcept
+{
+	assert(position < length);
+
+	auto &item = items[position];
+	item.version = version;
+
+	/* the song may have been edited (e.g. by "addtagid") */
+	memory_usage -= item.memory_usage;
+	item.memory_usage = item.song->GetMemoryUsage();
+	memory_usage += item.memory_usage;
+}
+
 void
 Queue::ModifyAtOrder(unsigned _order) noexcept
 {
@@ -90,6 +104,8 @@ Queue::Append(DetachedSong &&song, uint8_t priority) noexcept
 	item.id = id;
 	item.version = version;
 	item.priority = priority;
+	item.memory_usage = item.song->GetMemoryUsage();
+	memory_usage += item.memory_usage;
 
 	order[position] = position;
 
@@ -233,6 +249,7 @@ Queue::DeletePosition(unsigned position) noexcept
 {
 	assert(position < length);
 
+	memory_usage -= items[position].memory_usage;
 	delete items[position].song;
 
 	const unsigned id = PositionToId(position);
@@ -273,6 +290,7 @@ Queue::Clear() noexcept
 	}
 
 	length = 0;
+	memory_usage = 0;
 }
 
 static void
@@ -379,6 +397,41 @@ Queue::ShuffleOrderLastWithPriority(unsigned start, unsigned end) noexcept
 	SwapOrders(end - 1, distribution(rand));
 }
 
+void
+Queue::ShuffleOrderAppendedWithPriority(unsigned start, unsigned new_start,
+					unsigned end) noexcept
+{
+	assert(start <= new_start);
+	assert(new_start <= end);
+	assert(end <= length);
+
+	rand.AutoCreate();
+
+	unsigned group_start = start;
+	uint8_t group_priority = 0;
+	bool have_group = false;
+
+	for (unsigned i = new_start; i < end; ++i) {
+		const uint8_t priority = items[OrderToPosition(i)].priority;
+		if (!have_group || priority != group_priority) {
+			/* skip all items at the start which have a
+			   higher priority (see
+			   ShuffleOrderLastWithPriority()) */
+			group_start = start;
+			while (items[OrderToPosition(group_start)].priority != priority) {
+				++group_start;
+				assert(group_start <= i);
+			}
+
+			group_priority = priority;
+			have_group = true;
+		}
+
+		std::uniform_int_distribution<unsigned> distribution(group_start, i);
+		SwapOrders(i, distribution(rand));
+	}
+}
+
 void
 Queue::ShuffleRange(unsigned start, unsigned end) noexcept
 {
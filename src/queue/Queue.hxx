@@ -26,6 +26,7 @@
 #include "util/LazyRandomEngine.hxx"
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 
@@ -67,6 +68,12 @@ struct Queue {
 		 * "random" mode.
 		 */
 		uint8_t priority;
+
+		/**
+		 * The value of DetachedSong::GetMemoryUsage() when
+		 * this item was added or last modified.
+		 */
+		uint32_t memory_usage;
 	};
 
 	/** configured maximum length of the queue */
@@ -78,6 +85,9 @@ struct Queue {
 	/** the current version number */
 	uint32_t version = 1;
 
+	/** the sum of all Item::memory_usage values */
+	std::size_t memory_usage = 0;
+
 	/** all songs in "position" order */
 	Item *const items;
 
@@ -122,6 +132,14 @@ struct Queue {
 		return length == 0;
 	}
 
+	/**
+	 * Returns the approximate number of bytes allocated for the
+	 * songs in this queue.
+	 */
+	std::size_t GetMemoryUsage() const noexcept {
+		return memory_usage;
+	}
+
 	/**
 	 * Determine if the maximum number of songs has been reached.
 	 */
@@ -240,11 +258,7 @@ struct Queue {
 	 * IncrementVersion() after all modifications have been made.
 	 * number.
 	 */
-	void ModifyAtPosition(unsigned position) noexcept {
-		assert(position < length);
-
-		items[position].version = version;
-	}
+	void ModifyAtPosition(unsigned position) noexcept;
 
 	/**
 	 * Marks the specified song as "modified".  Call
@@ -359,6 +373,17 @@ struct Queue {
 	 */
 	void ShuffleOrderLastWithPriority(unsigned start, unsigned end) noexcept;
 
+	/**
+	 * Like ShuffleOrderLastWithPriority(), but for all songs in
+	 * the (order) range from #new_start to #end which have been
+	 * appended at once.  This is equivalent to calling
+	 * ShuffleOrderLastWithPriority() after each Append(), but
+	 * skips the songs with a higher priority only once.
+	 */
+	void ShuffleOrderAppendedWithPriority(unsigned start,
+					      unsigned new_start,
+					      unsigned end) noexcept;
+
 	/**
 	 * Shuffles a (position) range in the queue.  The songs are physically
 	 * shuffled, not by using the "order" mapping.
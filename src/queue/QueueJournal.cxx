@@ -0,0 +1,203 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "QueueJournal.hxx"
+#include "QueueSave.hxx"
+#include "Queue.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/io/OutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+#include "util/StringAPI.hxx"
+#include "util/StringCompare.hxx"
+
+#include <stdexcept>
+#include <unordered_map>
+
+#include <stdlib.h>
+
+#define QUEUE_JOURNAL_BEGIN "queue_changes_begin"
+#define QUEUE_JOURNAL_END "queue_changes_end"
+#define QUEUE_JOURNAL_KEEP "queue_keep: "
+
+namespace {
+
+/**
+ * An #OutputStream which calculates the FNV-1a hash of all data.
+ */
+class HashOutputStream final : public OutputStream {
+	static constexpr uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+	static constexpr uint64_t PRIME = 1099511628211ULL;
+
+	uint64_t hash = OFFSET_BASIS;
+
+public:
+	uint64_t Finish() noexcept {
+		const uint64_t result = hash;
+		hash = OFFSET_BASIS;
+		return result;
+	}
+
+	/* virtual methods from class OutputStream */
+	void Write(const void *data, size_t size) noexcept override {
+		for (const auto *p = (const uint8_t *)data, *end = p + size;
+		     p != end; ++p) {
+			hash ^= *p;
+			hash *= PRIME;
+		}
+	}
+};
+
+/**
+ * Calculates QueueJournal::Entry::hash.  The position is omitted, so
+ * moving a song does not change its hash.
+ */
+class EntryHasher {
+	HashOutputStream hos;
+	BufferedOutputStream bos{hos};
+
+public:
+	uint64_t operator()(const Queue &queue, unsigned position) {
+		queue_save_entry(bos, 0, queue.GetPriorityAtPosition(position),
+				 queue.Get(position));
+		bos.Flush();
+		return hos.Finish();
+	}
+};
+
+}
+
+void
+QueueJournal::Reset(const Queue &queue)
+{
+	EntryHasher hasher;
+
+	entries.clear();
+	entries.reserve(queue.GetLength());
+
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		entries.push_back({unsigned(queue.PositionToId(i)),
+				   hasher(queue, i)});
+
+	version = queue.version;
+}
+
+void
+QueueJournal::SaveChanges(BufferedOutputStream &os, const Queue &queue)
+{
+	std::unordered_map<unsigned, unsigned> old_positions;
+	old_positions.reserve(entries.size());
+	for (unsigned i = 0; i < entries.size(); ++i)
+		old_positions.emplace(entries[i].id, i);
+
+	EntryHasher hasher;
+	std::vector<Entry> new_entries;
+	new_entries.reserve(queue.GetLength());
+
+	/* a run of songs which are unmodified and consecutive in
+	   the old queue */
+	unsigned keep_start = 0, keep_count = 0;
+
+	os.Write(QUEUE_JOURNAL_BEGIN "\n");
+
+	for (unsigned i = 0; i < queue.GetLength(); ++i) {
+		const unsigned id = queue.PositionToId(i);
+
+		int old_position = -1;
+		uint64_t hash;
+
+		if (!queue.IsNewerAtPosition(i, version) &&
+		    i < entries.size() && entries[i].id == id) {
+			/* not touched since the last call */
+			old_position = i;
+			hash = entries[i].hash;
+		} else {
+			/* moved or modified: compare the contents */
+			hash = hasher(queue, i);
+
+			auto j = old_positions.find(id);
+			if (j != old_positions.end() &&
+			    entries[j->second].hash == hash)
+				old_position = j->second;
+		}
+
+		new_entries.push_back({id, hash});
+
+		if (old_position >= 0 && keep_count > 0 &&
+		    unsigned(old_position) == keep_start + keep_count) {
+			++keep_count;
+			continue;
+		}
+
+		if (keep_count > 0)
+			os.Format(QUEUE_JOURNAL_KEEP "%u %u\n",
+				  keep_start, keep_count);
+
+		if (old_position >= 0) {
+			keep_start = old_position;
+			keep_count = 1;
+		} else {
+			keep_count = 0;
+			queue_save_entry(os, i, queue.GetPriorityAtPosition(i),
+					 queue.Get(i));
+		}
+	}
+
+	if (keep_count > 0)
+		os.Format(QUEUE_JOURNAL_KEEP "%u %u\n",
+			  keep_start, keep_count);
+
+	os.Write(QUEUE_JOURNAL_END "\n");
+
+	entries = std::move(new_entries);
+	version = queue.version;
+}
+
+bool
+queue_journal_replay(const char *line, TextFile &file,
+		     const std::vector<std::string> &entries,
+		     std::vector<std::string> &result)
+{
+	if (!StringIsEqual(line, QUEUE_JOURNAL_BEGIN))
+		return false;
+
+	result.clear();
+
+	while (true) {
+		line = file.ReadLine();
+		if (line == nullptr)
+			throw std::runtime_error("Unexpected end of file");
+
+		if (StringIsEqual(line, QUEUE_JOURNAL_END))
+			return true;
+
+		if (const char *p = StringAfterPrefix(line, QUEUE_JOURNAL_KEEP)) {
+			char *endptr;
+			const unsigned long start = strtoul(p, &endptr, 10);
+			const unsigned long count = strtoul(endptr, &endptr, 10);
+			if (*endptr != 0 || start > entries.size() ||
+			    count > entries.size() - start)
+				throw std::runtime_error("Malformed queue journal");
+
+			result.insert(result.end(),
+				      entries.begin() + start,
+				      entries.begin() + start + count);
+		} else
+			result.emplace_back(queue_read_entry(file, line));
+	}
+}
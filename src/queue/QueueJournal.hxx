@@ -0,0 +1,95 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_QUEUE_JOURNAL_HXX
+#define MPD_QUEUE_JOURNAL_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Queue;
+class BufferedOutputStream;
+class TextFile;
+
+/**
+ * Remembers the queue contents which have been written to the state
+ * file (or to its journal), so the journal needs to contain only the
+ * differences.  Songs which have only been moved (e.g. after a song
+ * before them has been deleted) are referred to by their previous
+ * position instead of being written again.
+ */
+class QueueJournal {
+	struct Entry {
+		/**
+		 * The song id in the #Queue.
+		 */
+		unsigned id;
+
+		/**
+		 * A hash of the text written by queue_save_entry(),
+		 * for detecting songs which have been modified.
+		 */
+		uint64_t hash;
+	};
+
+	/**
+	 * The queue as it was last written.
+	 */
+	std::vector<Entry> entries;
+
+	/**
+	 * The queue version at the last Reset() or SaveChanges()
+	 * call.
+	 */
+	uint32_t version = 0;
+
+public:
+	/**
+	 * Remember the current queue after it has been written
+	 * completely by queue_save().
+	 */
+	void Reset(const Queue &queue);
+
+	/**
+	 * Write the differences since the last Reset() or
+	 * SaveChanges() call and remember the current queue.
+	 *
+	 * Throws on error; after that, the object must be Reset().
+	 */
+	void SaveChanges(BufferedOutputStream &os, const Queue &queue);
+};
+
+/**
+ * Apply the differences written by QueueJournal::SaveChanges() to a
+ * list of raw songs obtained by queue_read_entry().
+ *
+ * Throws on error.
+ *
+ * @param line the current line
+ * @param entries the songs before the change
+ * @param result receives the songs after the change
+ * @return false if the line was not recognized
+ */
+bool
+queue_journal_replay(const char *line, TextFile &file,
+		     const std::vector<std::string> &entries,
+		     std::vector<std::string> &result);
+
+#endif
@@ -25,10 +25,12 @@
 #include "playlist/PlaylistSong.hxx"
 #include "fs/io/TextFile.hxx"
 #include "fs/io/BufferedOutputStream.hxx"
+#include "util/StringAPI.hxx"
 #include "util/StringCompare.hxx"
 #include "Log.hxx"
 
 #include <exception>
+#include <stdexcept>
 
 #include <stdlib.h>
 
@@ -61,16 +63,53 @@ queue_save_song(BufferedOutputStream &os, int idx, const DetachedSong &song)
 		queue_save_full_song(os, song);
 }
 
+void
+queue_save_entry(BufferedOutputStream &os, int idx, uint8_t priority,
+		 const DetachedSong &song)
+{
+	if (priority != 0)
+		os.Format(PRIO_LABEL "%u\n", priority);
+
+	queue_save_song(os, idx, song);
+}
+
 void
 queue_save(BufferedOutputStream &os, const Queue &queue)
 {
-	for (unsigned i = 0; i < queue.GetLength(); i++) {
-		uint8_t prio = queue.GetPriorityAtPosition(i);
-		if (prio != 0)
-			os.Format(PRIO_LABEL "%u\n", prio);
+	for (unsigned i = 0; i < queue.GetLength(); i++)
+		queue_save_entry(os, i, queue.GetPriorityAtPosition(i),
+				 queue.Get(i));
+}
+
+std::string
+queue_read_entry(TextFile &file, const char *line)
+{
+	std::string result;
 
-		queue_save_song(os, i, queue.Get(i));
+	if (StringStartsWith(line, PRIO_LABEL)) {
+		result.append(line);
+		result.push_back('\n');
+
+		line = file.ReadLine();
+		if (line == nullptr)
+			throw std::runtime_error("Song missing after priority");
+	}
+
+	result.append(line);
+	result.push_back('\n');
+
+	if (StringStartsWith(line, SONG_BEGIN)) {
+		do {
+			line = file.ReadLine();
+			if (line == nullptr)
+				throw std::runtime_error("Unexpected end of file");
+
+			result.append(line);
+			result.push_back('\n');
+		} while (!StringIsEqual(line, SONG_END));
 	}
+
+	return result;
 }
 
 static DetachedSong
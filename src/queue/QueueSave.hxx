@@ -25,7 +25,11 @@
 #ifndef MPD_QUEUE_SAVE_HXX
 #define MPD_QUEUE_SAVE_HXX
 
+#include <cstdint>
+#include <string>
+
 struct Queue;
+class DetachedSong;
 class BufferedOutputStream;
 class TextFile;
 class SongLoader;
@@ -33,6 +37,27 @@ class SongLoader;
 void
 queue_save(BufferedOutputStream &os, const Queue &queue);
 
+/**
+ * Save one song and its priority.
+ *
+ * @param idx the position of the song; it is only informational
+ * and is ignored by queue_load_song()
+ */
+void
+queue_save_entry(BufferedOutputStream &os, int idx, uint8_t priority,
+		 const DetachedSong &song);
+
+/**
+ * Read the raw text of one song (including its priority) written by
+ * queue_save() or queue_save_entry(), without loading it.
+ *
+ * Throws on error.
+ *
+ * @param line the first line of the song
+ */
+std::string
+queue_read_entry(TextFile &file, const char *line);
+
 /**
  * Loads one song from the state file and appends it to the queue.
  *
@@ -22,20 +22,39 @@
 #include "util/UriExtract.hxx"
 #include "fs/Traits.hxx"
 
-DetachedSong::DetachedSong(const LightSong &other)
+DetachedSong::Data::Data(const LightSong &other)
 	:uri(other.GetURI()),
 	 real_uri(other.real_uri != nullptr ? other.real_uri : ""),
 	 tag(other.tag),
-	 mtime(other.mtime),
+	 mtime(other.mtime) {}
+
+std::size_t
+DetachedSong::Data::GetMemoryUsage() const noexcept
+{
+	std::size_t result = sizeof(*this) + tag.num_items * sizeof(tag.items[0]);
+
+	/* short strings are stored inside the std::string object */
+	if (uri.capacity() >= sizeof(uri))
+		result += uri.capacity() + 1;
+	if (real_uri.capacity() >= sizeof(real_uri))
+		result += real_uri.capacity() + 1;
+
+	return result;
+}
+
+DetachedSong::DetachedSong(const LightSong &other)
+	:data(std::make_shared<Data>(other)),
 	 start_time(other.start_time),
 	 end_time(other.end_time) {}
 
 DetachedSong::operator LightSong() const noexcept
 {
-	LightSong result(uri.c_str(), tag);
+	LightSong result(data->uri.c_str(), data->tag);
 	result.directory = nullptr;
-	result.real_uri = real_uri.empty() ? nullptr : real_uri.c_str();
-	result.mtime = mtime;
+	result.real_uri = data->real_uri.empty()
+		? nullptr
+		: data->real_uri.c_str();
+	result.mtime = data->mtime;
 	result.start_time = start_time;
 	result.end_time = end_time;
 	return result;
@@ -68,6 +87,7 @@ DetachedSong::GetDuration() const noexcept
 {
 	SongTime a = start_time, b = end_time;
 	if (!b.IsPositive()) {
+		const auto &tag = GetTag();
 		if (tag.duration.IsNegative())
 			return tag.duration;
 
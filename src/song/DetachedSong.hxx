@@ -25,6 +25,8 @@
 #include "util/Compiler.h"
 
 #include <chrono>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -32,41 +34,66 @@ struct LightSong;
 class Storage;
 class Path;
 
+/**
+ * A song which is not attached to the database.
+ *
+ * The URIs, the tag and the modification time are stored in a
+ * reference-counted record which is shared by all copies (e.g. the
+ * one passed to the player); it gets copied before it is modified
+ * (copy-on-write).
+ */
 class DetachedSong {
-	friend DetachedSong DatabaseDetachSong(const Storage &db,
-					       const LightSong &song);
-
-	/**
-	 * An UTF-8-encoded URI referring to the song file.  This can
-	 * be one of:
-	 *
-	 * - an absolute URL with a scheme
-	 *   (e.g. "http://example.com/foo.mp3")
-	 *
-	 * - an absolute file name
-	 *
-	 * - a file name relative to the music directory
-	 */
-	std::string uri;
-
-	/**
-	 * The "real" URI, the one to be used for opening the
-	 * resource.  If this attribute is empty, then #uri shall be
-	 * used.
-	 *
-	 * This attribute is used for songs from the database which
-	 * have a relative URI.
-	 */
-	std::string real_uri;
-
-	Tag tag;
-
-	/**
-	 * The time stamp of the last file modification.  A negative
-	 * value means that this is unknown/unavailable.
-	 */
-	std::chrono::system_clock::time_point mtime =
-		std::chrono::system_clock::time_point::min();
+	struct Data {
+		/**
+		 * An UTF-8-encoded URI referring to the song file.
+		 * This can be one of:
+		 *
+		 * - an absolute URL with a scheme
+		 *   (e.g. "http://example.com/foo.mp3")
+		 *
+		 * - an absolute file name
+		 *
+		 * - a file name relative to the music directory
+		 */
+		std::string uri;
+
+		/**
+		 * The "real" URI, the one to be used for opening the
+		 * resource.  If this attribute is empty, then #uri
+		 * shall be used.
+		 *
+		 * This attribute is used for songs from the database
+		 * which have a relative URI.
+		 */
+		std::string real_uri;
+
+		Tag tag;
+
+		/**
+		 * The time stamp of the last file modification.  A
+		 * negative value means that this is
+		 * unknown/unavailable.
+		 */
+		std::chrono::system_clock::time_point mtime =
+			std::chrono::system_clock::time_point::min();
+
+		explicit Data(std::string &&_uri) noexcept
+			:uri(std::move(_uri)) {}
+
+		template<typename U>
+		Data(U &&_uri, Tag &&_tag)
+			:uri(std::forward<U>(_uri)), tag(std::move(_tag)) {}
+
+		explicit Data(const LightSong &other);
+
+		Data(const Data &other) = default;
+		Data &operator=(const Data &) = delete;
+
+		gcc_pure
+		std::size_t GetMemoryUsage() const noexcept;
+	};
+
+	std::shared_ptr<Data> data;
 
 	/**
 	 * Start of this sub-song within the file.
@@ -81,23 +108,23 @@ class DetachedSong {
 
 public:
 	explicit DetachedSong(const char *_uri)
-		:uri(_uri) {}
+		:data(std::make_shared<Data>(std::string(_uri))) {}
 
 	explicit DetachedSong(const std::string &_uri)
-		:uri(_uri) {}
+		:data(std::make_shared<Data>(std::string(_uri))) {}
 
 	explicit DetachedSong(std::string &&_uri)
-		:uri(std::move(_uri)) {}
+		:data(std::make_shared<Data>(std::move(_uri))) {}
 
 	template<typename U>
 	DetachedSong(U &&_uri, Tag &&_tag)
-		:uri(std::forward<U>(_uri)),
-		 tag(std::move(_tag)) {}
+		:data(std::make_shared<Data>(std::forward<U>(_uri),
+					     std::move(_tag))) {}
 
 	/**
 	 * Copy data from a #LightSong instance.  Usually, you should
 	 * call DatabaseDetachSong() instead, which initializes
-	 * #real_uri properly using Storage::MapUTF8().
+	 * the "real" URI properly using Storage::MapUTF8().
 	 */
 	explicit DetachedSong(const LightSong &other);
 
@@ -105,7 +132,8 @@ public:
 	~DetachedSong() = default;
 
 	/* these are declared because the user-defined destructor
-	   above prevents them from being generated implicitly */
+	   above prevents them from being generated implicitly; the
+	   copy shares the record */
 	explicit DetachedSong(const DetachedSong &) = default;
 	DetachedSong(DetachedSong &&) = default;
 	DetachedSong &operator=(DetachedSong &&) = default;
@@ -115,12 +143,12 @@ public:
 
 	gcc_pure
 	const char *GetURI() const noexcept {
-		return uri.c_str();
+		return data->uri.c_str();
 	}
 
 	template<typename T>
 	void SetURI(T &&_uri) {
-		uri = std::forward<T>(_uri);
+		Mutable().uri = std::forward<T>(_uri);
 	}
 
 	/**
@@ -129,21 +157,21 @@ public:
 	 */
 	gcc_pure
 	bool HasRealURI() const noexcept {
-		return !real_uri.empty();
+		return !data->real_uri.empty();
 	}
 
 	/**
-	 * Returns "real" URI (#real_uri) and falls back to just
+	 * Returns "real" URI (Data::real_uri) and falls back to just
 	 * GetURI().
 	 */
 	gcc_pure
 	const char *GetRealURI() const noexcept {
-		return (HasRealURI() ? real_uri : uri).c_str();
+		return (HasRealURI() ? data->real_uri : data->uri).c_str();
 	}
 
 	template<typename T>
 	void SetRealURI(T &&_uri) {
-		real_uri = std::forward<T>(_uri);
+		Mutable().real_uri = std::forward<T>(_uri);
 	}
 
 	/**
@@ -152,14 +180,14 @@ public:
 	 */
 	gcc_pure
 	bool IsSame(const DetachedSong &other) const noexcept {
-		return uri == other.uri &&
+		return data->uri == other.data->uri &&
 			start_time == other.start_time &&
 			end_time == other.end_time;
 	}
 
 	gcc_pure gcc_nonnull_all
 	bool IsURI(const char *other_uri) const noexcept {
-		return uri == other_uri;
+		return data->uri == other_uri;
 	}
 
 	gcc_pure
@@ -177,23 +205,27 @@ public:
 	bool IsInDatabase() const noexcept;
 
 	const Tag &GetTag() const noexcept {
-		return tag;
+		return data->tag;
 	}
 
-	Tag &WritableTag() noexcept {
-		return tag;
+	/**
+	 * Returns a writable reference to the tag; if the record is
+	 * shared, this song gets its own copy first.
+	 */
+	Tag &WritableTag() {
+		return Mutable().tag;
 	}
 
 	void SetTag(const Tag &_tag) {
-		tag = Tag(_tag);
+		Mutable().tag = Tag(_tag);
 	}
 
 	void SetTag(Tag &&_tag) {
-		tag = std::move(_tag);
+		Mutable().tag = std::move(_tag);
 	}
 
 	void MoveTagFrom(DetachedSong &&other) {
-		tag = std::move(other.tag);
+		Mutable().tag = std::move(other.Mutable().tag);
 	}
 
 	/**
@@ -201,15 +233,15 @@ public:
 	 * array.
 	 */
 	void MoveTagItemsFrom(DetachedSong &&other) {
-		tag.MoveItemsFrom(std::move(other.tag));
+		Mutable().tag.MoveItemsFrom(std::move(other.Mutable().tag));
 	}
 
 	std::chrono::system_clock::time_point GetLastModified() const {
-		return mtime;
+		return data->mtime;
 	}
 
 	void SetLastModified(std::chrono::system_clock::time_point _value) {
-		mtime = _value;
+		Mutable().mtime = _value;
 	}
 
 	SongTime GetStartTime() const {
@@ -232,7 +264,7 @@ public:
 	SignedSongTime GetDuration() const noexcept;
 
 	/**
-	 * Update the #tag and #mtime.
+	 * Update the tag and the modification time.
 	 *
 	 * Throws on error.
 	 *
@@ -241,11 +273,45 @@ public:
 	bool Update();
 
 	/**
-	 * Load #tag and #mtime from a local file.
+	 * Load the tag and the modification time from a local file.
 	 *
 	 * Throws on error.
 	 */
 	bool LoadFile(Path path);
+
+	/**
+	 * Returns an opaque pointer identifying the shared record;
+	 * two songs which share it return the same pointer.
+	 */
+	gcc_pure
+	const void *GetRecordId() const noexcept {
+		return data.get();
+	}
+
+	/**
+	 * Returns the approximate number of bytes allocated for this
+	 * song, including its record (even if it is shared).
+	 */
+	gcc_pure
+	std::size_t GetMemoryUsage() const noexcept {
+		return sizeof(*this) + data->GetMemoryUsage();
+	}
+
+private:
+	/**
+	 * Returns a writable reference to the record, copying it if
+	 * it is shared.
+	 *
+	 * A record can only be reached through the songs which own
+	 * it, so if this is the only one, nobody else can start
+	 * sharing it concurrently.
+	 */
+	Data &Mutable() {
+		if (data.use_count() > 1)
+			data = std::make_shared<Data>(*data);
+
+		return *data;
+	}
 };
 
 #endif
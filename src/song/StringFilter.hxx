@@ -90,6 +90,15 @@ public:
 		return negated;
 	}
 
+	/**
+	 * Does this filter match exactly one string, i.e. no case
+	 * folding, no substring, no regular expression and no
+	 * negation?
+	 */
+	bool IsExact() const noexcept {
+		return !fold_case && !substring && !negated && !IsRegex();
+	}
+
 	void ToggleNegated() noexcept {
 		negated = !negated;
 	}
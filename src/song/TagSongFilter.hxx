@@ -54,6 +54,10 @@ public:
 		return filter.IsNegated();
 	}
 
+	bool IsExact() const noexcept {
+		return filter.IsExact();
+	}
+
 	void ToggleNegated() noexcept {
 		filter.ToggleNegated();
 	}
@@ -19,6 +19,7 @@
 
 #include "Pool.hxx"
 #include "Item.hxx"
+#include "thread/Mutex.hxx"
 #include "util/Cast.hxx"
 #include "util/VarSize.hxx"
 #include "util/StringView.hxx"
@@ -26,68 +27,160 @@
 #include <cassert>
 #include <cstdint>
 #include <limits>
+#include <mutex>
 
 #include <string.h>
 #include <stdlib.h>
 
-Mutex tag_pool_lock;
+/**
+ * The number of shards; must be a power of two.  Each shard has its
+ * own lock, which reduces lock contention between the threads which
+ * create and destroy tags (update, decoder, input).
+ */
+static constexpr unsigned SHARD_BITS = 4;
+static constexpr unsigned NUM_SHARDS = 1U << SHARD_BITS;
 
-static constexpr size_t NUM_SLOTS = 16127;
+/**
+ * The initial number of hash table buckets per shard; must be a
+ * power of two.
+ */
+static constexpr std::size_t INITIAL_BUCKETS = 1024;
 
 struct TagPoolSlot {
 	TagPoolSlot *next;
+
+	/**
+	 * The hash of #item; it selects the shard and the bucket, and
+	 * is stored here so tag_pool_put_item() and rehashing don't
+	 * need to calculate it again.
+	 */
+	uint32_t hash;
+
 	uint8_t ref = 1;
 	TagItem item;
 
 	static constexpr unsigned MAX_REF = std::numeric_limits<decltype(ref)>::max();
 
-	TagPoolSlot(TagPoolSlot *_next, TagType type,
+	TagPoolSlot(TagPoolSlot *_next, uint32_t _hash, TagType type,
 		    StringView value) noexcept
-		:next(_next) {
+		:next(_next), hash(_hash) {
 		item.type = type;
 		memcpy(item.value, value.data, value.size);
 		item.value[value.size] = 0;
 	}
 
-	static TagPoolSlot *Create(TagPoolSlot *_next, TagType type,
+	static TagPoolSlot *Create(TagPoolSlot *_next, uint32_t _hash,
+				   TagType type,
 				   StringView value) noexcept;
+
+	gcc_pure
+	bool Equals(TagType type, StringView value) const noexcept {
+		return item.type == type &&
+			/* strncmp() stops at the end of a shorter
+			   item.value, so it never reads past it; this
+			   only works if there are no null bytes in
+			   "value", which FixTagString() has already
+			   ensured at this point */
+			strncmp(value.data, item.value, value.size) == 0 &&
+			item.value[value.size] == 0;
+	}
 };
 
 TagPoolSlot *
-TagPoolSlot::Create(TagPoolSlot *_next, TagType type,
+TagPoolSlot::Create(TagPoolSlot *_next, uint32_t _hash, TagType type,
 		    StringView value) noexcept
 {
 	TagPoolSlot *dummy;
 	return NewVarSize<TagPoolSlot>(sizeof(dummy->item.value),
 				       value.size + 1,
-				       _next, type,
+				       _next, _hash, type,
 				       value);
 }
 
-static TagPoolSlot *slots[NUM_SLOTS];
+struct TagPoolShard {
+	Mutex mutex;
+
+	/**
+	 * The hash table; allocated on demand and never freed,
+	 * because #Tag instances may outlive static destructors.
+	 */
+	TagPoolSlot **buckets = nullptr;
+
+	/**
+	 * The number of elements in #buckets; always zero or a power
+	 * of two.
+	 */
+	std::size_t n_buckets = 0;
+
+	/**
+	 * The number of #TagPoolSlot instances in this shard.
+	 */
+	std::size_t n_slots = 0;
+
+	TagPoolSlot **GetBucket(uint32_t hash) noexcept {
+		assert(n_buckets > 0);
+
+		return &buckets[hash & (n_buckets - 1)];
+	}
+
+	/**
+	 * Double the size of the hash table (or allocate the initial
+	 * one) and move all slots to their new buckets.
+	 */
+	void Grow() noexcept;
+
+	TagPoolSlot *Get(uint32_t hash, TagType type,
+			 StringView value) noexcept;
+
+	void Put(TagPoolSlot &slot) noexcept;
+};
 
-static inline unsigned
+static TagPoolShard shards[NUM_SHARDS];
+
+/**
+ * A hash function which consumes eight bytes per iteration; it is
+ * much faster than a byte-wise hash on long strings and distributes
+ * similar strings (e.g. track numbers) well.
+ */
+gcc_pure
+static uint32_t
 calc_hash(TagType type, StringView p) noexcept
 {
-	unsigned hash = 5381;
+	constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
 
-	for (auto ch : p)
-		hash = (hash << 5) + hash + ch;
+	uint64_t hash = (uint64_t(type) + 1) * MULTIPLIER ^ p.size;
 
-	return hash ^ type;
-}
+	const char *s = p.data;
+	std::size_t n = p.size;
 
-static inline unsigned
-calc_hash(TagType type, const char *p) noexcept
-{
-	unsigned hash = 5381;
+	for (; n >= sizeof(uint64_t); s += sizeof(uint64_t),
+		     n -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, s, sizeof(word));
+		hash = (hash ^ word) * MULTIPLIER;
+		hash ^= hash >> 32;
+	}
 
-	assert(p != nullptr);
+	if (n > 0) {
+		uint64_t word = 0;
+		memcpy(&word, s, n);
+		hash = (hash ^ word) * MULTIPLIER;
+	}
 
-	while (*p != 0)
-		hash = (hash << 5) + hash + *p++;
+	/* final avalanche (from SplitMix64) */
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9;
+	hash ^= hash >> 31;
 
-	return hash ^ type;
+	return uint32_t(hash ^ (hash >> 32));
+}
+
+static constexpr TagPoolShard &
+GetShard(uint32_t hash) noexcept
+{
+	/* use the upper bits for the shard and the lower bits for
+	   the bucket */
+	return shards[hash >> (32 - SHARD_BITS)];
 }
 
 static constexpr TagPoolSlot *
@@ -96,44 +189,94 @@ tag_item_to_slot(TagItem *item) noexcept
 	return &ContainerCast(*item, &TagPoolSlot::item);
 }
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, StringView value) noexcept
+void
+TagPoolShard::Grow() noexcept
 {
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
+	const std::size_t new_n_buckets = n_buckets > 0
+		? n_buckets * 2
+		: INITIAL_BUCKETS;
+	auto *const new_buckets = new TagPoolSlot *[new_n_buckets]();
+
+	for (std::size_t i = 0; i < n_buckets; ++i) {
+		for (auto *slot = buckets[i], *next = slot; slot != nullptr;
+		     slot = next) {
+			next = slot->next;
+
+			auto &bucket = new_buckets[slot->hash & (new_n_buckets - 1)];
+			slot->next = bucket;
+			bucket = slot;
+		}
+	}
+
+	delete[] buckets;
+	buckets = new_buckets;
+	n_buckets = new_n_buckets;
 }
 
-static inline TagPoolSlot **
-tag_value_slot_p(TagType type, const char *value) noexcept
+inline TagPoolSlot *
+TagPoolShard::Get(uint32_t hash, TagType type, StringView value) noexcept
 {
-	return &slots[calc_hash(type, value) % NUM_SLOTS];
+	if (n_buckets > 0) {
+		for (auto slot = *GetBucket(hash); slot != nullptr;
+		     slot = slot->next) {
+			if (slot->hash == hash && slot->Equals(type, value) &&
+			    slot->ref < TagPoolSlot::MAX_REF) {
+				assert(slot->ref > 0);
+				++slot->ref;
+				return slot;
+			}
+		}
+	}
+
+	/* keep the load factor at or below 1 */
+	if (n_slots >= n_buckets)
+		Grow();
+
+	auto slot_p = GetBucket(hash);
+	auto slot = TagPoolSlot::Create(*slot_p, hash, type, value);
+	*slot_p = slot;
+	++n_slots;
+	return slot;
+}
+
+inline void
+TagPoolShard::Put(TagPoolSlot &slot) noexcept
+{
+	assert(slot.ref > 0);
+	--slot.ref;
+
+	if (slot.ref > 0)
+		return;
+
+	TagPoolSlot **slot_p;
+	for (slot_p = GetBucket(slot.hash);
+	     *slot_p != &slot;
+	     slot_p = &(*slot_p)->next) {
+		assert(*slot_p != nullptr);
+	}
+
+	*slot_p = slot.next;
+	--n_slots;
+	DeleteVarSize(&slot);
 }
 
 TagItem *
 tag_pool_get_item(TagType type, StringView value) noexcept
 {
-	auto slot_p = tag_value_slot_p(type, value);
-	for (auto slot = *slot_p; slot != nullptr; slot = slot->next) {
-		if (slot->item.type == type &&
-		    /* strncmp() only works if there are no null
-		       bytes, which FixTagString() has already ensured
-		       at this point */
-		    strncmp(value.data, slot->item.value, value.size) == 0 &&
-		    slot->ref < TagPoolSlot::MAX_REF) {
-			assert(slot->ref > 0);
-			++slot->ref;
-			return &slot->item;
-		}
-	}
+	const auto hash = calc_hash(type, value);
+	auto &shard = GetShard(hash);
 
-	auto slot = TagPoolSlot::Create(*slot_p, type, value);
-	*slot_p = slot;
-	return &slot->item;
+	const std::lock_guard<Mutex> protect(shard.mutex);
+	return &shard.Get(hash, type, value)->item;
 }
 
 TagItem *
 tag_pool_dup_item(TagItem *item) noexcept
 {
 	TagPoolSlot *slot = tag_item_to_slot(item);
+	auto &shard = GetShard(slot->hash);
+
+	const std::lock_guard<Mutex> protect(shard.mutex);
 
 	assert(slot->ref > 0);
 
@@ -144,28 +287,43 @@ tag_pool_dup_item(TagItem *item) noexcept
 		/* the reference counter overflows above MAX_REF;
 		   obtain a reference to a different TagPoolSlot which
 		   isn't yet "full" */
-		return tag_pool_get_item(item->type, item->value);
+		return &shard.Get(slot->hash, item->type, item->value)->item;
 	}
 }
 
 void
 tag_pool_put_item(TagItem *item) noexcept
 {
-	TagPoolSlot **slot_p, *slot;
+	TagPoolSlot *slot = tag_item_to_slot(item);
+	auto &shard = GetShard(slot->hash);
 
-	slot = tag_item_to_slot(item);
-	assert(slot->ref > 0);
-	--slot->ref;
+	const std::lock_guard<Mutex> protect(shard.mutex);
+	shard.Put(*slot);
+}
 
-	if (slot->ref > 0)
-		return;
+TagPoolStats
+tag_pool_stats() noexcept
+{
+	TagPoolStats stats{};
 
-	for (slot_p = tag_value_slot_p(item->type, item->value);
-	     *slot_p != slot;
-	     slot_p = &(*slot_p)->next) {
-		assert(*slot_p != nullptr);
+	for (auto &shard : shards) {
+		const std::lock_guard<Mutex> protect(shard.mutex);
+
+		stats.items += shard.n_slots;
+		stats.buckets += shard.n_buckets;
+
+		for (std::size_t i = 0; i < shard.n_buckets; ++i) {
+			for (const auto *slot = shard.buckets[i];
+			     slot != nullptr; slot = slot->next) {
+				if (slot != shard.buckets[i])
+					++stats.collisions;
+
+				stats.references += slot->ref;
+				stats.saved_bytes += (slot->ref - 1) *
+					(strlen(slot->item.value) + 1);
+			}
+		}
 	}
 
-	*slot_p = slot->next;
-	DeleteVarSize(slot);
+	return stats;
 }
@@ -21,13 +21,19 @@
 #define MPD_TAG_POOL_HXX
 
 #include "Type.h"
-#include "thread/Mutex.hxx"
 
-extern Mutex tag_pool_lock;
+#include <cstddef>
 
 struct TagItem;
 struct StringView;
 
+/*
+ * The tag pool is split into shards, each protected by its own
+ * mutex, which is locked internally by the functions below.
+ * Therefore, these functions may be called from any thread without
+ * further locking.
+ */
+
 TagItem *
 tag_pool_get_item(TagType type, StringView value) noexcept;
 
@@ -37,4 +43,41 @@ tag_pool_dup_item(TagItem *item) noexcept;
 void
 tag_pool_put_item(TagItem *item) noexcept;
 
+struct TagPoolStats {
+	/**
+	 * The number of distinct #TagItem instances.
+	 */
+	std::size_t items;
+
+	/**
+	 * The number of references to all #TagItem instances.
+	 */
+	std::size_t references;
+
+	/**
+	 * The number of hash table buckets (in all shards).
+	 */
+	std::size_t buckets;
+
+	/**
+	 * The number of items which share their hash table bucket
+	 * with a preceding item.
+	 */
+	std::size_t collisions;
+
+	/**
+	 * The number of string bytes which would be needed if each
+	 * reference had its own copy of the value, minus the number
+	 * of bytes actually allocated for values.
+	 */
+	std::size_t saved_bytes;
+};
+
+/**
+ * Obtain statistics about the tag pool.  This locks each shard while
+ * walking its hash table, therefore it is somewhat expensive.
+ */
+TagPoolStats
+tag_pool_stats() noexcept;
+
 #endif
@@ -29,11 +29,8 @@ Tag::Clear() noexcept
 	duration = SignedSongTime::Negative();
 	has_playlist = false;
 
-	{
-		const std::lock_guard<Mutex> protect(tag_pool_lock);
-		for (unsigned i = 0; i < num_items; ++i)
-			tag_pool_put_item(items[i]);
-	}
+	for (unsigned i = 0; i < num_items; ++i)
+		tag_pool_put_item(items[i]);
 
 	delete[] items;
 	items = nullptr;
@@ -47,7 +44,6 @@ Tag::Tag(const Tag &other) noexcept
 	if (num_items > 0) {
 		items = new TagItem *[num_items];
 
-		const std::lock_guard<Mutex> protect(tag_pool_lock);
 		for (unsigned i = 0; i < num_items; i++)
 			items[i] = tag_pool_dup_item(other.items[i]);
 	}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Max Kellermann <max.kellermann@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef THREAD_SHARED_MUTEX_HXX
+#define THREAD_SHARED_MUTEX_HXX
+
+#include "Mutex.hxx"
+#include "Cond.hxx"
+
+#include <cassert>
+
+/**
+ * A reader/writer lock which prefers writers: as soon as a thread
+ * waits in lock(), no new shared lock is granted.  This prevents a
+ * steady stream of readers from starving writers, which happens
+ * with the glibc implementation of std::shared_mutex.
+ *
+ * Neither mode is recursive.  The method names are compatible with
+ * std::unique_lock and std::shared_lock.
+ */
+class SharedMutex {
+	Mutex mutex;
+
+	/**
+	 * Signalled when a writer may proceed.
+	 */
+	Cond writer_cond;
+
+	/**
+	 * Signalled when readers may proceed.
+	 */
+	Cond reader_cond;
+
+	/**
+	 * The number of threads holding a shared lock.
+	 */
+	unsigned readers = 0;
+
+	/**
+	 * The number of threads waiting in lock().
+	 */
+	unsigned waiting_writers = 0;
+
+	/**
+	 * Does a thread hold the exclusive lock?
+	 */
+	bool writer = false;
+
+public:
+	SharedMutex() = default;
+	SharedMutex(const SharedMutex &) = delete;
+	SharedMutex &operator=(const SharedMutex &) = delete;
+
+	void lock() noexcept {
+		std::unique_lock<Mutex> lock(mutex);
+		++waiting_writers;
+		writer_cond.wait(lock, [this]{
+			return !writer && readers == 0;
+		});
+		--waiting_writers;
+		writer = true;
+	}
+
+	void unlock() noexcept {
+		const std::lock_guard<Mutex> lock(mutex);
+		assert(writer);
+		writer = false;
+
+		if (waiting_writers > 0)
+			writer_cond.notify_one();
+		else
+			reader_cond.notify_all();
+	}
+
+	void lock_shared() noexcept {
+		std::unique_lock<Mutex> lock(mutex);
+		reader_cond.wait(lock, [this]{
+			return !writer && waiting_writers == 0;
+		});
+		++readers;
+	}
+
+	void unlock_shared() noexcept {
+		const std::lock_guard<Mutex> lock(mutex);
+		assert(readers > 0);
+
+		if (--readers == 0 && waiting_writers > 0)
+			writer_cond.notify_one();
+	}
+};
+
+#endif
@@ -23,124 +23,244 @@
 #include "HugeAllocator.hxx"
 #include "Compiler.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <new>
+#include <thread>
 #include <utility>
 
 /**
  * This class pre-allocates a certain number of objects, and allows
- * callers to allocate and free these objects ("slices").
+ * callers to allocate and free these objects ("slices").  The size
+ * of each slice may be larger than sizeof(T), for objects which end
+ * with a variable-length array.
+ *
+ * All methods are thread-safe and lock-free (except for a short
+ * spin while the memory is being discarded after the last slice was
+ * freed).  Free slices are kept on a stack of indices whose head is
+ * tagged with a counter to avoid the ABA problem.
  */
 template<typename T>
 class SliceBuffer {
-	union Slice {
-		Slice *next;
+	/**
+	 * The size of each slice in bytes; a multiple of alignof(T).
+	 */
+	const std::size_t slice_size;
+
+	/**
+	 * The number of slices.
+	 */
+	const unsigned n_slices;
+
+	HugeArray<std::byte> buffer;
 
-		T value;
-	};
+	/**
+	 * For each slice in the "available" stack: the index of the
+	 * next one plus one (0 marks the end of the stack).
+	 */
+	const std::unique_ptr<std::atomic<uint32_t>[]> links;
 
-	HugeArray<Slice> buffer;
+	/**
+	 * The head of the stack of available slices.  The lower 32
+	 * bits are the index of the first slice plus one (0 means
+	 * the stack is empty); the upper 32 bits are incremented on
+	 * each modification.
+	 */
+	std::atomic<uint64_t> available{0};
 
 	/**
 	 * The number of slices that are initialized.  This is used to
 	 * avoid page faulting on the new allocation, so the kernel
 	 * does not need to reserve physical memory pages.
 	 */
-	unsigned n_initialized = 0;
+	std::atomic<unsigned> n_initialized{0};
 
 	/**
-	 * The number of slices currently allocated.
+	 * The number of slices currently allocated (or reserved by a
+	 * pending Allocate() call).  While DiscardMemory() runs, the
+	 * #LOCKED bit is set.
 	 */
-	unsigned n_allocated = 0;
+	std::atomic<unsigned> n_allocated{0};
 
-	/**
-	 * Pointer to the first free element in the chain.
-	 */
-	Slice *available = nullptr;
+	static constexpr unsigned LOCKED = 1U << 31;
+
+	static constexpr uint64_t INDEX_MASK = 0xffffffff;
 
 public:
-	SliceBuffer(unsigned _count)
-		:buffer(_count) {
+	explicit SliceBuffer(unsigned _count,
+			     std::size_t _slice_size=sizeof(T))
+		:slice_size((_slice_size + alignof(T) - 1) / alignof(T) * alignof(T)),
+		 n_slices(_count),
+		 buffer(slice_size * _count),
+		 links(new std::atomic<uint32_t>[_count]) {
+		assert(_count < LOCKED);
+		assert(_slice_size >= sizeof(T));
+
 		buffer.ForkCow(false);
 	}
 
 	~SliceBuffer() noexcept {
 		/* all slices must be freed explicitly, and this
 		   assertion checks for leaks */
-		assert(n_allocated == 0);
+		assert(n_allocated.load(std::memory_order_relaxed) == 0);
 	}
 
 	SliceBuffer(const SliceBuffer &other) = delete;
 	SliceBuffer &operator=(const SliceBuffer &other) = delete;
 
 	unsigned GetCapacity() const noexcept {
-		return buffer.size();
+		return n_slices;
 	}
 
-	bool empty() const noexcept {
-		return n_allocated == 0;
+	std::size_t GetSliceSize() const noexcept {
+		return slice_size;
 	}
 
-	bool IsFull() const noexcept {
-		return n_allocated == buffer.size();
+	bool empty() const noexcept {
+		return (n_allocated.load(std::memory_order_relaxed) & ~LOCKED) == 0;
 	}
 
-	void DiscardMemory() noexcept {
-		assert(empty());
-
-		n_initialized = 0;
-		buffer.Discard();
-		available = nullptr;
+	bool IsFull() const noexcept {
+		return n_allocated.load(std::memory_order_relaxed) == n_slices;
 	}
 
 	template<typename... Args>
 	T *Allocate(Args&&... args) {
-		assert(n_initialized <= buffer.size());
-		assert(n_allocated <= n_initialized);
-
-		if (available == nullptr) {
-			if (n_initialized == buffer.size()) {
-				/* out of (internal) memory, buffer is full */
-				assert(n_allocated == buffer.size());
-				return nullptr;
-			}
-
-			available = &buffer[n_initialized++];
-			available->next = nullptr;
-		}
+		if (!Reserve())
+			/* out of (internal) memory, buffer is full */
+			return nullptr;
 
 		/* allocate a slice */
-		T *value = &available->value;
-		available = available->next;
-		++n_allocated;
+		void *value = Pop();
 
 		/* construct the object */
-		return ::new((void *)value) T(std::forward<Args>(args)...);
+		return ::new(value) T(std::forward<Args>(args)...);
 	}
 
 	void Free(T *value) noexcept {
-		assert(n_initialized <= buffer.size());
-		assert(n_allocated > 0);
-		assert(n_allocated <= n_initialized);
+		assert(!empty());
 
-		Slice *slice = reinterpret_cast<Slice *>(value);
-		assert(slice >= &buffer.front() && slice <= &buffer.back());
+		const std::size_t offset = (std::byte *)value - &buffer.front();
+		assert(offset < buffer.size());
+		assert(offset % slice_size == 0);
 
 		/* destruct the object */
 		value->~T();
 
-		/* insert the slice in the "available" linked list */
-		slice->next = available;
-		available = slice;
-		--n_allocated;
+		/* insert the slice in the "available" stack */
+		Push(offset / slice_size);
 
 		/* give memory back to the kernel when the last slice
 		   was freed */
-		if (n_allocated == 0) {
+		if (n_allocated.fetch_sub(1, std::memory_order_acq_rel) == 1)
 			DiscardMemory();
+	}
+
+private:
+	static constexpr uint64_t NextHead(uint64_t head,
+					   uint32_t index_plus_one) noexcept {
+		return (((head >> 32) + 1) << 32) | index_plus_one;
+	}
+
+	/**
+	 * Reserve one slice by incrementing #n_allocated.
+	 *
+	 * @return false if the buffer is full
+	 */
+	bool Reserve() noexcept {
+		unsigned n = n_allocated.load(std::memory_order_relaxed);
+		while (true) {
+			if (n & LOCKED) {
+				/* DiscardMemory() is running; wait for
+				   it to finish */
+				std::this_thread::yield();
+				n = n_allocated.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (n >= n_slices)
+				return false;
+
+			if (n_allocated.compare_exchange_weak(n, n + 1,
+							      std::memory_order_acquire,
+							      std::memory_order_relaxed))
+				return true;
+		}
+	}
+
+	void *GetSlice(uint32_t i) noexcept {
+		assert(i < n_slices);
+
+		return &buffer[i * slice_size];
+	}
+
+	/**
+	 * Obtain a free slice.  The caller must have called
+	 * Reserve() successfully before.
+	 */
+	void *Pop() noexcept {
+		while (true) {
+			uint64_t head = available.load(std::memory_order_acquire);
+			while ((head & INDEX_MASK) != 0) {
+				const uint32_t i = uint32_t(head & INDEX_MASK) - 1;
+				const uint64_t new_head =
+					NextHead(head, links[i].load(std::memory_order_relaxed));
+				if (available.compare_exchange_weak(head, new_head,
+								    std::memory_order_acquire,
+								    std::memory_order_acquire))
+					return GetSlice(i);
+			}
+
+			/* the stack is empty: initialize a new slice */
+			unsigned i = n_initialized.load(std::memory_order_relaxed);
+			while (i < n_slices)
+				if (n_initialized.compare_exchange_weak(i, i + 1,
+									std::memory_order_relaxed))
+					return GetSlice(i);
+
+			/* all slices are initialized, and the one
+			   reserved by us is just being returned by
+			   another thread; try again */
+			std::this_thread::yield();
 		}
 	}
+
+	void Push(uint32_t i) noexcept {
+		assert(i < n_slices);
+
+		uint64_t head = available.load(std::memory_order_relaxed);
+		do {
+			links[i].store(uint32_t(head & INDEX_MASK),
+				       std::memory_order_relaxed);
+		} while (!available.compare_exchange_weak(head,
+							  NextHead(head, i + 1),
+							  std::memory_order_release,
+							  std::memory_order_relaxed));
+	}
+
+	/**
+	 * Called after the last slice has been freed.
+	 */
+	void DiscardMemory() noexcept {
+		/* block Allocate() calls until we're done; if another
+		   thread has allocated meanwhile, skip this */
+		unsigned expected = 0;
+		if (!n_allocated.compare_exchange_strong(expected, LOCKED,
+							 std::memory_order_acquire,
+							 std::memory_order_relaxed))
+			return;
+
+		/* now nobody else can access the stack */
+		available.store(NextHead(available.load(std::memory_order_relaxed), 0),
+				std::memory_order_relaxed);
+		n_initialized.store(0, std::memory_order_relaxed);
+		buffer.Discard();
+
+		n_allocated.store(0, std::memory_order_release);
+	}
 };
 
 #endif
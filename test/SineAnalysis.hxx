@@ -0,0 +1,86 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPD_TEST_SINE_ANALYSIS_HXX
+#define MPD_TEST_SINE_ANALYSIS_HXX
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ * Generate a sine wave with the given amplitude into each channel of
+ * an interleaved buffer.
+ *
+ * @param offset the index of the first frame
+ */
+static inline void
+GenerateSine(float *dest, std::size_t n_frames, unsigned channels,
+	     double frequency, unsigned sample_rate, double amplitude,
+	     std::size_t offset=0) noexcept
+{
+	const double omega = 2 * M_PI * frequency / sample_rate;
+
+	for (std::size_t i = 0; i < n_frames; ++i) {
+		const float value = amplitude * std::sin(omega * (offset + i));
+		for (unsigned c = 0; c < channels; ++c)
+			*dest++ = value;
+	}
+}
+
+/**
+ * Measure the THD+N of a sine wave with the given frequency: fit a
+ * sine wave (amplitude and phase) and return the power of the
+ * residual relative to the power of the sine in dB.
+ *
+ * @param stride the distance between two samples, i.e. the number
+ * of channels
+ */
+static inline double
+MeasureThdN(const float *src, std::size_t n, std::size_t stride,
+	    double frequency, unsigned sample_rate) noexcept
+{
+	const double omega = 2 * M_PI * frequency / sample_rate;
+
+	double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const double s = std::sin(omega * i), c = std::cos(omega * i);
+		const double y = static_cast<double>(src[i * stride]);
+		ss += s * s;
+		sc += s * c;
+		cc += c * c;
+		ys += y * s;
+		yc += y * c;
+	}
+
+	const double det = ss * cc - sc * sc;
+	const double a = (ys * cc - yc * sc) / det;
+	const double b = (yc * ss - ys * sc) / det;
+
+	double signal = 0, noise = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const double fit = a * std::sin(omega * i) + b * std::cos(omega * i);
+		const double residual = static_cast<double>(src[i * stride]) - fit;
+		signal += fit * fit;
+		noise += residual * residual;
+	}
+
+	return 10 * std::log10(noise / signal);
+}
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Unit tests for src/db/plugins/simple/BinaryDatabase.cxx
+ */
+
+#include "config.h"
+#include "MakeTag.hxx"
+#include "db/plugins/simple/BinaryDatabase.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/PlaylistVector.hxx"
+#include "config/Block.hxx"
+#include "fs/Path.hxx"
+#include "lib/icu/Init.hxx"
+#include "tag/Type.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#ifdef ENABLE_UPNP
+#include "input/InputStream.hxx"
+size_t
+InputStream::LockRead(void *, size_t)
+{
+	return 0;
+}
+#endif
+
+static std::unique_ptr<SimpleDatabase>
+MakeDatabase(const std::string &path)
+{
+	ConfigBlock block;
+	block.AddBlockParam("path", path);
+	block.AddBlockParam("compress", "no");
+	block.AddBlockParam("format", "binary");
+	return std::make_unique<SimpleDatabase>(block);
+}
+
+static std::vector<char>
+ReadFile(const std::string &path)
+{
+	std::vector<char> result;
+
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return result;
+
+	char buffer[4096];
+	size_t nbytes;
+	while ((nbytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		result.insert(result.end(), buffer, buffer + nbytes);
+
+	fclose(file);
+	return result;
+}
+
+static void
+WriteFile(const std::string &path, const char *data, size_t size)
+{
+	FILE *file = fopen(path.c_str(), "wb");
+	ASSERT_NE(file, nullptr);
+	ASSERT_EQ(fwrite(data, 1, size, file), size);
+	fclose(file);
+}
+
+/* Directory::Sort() needs the collator; it can be initialized only
+   once per process */
+static const ScopeIcuInit icu_init;
+
+class BinaryDatabaseTest : public ::testing::Test {
+protected:
+	std::string path, mount_path, corrupt_path;
+
+	void SetUp() override {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "/tmp/TestBinaryDatabase.%d",
+			 (int)getpid());
+		path = buffer;
+		mount_path = path + ".mount";
+		corrupt_path = path + ".corrupt";
+	}
+
+	void TearDown() override {
+		unlink(path.c_str());
+		unlink(mount_path.c_str());
+		unlink(corrupt_path.c_str());
+	}
+
+	/**
+	 * Create and save a database with all kinds of objects.
+	 */
+	void Populate() {
+		auto db = MakeDatabase(path);
+		db->Open();
+
+		{
+			const ScopeDatabaseLock protect;
+			Directory &root = db->GetRoot();
+
+			Directory &artist = *root.MakeChild("artist");
+			artist.mtime = std::chrono::system_clock::from_time_t(1000);
+
+			Directory &album = *artist.MakeChild("album");
+			album.mtime = std::chrono::system_clock::from_time_t(2000);
+
+			auto song = std::make_unique<Song>("a.flac", album);
+			song->tag = MakeTag(TAG_ARTIST, "Artist",
+					    TAG_TITLE, "A",
+					    TAG_GENRE, "Rock",
+					    TAG_GENRE, "Pop");
+			song->mtime = std::chrono::system_clock::from_time_t(3000);
+			song->audio_format = AudioFormat(44100,
+							 SampleFormat::S16, 2);
+			album.AddSong(std::move(song));
+
+			/* a song without tags and time stamp */
+			album.AddSong(std::make_unique<Song>("b.flac", album));
+
+			/* a CUE sheet */
+			Directory &cue = *album.MakeChild("album.cue");
+			cue.device = DEVICE_PLAYLIST;
+			song = std::make_unique<Song>("track0001", cue);
+			song->target = "album.flac";
+			song->start_time = SongTime::FromMS(1500);
+			song->end_time = SongTime::FromMS(90000);
+			song->tag = MakeTag(TAG_TITLE, "Track 1");
+			cue.AddSong(std::move(song));
+
+			album.playlists.UpdateOrInsert(PlaylistInfo("list.m3u",
+								    std::chrono::system_clock::from_time_t(4000)));
+		}
+
+		/* mount points are not saved */
+		auto mounted = MakeDatabase(mount_path);
+		mounted->Open();
+		db->Mount("mnt", std::move(mounted));
+
+		db->Save();
+		db->Close();
+	}
+};
+
+TEST_F(BinaryDatabaseTest, RoundTrip)
+{
+	Populate();
+	ASSERT_TRUE(db_is_binary(Path::FromFS(path.c_str())));
+
+	auto db = MakeDatabase(path);
+	db->Open();
+
+	const ScopeDatabaseLock protect;
+	Directory &root = db->GetRoot();
+	EXPECT_EQ(root.FindChild("mnt"), nullptr);
+
+	const Directory *artist = root.FindChild("artist");
+	ASSERT_NE(artist, nullptr);
+	EXPECT_EQ(artist->mtime, std::chrono::system_clock::from_time_t(1000));
+
+	const Directory *album = artist->FindChild("album");
+	ASSERT_NE(album, nullptr);
+	EXPECT_STREQ(album->GetPath(), "artist/album");
+	EXPECT_EQ(album->mtime, std::chrono::system_clock::from_time_t(2000));
+	EXPECT_EQ(album->device, 0U);
+
+	const Song *a = album->FindSong("a.flac");
+	ASSERT_NE(a, nullptr);
+	EXPECT_STREQ(a->tag.GetValue(TAG_ARTIST), "Artist");
+	EXPECT_STREQ(a->tag.GetValue(TAG_TITLE), "A");
+	EXPECT_EQ(a->tag.num_items, 4U);
+	EXPECT_EQ(a->mtime, std::chrono::system_clock::from_time_t(3000));
+	EXPECT_EQ(a->audio_format, AudioFormat(44100, SampleFormat::S16, 2));
+	EXPECT_TRUE(a->target.empty());
+
+	const Song *b = album->FindSong("b.flac");
+	ASSERT_NE(b, nullptr);
+	EXPECT_TRUE(b->tag.IsEmpty());
+	EXPECT_TRUE(b->tag.duration.IsNegative());
+	EXPECT_EQ(b->mtime, std::chrono::system_clock::time_point::min());
+	EXPECT_FALSE(b->audio_format.IsDefined());
+
+	const Directory *cue = album->FindChild("album.cue");
+	ASSERT_NE(cue, nullptr);
+	EXPECT_EQ(cue->device, (uint64_t)DEVICE_PLAYLIST);
+
+	const Song *track = cue->FindSong("track0001");
+	ASSERT_NE(track, nullptr);
+	EXPECT_EQ(track->target, "album.flac");
+	EXPECT_EQ(track->start_time.ToMS(), 1500U);
+	EXPECT_EQ(track->end_time.ToMS(), 90000U);
+	EXPECT_STREQ(track->tag.GetValue(TAG_TITLE), "Track 1");
+
+	auto playlist = album->playlists.begin();
+	ASSERT_NE(playlist, album->playlists.end());
+	EXPECT_EQ(playlist->name, "list.m3u");
+	EXPECT_EQ(playlist->mtime,
+		  std::chrono::system_clock::from_time_t(4000));
+	EXPECT_EQ(std::next(playlist), album->playlists.end());
+}
+
+/**
+ * Truncated and corrupt files must be rejected with an exception,
+ * not crash.
+ */
+TEST_F(BinaryDatabaseTest, Corrupt)
+{
+	Populate();
+
+	const auto data = ReadFile(path);
+	ASSERT_GT(data.size(), 64U);
+
+	const auto corrupt_path_fs = Path::FromFS(corrupt_path.c_str());
+
+	/* every truncated file must be rejected */
+	for (size_t size = 0; size < data.size(); ++size) {
+		WriteFile(corrupt_path, data.data(), size);
+
+		std::unique_ptr<Directory> root(Directory::NewRoot());
+		EXPECT_THROW(db_load_binary(corrupt_path_fs, *root),
+			     std::runtime_error) << "size=" << size;
+
+		const ScopeDatabaseLock protect;
+		root.reset();
+	}
+
+	/* overwrite each byte; this may or may not be detected (e.g.
+	   if it is part of a string), but must not crash */
+	for (size_t i = 0; i < data.size(); ++i) {
+		for (char value : {'\0', '\xff'}) {
+			auto copy = data;
+			copy[i] = value;
+			WriteFile(corrupt_path, copy.data(), copy.size());
+
+			std::unique_ptr<Directory> root(Directory::NewRoot());
+			try {
+				db_load_binary(corrupt_path_fs, *root);
+			} catch (const std::runtime_error &) {
+			}
+
+			const ScopeDatabaseLock protect;
+			root.reset();
+		}
+	}
+}
@@ -0,0 +1,221 @@
+/*
+ * Unit tests for src/CoverArtCache.cxx
+ */
+
+#include "CoverArtCache.hxx"
+#include "TagFile.hxx"
+#include "tag/Handler.hxx"
+#include "tag/Generic.hxx"
+#include "fs/Path.hxx"
+#include "util/ConstBuffer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static unsigned n_scans;
+
+/**
+ * A fake tag scanner: the "song file" contains the size of its
+ * embedded picture as a decimal number.
+ */
+bool
+ScanFileTagsNoGeneric(Path path, TagHandler &handler)
+{
+	FILE *file = fopen(path.c_str(), "r");
+	if (file == nullptr)
+		return false;
+
+	unsigned long size = 0;
+	const bool success = fscanf(file, "%lu", &size) == 1;
+	fclose(file);
+	if (!success)
+		return false;
+
+	++n_scans;
+
+	const std::vector<std::byte> data(size);
+	handler.OnPicture("image/png", {data.data(), data.size()});
+	return true;
+}
+
+bool
+ScanGenericTags(Path, TagHandler &)
+{
+	return false;
+}
+
+class CoverArtCacheTest : public ::testing::Test {
+protected:
+	std::string directory;
+
+	CoverArtCache cache;
+
+	void SetUp() override {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer),
+			 "/tmp/TestCoverArtCache.%d", (int)getpid());
+		directory = buffer;
+		ASSERT_EQ(mkdir(directory.c_str(), 0700), 0);
+
+		n_scans = 0;
+	}
+
+	void TearDown() override {
+		std::string command = "rm -rf " + directory;
+		(void)system(command.c_str());
+	}
+
+	std::string MakePath(const char *name) const {
+		return directory + "/" + name;
+	}
+
+	/**
+	 * Create a file and set its modification time (not relying
+	 * on the file system's time stamp granularity).
+	 */
+	void WriteFile(const char *name, const char *contents,
+		       time_t mtime) const {
+		const auto path = MakePath(name);
+		FILE *file = fopen(path.c_str(), "w");
+		ASSERT_NE(file, nullptr);
+		fputs(contents, file);
+		fclose(file);
+		SetMtime(path, mtime);
+	}
+
+	static void SetMtime(const std::string &path, time_t mtime) {
+		const struct timeval times[2] = {{mtime, 0}, {mtime, 0}};
+		ASSERT_EQ(utimes(path.c_str(), times), 0);
+	}
+
+	auto GetPicture(const char *name) {
+		const auto path = MakePath(name);
+		return cache.GetPicture(Path::FromFS(path.c_str()));
+	}
+
+	auto GetCoverFile() {
+		return cache.GetCoverFile(Path::FromFS(directory.c_str()));
+	}
+};
+
+TEST_F(CoverArtCacheTest, PictureHitMiss)
+{
+	WriteFile("a.ogg", "100", 1000);
+	WriteFile("b.ogg", "200", 1000);
+
+	const auto a = GetPicture("a.ogg");
+	ASSERT_TRUE(a);
+	EXPECT_TRUE(a->found);
+	EXPECT_EQ(a->mime_type, "image/png");
+	EXPECT_EQ(a->data.size(), 100U);
+	EXPECT_EQ(n_scans, 1U);
+
+	/* hit */
+	EXPECT_EQ(GetPicture("a.ogg"), a);
+	EXPECT_EQ(n_scans, 1U);
+
+	/* miss */
+	const auto b = GetPicture("b.ogg");
+	EXPECT_EQ(b->data.size(), 200U);
+	EXPECT_EQ(n_scans, 2U);
+
+	EXPECT_EQ(GetPicture("a.ogg"), a);
+	EXPECT_EQ(GetPicture("b.ogg"), b);
+	EXPECT_EQ(n_scans, 2U);
+
+	/* not a regular file */
+	EXPECT_FALSE(cache.GetPicture(Path::FromFS(directory.c_str())));
+}
+
+TEST_F(CoverArtCacheTest, PictureModified)
+{
+	WriteFile("a.ogg", "100", 1000);
+	const auto a = GetPicture("a.ogg");
+	EXPECT_EQ(n_scans, 1U);
+
+	/* same size, new modification time */
+	SetMtime(MakePath("a.ogg"), 2000);
+	const auto a2 = GetPicture("a.ogg");
+	EXPECT_NE(a2, a);
+	EXPECT_EQ(n_scans, 2U);
+
+	/* the old value is still valid */
+	EXPECT_EQ(a->data.size(), 100U);
+
+	EXPECT_EQ(GetPicture("a.ogg"), a2);
+	EXPECT_EQ(n_scans, 2U);
+}
+
+TEST_F(CoverArtCacheTest, PictureEvict)
+{
+	/* the cache holds at most 32 MiB of pictures */
+	static constexpr const char *names[] = {
+		"a.ogg", "b.ogg", "c.ogg", "d.ogg", "e.ogg",
+	};
+
+	const auto size = std::to_string(7 * 1024 * 1024);
+	for (const char *name : names)
+		WriteFile(name, size.c_str(), 1000);
+
+	for (const char *name : names)
+		GetPicture(name);
+	EXPECT_EQ(n_scans, 5U);
+
+	/* the least recently used one has been evicted */
+	GetPicture("e.ogg");
+	GetPicture("b.ogg");
+	EXPECT_EQ(n_scans, 5U);
+	GetPicture("a.ogg");
+	EXPECT_EQ(n_scans, 6U);
+
+	/* ... and now "c.ogg" */
+	GetPicture("b.ogg");
+	EXPECT_EQ(n_scans, 6U);
+	GetPicture("c.ogg");
+	EXPECT_EQ(n_scans, 7U);
+
+	/* very large pictures are not cached at all */
+	WriteFile("f.ogg", std::to_string(9 * 1024 * 1024).c_str(), 1000);
+	GetPicture("f.ogg");
+	GetPicture("f.ogg");
+	EXPECT_EQ(n_scans, 9U);
+}
+
+TEST_F(CoverArtCacheTest, CoverFile)
+{
+	SetMtime(directory, 1000);
+
+	const auto none = GetCoverFile();
+	EXPECT_FALSE(none->fd.IsDefined());
+	EXPECT_EQ(GetCoverFile(), none);
+
+	WriteFile("cover.jpg", "jpeg", 1000);
+	SetMtime(directory, 2000);
+
+	const auto jpg = GetCoverFile();
+	EXPECT_NE(jpg, none);
+	EXPECT_TRUE(jpg->fd.IsDefined());
+	EXPECT_EQ(jpg->size, 4U);
+	EXPECT_EQ(GetCoverFile(), jpg);
+
+	/* the cover file has been modified in place */
+	WriteFile("cover.jpg", "jpeg2", 1000);
+	const auto jpg2 = GetCoverFile();
+	EXPECT_NE(jpg2, jpg);
+	EXPECT_EQ(jpg2->size, 5U);
+
+	/* "cover.png" is preferred */
+	WriteFile("cover.png", "png", 1000);
+	SetMtime(directory, 3000);
+	const auto png = GetCoverFile();
+	EXPECT_NE(png, jpg2);
+	EXPECT_EQ(png->size, 3U);
+}
@@ -0,0 +1,85 @@
+/*
+ * Unit tests for src/song/DetachedSong.cxx
+ */
+
+#include "song/DetachedSong.hxx"
+#include "queue/Queue.hxx"
+#include "tag/Builder.hxx"
+#include "tag/Tag.hxx"
+
+#include <gtest/gtest.h>
+
+static DetachedSong
+MakeSong(const char *uri, const char *title)
+{
+	TagBuilder builder;
+	builder.AddItem(TAG_TITLE, title);
+
+	DetachedSong song(uri, builder.Commit());
+	song.SetLastModified(std::chrono::system_clock::from_time_t(1234));
+	return song;
+}
+
+TEST(DetachedSong, CopyOnWrite)
+{
+	auto a = MakeSong("foo/b.ogg", "B");
+	DetachedSong b(a);
+	EXPECT_EQ(a.GetRecordId(), b.GetRecordId());
+	EXPECT_EQ(a.GetMemoryUsage(), b.GetMemoryUsage());
+
+	b.SetURI("foo/c.ogg");
+	EXPECT_NE(a.GetRecordId(), b.GetRecordId());
+	EXPECT_STREQ(a.GetURI(), "foo/b.ogg");
+	EXPECT_STREQ(b.GetURI(), "foo/c.ogg");
+
+	/* b's record is now private, and is modified in place */
+	const void *id = b.GetRecordId();
+	b.WritableTag().Clear();
+	EXPECT_EQ(b.GetRecordId(), id);
+	EXPECT_STREQ(a.GetTag().GetValue(TAG_TITLE), "B");
+	EXPECT_TRUE(b.GetTag().IsEmpty());
+}
+
+TEST(DetachedSong, QueueMemory)
+{
+	Queue queue(16);
+	EXPECT_EQ(queue.GetMemoryUsage(), 0U);
+
+	const auto a = MakeSong("foo/a.ogg", "A");
+	const auto b = MakeSong("foo/b.ogg", "B");
+	queue.Append(DetachedSong(a), 0);
+	queue.Append(DetachedSong(b), 0);
+	queue.Append(DetachedSong(a), 0);
+	EXPECT_EQ(queue.GetMemoryUsage(),
+		  2 * a.GetMemoryUsage() + b.GetMemoryUsage());
+
+	/* moving items around doesn't change anything */
+	queue.MovePostion(0, 2);
+	queue.SwapPositions(0, 1);
+	EXPECT_EQ(queue.GetMemoryUsage(),
+		  2 * a.GetMemoryUsage() + b.GetMemoryUsage());
+
+	/* modifying a song is accounted for */
+	for (unsigned i = 0; i < queue.GetLength(); ++i) {
+		if (queue.Get(i).IsURI("foo/b.ogg")) {
+			queue.Get(i).SetURI("foo/a-much-longer-uri-which-is-not-stored-inline.ogg");
+			queue.ModifyAtPosition(i);
+		}
+	}
+
+	std::size_t expected = 0;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		expected += queue.Get(i).GetMemoryUsage();
+	EXPECT_EQ(queue.GetMemoryUsage(), expected);
+	EXPECT_GT(queue.GetMemoryUsage(),
+		  2 * a.GetMemoryUsage() + b.GetMemoryUsage());
+
+	queue.DeletePosition(0);
+	expected = 0;
+	for (unsigned i = 0; i < queue.GetLength(); ++i)
+		expected += queue.Get(i).GetMemoryUsage();
+	EXPECT_EQ(queue.GetMemoryUsage(), expected);
+
+	queue.Clear();
+	EXPECT_EQ(queue.GetMemoryUsage(), 0U);
+}
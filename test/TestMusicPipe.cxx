@@ -0,0 +1,67 @@
+/*
+ * Unit tests for src/MusicPipe.cxx
+ */
+
+#include "MusicPipe.hxx"
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <string.h>
+
+static constexpr unsigned long N_CHUNKS = 200000;
+
+TEST(MusicPipe, ProducerConsumer)
+{
+	/* a small buffer, so both threads frequently find the pipe
+	   empty or the buffer exhausted */
+	MusicBuffer buffer(4);
+	MusicPipe pipe;
+
+	std::thread producer([&]{
+		for (unsigned long i = 0; i < N_CHUNKS; ++i) {
+			if (i == N_CHUNKS / 2) {
+				/* the format may change after the
+				   pipe has been drained */
+				while (!pipe.IsEmpty())
+					std::this_thread::yield();
+			}
+
+			MusicChunkPtr chunk;
+			while (!(chunk = buffer.Allocate()))
+				std::this_thread::yield();
+
+#ifndef NDEBUG
+			chunk->audio_format = i < N_CHUNKS / 2
+				? AudioFormat(44100, SampleFormat::S16, 2)
+				: AudioFormat(48000, SampleFormat::S24_P32, 2);
+#endif
+			memcpy(chunk->GetData(), &i, sizeof(i));
+			chunk->length = sizeof(i);
+			pipe.Push(std::move(chunk));
+		}
+	});
+
+	unsigned long n_received = 0;
+	while (n_received < N_CHUNKS) {
+		auto chunk = pipe.Shift();
+		if (!chunk) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		unsigned long value;
+		memcpy(&value, chunk->GetData(), sizeof(value));
+		ASSERT_EQ(value, n_received);
+		++n_received;
+	}
+
+	producer.join();
+
+	EXPECT_TRUE(pipe.IsEmpty());
+	EXPECT_FALSE(pipe.Shift());
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "encoder/SharedEncoder.hxx"
+#include "encoder/EncoderInterface.hxx"
+#include "encoder/EncoderPlugin.hxx"
+#include "encoder/plugins/NullEncoderPlugin.hxx"
+#include "config/Block.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "tag/Tag.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+static std::unique_ptr<PreparedEncoder>
+MakeShared()
+{
+	ConfigBlock block;
+	return std::unique_ptr<PreparedEncoder>(CreateSharedEncoder(null_encoder_plugin,
+								    block));
+}
+
+/**
+ * An encoder which holds back its input until Flush() or End(), like
+ * real codecs do with incomplete frames; End() appends a trailer.
+ */
+class BufferingEncoder final : public Encoder {
+	std::string pending, output;
+
+public:
+	BufferingEncoder() noexcept:Encoder(false) {}
+
+	void End() override {
+		Flush();
+		output += "|";
+	}
+
+	void Flush() override {
+		output += pending;
+		pending.clear();
+	}
+
+	void Write(const void *data, size_t length) override {
+		pending.append((const char *)data, length);
+	}
+
+	size_t Read(void *dest, size_t length) override {
+		length = std::min(length, output.size());
+		output.copy((char *)dest, length);
+		output.erase(0, length);
+		return length;
+	}
+};
+
+class PreparedBufferingEncoder final : public PreparedEncoder {
+public:
+	Encoder *Open(AudioFormat &) override {
+		return new BufferingEncoder();
+	}
+};
+
+static constexpr EncoderPlugin buffering_encoder_plugin = {
+	"buffering",
+	[](const ConfigBlock &) -> PreparedEncoder * {
+		return new PreparedBufferingEncoder();
+	},
+};
+
+/**
+ * Read everything without flushing.
+ */
+static std::string
+Drain(Encoder &encoder)
+{
+	std::string result;
+	char buffer[16];
+	std::size_t nbytes;
+	while ((nbytes = encoder.Read(buffer, sizeof(buffer))) > 0)
+		result.append(buffer, nbytes);
+	return result;
+}
+
+static std::string
+ReadAll(Encoder &encoder)
+{
+	encoder.Flush();
+
+	std::string result;
+	char buffer[16];
+	std::size_t nbytes;
+	while ((nbytes = encoder.Read(buffer, sizeof(buffer))) > 0)
+		result.append(buffer, nbytes);
+	return result;
+}
+
+TEST(SharedEncoder, Share)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+
+	e1->Write("abcd", 4);
+	e2->Write("abcd", 4);
+	e1->Write("efgh", 4);
+
+	/* each subscriber sees only the data it has submitted */
+	EXPECT_EQ(ReadAll(*e1), "abcdefgh");
+	EXPECT_EQ(ReadAll(*e2), "abcd");
+
+	/* the second subscriber's data was not encoded again */
+	e2->Write("efgh", 4);
+	EXPECT_EQ(ReadAll(*e2), "efgh");
+	EXPECT_EQ(ReadAll(*e1), "");
+
+	/* the second subscriber takes the lead */
+	e2->Write("ijkl", 4);
+	e1->Write("ijkl", 4);
+	EXPECT_EQ(ReadAll(*e1), "ijkl");
+	EXPECT_EQ(ReadAll(*e2), "ijkl");
+}
+
+TEST(SharedEncoder, Join)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	e1->Write("abcd", 4);
+	EXPECT_EQ(ReadAll(*e1), "abcd");
+
+	/* a late subscriber starts at the current position */
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+	e2->Write("efgh", 4);
+	e1->Write("efgh", 4);
+	EXPECT_EQ(ReadAll(*e2), "efgh");
+	EXPECT_EQ(ReadAll(*e1), "efgh");
+
+	/* after the first one has gone, a new one starts from
+	   scratch */
+	e1.reset();
+	e2.reset();
+	e1.reset(a->Open(audio_format));
+	e1->Write("ijkl", 4);
+	EXPECT_EQ(ReadAll(*e1), "ijkl");
+}
+
+TEST(SharedEncoder, DifferentFormat)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat af1(44100, SampleFormat::S16, 2);
+	AudioFormat af2(48000, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(af1));
+	std::unique_ptr<Encoder> e2(b->Open(af2));
+
+	e1->Write("abcd", 4);
+	e2->Write("efgh", 4);
+	EXPECT_EQ(ReadAll(*e1), "abcd");
+	EXPECT_EQ(ReadAll(*e2), "efgh");
+}
+
+static std::string
+WriteAndRead(Encoder &encoder, const std::string &input)
+{
+	std::string result;
+	char buffer[4096];
+
+	for (std::size_t i = 0; i < input.size(); i += 1024) {
+		encoder.Write(input.data() + i, 1024);
+
+		std::size_t nbytes;
+		while ((nbytes = encoder.Read(buffer, sizeof(buffer))) > 0)
+			result.append(buffer, nbytes);
+	}
+
+	return result + ReadAll(encoder);
+}
+
+TEST(SharedEncoder, Threads)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+
+	std::string input;
+	for (unsigned i = 0; i < 256 * 1024; ++i)
+		input.push_back(char(i * 7 + i / 1024));
+
+	std::string r1, r2;
+	std::thread t1([&]{ r1 = WriteAndRead(*e1, input); });
+	std::thread t2([&]{ r2 = WriteAndRead(*e2, input); });
+	t1.join();
+	t2.join();
+
+	EXPECT_EQ(r1, input);
+	EXPECT_EQ(r2, input);
+}
+
+TEST(SharedEncoder, EndTail)
+{
+	ConfigBlock block;
+	std::unique_ptr<PreparedEncoder> a(CreateSharedEncoder(buffering_encoder_plugin,
+							       block));
+	std::unique_ptr<PreparedEncoder> b(CreateSharedEncoder(buffering_encoder_plugin,
+							       block));
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+
+	e1->Write("abcd", 4);
+	e2->Write("abcd", 4);
+	EXPECT_EQ(Drain(*e1), "");
+	EXPECT_EQ(Drain(*e2), "");
+
+	/* the encoder is still being used by e1, but e2 gets the
+	   data it has submitted */
+	e2->End();
+	EXPECT_EQ(Drain(*e2), "abcd");
+	e2.reset();
+
+	/* the last subscriber really ends the stream */
+	e1->Write("efgh", 4);
+	e1->End();
+	EXPECT_EQ(Drain(*e1), "abcdefgh|");
+}
+
+TEST(SharedEncoder, Detach)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+
+	/* e2 stops writing; after e1 has submitted more than two
+	   seconds, e2 gets detached */
+	const std::string lead(audio_format.TimeToSize(std::chrono::seconds(3)),
+			       'a');
+	e1->Write(lead.data(), lead.size());
+	EXPECT_EQ(ReadAll(*e1), lead);
+	EXPECT_EQ(Drain(*e2), "");
+
+	/* e2's old input must not be submitted while e1 is still
+	   there; it reads e1's data from the live head instead */
+	e2->Write("zzzz", 4);
+	e1->Write("bbbb", 4);
+	EXPECT_EQ(ReadAll(*e1), "bbbb");
+	e2->Write("yyyy", 4);
+	EXPECT_EQ(ReadAll(*e2), "bbbb");
+
+	e1->Write("cccc", 4);
+	EXPECT_EQ(ReadAll(*e1), "cccc");
+
+	/* after e1 has gone, e2 submits again */
+	e1.reset();
+	e2->Write("dddd", 4);
+	EXPECT_EQ(ReadAll(*e2), "ccccdddd");
+}
+
+TEST(SharedEncoder, CatchUpTag)
+{
+	auto a = MakeShared(), b = MakeShared();
+
+	AudioFormat audio_format(44100, SampleFormat::S16, 2);
+	std::unique_ptr<Encoder> e1(a->Open(audio_format));
+	std::unique_ptr<Encoder> e2(b->Open(audio_format));
+
+	const Tag tag;
+
+	e1->Write("abcd", 4);
+	e1->SendTag(tag);
+
+	/* e2 sends the same tag without having submitted the PCM
+	   before it: it skips to the tag */
+	e2->SendTag(tag);
+
+	e1->Write("efgh", 4);
+	e2->Write("efgh", 4);
+	EXPECT_EQ(ReadAll(*e1), "abcdefgh");
+	EXPECT_EQ(ReadAll(*e2), "efgh");
+}
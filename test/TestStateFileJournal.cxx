@@ -0,0 +1,217 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StateFileJournal.hxx"
+#include "queue/Queue.hxx"
+#include "queue/QueueJournal.hxx"
+#include "queue/QueueSave.hxx"
+#include "song/DetachedSong.hxx"
+#include "fs/Path.hxx"
+#include "fs/io/FileOutputStream.hxx"
+#include "fs/io/BufferedOutputStream.hxx"
+#include "fs/io/TextFile.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+class StateFileJournalTest : public ::testing::Test {
+protected:
+	std::string path;
+
+	Queue queue{32};
+	QueueJournal journal;
+
+	/**
+	 * The queue as it was in the state file.
+	 */
+	std::vector<std::string> snapshot;
+
+	unsigned n_records = 0;
+
+	void SetUp() override {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer),
+			 "/tmp/TestStateFileJournal.%d", (int)getpid());
+		path = buffer;
+
+		for (const char *uri : {"a.ogg", "b.ogg", "c.ogg"})
+			queue.Append(DetachedSong(uri), 0);
+
+		/* write the snapshot */
+		{
+			FileOutputStream fos(Path::FromFS(path.c_str()));
+			BufferedOutputStream bos(fos);
+			queue_save(bos, queue);
+			bos.Flush();
+			fos.Commit();
+		}
+
+		TextFile file(Path::FromFS(path.c_str()));
+		const char *line;
+		while ((line = file.ReadLine()) != nullptr)
+			snapshot.emplace_back(queue_read_entry(file, line));
+
+		journal.Reset(queue);
+
+		/* start a new journal */
+		FileOutputStream fos(Path::FromFS(path.c_str()));
+		BufferedOutputStream bos(fos);
+		bos.Write(JOURNAL_ID "1\n");
+		bos.Flush();
+		fos.Commit();
+	}
+
+	void TearDown() override {
+		unlink(path.c_str());
+	}
+
+	/**
+	 * Append a record with the queue changes, like
+	 * StateFile::AppendJournal() does.
+	 */
+	void AppendRecord() {
+		FileOutputStream fos(Path::FromFS(path.c_str()),
+				     FileOutputStream::Mode::APPEND_EXISTING);
+		BufferedOutputStream bos(fos);
+		bos.Write(JOURNAL_BEGIN "\n");
+		bos.Format("record: %u\n", ++n_records);
+		journal.SaveChanges(bos, queue);
+		bos.Write(JOURNAL_END "\n");
+		bos.Flush();
+		fos.Commit();
+	}
+
+	/**
+	 * Simulate a crash while appending to the journal.
+	 */
+	void Truncate(off_t n) {
+		FILE *f = fopen(path.c_str(), "rb");
+		ASSERT_NE(f, nullptr);
+		fseek(f, 0, SEEK_END);
+		const long size = ftell(f);
+		fclose(f);
+
+		ASSERT_EQ(truncate(path.c_str(), size - n), 0);
+	}
+
+	unsigned Apply(std::vector<std::string> &lines,
+		       std::vector<std::string> &entries,
+		       bool &incomplete) {
+		TextFile file(Path::FromFS(path.c_str()));
+
+		/* skip the JOURNAL_ID line */
+		file.ReadLine();
+
+		entries = snapshot;
+		return state_journal_apply(file, lines, entries, incomplete);
+	}
+};
+
+/**
+ * Extract the URI from an entry written by queue_save_entry().
+ */
+static std::string
+GetUri(const std::string &entry)
+{
+	const auto colon = entry.find(':');
+	return entry.substr(colon + 1, entry.size() - colon - 2);
+}
+
+static std::vector<std::string>
+GetUris(const std::vector<std::string> &entries)
+{
+	std::vector<std::string> result;
+	for (const auto &i : entries)
+		result.emplace_back(GetUri(i));
+	return result;
+}
+
+using Uris = std::vector<std::string>;
+
+TEST_F(StateFileJournalTest, Replay)
+{
+	queue.Append(DetachedSong("d.ogg"), 0);
+	AppendRecord();
+
+	queue.DeletePosition(0);
+	AppendRecord();
+
+	queue.MoveRange(2, 3, 0);
+	AppendRecord();
+
+	std::vector<std::string> lines{"record: 0"}, entries;
+	bool incomplete;
+	EXPECT_EQ(Apply(lines, entries, incomplete), 3U);
+	EXPECT_FALSE(incomplete);
+	EXPECT_EQ(lines, Uris{"record: 3"});
+	EXPECT_EQ(GetUris(entries), (Uris{"d.ogg", "b.ogg", "c.ogg"}));
+}
+
+TEST_F(StateFileJournalTest, Empty)
+{
+	std::vector<std::string> lines{"record: 0"}, entries;
+	bool incomplete;
+	EXPECT_EQ(Apply(lines, entries, incomplete), 0U);
+	EXPECT_FALSE(incomplete);
+	EXPECT_EQ(lines, Uris{"record: 0"});
+	EXPECT_EQ(entries, snapshot);
+}
+
+TEST_F(StateFileJournalTest, TornEnd)
+{
+	queue.Append(DetachedSong("d.ogg"), 0);
+	AppendRecord();
+
+	queue.DeletePosition(0);
+	AppendRecord();
+
+	/* cut off the JOURNAL_END line */
+	Truncate(sizeof(JOURNAL_END));
+
+	std::vector<std::string> lines{"record: 0"}, entries;
+	bool incomplete;
+	EXPECT_EQ(Apply(lines, entries, incomplete), 1U);
+	EXPECT_TRUE(incomplete);
+	EXPECT_EQ(lines, Uris{"record: 1"});
+	EXPECT_EQ(GetUris(entries),
+		  (Uris{"a.ogg", "b.ogg", "c.ogg", "d.ogg"}));
+}
+
+TEST_F(StateFileJournalTest, TornQueue)
+{
+	queue.Append(DetachedSong("d.ogg"), 0);
+	AppendRecord();
+
+	queue.Append(DetachedSong("e.ogg"), 0);
+	queue.Append(DetachedSong("f.ogg"), 0);
+	AppendRecord();
+
+	/* cut off the queue in the middle of a song */
+	Truncate(sizeof(JOURNAL_END) + 20);
+
+	std::vector<std::string> lines{"record: 0"}, entries;
+	bool incomplete;
+	EXPECT_EQ(Apply(lines, entries, incomplete), 1U);
+	EXPECT_TRUE(incomplete);
+	EXPECT_EQ(lines, Uris{"record: 1"});
+	EXPECT_EQ(GetUris(entries),
+		  (Uris{"a.ogg", "b.ogg", "c.ogg", "d.ogg"}));
+}
@@ -0,0 +1,112 @@
+/*
+ * Unit tests for src/tag/Pool.cxx
+ */
+
+#include "tag/Pool.hxx"
+#include "tag/Item.hxx"
+#include "util/StringView.hxx"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+TEST(TagPool, Interning)
+{
+	const auto before = tag_pool_stats();
+
+	TagItem *a = tag_pool_get_item(TAG_ARTIST, "foo");
+	TagItem *b = tag_pool_get_item(TAG_ARTIST, "foo");
+	TagItem *c = tag_pool_get_item(TAG_ALBUM, "foo");
+
+	EXPECT_EQ(a, b);
+	EXPECT_NE(a, c);
+	EXPECT_EQ(TAG_ARTIST, a->type);
+	EXPECT_STREQ("foo", a->value);
+	EXPECT_EQ(TAG_ALBUM, c->type);
+
+	const auto stats = tag_pool_stats();
+	EXPECT_EQ(before.items + 2, stats.items);
+	EXPECT_EQ(before.references + 3, stats.references);
+	EXPECT_EQ(before.saved_bytes + 4, stats.saved_bytes);
+
+	tag_pool_put_item(a);
+	tag_pool_put_item(b);
+	tag_pool_put_item(c);
+
+	EXPECT_EQ(before.items, tag_pool_stats().items);
+}
+
+TEST(TagPool, Prefix)
+{
+	/* a value must not match a longer value which begins with
+	   it */
+	TagItem *a = tag_pool_get_item(TAG_GENRE, "Rock and Roll");
+	TagItem *b = tag_pool_get_item(TAG_GENRE, StringView("Rock and Roll", 4));
+
+	EXPECT_NE(a, b);
+	EXPECT_STREQ("Rock and Roll", a->value);
+	EXPECT_STREQ("Rock", b->value);
+
+	tag_pool_put_item(a);
+	tag_pool_put_item(b);
+}
+
+TEST(TagPool, RefOverflow)
+{
+	std::vector<TagItem *> items;
+	items.push_back(tag_pool_get_item(TAG_TITLE, "overflow"));
+
+	for (unsigned i = 0; i < 1000; ++i)
+		items.push_back(tag_pool_dup_item(items.front()));
+
+	for (auto *i : items) {
+		EXPECT_EQ(TAG_TITLE, i->type);
+		EXPECT_STREQ("overflow", i->value);
+	}
+
+	/* the reference counter is only 8 bit wide */
+	EXPECT_NE(items.front(), items.back());
+
+	for (auto *i : items)
+		tag_pool_put_item(i);
+}
+
+TEST(TagPool, Threads)
+{
+	const auto before = tag_pool_stats();
+
+	auto f = []{
+		char buffer[32];
+		std::vector<TagItem *> items;
+
+		for (unsigned round = 0; round < 4; ++round) {
+			for (unsigned i = 0; i < 5000; ++i) {
+				snprintf(buffer, sizeof(buffer), "value %u", i);
+				items.push_back(tag_pool_get_item(TAG_ALBUM, buffer));
+			}
+
+			for (auto *i : items) {
+				tag_pool_put_item(tag_pool_dup_item(i));
+				tag_pool_put_item(i);
+			}
+
+			items.clear();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < 4; ++i)
+		threads.emplace_back(f);
+
+	for (auto &i : threads)
+		i.join();
+
+	const auto stats = tag_pool_stats();
+	EXPECT_EQ(before.items, stats.items);
+	EXPECT_EQ(before.references, stats.references);
+	EXPECT_GT(stats.buckets, 0U);
+}
@@ -0,0 +1,225 @@
+/*
+ * Unit tests for src/db/update/ScanPool.cxx
+ *
+ * Several worker threads load songs while the "update thread" (the
+ * test) keeps submitting jobs and commits the finished ones the way
+ * UpdateWalk::LoadSongFile(), CommitScans() and FlushScans() do.
+ */
+
+#include "config.h"
+#include "db/update/ScanPool.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "storage/StorageInterface.hxx"
+#include "storage/FileInfo.hxx"
+#include "fs/AllocatedPath.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+
+#ifdef ENABLE_UPNP
+#include "input/InputStream.hxx"
+size_t
+InputStream::LockRead(void *, size_t)
+{
+	return 0;
+}
+#endif
+
+static constexpr unsigned N_THREADS = 4;
+static constexpr unsigned N_SONGS = 500;
+
+static std::atomic_uint n_running, max_running;
+
+/**
+ * A fake implementation: names starting with "bad" fail, names
+ * starting with "skip" are not recognized, and all others are
+ * loaded after a short delay (to simulate a slow storage).
+ */
+SongPtr
+Song::LoadFile(Storage &, const char *name_utf8, Directory &parent)
+{
+	const unsigned n = ++n_running;
+	unsigned max = max_running.load();
+	while (n > max && !max_running.compare_exchange_weak(max, n)) {}
+
+	std::this_thread::sleep_for(std::chrono::microseconds(200));
+	--n_running;
+
+	if (strncmp(name_utf8, "bad", 3) == 0)
+		throw std::runtime_error(name_utf8);
+
+	if (strncmp(name_utf8, "skip", 4) == 0)
+		return nullptr;
+
+	auto song = std::make_unique<Song>(name_utf8, parent);
+	song->mtime = std::chrono::system_clock::from_time_t(2);
+	return song;
+}
+
+class NullStorage final : public Storage {
+public:
+	StorageFileInfo GetInfo(std::string_view, bool) override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	std::unique_ptr<StorageDirectoryReader> OpenDirectory(std::string_view) override {
+		throw std::runtime_error("Not implemented");
+	}
+
+	std::string MapUTF8(std::string_view uri_utf8) const noexcept override {
+		return std::string(uri_utf8);
+	}
+
+	std::string_view MapToRelativeUTF8(std::string_view) const noexcept override {
+		return {};
+	}
+};
+
+class UpdateScanPoolTest : public ::testing::Test {
+protected:
+	NullStorage storage;
+	Directory root{std::string(), nullptr};
+	UpdateScanPool pool{storage, N_THREADS};
+
+	/** how often each song was committed */
+	std::map<std::string, unsigned> committed;
+
+	unsigned n_errors = 0, n_skipped = 0, n_updated = 0;
+
+	void SetUp() override {
+		n_running = 0;
+		max_running = 0;
+	}
+
+	/**
+	 * Like UpdateWalk::CommitScan().
+	 */
+	void CommitScan(UpdateScanJob &job) {
+		ASSERT_EQ(&job.directory, &root);
+		++committed[job.name];
+
+		if (job.error) {
+			++n_errors;
+			ASSERT_FALSE(job.new_song);
+		} else if (!job.new_song) {
+			++n_skipped;
+		} else if (job.old_song == nullptr) {
+			root.AddSong(std::move(job.new_song));
+		} else {
+			job.old_song->mtime = job.new_song->mtime;
+			++n_updated;
+		}
+	}
+
+	/**
+	 * Like UpdateWalk::CommitScans().
+	 */
+	void CommitScans(bool wait) {
+		auto jobs = pool.Take(wait);
+		if (jobs.empty())
+			return;
+
+		const ScopeDatabaseLock protect;
+		for (auto &job : jobs)
+			CommitScan(job);
+	}
+
+	/**
+	 * Like UpdateWalk::FlushScans().
+	 */
+	void FlushScans() {
+		while (!pool.IsEmpty())
+			CommitScans(true);
+	}
+
+	/**
+	 * Like UpdateWalk::LoadSongFile().
+	 */
+	void LoadSongFile(Song *song, const std::string &name) {
+		if (pool.IsFull())
+			CommitScans(true);
+
+		ASSERT_FALSE(pool.IsFull());
+		pool.Push(root, song, name);
+	}
+};
+
+TEST_F(UpdateScanPoolTest, Empty)
+{
+	EXPECT_TRUE(pool.IsEmpty());
+
+	/* must not block */
+	EXPECT_TRUE(pool.Take(true).empty());
+
+	FlushScans();
+	EXPECT_TRUE(committed.empty());
+}
+
+TEST_F(UpdateScanPoolTest, Load)
+{
+	for (unsigned i = 0; i < N_SONGS; ++i) {
+		std::string name = std::to_string(i) + ".ogg";
+		if (i % 10 == 3)
+			name.insert(0, "bad");
+		else if (i % 10 == 7)
+			name.insert(0, "skip");
+
+		LoadSongFile(nullptr, name);
+
+		/* like UpdateWalk::UpdateDirectory() after each
+		   directory entry */
+		CommitScans(false);
+	}
+
+	FlushScans();
+	EXPECT_TRUE(pool.IsEmpty());
+
+	/* the workers have really run in parallel */
+	EXPECT_GT(max_running.load(), 1U);
+	EXPECT_LE(max_running.load(), N_THREADS);
+
+	EXPECT_EQ(committed.size(), N_SONGS);
+	for (const auto &[name, n] : committed)
+		EXPECT_EQ(n, 1U) << name;
+
+	EXPECT_EQ(n_errors, N_SONGS / 10);
+	EXPECT_EQ(n_skipped, N_SONGS / 10);
+
+	std::vector<Song *> existing;
+
+	{
+		const ScopeDatabaseLock protect;
+		EXPECT_NE(root.FindSong("0.ogg"), nullptr);
+		EXPECT_EQ(root.FindSong("skip7.ogg"), nullptr);
+
+		for (auto &song : root.songs) {
+			song.mtime = std::chrono::system_clock::from_time_t(1);
+			existing.push_back(&song);
+		}
+	}
+
+	EXPECT_EQ(existing.size(), N_SONGS - 2 * N_SONGS / 10);
+
+	/* now update all existing songs */
+	for (Song *song : existing)
+		LoadSongFile(song, song->filename);
+
+	FlushScans();
+	EXPECT_EQ(n_updated, existing.size());
+
+	const ScopeDatabaseLock protect;
+	for (const auto &song : root.songs)
+		EXPECT_EQ(song.mtime,
+			  std::chrono::system_clock::from_time_t(2));
+}
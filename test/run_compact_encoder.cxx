@@ -0,0 +1,174 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program compares the size and the CPU cost of a
+ * "listallinfo"-like response in the traditional text encoding and
+ * in the "compact" encoding (#CompactEncoder).
+ */
+
+#include "client/CompactEncoder.hxx"
+#include "client/Response.hxx"
+#include "util/AllocatedString.hxx"
+#include "util/FormatString.hxx"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Collects the response, like #PoolBackgroundCommand does.
+ */
+struct StringSink final : ResponseSink {
+	std::string value;
+
+	bool Write(const void *data, size_t length) noexcept override {
+		value.append((const char *)data, length);
+		return true;
+	}
+};
+
+struct Field {
+	const char *key;
+	std::string value;
+};
+
+/**
+ * Generate the fields of a typical song (as printed by
+ * song_print_info()).
+ */
+static std::vector<Field>
+MakeSong(unsigned i)
+{
+	char buffer[256];
+	std::vector<Field> song;
+
+	snprintf(buffer, sizeof(buffer),
+		 "Artist %03u/Album %04u/%02u - Some Song Title %u.flac",
+		 i / 250, i / 12, i % 12 + 1, i);
+	song.push_back({"file", buffer});
+	song.push_back({"Last-Modified", "2020-11-06T12:34:56Z"});
+	song.push_back({"Format", "44100:16:2"});
+
+	snprintf(buffer, sizeof(buffer), "Artist %03u", i / 250);
+	song.push_back({"Artist", buffer});
+	song.push_back({"AlbumArtist", buffer});
+	snprintf(buffer, sizeof(buffer), "Album %04u", i / 12);
+	song.push_back({"Album", buffer});
+	snprintf(buffer, sizeof(buffer), "Some Song Title %u", i);
+	song.push_back({"Title", buffer});
+	snprintf(buffer, sizeof(buffer), "%u", i % 12 + 1);
+	song.push_back({"Track", buffer});
+	song.push_back({"Date", "1997"});
+	song.push_back({"Genre", "Rock"});
+	song.push_back({"Time", "245"});
+	song.push_back({"duration", "245.133"});
+	return song;
+}
+
+template<typename F>
+static void
+Measure(const char *name, const std::vector<std::vector<Field>> &songs,
+	unsigned n_loops, F &&f)
+{
+	std::size_t size = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < n_loops; ++i) {
+		StringSink sink;
+		ResponseSink &r = sink;
+		f(r, songs);
+		size = sink.value.size();
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	printf("%-8s %10zu bytes %8.1f ns/song\n", name, size,
+	       duration.count() * 1e9 / n_loops / songs.size());
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: run_compact_encoder [SONGS [LOOPS]]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n_songs = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 50000;
+	const unsigned n_loops = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 10;
+
+	std::vector<std::vector<Field>> songs;
+	songs.reserve(n_songs);
+	for (unsigned i = 0; i < n_songs; ++i)
+		songs.push_back(MakeSong(i));
+
+	/* what Response::Format() used to do for each line */
+	Measure("printf", songs, n_loops, [](ResponseSink &r,
+					      const auto &_songs){
+		for (const auto &song : _songs) {
+			for (const auto &field : song) {
+				const auto line =
+					FormatString("%s: %s\n", field.key,
+						     field.value.c_str());
+				r.Write(line.c_str(), strlen(line.c_str()));
+			}
+		}
+	});
+
+	/* the text path of Response::Field() */
+	Measure("text", songs, n_loops, [](ResponseSink &r,
+					    const auto &_songs){
+		for (const auto &song : _songs) {
+			for (const auto &field : song) {
+				r.Write(field.key, strlen(field.key));
+				r.Write(": ", 2);
+				r.Write(field.value.data(), field.value.size());
+				r.Write("\n", 1);
+			}
+		}
+	});
+
+	/* the compact path of Response::Field() */
+	Measure("compact", songs, n_loops, [](ResponseSink &r,
+					       const auto &_songs){
+		CompactEncoder encoder;
+		for (const auto &song : _songs) {
+			for (const auto &field : song) {
+				const auto header =
+					encoder.EncodeHeader(field.key,
+							     field.value.size());
+				r.Write(header.data(), header.size());
+				r.Write(field.value.data(), field.value.size());
+			}
+		}
+	});
+
+	return EXIT_SUCCESS;
+}
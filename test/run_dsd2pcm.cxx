@@ -0,0 +1,103 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the DSD-to-PCM converter
+ * (MultiDsd2Pcm) in megabytes of DSD input per second.
+ */
+
+#include "pcm/Dsd2Pcm.hxx"
+
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The number of frames passed to MultiDsd2Pcm in each call; this
+ * is roughly what the decoders pass.
+ */
+static constexpr size_t FRAMES_PER_CALL = 4096;
+
+template<typename T, typename F>
+static void
+Measure(const char *name, unsigned channels, size_t total_bytes,
+	const std::vector<uint8_t> &src, F &&f)
+{
+	std::vector<T> dest(src.size());
+
+	const size_t n_frames = src.size() / channels;
+
+	/* measure CPU time, not wall time, to reduce the noise caused
+	   by other processes */
+	const clock_t start = clock();
+
+	size_t done = 0;
+	while (done < total_bytes) {
+		f(channels, n_frames, src.data(), dest.data());
+		done += src.size();
+	}
+
+	const double duration = double(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%s, %u channels: %.1f MB/s\n", name, channels,
+	       done / duration / (1024 * 1024));
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 3) {
+		fprintf(stderr, "Usage: run_dsd2pcm [CHANNELS] [MEGABYTES]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned channels = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 2;
+	if (channels < 1 || channels > MAX_CHANNELS) {
+		fprintf(stderr, "Invalid number of channels\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t total_bytes = (argc > 2
+				    ? strtoul(argv[2], nullptr, 10)
+				    : 64) * 1024 * 1024;
+
+	std::vector<uint8_t> src(FRAMES_PER_CALL * channels);
+	std::minstd_rand rand;
+	for (auto &i : src)
+		i = rand();
+
+	MultiDsd2Pcm dsd2pcm;
+
+	Measure<float>("float", channels, total_bytes, src,
+		       [&dsd2pcm](auto... args){
+			       dsd2pcm.Translate(args...);
+		       });
+
+	Measure<int32_t>("S24", channels, total_bytes, src,
+			 [&dsd2pcm](auto... args){
+				 dsd2pcm.TranslateS24(args...);
+			 });
+
+	return EXIT_SUCCESS;
+}
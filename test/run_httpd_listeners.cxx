@@ -0,0 +1,169 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program connects many listeners to a "httpd" output and
+ * measures the throughput and, if the server's process id is given
+ * (Linux only), the server's CPU usage per listener.
+ */
+
+#include "net/Resolver.hxx"
+#include "net/AddressInfo.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/PrintException.hxx"
+#include "system/Error.hxx"
+
+#include <chrono>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Returns the CPU time (user + system) consumed by the given process
+ * so far, or a negative value on error.
+ */
+static double
+GetProcessCpuTime(unsigned pid) noexcept
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+
+	FILE *file = fopen(path, "r");
+	if (file == nullptr)
+		return -1;
+
+	char buffer[1024];
+	const size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+	fclose(file);
+	buffer[length] = 0;
+
+	/* skip the command name, which may contain spaces */
+	const char *p = strrchr(buffer, ')');
+	if (p == nullptr)
+		return -1;
+
+	/* utime and stime are fields 14 and 15; the fields after the
+	   command name start with field 3 */
+	unsigned long utime, stime;
+	if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		   &utime, &stime) != 2)
+		return -1;
+
+	return double(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static UniqueSocketDescriptor
+Connect(SocketAddress address, int family, bool metadata)
+{
+	UniqueSocketDescriptor fd;
+	if (!fd.Create(family, SOCK_STREAM, 0))
+		throw MakeErrno("Failed to create socket");
+
+	if (!fd.Connect(address))
+		throw MakeErrno("Failed to connect");
+
+	const std::string request = std::string("GET / HTTP/1.1\r\n") +
+		(metadata ? "Icy-MetaData: 1\r\n" : "") +
+		"\r\n";
+	if (fd.Write(request.data(), request.size()) != ssize_t(request.size()))
+		throw MakeErrno("Failed to send request");
+
+	fd.SetNonBlocking();
+	return fd;
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc < 3 || argc > 6) {
+		fprintf(stderr, "Usage: run_httpd_listeners HOST:PORT N [SECONDS] [PID] [icy]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n = strtoul(argv[2], nullptr, 10);
+	const unsigned seconds = argc > 3 ? strtoul(argv[3], nullptr, 10) : 10;
+	const unsigned pid = argc > 4 ? strtoul(argv[4], nullptr, 10) : 0;
+	const bool metadata = argc > 5 && strcmp(argv[5], "icy") == 0;
+
+	const auto addresses = Resolve(argv[1], 8000, 0, SOCK_STREAM);
+	const auto &address = addresses.GetBest();
+
+	std::vector<UniqueSocketDescriptor> sockets;
+	std::vector<struct pollfd> pfds;
+	sockets.reserve(n);
+	for (unsigned i = 0; i < n; ++i) {
+		sockets.emplace_back(Connect(address, address.GetFamily(),
+					     metadata));
+		pfds.push_back({sockets.back().Get(), POLLIN, 0});
+	}
+
+	const double cpu_start = pid > 0 ? GetProcessCpuTime(pid) : -1;
+	const auto start = std::chrono::steady_clock::now();
+	const auto end = start + std::chrono::seconds(seconds);
+
+	unsigned long long total = 0;
+	unsigned closed = 0;
+	static char buffer[65536];
+
+	while (closed < n && std::chrono::steady_clock::now() < end) {
+		if (poll(pfds.data(), pfds.size(), 100) < 0)
+			throw MakeErrno("poll() failed");
+
+		for (auto &pfd : pfds) {
+			if (pfd.revents == 0)
+				continue;
+
+			const ssize_t nbytes = read(pfd.fd, buffer,
+						    sizeof(buffer));
+			if (nbytes > 0) {
+				total += nbytes;
+			} else if (nbytes == 0) {
+				/* ignore this socket from now on */
+				pfd.fd = -1;
+				++closed;
+			}
+		}
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	printf("listeners:   %u (%u closed)\n", n, closed);
+	printf("throughput:  %.1f kB/s per listener\n",
+	       total / duration.count() / n / 1024);
+
+	if (cpu_start >= 0) {
+		const double cpu = GetProcessCpuTime(pid) - cpu_start;
+		printf("server CPU:  %.1f%%\n", cpu * 100 / duration.count());
+		printf("per listener: %.1f us CPU per second\n",
+		       cpu * 1e6 / duration.count() / n);
+	}
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
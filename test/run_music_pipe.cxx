@@ -0,0 +1,109 @@
+/*
+ * This program measures the throughput of MusicBuffer and MusicPipe:
+ * one thread allocates chunks and pushes them into the pipe, another
+ * one shifts them and returns them to the buffer.  The result is
+ * compared with the chunk rate needed to play the given audio format
+ * in real time, and the CPU time spent per second of audio is
+ * printed (to compare different chunk sizes).
+ */
+
+#include "MusicBuffer.hxx"
+#include "MusicChunk.hxx"
+#include "MusicPipe.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "pcm/AudioParser.hxx"
+#include "util/PrintException.hxx"
+#include "util/StringBuffer.hxx"
+
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int
+main(int argc, char **argv)
+try {
+	if (argc > 5) {
+		fprintf(stderr, "Usage: run_music_pipe [FORMAT] [NUM_CHUNKS] [BUFFER_CHUNKS] [CHUNK_SIZE]\n");
+		return EXIT_FAILURE;
+	}
+
+	const AudioFormat audio_format = argc > 1
+		? ParseAudioFormat(argv[1], false)
+		: AudioFormat(768000, SampleFormat::S32, 2);
+
+	const unsigned long n_chunks = argc > 2
+		? strtoul(argv[2], nullptr, 10)
+		: 1000000;
+
+	const unsigned buffer_chunks = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: 1024;
+
+	const std::size_t chunk_size = argc > 4
+		? strtoul(argv[4], nullptr, 10)
+		: CHUNK_SIZE;
+	if (chunk_size < CHUNK_SIZE || chunk_size > MAX_CHUNK_SIZE) {
+		fprintf(stderr, "Chunk size must be between %zu and %zu\n",
+			CHUNK_SIZE, MAX_CHUNK_SIZE);
+		return EXIT_FAILURE;
+	}
+
+	MusicBuffer buffer(buffer_chunks, chunk_size);
+	MusicPipe pipe;
+
+	const std::size_t frame_size = audio_format.GetFrameSize();
+	const std::size_t chunk_payload =
+		buffer.GetChunkCapacity() / frame_size * frame_size;
+	const double realtime_chunk_rate =
+		double(audio_format.TimeToSize(std::chrono::seconds(1))) /
+		chunk_payload;
+
+	const auto start = std::chrono::steady_clock::now();
+	const clock_t start_cpu = clock();
+
+	std::thread producer([&]{
+		for (unsigned long i = 0; i < n_chunks; ++i) {
+			MusicChunkPtr chunk;
+			while (!(chunk = buffer.Allocate()))
+				std::this_thread::yield();
+
+#ifndef NDEBUG
+			chunk->audio_format = audio_format;
+#endif
+			chunk->length = chunk_payload;
+			pipe.Push(std::move(chunk));
+		}
+	});
+
+	unsigned long n_received = 0;
+	while (n_received < n_chunks) {
+		if (pipe.Shift())
+			++n_received;
+		else
+			std::this_thread::yield();
+	}
+
+	producer.join();
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	const double cpu_time = double(clock() - start_cpu) / CLOCKS_PER_SEC;
+	const double chunk_rate = n_chunks / duration.count();
+	const double audio_seconds = n_chunks / realtime_chunk_rate;
+
+	printf("%lu chunks of %zu bytes in %.3f s: %.0f chunks/s\n",
+	       n_chunks, chunk_size, duration.count(), chunk_rate);
+	printf("%s needs %.0f chunks/s: %.1fx real time\n",
+	       ToString(audio_format).c_str(), realtime_chunk_rate,
+	       chunk_rate / realtime_chunk_rate);
+	printf("CPU time per second of audio: %.3f ms\n",
+	       cpu_time * 1000 / audio_seconds);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
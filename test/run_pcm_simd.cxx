@@ -0,0 +1,111 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the #PcmSimd kernels for
+ * each instruction set supported by this CPU.
+ */
+
+#include "pcm/Simd.hxx"
+#include "pcm/Volume.hxx"
+
+#include <chrono>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr size_t N = 4096;
+
+template<typename F>
+static void
+Measure(const char *kernel, const PcmSimd &simd, unsigned long n_loops,
+	F &&f)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < n_loops; ++i)
+		f(simd);
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	printf("%-16s %-8s %8.1f Msamples/s\n", kernel, simd.name,
+	       n_loops * N / duration.count() / 1e6);
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "Usage: run_pcm_simd [LOOPS]\n");
+		return EXIT_FAILURE;
+	}
+
+	const unsigned long n_loops = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: 10000;
+
+	std::vector<float> f1(N, 0.5f), f2(N, -0.25f);
+	std::vector<int16_t> s16(N, 1234);
+	std::vector<int32_t> s32(N, 123456);
+
+	for (auto level : {PcmSimdLevel::PORTABLE, PcmSimdLevel::SSE2,
+			   PcmSimdLevel::AVX2}) {
+		const auto *simd = GetPcmSimd(level);
+		if (simd == nullptr)
+			continue;
+
+		Measure("volume_float", *simd, n_loops, [&](const PcmSimd &s){
+			s.volume_float(f2.data(), f1.data(), N, 0.5f);
+		});
+
+		Measure("volume_16_to_24", *simd, n_loops, [&](const PcmSimd &s){
+			s.volume_16_to_24(s32.data(), s16.data(), N,
+					  PCM_VOLUME_1S / 2);
+		});
+
+		Measure("mix_float", *simd, n_loops, [&](const PcmSimd &s){
+			s.mix_float(f1.data(), f2.data(), N, 0.3f, 0.7f);
+		});
+
+		Measure("float_to_16", *simd, n_loops, [&](const PcmSimd &s){
+			s.float_to_16(s16.data(), f1.data(), N);
+		});
+
+		Measure("float_to_24", *simd, n_loops, [&](const PcmSimd &s){
+			s.float_to_24(s32.data(), f1.data(), N);
+		});
+
+		Measure("s16_to_float", *simd, n_loops, [&](const PcmSimd &s){
+			s.s16_to_float(f1.data(), s16.data(), N);
+		});
+
+		Measure("s32_to_float", *simd, n_loops, [&](const PcmSimd &s){
+			s.s32_to_float(f2.data(), s32.data(), N);
+		});
+
+		Measure("dot_float", *simd, n_loops, [&](const PcmSimd &s){
+			volatile float result = s.dot_float(f1.data(), f2.data(), N);
+			(void)result;
+		});
+	}
+
+	return EXIT_SUCCESS;
+}
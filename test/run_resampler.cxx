@@ -0,0 +1,174 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the quality (THD+N of a sine wave), the
+ * throughput and the latency of each Resample() call of the "sinc"
+ * resampler for each quality setting, optionally with the channels
+ * split to several threads (#ParallelPcmResampler).
+ */
+
+#include "SineAnalysis.hxx"
+#include "pcm/SincResampler.hxx"
+#include "pcm/ParallelResampler.hxx"
+#include "pcm/AudioFormat.hxx"
+#include "config/Block.hxx"
+#include "util/PrintException.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr double FREQUENCY = 997;
+
+struct Parameters {
+	unsigned channels = 2;
+	unsigned threads = 1;
+	std::size_t chunk_frames = 4096;
+};
+
+static PcmResampler *
+CreateSincResampler()
+{
+	return new SincPcmResampler();
+}
+
+static void
+Measure(const char *quality, unsigned in_rate, unsigned out_rate,
+	unsigned seconds, const Parameters &p)
+{
+	ConfigBlock block;
+	block.AddBlockParam("plugin", "sinc");
+	block.AddBlockParam("quality", quality);
+	pcm_resample_sinc_global_init(block);
+
+	const unsigned channels = p.channels;
+	const std::size_t n_frames = std::size_t(in_rate) * seconds;
+	std::vector<float> input(n_frames * channels);
+	GenerateSine(input.data(), n_frames, channels,
+		     FREQUENCY, in_rate, 0.5);
+
+	std::vector<float> output;
+	output.reserve((n_frames * out_rate / in_rate + 1) * channels);
+
+	std::unique_ptr<PcmResampler> resampler(p.threads > 1
+						? new ParallelPcmResampler(p.threads,
+									   CreateSincResampler)
+						: CreateSincResampler());
+	AudioFormat af(in_rate, SampleFormat::FLOAT, channels);
+	resampler->Open(af, out_rate);
+
+	using Clock = std::chrono::steady_clock;
+	Clock::duration max_latency{};
+	std::size_t n_calls = 0;
+
+	const auto start = Clock::now();
+
+	for (std::size_t i = 0; i < n_frames; i += p.chunk_frames) {
+		const std::size_t n = std::min(p.chunk_frames, n_frames - i);
+		const ConstBuffer<float> src(input.data() + i * channels,
+					     n * channels);
+
+		const auto call_start = Clock::now();
+		const auto result =
+			ConstBuffer<float>::FromVoid(resampler->Resample(src.ToVoid()));
+		max_latency = std::max(max_latency, Clock::now() - call_start);
+		++n_calls;
+
+		output.insert(output.end(), result.begin(), result.end());
+	}
+
+	while (true) {
+		const auto result =
+			ConstBuffer<float>::FromVoid(resampler->Flush());
+		if (result.IsNull())
+			break;
+
+		output.insert(output.end(), result.begin(), result.end());
+	}
+
+	const std::chrono::duration<double> duration = Clock::now() - start;
+
+	resampler->Close();
+
+	/* skip the first and the last 100 ms: the sine starts and
+	   stops abruptly, and the filter responds to that */
+	const std::size_t skip = out_rate / 10;
+	const double thd_n = MeasureThdN(output.data() + skip * channels,
+					 output.size() / channels - 2 * skip,
+					 channels,
+					 FREQUENCY, out_rate);
+
+	const std::chrono::duration<double, std::micro> max_us = max_latency;
+	printf("%6u -> %6u %-10s THD+N %7.1f dB %8.2f Mframes/s"
+	       " latency avg %7.1f us max %7.1f us\n",
+	       in_rate, out_rate, quality, thd_n,
+	       n_frames / duration.count() / 1e6,
+	       duration.count() * 1e6 / n_calls, max_us.count());
+}
+
+int
+main(int argc, char **argv)
+try {
+	if (argc != 1 && (argc < 3 || argc > 6)) {
+		fprintf(stderr, "Usage: run_resampler [IN_RATE OUT_RATE [CHANNELS [THREADS [CHUNK_FRAMES]]]]\n");
+		return EXIT_FAILURE;
+	}
+
+	Parameters p;
+	if (argc > 3)
+		p.channels = strtoul(argv[3], nullptr, 10);
+	if (argc > 4)
+		p.threads = strtoul(argv[4], nullptr, 10);
+	if (argc > 5)
+		p.chunk_frames = strtoul(argv[5], nullptr, 10);
+
+	static constexpr unsigned rates[][2] = {
+		{ 44100, 48000 },
+		{ 48000, 44100 },
+		{ 44100, 96000 },
+		{ 96000, 44100 },
+		{ 44100, 352800 },
+		{ 44056, 48000 },
+	};
+
+	static constexpr const char *qualities[] = {
+		"low", "medium", "high", "very high",
+	};
+
+	for (const char *quality : qualities) {
+		if (argc >= 3) {
+			Measure(quality, strtoul(argv[1], nullptr, 10),
+				strtoul(argv[2], nullptr, 10), 10, p);
+			continue;
+		}
+
+		for (const auto &i : rates)
+			Measure(quality, i[0], i[1], 10, p);
+	}
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
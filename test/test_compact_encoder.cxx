@@ -0,0 +1,91 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "client/CompactEncoder.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <stdio.h>
+#include <string.h>
+
+using std::string_literals::operator""s;
+
+static std::string
+Encode(CompactEncoder &e, const char *key, std::string_view value)
+{
+	const auto header = e.EncodeHeader(key, value.size());
+	if (header.empty())
+		return {};
+
+	return std::string(header) + std::string(value);
+}
+
+TEST(CompactEncoder, DefineOnce)
+{
+	CompactEncoder e;
+
+	EXPECT_EQ(Encode(e, "Artist", "foo"),
+		  "\x01\x00\x06" "Artist" "\x02\x00\x03" "foo"s);
+	EXPECT_EQ(Encode(e, "Artist", "bar"),
+		  "\x02\x00\x03" "bar"s);
+	EXPECT_EQ(Encode(e, "Title", ""),
+		  "\x01\x01\x05" "Title" "\x02\x01\x00"s);
+	EXPECT_EQ(Encode(e, "Title", "x"),
+		  "\x02\x01\x01" "x"s);
+}
+
+TEST(CompactEncoder, SameNameDifferentAddress)
+{
+	CompactEncoder e;
+
+	static constexpr char a[] = "file";
+	static constexpr char b[] = "file";
+
+	Encode(e, a, "x");
+	EXPECT_EQ(Encode(e, b, "y"), "\x02\x00\x01" "y"s);
+}
+
+TEST(CompactEncoder, LongValue)
+{
+	CompactEncoder e;
+	Encode(e, "k", "");
+
+	/* 300 = 0b10'0101100 */
+	const std::string value(300, 'v');
+	EXPECT_EQ(Encode(e, "k", value), "\x02\x00\xac\x02"s + value);
+}
+
+TEST(CompactEncoder, TableFull)
+{
+	static char keys[CompactEncoder::MAX_KEYS + 1][16];
+
+	CompactEncoder e;
+	for (unsigned i = 0; i < CompactEncoder::MAX_KEYS; ++i) {
+		snprintf(keys[i], sizeof(keys[i]), "k%u", i);
+		EXPECT_FALSE(Encode(e, keys[i], "v").empty());
+	}
+
+	strcpy(keys[CompactEncoder::MAX_KEYS], "overflow");
+	EXPECT_TRUE(Encode(e, keys[CompactEncoder::MAX_KEYS], "v").empty());
+
+	/* existing keys still work */
+	EXPECT_EQ(Encode(e, keys[0], "v"), "\x02\x00\x01" "v"s);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Stress test for the shared/exclusive #db_mutex: several reader
+ * threads call SimpleDatabase::Visit() (with the tag index, the
+ * filter pool and Directory::Walk()) while a writer thread modifies
+ * the tree and saves the database.
+ */
+
+#include "config.h"
+#include "MakeTag.hxx"
+#include "db/plugins/simple/SimpleDatabasePlugin.hxx"
+#include "db/plugins/simple/Directory.hxx"
+#include "db/plugins/simple/Song.hxx"
+#include "db/DatabaseLock.hxx"
+#include "db/Selection.hxx"
+#include "song/Filter.hxx"
+#include "song/LightSong.hxx"
+#include "config/Block.hxx"
+#include "lib/icu/Init.hxx"
+#include "tag/Type.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#ifdef ENABLE_UPNP
+#include "input/InputStream.hxx"
+size_t
+InputStream::LockRead(void *, size_t)
+{
+	return 0;
+}
+#endif
+
+/**
+ * The number of songs in the "stable" directory, which is never
+ * modified.  It is larger than the threshold for the filter pool.
+ */
+static constexpr unsigned N_STABLE = 5000;
+
+/**
+ * The number of songs which the writer adds to (and removes from)
+ * the "volatile" directory in each iteration.
+ */
+static constexpr unsigned N_VOLATILE = 100;
+
+static constexpr unsigned N_READERS = 3;
+static constexpr unsigned N_WRITER_ITERATIONS = 50;
+
+static void
+AddSongs(Directory &directory, const char *prefix, unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i) {
+		const std::string name = prefix + std::to_string(i) + ".ogg";
+		auto song = std::make_unique<Song>(name, directory);
+		song->tag = MakeTag(TAG_ARTIST, "Stable Artist",
+				    TAG_TITLE, name.c_str());
+		directory.AddSong(std::move(song));
+	}
+}
+
+static unsigned
+CountSongs(const Database &db, const char *uri, const SongFilter *filter)
+{
+	unsigned n = 0;
+	db.Visit(DatabaseSelection(uri, true, filter),
+		 {}, [&n](const LightSong &){ ++n; }, {});
+	return n;
+}
+
+class DatabaseLockTest : public ::testing::Test {
+	/* Directory::Sort() needs the collator */
+	const ScopeIcuInit icu_init;
+
+protected:
+	std::string path;
+
+	std::unique_ptr<SimpleDatabase> db;
+
+	void SetUp() override {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "/tmp/test_database_lock.%d",
+			 (int)getpid());
+		path = buffer;
+
+		ConfigBlock block;
+		block.AddBlockParam("path", path);
+		block.AddBlockParam("compress", "no");
+		block.AddBlockParam("threads", "4");
+
+		db = std::make_unique<SimpleDatabase>(block);
+		db->Open();
+
+		const ScopeDatabaseLock protect;
+		AddSongs(*db->GetRoot().MakeChild("stable"), "s", N_STABLE);
+	}
+
+	void TearDown() override {
+		db->Close();
+		db.reset();
+		unlink(path.c_str());
+	}
+};
+
+TEST_F(DatabaseLockTest, ConcurrentVisit)
+{
+	/* build the tag index */
+	db->Save();
+
+	/* exact match: answered by the tag index (if valid) */
+	const SongFilter exact(TAG_ARTIST, "Stable Artist");
+
+	/* case-folded substring: evaluated by the filter pool */
+	const SongFilter folded(TAG_ARTIST, "STABLE", true);
+
+	std::atomic_bool done{false};
+	std::atomic_uint errors{0}, visits{0};
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i < N_READERS; ++i) {
+		readers.emplace_back([&, i]{
+			const SongFilter *filters[] = {
+				&exact, &folded, nullptr,
+			};
+
+			unsigned j = i;
+			do {
+				const SongFilter *filter = filters[j++ % 3];
+
+				if (CountSongs(*db, "stable", filter) != N_STABLE)
+					++errors;
+
+				if (CountSongs(*db, "", filter) < N_STABLE)
+					++errors;
+
+				++visits;
+			} while (!done);
+		});
+	}
+
+	std::thread writer([&]{
+		for (unsigned i = 0; i < N_WRITER_ITERATIONS; ++i) {
+			{
+				const ScopeDatabaseLock protect;
+				Directory &directory =
+					*db->GetRoot().MakeChild("volatile");
+				AddSongs(directory, "v", N_VOLATILE);
+			}
+
+			if (i % 10 == 0)
+				/* prunes, sorts and rebuilds the
+				   tag index */
+				db->Save();
+
+			{
+				const ScopeDatabaseLock protect;
+				Directory &directory =
+					*db->GetRoot().MakeChild("volatile");
+				while (!directory.songs.empty())
+					directory.RemoveSong(&directory.songs.front());
+			}
+		}
+
+		done = true;
+	});
+
+	writer.join();
+	for (auto &i : readers)
+		i.join();
+
+	EXPECT_EQ(errors, 0U);
+	EXPECT_GT(visits, 0U);
+
+	db->Save();
+	EXPECT_EQ(CountSongs(*db, "", &exact), N_STABLE);
+	EXPECT_EQ(CountSongs(*db, "", &folded), N_STABLE);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef ENABLE_DSD
+
+#include "pcm/Dsd2Pcm.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+TEST(PcmTest, Dsd2PcmS24)
+{
+	/* generated with the original ring buffer implementation */
+	static constexpr int32_t expected[] = {
+		-39943, -39902, 2645, 668, -35404, -18246, 115451, 80963,
+		68118, -100715, -3615063, -1442365, -1342609, -159432, 2886091, 2239057,
+		1124442, -1443071, -559601, -4578775, 3222837, -443333, 1906881, 1675322,
+		-4319621, -1802811, -632483, -613754, 2598676, 286344, 4533705, -4123376,
+	};
+
+	uint8_t src[std::size(expected)];
+	for (unsigned i = 0; i < std::size(src); ++i)
+		src[i] = i * 37 + 5;
+
+	int32_t dest[std::size(expected)];
+	MultiDsd2Pcm dsd2pcm;
+	dsd2pcm.TranslateS24(2, std::size(src) / 2, src, dest);
+
+	for (unsigned i = 0; i < std::size(expected); ++i)
+		EXPECT_EQ(dest[i], expected[i]);
+}
+
+/**
+ * Converting in many small calls must produce the same output as
+ * converting everything at once, and each channel of a
+ * multi-channel stream must be converted like a mono stream.
+ */
+TEST(PcmTest, Dsd2PcmSplit)
+{
+	constexpr unsigned channels = 3;
+	constexpr size_t n_frames = Dsd2Pcm::BLOCK_SIZE * 3 + 17;
+
+	std::minstd_rand rand;
+	std::vector<uint8_t> src(n_frames * channels);
+	for (auto &i : src)
+		i = rand();
+
+	std::vector<float> expected(src.size());
+	MultiDsd2Pcm a;
+	a.Translate(channels, n_frames, src.data(), expected.data());
+
+	std::vector<float> actual(src.size());
+	MultiDsd2Pcm b;
+	for (size_t i = 0, n = 1; i < n_frames; i += n, n = n * 2 + 1) {
+		n = std::min(n, n_frames - i);
+		b.Translate(channels, n, &src[i * channels],
+			    &actual[i * channels]);
+	}
+
+	EXPECT_EQ(actual, expected);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		Dsd2Pcm mono;
+		std::vector<float> dest(n_frames);
+		mono.Translate(n_frames, &src[c], channels, dest.data(), 1);
+
+		for (size_t i = 0; i < n_frames; ++i)
+			EXPECT_EQ(dest[i], expected[i * channels + c]);
+	}
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SineAnalysis.hxx"
+#include "pcm/SincResampler.hxx"
+#include "pcm/ParallelResampler.hxx"
+#include "pcm/AudioFormat.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+static constexpr unsigned CHANNELS = 2;
+
+static PcmResampler *
+CreateSincResampler()
+{
+	return new SincPcmResampler();
+}
+
+/**
+ * Resample the whole input in chunks of the given size (in frames),
+ * including Flush().
+ */
+static std::vector<float>
+Resample(PcmResampler &resampler, unsigned in_rate, unsigned out_rate,
+	 unsigned channels,
+	 const std::vector<float> &input, std::size_t chunk_frames)
+{
+	AudioFormat af(in_rate, SampleFormat::FLOAT, channels);
+	const auto out_af = resampler.Open(af, out_rate);
+	EXPECT_EQ(af.format, SampleFormat::FLOAT);
+	EXPECT_EQ(out_af.sample_rate, out_rate);
+
+	std::vector<float> output;
+	const std::size_t n_frames = input.size() / channels;
+	for (std::size_t i = 0; i < n_frames; i += chunk_frames) {
+		const std::size_t n = std::min(chunk_frames, n_frames - i);
+		const ConstBuffer<float> src(input.data() + i * channels,
+					     n * channels);
+		const auto result =
+			ConstBuffer<float>::FromVoid(resampler.Resample(src.ToVoid()));
+		output.insert(output.end(), result.begin(), result.end());
+	}
+
+	while (true) {
+		const auto result =
+			ConstBuffer<float>::FromVoid(resampler.Flush());
+		if (result.IsNull())
+			break;
+
+		output.insert(output.end(), result.begin(), result.end());
+	}
+
+	resampler.Close();
+	return output;
+}
+
+static std::vector<float>
+Resample(unsigned in_rate, unsigned out_rate,
+	 const std::vector<float> &input, std::size_t chunk_frames)
+{
+	SincPcmResampler resampler;
+	return Resample(resampler, in_rate, out_rate, CHANNELS,
+			input, chunk_frames);
+}
+
+static void
+TestSine(unsigned in_rate, unsigned out_rate, double max_thd_n)
+{
+	const double frequency = 997;
+
+	std::vector<float> input(in_rate * CHANNELS);
+	GenerateSine(input.data(), in_rate, CHANNELS,
+		     frequency, in_rate, 0.5);
+
+	const auto output = Resample(in_rate, out_rate, input, 1000);
+	ASSERT_EQ(output.size() % CHANNELS, 0u);
+
+	/* one second of input yields one second of output */
+	const std::size_t n_frames = output.size() / CHANNELS;
+	EXPECT_GE(n_frames, out_rate - 1);
+	EXPECT_LE(n_frames, out_rate + 1);
+
+	/* the chunk size does not matter */
+	EXPECT_EQ(Resample(in_rate, out_rate, input, 1), output);
+	EXPECT_EQ(Resample(in_rate, out_rate, input, in_rate), output);
+
+	/* skip the beginning and the end where the sine starts and
+	   stops abruptly */
+	const std::size_t skip = out_rate / 10;
+	EXPECT_LT(MeasureThdN(output.data() + skip * CHANNELS,
+			      n_frames - 2 * skip, CHANNELS,
+			      frequency, out_rate),
+		  max_thd_n);
+}
+
+TEST(SincResampler, Upsample)
+{
+	TestSine(44100, 48000, -100);
+}
+
+TEST(SincResampler, Downsample)
+{
+	TestSine(96000, 44100, -100);
+}
+
+TEST(SincResampler, Interpolated)
+{
+	/* the reduced ratio has more phases than the table */
+	TestSine(44056, 48000, -100);
+}
+
+TEST(ParallelResampler, Sinc)
+{
+	/* not a multiple of the number of threads */
+	constexpr unsigned channels = 5;
+	constexpr unsigned in_rate = 44100, out_rate = 48000;
+
+	std::vector<float> input(in_rate * channels);
+	GenerateSine(input.data(), in_rate, channels, 997, in_rate, 0.5);
+
+	/* make the channels different */
+	for (std::size_t i = 0; i < input.size(); ++i)
+		input[i] *= 1.0f - 0.1f * (i % channels);
+
+	SincPcmResampler single;
+	const auto expected = Resample(single, in_rate, out_rate, channels,
+				       input, 4096);
+
+	ParallelPcmResampler parallel(3, CreateSincResampler);
+
+	/* large chunks are resampled by the worker threads, small
+	   ones by the calling thread; the result is the same */
+	for (std::size_t chunk_frames : {4096, 1}) {
+		EXPECT_EQ(Resample(parallel, in_rate, out_rate, channels,
+				   input, chunk_frames),
+			  expected);
+	}
+}
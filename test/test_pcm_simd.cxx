@@ -0,0 +1,186 @@
+/*
+ * Copyright 2003-2021 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "test_pcm_util.hxx"
+#include "pcm/Simd.hxx"
+#include "pcm/Volume.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+/* not a multiple of any vector size, to test the trailing samples */
+static constexpr size_t N = 1021;
+
+/**
+ * Random floats slightly outside [-1..1], to test clamping.
+ */
+struct RandomFloatClip : RandomFloat {
+	float operator()() {
+		return RandomFloat::operator()() * 1.25f;
+	}
+};
+
+/**
+ * Invoke the given function with each #PcmSimd implementation
+ * supported by this CPU (except the portable one).
+ */
+template<typename F>
+static void
+ForEachPcmSimd(F &&f)
+{
+	for (auto level : {PcmSimdLevel::SSE2, PcmSimdLevel::AVX2}) {
+		const auto *simd = GetPcmSimd(level);
+		if (simd == nullptr)
+			continue;
+
+		SCOPED_TRACE(simd->name);
+		f(*simd);
+	}
+}
+
+TEST(PcmSimdTest, Select)
+{
+	const auto &simd = SelectPcmSimd();
+	EXPECT_EQ(GetPcmSimd(simd.level), &simd);
+	EXPECT_EQ(GetPcmSimd(PcmSimdLevel::PORTABLE), &pcm_simd_portable);
+}
+
+TEST(PcmSimdTest, VolumeFloat)
+{
+	const TestDataBuffer<float, N> src{RandomFloatClip()};
+
+	float expected[N], actual[N];
+	for (float volume : {0.0f, 0.25f, 0.7f, 1.0f, 1.5f}) {
+		pcm_simd_portable.volume_float(expected, src, N, volume);
+
+		ForEachPcmSimd([&](const PcmSimd &simd){
+			simd.volume_float(actual, src, N, volume);
+			EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+		});
+	}
+}
+
+TEST(PcmSimdTest, Volume16To24)
+{
+	const TestDataBuffer<int16_t, N> src;
+
+	int32_t expected[N], actual[N];
+	for (int volume : {0, 1, PCM_VOLUME_1S / 3, PCM_VOLUME_1S,
+			   PCM_VOLUME_1S * 4, 40000}) {
+		pcm_simd_portable.volume_16_to_24(expected, src, N, volume);
+
+		ForEachPcmSimd([&](const PcmSimd &simd){
+			simd.volume_16_to_24(actual, src, N, volume);
+			EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+		});
+	}
+}
+
+TEST(PcmSimdTest, MixFloat)
+{
+	const TestDataBuffer<float, N> a{RandomFloatClip()};
+	const TestDataBuffer<float, N> b{RandomFloatClip()};
+
+	float expected[N], actual[N];
+
+	std::copy(a.begin(), a.end(), expected);
+	pcm_simd_portable.mix_float(expected, b, N, 0.3f, 0.7f);
+
+	ForEachPcmSimd([&](const PcmSimd &simd){
+		std::copy(a.begin(), a.end(), actual);
+		simd.mix_float(actual, b, N, 0.3f, 0.7f);
+		EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+	});
+
+	std::copy(a.begin(), a.end(), expected);
+	pcm_simd_portable.add_float(expected, b, N);
+
+	ForEachPcmSimd([&](const PcmSimd &simd){
+		std::copy(a.begin(), a.end(), actual);
+		simd.add_float(actual, b, N);
+		EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+	});
+}
+
+template<typename T>
+static void
+TestFromFloat(void (*PcmSimd::*kernel)(T *, const float *, size_t) noexcept)
+{
+	const TestDataBuffer<float, N> src{RandomFloatClip()};
+
+	T expected[N], actual[N];
+	(pcm_simd_portable.*kernel)(expected, src, N);
+
+	ForEachPcmSimd([&](const PcmSimd &simd){
+		(simd.*kernel)(actual, src, N);
+		EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+	});
+}
+
+TEST(PcmSimdTest, FloatToInteger)
+{
+	TestFromFloat(&PcmSimd::float_to_16);
+	TestFromFloat(&PcmSimd::float_to_24);
+	TestFromFloat(&PcmSimd::float_to_32);
+}
+
+template<typename T, typename G>
+static void
+TestToFloat(void (*PcmSimd::*kernel)(float *, const T *, size_t) noexcept,
+	    G g)
+{
+	const TestDataBuffer<T, N> src{g};
+
+	float expected[N], actual[N];
+	(pcm_simd_portable.*kernel)(expected, src, N);
+
+	ForEachPcmSimd([&](const PcmSimd &simd){
+		(simd.*kernel)(actual, src, N);
+		EXPECT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+	});
+}
+
+TEST(PcmSimdTest, IntegerToFloat)
+{
+	TestToFloat(&PcmSimd::s16_to_float, RandomInt<int16_t>());
+	TestToFloat(&PcmSimd::s24_to_float, RandomInt24());
+	TestToFloat(&PcmSimd::s32_to_float, RandomInt<int32_t>());
+}
+
+TEST(PcmSimdTest, DotFloat)
+{
+	const TestDataBuffer<float, N> a{RandomFloatClip()};
+	const TestDataBuffer<float, N> b{RandomFloatClip()};
+
+	/* the products are added in a different order, so the
+	   results are not exactly the same */
+	for (size_t n : {N, size_t(16), size_t(7), size_t(0)}) {
+		double expected = 0;
+		for (size_t i = 0; i < n; ++i)
+			expected += double(a[i]) * double(b[i]);
+
+		EXPECT_NEAR(pcm_simd_portable.dot_float(a, b, n),
+			    expected, 1e-3);
+
+		ForEachPcmSimd([&](const PcmSimd &simd){
+			EXPECT_NEAR(simd.dot_float(a, b, n), expected, 1e-3);
+		});
+	}
+}
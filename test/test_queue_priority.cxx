@@ -164,3 +164,38 @@ TEST(QueuePriority, Priority)
 	a_order = queue.PositionToOrder(a_position);
 	EXPECT_EQ(6u, a_order);
 }
+
+TEST(QueuePriority, Append)
+{
+	Queue queue(64);
+
+	for (unsigned i = 0; i < 16; ++i)
+		queue.Append(DetachedSong("x.ogg"), 0);
+
+	queue.SetPriorityRange(4, 8, 10, -1);
+
+	queue.random = true;
+	queue.ShuffleOrder();
+
+	/* append 32 songs at once; they must be shuffled only among
+	   the other priority=0 songs */
+
+	for (unsigned i = 0; i < 32; ++i)
+		queue.Append(DetachedSong("y.ogg"), 0);
+
+	queue.ShuffleOrderAppendedWithPriority(0, 16, queue.GetLength());
+	check_descending_priority(&queue, 0);
+
+	for (unsigned i = 4; i < 8; ++i)
+		EXPECT_LT(queue.PositionToOrder(i), 4u);
+
+	/* the order must still be a permutation */
+	bool seen[64]{};
+	for (unsigned order = 0; order < queue.GetLength(); ++order) {
+		const unsigned position = queue.OrderToPosition(order);
+		ASSERT_LT(position, queue.GetLength());
+		EXPECT_FALSE(seen[position]);
+		seen[position] = true;
+		EXPECT_EQ(order, queue.PositionToOrder(position));
+	}
+}